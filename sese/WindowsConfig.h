@@ -61,6 +61,7 @@
 #ifndef __MINGW32__
 /// Ignore case comparisons
 #define strcasecmp strcmpi
+#define strncasecmp strnicmp
 #endif
 
 #ifndef timegm
@@ -0,0 +1,65 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <sese/container/StrCaseMap.h>
+#include <sese/net/http/Header.h>
+
+/// Fields of a typical request, received in the order a browser sends them
+static const std::pair<std::string, std::string> FIELDS[] = {
+        {"Host", "localhost:8080"},
+        {"Connection", "keep-alive"},
+        {"User-Agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36"},
+        {"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8"},
+        {"Accept-Encoding", "gzip, deflate, br"},
+        {"Accept-Language", "en-US,en;q=0.9"},
+        {"Content-Type", "application/json; charset=utf-8"},
+        {"X-Request-Id", "7f3a9c2e-51d8-4b6f-9a0e-2c1d3b4a5e6f"},
+};
+
+/// Lookups made while handling a request
+static const std::string LOOKUPS[] = {"content-length", "connection", "expect", "content-type", "accept-encoding", "range"};
+
+/// The storage used before, a node per field
+static void BM_HeaderMap(benchmark::State &state) {
+    sese::StrCaseMap<std::string> headers;
+    for (auto _: state) {
+        for (auto &&[key, value]: FIELDS) {
+            headers[key] = value;
+        }
+        for (auto &&key: LOOKUPS) {
+            benchmark::DoNotOptimize(headers.find(key));
+        }
+        headers.clear();
+    }
+}
+
+static void BM_HeaderFlat(benchmark::State &state) {
+    sese::net::http::Header header;
+    for (auto _: state) {
+        for (auto &&[key, value]: FIELDS) {
+            header.set(key, value);
+        }
+        for (auto &&key: LOOKUPS) {
+            benchmark::DoNotOptimize(header.find(key));
+        }
+        header.clear();
+    }
+}
+
+BENCHMARK(BM_HeaderMap);
+BENCHMARK(BM_HeaderFlat);
+
+BENCHMARK_MAIN();
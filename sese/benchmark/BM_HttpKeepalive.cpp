@@ -0,0 +1,131 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <sese/net/Socket.h>
+#include <sese/net/http/Controller.h>
+#include <sese/service/http/HttpServer.h>
+#include <sese/util/Initializer.h>
+#include <sese/util/Random.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/// Heap allocations of the whole process, the client below does not allocate per request
+static std::atomic<uint64_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static constexpr char REQUEST[] = "GET /api/users/1024?fields=name HTTP/1.1\r\n"
+                                  "host: localhost\r\n"
+                                  "user-agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+                                  "accept: application/json, text/plain, */*\r\n"
+                                  "accept-encoding: identity\r\n"
+                                  "accept-language: en-US,en;q=0.9\r\n"
+                                  "x-request-id: 7f3a9c2e51d84b6f\r\n"
+                                  "connection: keep-alive\r\n"
+                                  "\r\n";
+
+/// Keepalive requests against a servlet answering a small JSON body, reporting the allocations per request
+static void BM_HttpKeepalive(benchmark::State &state) {
+    auto port = static_cast<uint16_t>(sese::net::createRandomPort());
+    sese::service::http::HttpServer server;
+    sese::net::http::Servlet servlet(sese::net::http::RequestType::GET, "/api/users/{id}");
+    servlet = [](sese::net::http::HttpServletContext &ctx) {
+        constexpr char BODY[] = R"({"id":1024,"name":"sese"})";
+        ctx.getResp().set("content-type", "application/json");
+        ctx.getResp().getBody().write(BODY, sizeof(BODY) - 1);
+    };
+    server.regServlet(servlet);
+    server.regService(sese::net::IPv4Address::localhost(port), nullptr);
+    server.setThreads(1);
+    if (!server.startup()) {
+        state.SkipWithError("failed to start the server");
+        return;
+    }
+
+    sese::net::Socket client(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    if (client.connect(sese::net::IPv4Address::localhost(port)) != 0) {
+        state.SkipWithError("failed to connect");
+        server.shutdown();
+        return;
+    }
+
+    char buffer[4096];
+    size_t response_length = 0;
+    auto round_trip = [&] {
+        client.write(REQUEST, sizeof(REQUEST) - 1);
+        size_t received = 0;
+        while (response_length == 0 || received < response_length) {
+            auto len = client.read(buffer + received, sizeof(buffer) - received);
+            if (len <= 0) {
+                return false;
+            }
+            received += len;
+            if (response_length == 0) {
+                // The response of the first round gives the length of the following ones
+                auto end = std::strstr(buffer, "\r\n\r\n");
+                auto length = std::strstr(buffer, "content-length: ");
+                if (end && length) {
+                    response_length = end - buffer + 4 + std::strtoul(length + 16, nullptr, 10);
+                }
+            }
+        }
+        return true;
+    };
+    // Warm up the connection so that only the steady state is measured
+    for (int i = 0; i < 16; ++i) {
+        round_trip();
+    }
+
+    auto before = allocations.load();
+    for (auto _: state) {
+        if (!round_trip()) {
+            state.SkipWithError("connection lost");
+            break;
+        }
+    }
+    state.counters["allocs/req"] = benchmark::Counter(
+            static_cast<double>(allocations.load() - before) / static_cast<double>(state.iterations())
+    );
+    client.close();
+    server.shutdown();
+}
+
+BENCHMARK(BM_HttpKeepalive);
+
+int main(int argc, char **argv) {
+    // The server logs through the core
+    sese::initCore(argc, argv);
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+#include <sese/net/http/HPACK.h>
+#include <sese/net/http/Huffman.h>
+
+#include <memory>
+
+using sese::net::http::HuffmanDecoder;
+using sese::net::http::HuffmanEncoder;
+
+/// Typical request and response header values
+static const std::vector<std::string> HEADERS = {
+        "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36",
+        "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+        "gzip, deflate, br",
+        "en-US,en;q=0.9",
+        "/api/v1/users/1024/profile?fields=name,email",
+        "session=7f3a9c2e51d84b6f; theme=dark; lang=en",
+        "Sat, 01 Apr 2023 14:57:33 GMT",
+        "\"63ea2d3e-18b4\"",
+        "max-age=0, no-cache",
+        "application/json; charset=utf-8",
+};
+
+/// Bit-at-a-time tree decoder, kept as the baseline
+class BitwiseDecoder {
+public:
+    BitwiseDecoder() {
+        nodes.push_back({});
+        for (size_t symbol = 0; symbol < sese::net::http::HUFFMAN_TABLE.size(); ++symbol) {
+            size_t current = 0;
+            for (auto bit: sese::net::http::HUFFMAN_TABLE[symbol]) {
+                auto &&child = bit ? nodes[current].right : nodes[current].left;
+                if (child == 0) {
+                    child = nodes.size();
+                    nodes.push_back({});
+                }
+                current = bit ? nodes[current].right : nodes[current].left;
+            }
+            nodes[current].code = static_cast<int16_t>(symbol);
+        }
+    }
+
+    std::optional<std::string> decode(const char *src, size_t len) const {
+        std::string dst;
+        size_t current = 0;
+        for (size_t idx = 0; idx < len; ++idx) {
+            for (int j = 7; j >= 0; --j) {
+                current = (src[idx] >> j & 1) ? nodes[current].right : nodes[current].left;
+                if (current == 0) {
+                    return std::nullopt;
+                }
+                if (nodes[current].code >= 0) {
+                    dst += static_cast<char>(nodes[current].code);
+                    current = 0;
+                }
+            }
+        }
+        return dst;
+    }
+
+private:
+    struct Node {
+        size_t left = 0;
+        size_t right = 0;
+        int16_t code = -1;
+    };
+
+    std::vector<Node> nodes;
+};
+
+static std::vector<std::vector<uint8_t>> encodeHeaders() {
+    HuffmanEncoder encoder;
+    std::vector<std::vector<uint8_t>> result;
+    for (auto &&header: HEADERS) {
+        result.emplace_back(encoder.encode(header));
+    }
+    return result;
+}
+
+static void BM_HuffmanDecodeTable(benchmark::State &state) {
+    HuffmanDecoder decoder;
+    auto encoded = encodeHeaders();
+    for (auto _: state) {
+        for (auto &&code: encoded) {
+            auto result = decoder.decode(reinterpret_cast<const char *>(code.data()), code.size());
+            benchmark::DoNotOptimize(result);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * encoded.size()));
+}
+
+static void BM_HuffmanDecodeBitwise(benchmark::State &state) {
+    BitwiseDecoder decoder;
+    auto encoded = encodeHeaders();
+    for (auto _: state) {
+        for (auto &&code: encoded) {
+            auto result = decoder.decode(reinterpret_cast<const char *>(code.data()), code.size());
+            benchmark::DoNotOptimize(result);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * encoded.size()));
+}
+
+static void BM_HuffmanEncode(benchmark::State &state) {
+    HuffmanEncoder encoder;
+    for (auto _: state) {
+        for (auto &&header: HEADERS) {
+            auto result = encoder.encode(header);
+            benchmark::DoNotOptimize(result);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * HEADERS.size()));
+}
+
+BENCHMARK(BM_HuffmanDecodeTable);
+BENCHMARK(BM_HuffmanDecodeBitwise);
+BENCHMARK(BM_HuffmanEncode);
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <sese/net/ws/WebsocketFrame.h>
+
+#include <string>
+
+static const uint8_t KEY[4] = {0x37, 0xFA, 0x21, 0x3D};
+
+/// The byte loop a straightforward decoder uses
+static void BM_UnmaskBytes(benchmark::State &state) {
+    std::string payload(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _: state) {
+        auto data = reinterpret_cast<uint8_t *>(payload.data());
+        for (size_t i = 0; i < payload.length(); ++i) {
+            data[i] ^= KEY[i & 3];
+        }
+        benchmark::DoNotOptimize(payload.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+static void BM_UnmaskVector(benchmark::State &state) {
+    std::string payload(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _: state) {
+        sese::net::ws::WebsocketFrame::unmask(payload.data(), payload.length(), KEY);
+        benchmark::DoNotOptimize(payload.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_UnmaskBytes)->Arg(125)->Arg(4096)->Arg(65536);
+BENCHMARK(BM_UnmaskVector)->Arg(125)->Arg(4096)->Arg(65536);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file MapNodePool.h
+/// \brief Recycles the nodes of a node-based map
+/// \date October 17, 2026
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace sese {
+
+/// \brief Keeps the nodes of the cleared entries of a map, so that filling it again does not allocate.
+/// The strings of a recycled node keep their capacity, which is what makes this worthwhile for maps of strings
+/// \tparam MAP std::map or std::unordered_map
+template<class MAP>
+class MapNodePool final {
+public:
+    using Map = MAP;
+    using NodeType = typename MAP::node_type;
+
+    /// Maximum number of nodes kept, the rest of a very large map is released
+    static constexpr size_t MAX_NODES = 64;
+
+    MapNodePool() = default;
+    ~MapNodePool() = default;
+    /// The nodes belong to the source, a copy starts empty
+    MapNodePool(const MapNodePool &) noexcept {}
+    MapNodePool &operator=(const MapNodePool &) noexcept { return *this; }
+    MapNodePool(MapNodePool &&) noexcept = default;
+    MapNodePool &operator=(MapNodePool &&) noexcept = default;
+
+    /// Remove all entries of the map, keeping their nodes
+    /// \param map Target map
+    void clear(Map &map) {
+        while (!map.empty() && nodes.size() < MAX_NODES) {
+            nodes.emplace_back(map.extract(map.begin()));
+        }
+        map.clear();
+    }
+
+    /// Insert or assign an entry, the key and the value are written into the strings of a recycled node
+    /// \param map Target map
+    /// \param fill Called with the key and the value to write, returns false to discard the entry
+    /// \return The result of fill
+    template<class FILL>
+    bool assign(Map &map, FILL &&fill) {
+        if (nodes.empty()) {
+            Map temp;
+            temp.emplace();
+            nodes.emplace_back(temp.extract(temp.begin()));
+        }
+        auto &&node = nodes.back();
+        if (!fill(node.key(), node.mapped())) {
+            return false;
+        }
+        auto iterator = map.find(node.key());
+        if (iterator != map.end()) {
+            // The replaced value goes back to the pool with its capacity
+            iterator->second.swap(node.mapped());
+            return true;
+        }
+        map.insert(std::move(node));
+        nodes.pop_back();
+        return true;
+    }
+
+    /// Insert or assign an entry of a map of strings
+    /// \param map Target map
+    /// \param key Key
+    /// \param value Value
+    void assign(Map &map, std::string_view key, std::string_view value) {
+        assign(map, [&](auto &node_key, auto &node_value) {
+            node_key.assign(key);
+            node_value.assign(value);
+            return true;
+        });
+    }
+
+    /// \return Number of nodes kept
+    [[nodiscard]] size_t size() const noexcept { return nodes.size(); }
+
+private:
+    std::vector<NodeType> nodes;
+};
+
+} // namespace sese
@@ -17,6 +17,12 @@
 
 using sese::text::StringBuilder;
 
+sese::db::QueryMetrics::QueryMetrics(const char *driver)
+    : queries(MetricsRegistry::getInstance()->counter("sese_db_queries_total", "Queries executed", {{"driver", driver}})),
+      errors(MetricsRegistry::getInstance()->counter("sese_db_query_errors_total", "Queries that failed", {{"driver", driver}})),
+      duration(MetricsRegistry::getInstance()->histogram("sese_db_query_duration_seconds", "Time spent executing a query", {{"driver", driver}}, 1e-6)) {
+}
+
 std::map<std::string, std::string> sese::db::tokenize(const char *p) noexcept {
     std::map<std::string, std::string> result;
 
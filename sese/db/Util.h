@@ -19,11 +19,47 @@
 
 #pragma once
 
+#include <sese/util/Metrics.h>
+
 #include <map>
 #include <string>
 
 namespace sese::db {
 
+    /// \brief Metrics of the queries of a driver, shared by its instances and prepared statements
+    struct QueryMetrics {
+        /// \param driver Driver name, exposed as a label
+        explicit QueryMetrics(const char *driver);
+
+        Counter &queries;
+        Counter &errors;
+        Histogram &duration;
+    };
+
+    /// \brief Measures a query until it goes out of scope, the query is counted as failed unless it succeeds
+    class QueryScope final {
+    public:
+        explicit QueryScope(QueryMetrics &metrics) noexcept : metrics(metrics), timer(metrics.duration) {
+            metrics.queries.inc();
+        }
+
+        ~QueryScope() noexcept {
+            if (!succeeded) {
+                metrics.errors.inc();
+            }
+        }
+
+        QueryScope(const QueryScope &) = delete;
+        QueryScope &operator=(const QueryScope &) = delete;
+
+        void succeed() noexcept { succeeded = true; }
+
+    private:
+        QueryMetrics &metrics;
+        Histogram::Timer timer;
+        bool succeeded = false;
+    };
+
     /// \brief Perform simple tokenization on a string
     /// \param string Target string
     /// \return Tokenization result
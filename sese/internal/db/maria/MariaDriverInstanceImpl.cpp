@@ -13,10 +13,13 @@
 // limitations under the License.
 
 #include <sese/internal/db/maria/MariaDriverInstanceImpl.h>
+#include <sese/db/Util.h>
 #include <sese/internal/db/maria/MariaResultSetImpl.h>
 
 using namespace sese::db;
 
+static sese::db::QueryMetrics metrics("maria");
+
 impl::MariaDriverInstanceImpl::MariaDriverInstanceImpl(MYSQL *conn) noexcept {
     this->conn = conn;
 }
@@ -26,17 +29,21 @@ impl::MariaDriverInstanceImpl::~MariaDriverInstanceImpl() noexcept {
 }
 
 ResultSet::Ptr impl::MariaDriverInstanceImpl::executeQuery(const char *sql) noexcept {
+    QueryScope scope(metrics);
     if (0 != mysql_query(conn, sql)) {
         return nullptr;
     }
     MYSQL_RES *result = mysql_store_result(conn);
+    scope.succeed();
     return std::make_unique<MariaResultSetImpl>(result);
 }
 
 int64_t impl::MariaDriverInstanceImpl::executeUpdate(const char *sql) noexcept {
+    QueryScope scope(metrics);
     if (0 != mysql_query(conn, sql)) {
         return -1;
     }
+    scope.succeed();
     return static_cast<long long>(mysql_affected_rows(conn));
 }
 
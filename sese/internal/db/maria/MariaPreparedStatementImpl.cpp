@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include <sese/internal/db/maria/MariaPreparedStatementImpl.h>
+#include <sese/db/Util.h>
 #include <sese/log/Marco.h>
 
+static sese::db::QueryMetrics metrics("maria");
+
 sese::db::impl::MariaPreparedStatementImpl::MariaPreparedStatementImpl(
         MYSQL_STMT *stmt,
         MYSQL_RES *meta,
@@ -104,6 +107,7 @@ void sese::db::impl::MariaPreparedStatementImpl::freeBindStruct(MYSQL_BIND *bind
 }
 
 sese::db::ResultSet::Ptr sese::db::impl::MariaPreparedStatementImpl::executeQuery() noexcept {
+    QueryScope scope(metrics);
     if (!meta) return nullptr;
 
     if (mysql_stmt_bind_param(stmt, this->param)) {
@@ -122,6 +126,7 @@ sese::db::ResultSet::Ptr sese::db::impl::MariaPreparedStatementImpl::executeQuer
     if (mysql_stmt_store_result(stmt)) {
         goto freeResult;
     }
+    scope.succeed();
     return std::make_unique<impl::MariaStmtResultSet>(stmt, result, meta->field_count);
 
 freeResult:
@@ -130,6 +135,7 @@ freeResult:
 }
 
 int64_t sese::db::impl::MariaPreparedStatementImpl::executeUpdate() noexcept {
+    QueryScope scope(metrics);
     if (mysql_stmt_bind_param(stmt, this->param)) {
         return -1;
     }
@@ -137,6 +143,7 @@ int64_t sese::db::impl::MariaPreparedStatementImpl::executeUpdate() noexcept {
     if (mysql_stmt_execute(stmt)) {
         return -1;
     }
+    scope.succeed();
     return static_cast<int64_t>(mysql_stmt_affected_rows(stmt));
 }
 
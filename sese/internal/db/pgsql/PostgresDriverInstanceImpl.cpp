@@ -13,11 +13,14 @@
 // limitations under the License.
 
 #include <sese/internal/db/pgsql/PostgresDriverInstanceImpl.h>
+#include <sese/db/Util.h>
 #include <sese/internal/db/pgsql/PostgresResultSetImpl.h>
 #include <sese/text/StringBuilder.h>
 
 using namespace sese::db;
 
+static sese::db::QueryMetrics metrics("postgres");
+
 impl::PostgresDriverInstanceImpl::PostgresDriverInstanceImpl(PGconn *conn) noexcept {
     this->conn = conn;
     auto status = PQstatus(conn);
@@ -38,6 +41,7 @@ impl::PostgresDriverInstanceImpl::~PostgresDriverInstanceImpl() noexcept {
 }
 
 ResultSet::Ptr impl::PostgresDriverInstanceImpl::executeQuery(const char *sql) noexcept {
+    QueryScope scope(metrics);
     if (result) {
         PQclear(result);
         result = nullptr;
@@ -55,11 +59,13 @@ ResultSet::Ptr impl::PostgresDriverInstanceImpl::executeQuery(const char *sql) n
         auto rt = std::make_unique<PostgresResultSetImpl>(result);
         error = 0;
         result = nullptr;
+        scope.succeed();
         return rt;
     }
 }
 
 int64_t impl::PostgresDriverInstanceImpl::executeUpdate(const char *sql) noexcept {
+    QueryScope scope(metrics);
     if (result) {
         PQclear(result);
         result = nullptr;
@@ -77,6 +83,7 @@ int64_t impl::PostgresDriverInstanceImpl::executeUpdate(const char *sql) noexcep
         error = 0;
         PQclear(result);
         result = nullptr;
+        scope.succeed();
         return rt;
     }
 }
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <sese/internal/db/pgsql/PostgresPreparedStatementImpl.h>
+#include <sese/db/Util.h>
 #include <sstream>
 #include <utility>
 
@@ -32,6 +33,8 @@
 #define TIMEOID 1083
 #endif
 
+static sese::db::QueryMetrics metrics("postgres");
+
 sese::db::impl::PostgresPreparedStatementImpl::PostgresPreparedStatementImpl(
         std::string stmt_name,
         std::string stmt_string,
@@ -113,6 +116,7 @@ bool sese::db::impl::PostgresPreparedStatementImpl::setDateTime(uint32_t index,
 }
 
 sese::db::ResultSet::Ptr sese::db::impl::PostgresPreparedStatementImpl::executeQuery() noexcept {
+    QueryScope scope(metrics);
     result = PQexecPrepared(conn, stmtName.c_str(), static_cast<int>(count), paramValues, nullptr, nullptr, 0);
     if (result == nullptr) {
         error = static_cast<int>(PQstatus(conn));
@@ -127,10 +131,12 @@ sese::db::ResultSet::Ptr sese::db::impl::PostgresPreparedStatementImpl::executeQ
     auto rt = std::make_unique<impl::PostgresResultSetImpl>(result);
     error = 0;
     result = nullptr;
+    scope.succeed();
     return rt;
 }
 
 int64_t sese::db::impl::PostgresPreparedStatementImpl::executeUpdate() noexcept {
+    QueryScope scope(metrics);
     result = PQexecPrepared(conn, stmtName.c_str(), static_cast<int>(count), paramValues, nullptr, nullptr, 0);
     if (result == nullptr) {
         error = static_cast<int>(PQstatus(conn));
@@ -146,6 +152,7 @@ int64_t sese::db::impl::PostgresPreparedStatementImpl::executeUpdate() noexcept
     PQclear(result);
     result = nullptr;
     error = 0;
+    scope.succeed();
     return RT;
 }
 
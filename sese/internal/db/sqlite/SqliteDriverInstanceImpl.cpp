@@ -13,10 +13,13 @@
 // limitations under the License.
 
 #include <sese/internal/db/sqlite/SqliteDriverInstanceImpl.h>
+#include <sese/db/Util.h>
 #include <sese/internal/db/sqlite/SqliteResultSetImpl.h>
 
 using namespace sese::db;
 
+static sese::db::QueryMetrics metrics("sqlite");
+
 impl::SqliteDriverInstanceImpl::SqliteDriverInstanceImpl(sqlite3 *conn) noexcept {
     this->conn = conn;
 }
@@ -26,20 +29,24 @@ impl::SqliteDriverInstanceImpl::~SqliteDriverInstanceImpl() noexcept {
 }
 
 ResultSet::Ptr impl::SqliteDriverInstanceImpl::executeQuery(const char *sql) noexcept {
+    QueryScope scope(metrics);
     int rows;
     int columns;
     char **table;
     char *error = nullptr;
     int rt = sqlite3_get_table(conn, sql, &table, &rows, &columns, &error);
     if (0 != rt) return nullptr;
+    scope.succeed();
     return std::make_unique<SqliteResultSetImpl>(table, static_cast<size_t>(rows), static_cast<size_t>(columns), error);
 }
 
 int64_t impl::SqliteDriverInstanceImpl::executeUpdate(const char *sql) noexcept {
+    QueryScope scope(metrics);
     char *error = nullptr;
     auto rt = sqlite3_exec(conn, sql, nullptr, nullptr, &error);
     if (error) sqlite3_free(error);
     if (rt == 0) {
+        scope.succeed();
         return sqlite3_changes(conn);
     } else {
         return -1;
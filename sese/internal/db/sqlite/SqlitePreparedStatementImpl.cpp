@@ -13,9 +13,12 @@
 // limitations under the License.
 
 #include <sese/internal/db/sqlite/SqlitePreparedStatementImpl.h>
+#include <sese/db/Util.h>
 
 using namespace sese::db;
 
+static sese::db::QueryMetrics metrics("sqlite");
+
 const char *impl::SqlitePreparedStatementImpl::INTEGER_AFFINITY_SET[9]{
         "INT",
         "INTEGER",
@@ -85,10 +88,12 @@ impl::SqlitePreparedStatementImpl::~SqlitePreparedStatementImpl() noexcept {
 }
 
 ResultSet::Ptr impl::SqlitePreparedStatementImpl::executeQuery() noexcept {
+    QueryScope scope(metrics);
     auto rt = sqlite3_step(stmt);
     if (rt == SQLITE_ROW || rt == SQLITE_DONE) {
         sqlite3_reset(stmt);
         this->stmtStatus = true;
+        scope.succeed();
         return std::make_unique<SqliteStmtResultSetImpl>(stmt);
     } else {
         return nullptr;
@@ -96,9 +101,11 @@ ResultSet::Ptr impl::SqlitePreparedStatementImpl::executeQuery() noexcept {
 }
 
 int64_t impl::SqlitePreparedStatementImpl::executeUpdate() noexcept {
+    QueryScope scope(metrics);
     if (SQLITE_DONE == sqlite3_step(stmt)) {
         auto conn = sqlite3_db_handle(stmt);
         this->stmtStatus = true;
+        scope.succeed();
         return sqlite3_changes(conn);
     } else {
         return -1;
@@ -80,49 +80,48 @@ public:
     void start() noexcept {
         auto proc = [this]() {
             fd_set set;
-            struct timeval timeout {
-                1, 0
-            };
-            char buffer[1024];
+            // Events are variable-length, keep the buffer aligned for inotify_event
+            alignas(inotify_event) char buffer[4096];
+            std::string from_string;
             while (!is_shutdown) {
+                // select may modify the timeout, so it has to be reset every round
+                struct timeval timeout {
+                    1, 0
+                };
                 FD_ZERO(&set);
                 FD_SET(inotify_fd, &set);
                 select(FD_SETSIZE, &set, nullptr, nullptr, &timeout);
                 if (FD_ISSET(inotify_fd, &set)) {
-                    auto p_event = (inotify_event *) &buffer;
                     auto len = read(inotify_fd, buffer, sizeof(buffer));
-                    auto times = (len / sizeof(inotify_event)) - 1;
-                    char *from_string = nullptr;
-                    while (times) {
-                        if (p_event->wd != watch_fd) {
-                            p_event++;
-                            times--;
+                    if (len <= 0) {
+                        continue;
+                    }
+                    for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event *>(ptr)->len) {
+                        auto p_event = reinterpret_cast<inotify_event *>(ptr);
+                        if (p_event->wd != watch_fd || p_event->len == 0) {
                             continue;
-                        } else {
-                            if (p_event->mask & IN_CREATE) {
-                                if (on_create) {
-                                    on_create({p_event->name});
-                                }
-                            } else if (p_event->mask & IN_MODIFY) {
-                                if (on_modify) {
-                                    on_modify({p_event->name});
-                                }
-                            } else if (p_event->mask & IN_DELETE) {
-                                if (on_delete) {
-                                    on_delete({p_event->name});
-                                }
-                            } else if (p_event->mask & IN_MOVED_FROM) {
-                                from_string = p_event->name;
-                            } else if (p_event->mask & IN_MOVED_TO) {
-                                if (from_string) {
-                                    if (on_move) {
-                                        on_move({from_string}, {p_event->name});
-                                    }
-                                    from_string = nullptr;
+                        }
+                        if (p_event->mask & IN_CREATE) {
+                            if (on_create) {
+                                on_create({p_event->name});
+                            }
+                        } else if (p_event->mask & IN_MODIFY) {
+                            if (on_modify) {
+                                on_modify({p_event->name});
+                            }
+                        } else if (p_event->mask & IN_DELETE) {
+                            if (on_delete) {
+                                on_delete({p_event->name});
+                            }
+                        } else if (p_event->mask & IN_MOVED_FROM) {
+                            from_string = p_event->name;
+                        } else if (p_event->mask & IN_MOVED_TO) {
+                            if (!from_string.empty()) {
+                                if (on_move) {
+                                    on_move({from_string}, {p_event->name});
                                 }
+                                from_string.clear();
                             }
-                            times--;
-                            p_event++;
                         }
                     }
                 }
@@ -0,0 +1,192 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/net/AsioSSLDirect.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <cerrno>
+
+using sese::internal::net::AsioSSLDirect;
+
+bool AsioSSLDirect::attach(Stream &stream) {
+    asio::error_code error;
+    stream.next_layer().native_non_blocking(true, error);
+    if (error) {
+        return false;
+    }
+    auto bio = BIO_new_socket(static_cast<int>(stream.next_layer().native_handle()), BIO_NOCLOSE);
+    if (bio == nullptr) {
+        return false;
+    }
+    // asio passes the same memory BIO for both directions, only the writing side is replaced
+    SSL_set0_wbio(stream.native_handle(), bio);
+    return true;
+}
+
+bool AsioSSLDirect::isAttached(Stream &stream) {
+    auto ssl = stream.native_handle();
+    return SSL_get_wbio(ssl) != SSL_get_rbio(ssl);
+}
+
+bool AsioSSLDirect::isOffloaded([[maybe_unused]] Stream &stream) {
+#ifndef OPENSSL_NO_KTLS
+    return isAttached(stream) && BIO_get_ktls_send(SSL_get_wbio(stream.native_handle()));
+#else
+    return false;
+#endif
+}
+
+asio::error_code AsioSSLDirect::toError(Stream &stream, int result, asio::socket_base::wait_type &wait) {
+    auto error = errno;
+    switch (SSL_get_error(stream.native_handle(), result)) {
+        case SSL_ERROR_WANT_WRITE:
+            wait = asio::socket_base::wait_write;
+            return {};
+        case SSL_ERROR_WANT_READ:
+            // A post-handshake message such as a KeyUpdate must be read first, the socket stays writable meanwhile
+            wait = asio::socket_base::wait_read;
+            return {};
+        case SSL_ERROR_ZERO_RETURN:
+            return asio::error::eof;
+        case SSL_ERROR_SYSCALL:
+            if (error) {
+                return {error, asio::error::get_system_category()};
+            }
+            return asio::error::connection_reset;
+        default: {
+            auto code = ERR_get_error();
+            if (code == 0) {
+                return asio::ssl::error::unexpected_result;
+            }
+            return {static_cast<int>(code), asio::error::get_ssl_category()};
+        }
+    }
+}
+
+void AsioSSLDirect::write(const SharedStream &stream, const char *buffer, size_t length, const Callback &callback) {
+    auto ssl = stream->native_handle();
+    size_t budget = WRITE_BUDGET;
+    auto wait = asio::socket_base::wait_write;
+    while (length && budget) {
+        size_t wrote = 0;
+        ERR_clear_error();
+        errno = 0;
+        // A retried write may be longer than the one that failed, as asio enables partial writes
+        auto result = SSL_write_ex(ssl, buffer, std::min(length, budget), &wrote);
+        if (result == 1) {
+            buffer += wrote;
+            length -= wrote;
+            budget -= wrote;
+            continue;
+        }
+        auto error = toError(*stream, result, wait);
+        if (error) {
+            callback(error);
+            return;
+        }
+        break;
+    }
+    if (length == 0) {
+        callback({});
+        return;
+    }
+    // Wait until the socket is ready again or the loop has handled others
+    stream->next_layer().async_wait(wait, [stream, buffer, length, callback](const asio::error_code &error) {
+        if (error) {
+            callback(error);
+            return;
+        }
+        write(stream, buffer, length, callback);
+    });
+}
+
+void AsioSSLDirect::write(const SharedStream &stream, const std::vector<asio::const_buffer> &buffers, const Callback &callback) {
+    write(stream, std::make_shared<std::vector<asio::const_buffer>>(buffers), 0, callback);
+}
+
+void AsioSSLDirect::write(const SharedStream &stream, const std::shared_ptr<std::vector<asio::const_buffer>> &buffers, size_t index, const Callback &callback) {
+    if (index == buffers->size()) {
+        callback({});
+        return;
+    }
+    auto &&buffer = (*buffers)[index];
+    write(stream, static_cast<const char *>(buffer.data()), buffer.size(), [stream, buffers, index, callback](const asio::error_code &error) {
+        if (error) {
+            callback(error);
+            return;
+        }
+        write(stream, buffers, index + 1, callback);
+    });
+}
+
+bool AsioSSLDirect::sendFile([[maybe_unused]] const SharedStream &stream, [[maybe_unused]] int fd, [[maybe_unused]] int64_t offset, [[maybe_unused]] size_t length, [[maybe_unused]] const Callback &callback) {
+#if !defined(OPENSSL_NO_KTLS) && OPENSSL_VERSION_NUMBER >= 0x30000000L
+    if (!isOffloaded(*stream)) {
+        return false;
+    }
+    doSendFile(stream, fd, offset, length, callback);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AsioSSLDirect::doSendFile([[maybe_unused]] const SharedStream &stream, [[maybe_unused]] int fd, [[maybe_unused]] int64_t offset, [[maybe_unused]] size_t length, [[maybe_unused]] const Callback &callback) {
+#if !defined(OPENSSL_NO_KTLS) && OPENSSL_VERSION_NUMBER >= 0x30000000L
+    auto ssl = stream->native_handle();
+    size_t budget = WRITE_BUDGET;
+    auto wait = asio::socket_base::wait_write;
+    while (length && budget) {
+        ERR_clear_error();
+        errno = 0;
+        auto wrote = SSL_sendfile(ssl, fd, static_cast<off_t>(offset), std::min(length, budget), 0);
+        if (wrote > 0) {
+            offset += wrote;
+            length -= wrote;
+            budget -= wrote;
+            continue;
+        }
+        if (wrote == 0) {
+            // The file has been truncated
+            callback(asio::error::eof);
+            return;
+        }
+        auto error = toError(*stream, static_cast<int>(wrote), wait);
+        if (error) {
+            callback(error);
+            return;
+        }
+        break;
+    }
+    if (length == 0) {
+        callback({});
+        return;
+    }
+    stream->next_layer().async_wait(wait, [stream, fd, offset, length, callback](const asio::error_code &error) {
+        if (error) {
+            callback(error);
+            return;
+        }
+        doSendFile(stream, fd, offset, length, callback);
+    });
+#endif
+}
+
+void AsioSSLDirect::shutdown(Stream &stream) {
+    ERR_clear_error();
+    SSL_shutdown(stream.native_handle());
+}
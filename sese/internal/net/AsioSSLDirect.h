@@ -0,0 +1,77 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <asio.hpp>
+#include <asio/ssl/stream.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sese::internal::net {
+
+/// Helpers writing to an asio::ssl::stream directly through its socket.
+/// asio feeds OpenSSL through a memory BIO, which keeps the record encryption in user space,
+/// while OpenSSL can only offload it to the kernel (kTLS) when it writes to the socket itself.
+/// Reads still go through the stream
+struct AsioSSLDirect {
+    using Stream = asio::ssl::stream<asio::ip::tcp::socket>;
+    using SharedStream = std::shared_ptr<Stream>;
+    using Callback = std::function<void(const asio::error_code &error)>;
+
+    /// The maximum number of bytes written in one turn of the loop, so that a fast peer cannot monopolize it
+    static constexpr size_t WRITE_BUDGET = 4 * 1024 * 1024;
+
+    /// Make OpenSSL write to the socket of the stream, must be called before the handshake.
+    /// The output of the stream must then be written by write and sendFile only
+    /// @param stream Stream whose context enables SSL_OP_ENABLE_KTLS
+    /// @return false if the socket cannot be attached, the stream is left unchanged
+    static bool attach(Stream &stream);
+
+    /// @return Whether attach succeeded on the stream
+    static bool isAttached(Stream &stream);
+
+    /// @param stream Stream after the handshake
+    /// @return Whether the kernel encrypts the records sent
+    static bool isOffloaded(Stream &stream);
+
+    /// Write the whole buffer, the buffer must stay valid until the callback is called
+    static void write(const SharedStream &stream, const char *buffer, size_t length, const Callback &callback);
+
+    /// Write the buffers one after another
+    static void write(const SharedStream &stream, const std::vector<asio::const_buffer> &buffers, const Callback &callback);
+
+    /// Send a file range with SSL_sendfile, which requires the records to be encrypted by the kernel
+    /// @return false if the stream is not offloaded, nothing is sent
+    static bool sendFile(const SharedStream &stream, int fd, int64_t offset, size_t length, const Callback &callback);
+
+    /// Send close_notify without waiting, a stream whose socket is full is closed without it
+    static void shutdown(Stream &stream);
+
+private:
+    /// Map the result of a failed OpenSSL write
+    /// @param stream Stream
+    /// @param result Result of the write
+    /// @param wait Set to the readiness to wait for when the write should be retried
+    /// @return Empty if the socket should be waited for
+    static asio::error_code toError(Stream &stream, int result, asio::socket_base::wait_type &wait);
+
+    static void write(const SharedStream &stream, const std::shared_ptr<std::vector<asio::const_buffer>> &buffers, size_t index, const Callback &callback);
+
+    static void doSendFile(const SharedStream &stream, int fd, int64_t offset, size_t length, const Callback &callback);
+};
+
+} // namespace sese::internal::net
@@ -19,7 +19,16 @@
 
 using sese::internal::net::service::dns::DnsService;
 
-DnsService::DnsService() : socket(io_service), buffer(), running(false) {
+DnsService::DnsService()
+    : socket(io_service),
+      buffer(),
+      running(false),
+      requests(MetricsRegistry::getInstance()->counter("sese_dns_requests_total", "Requests received by the DNS service")),
+      invalid_requests(MetricsRegistry::getInstance()->counter("sese_dns_invalid_requests_total", "Requests that could not be decoded")),
+      local_answers(MetricsRegistry::getInstance()->counter("sese_dns_questions_answered_total", "Questions answered", {{"source", "local"}})),
+      upstream_answers(MetricsRegistry::getInstance()->counter("sese_dns_questions_answered_total", "Questions answered", {{"source", "upstream"}})),
+      upstream_failures(MetricsRegistry::getInstance()->counter("sese_dns_upstream_failures_total", "Questions the upstream name servers did not resolve")),
+      upstream_duration(MetricsRegistry::getInstance()->histogram("sese_dns_upstream_duration_seconds", "Time spent resolving a question upstream", {}, 1e-6)) {
 }
 
 int DnsService::getLastError() {
@@ -94,8 +103,10 @@ void DnsService::handle() {
             }
             continue;
         }
+        requests.inc();
         auto recv_package = sese::net::dns::DnsPackage::decode(buffer.data(), length);
         if (!recv_package) {
+            invalid_requests.inc();
             continue;
         }
         auto flags = sese::net::dns::DnsPackage::Flags();
@@ -158,6 +169,7 @@ void DnsService::handleBySelf(
                 answers.push_back(std::move(answer));
                 send_package->getQuestions().push_back(*q_iterator);
                 q_iterator = questions.erase(q_iterator);
+                local_answers.inc();
                 continue;
             }
         } else if (type == sese::net::dns::TYPE_AAAA) {
@@ -170,6 +182,7 @@ void DnsService::handleBySelf(
                 answers.push_back(std::move(answer));
                 send_package->getQuestions().push_back(*q_iterator);
                 q_iterator = questions.erase(q_iterator);
+                local_answers.inc();
                 continue;
             }
         }
@@ -187,8 +200,13 @@ void DnsService::handleByUpstream(
         auto &&name = q_iterator->name;
         auto &&type = q_iterator->type;
         auto &&class_ = q_iterator->class_;
-        auto ips = resolver.resolve(name, type);
+        std::vector<sese::net::IPAddress::Ptr> ips;
+        {
+            auto timer = upstream_duration.time();
+            ips = resolver.resolve(name, type);
+        }
         if (ips.empty()) {
+            upstream_failures.inc();
             ++q_iterator;
             continue;
         }
@@ -218,6 +236,7 @@ void DnsService::handleByUpstream(
             }
         }
         if (handled) {
+            upstream_answers.inc();
             send_package->getQuestions().push_back(*q_iterator);
             q_iterator = questions.erase(q_iterator);
         } else {
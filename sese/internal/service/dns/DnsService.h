@@ -24,6 +24,7 @@
 #include <sese/net/dns/Resolver.h>
 #include <sese/net/dns/DnsPackage.h>
 #include <sese/thread/Thread.h>
+#include <sese/util/Metrics.h>
 
 #include <asio.hpp>
 
@@ -42,6 +43,13 @@ class DnsService final : public sese::service::Service {
     std::map<std::string, sese::net::IPv4Address::Ptr> v4map;
     std::map<std::string, sese::net::IPv6Address::Ptr> v6map;
 
+    Counter &requests;
+    Counter &invalid_requests;
+    Counter &local_answers;
+    Counter &upstream_answers;
+    Counter &upstream_failures;
+    Histogram &upstream_duration;
+
     void handleBySelf(
         std::vector<sese::net::dns::DnsPackage::Question> &questions,
         sese::net::dns::DnsPackage::Ptr &send_package
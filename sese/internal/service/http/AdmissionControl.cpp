@@ -0,0 +1,116 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/service/http/AdmissionControl.h>
+
+#include <functional>
+
+using sese::internal::service::http::AdmissionControl;
+
+AdmissionControl::Ticket &AdmissionControl::Ticket::operator=(Ticket &&other) noexcept {
+    if (this != &other) {
+        release();
+        in_flight = other.in_flight;
+        other.in_flight = nullptr;
+    }
+    return *this;
+}
+
+void AdmissionControl::Ticket::release() noexcept {
+    if (in_flight) {
+        in_flight->fetch_sub(1, std::memory_order_relaxed);
+        in_flight = nullptr;
+    }
+}
+
+AdmissionControl::AdmissionControl(const sese::service::http::HttpService::AdmissionOptions &options)
+    : max_in_flight(options.max_in_flight),
+      max_queue_delay(static_cast<uint64_t>(options.max_queue_delay) * 1000),
+      rate_limited(MetricsRegistry::getInstance()->counter(
+              "sese_http_rejected_requests_total", "Requests rejected before their body was read", {{"reason", "rate_limit"}}
+      )),
+      overloaded(MetricsRegistry::getInstance()->counter(
+              "sese_http_rejected_requests_total", "Requests rejected before their body was read", {{"reason", "overload"}}
+      )) {
+    if (options.client.rate > 0) {
+        client_limiter = std::make_unique<RateLimiter>(options.client.rate, options.client.burst);
+    }
+    for (auto &&[uri_prefix, limit]: options.routes) {
+        if (limit.rate > 0 && route_router.insertPrefix(uri_prefix, route_limiters.size())) {
+            route_limiters.emplace_back(std::make_unique<RateLimiter>(limit.rate, limit.burst));
+        }
+    }
+}
+
+bool AdmissionControl::admit(const sese::net::IPAddress::Ptr &address, const sese::net::http::Request &req, sese::net::http::Response &resp, ThreadPool *worker_pool, Ticket &ticket) {
+    // Shedding comes first, a request rejected for overload does not use up the tokens of its client
+    if (max_queue_delay && queue_delay.load(std::memory_order_relaxed) > max_queue_delay && worker_pool && worker_pool->size()) {
+        overloaded.inc();
+        reject(resp, 503, 0);
+        return false;
+    }
+    if (max_in_flight) {
+        if (in_flight.fetch_add(1, std::memory_order_relaxed) >= max_in_flight) {
+            in_flight.fetch_sub(1, std::memory_order_relaxed);
+            overloaded.inc();
+            reject(resp, 503, 0);
+            return false;
+        }
+        ticket = Ticket();
+        ticket.in_flight = &in_flight;
+    }
+
+    if (!client_limiter && route_limiters.empty()) {
+        return true;
+    }
+    auto hash = hashAddress(address);
+    uint64_t retry_after = 0;
+    if (client_limiter && !client_limiter->tryAcquire(hash, &retry_after)) {
+        ticket.release();
+        rate_limited.inc();
+        reject(resp, 429, retry_after);
+        return false;
+    }
+    auto id = route_limiters.empty() ? sese::net::http::Router::NPOS : route_router.matchLongestPrefix(req.getUri());
+    if (id != sese::net::http::Router::NPOS && !route_limiters[id]->tryAcquire(hash, &retry_after)) {
+        ticket.release();
+        rate_limited.inc();
+        reject(resp, 429, retry_after);
+        return false;
+    }
+    return true;
+}
+
+uint64_t AdmissionControl::hashAddress(const sese::net::IPAddress::Ptr &address) noexcept {
+    if (!address) {
+        return 0;
+    }
+    auto raw = address->getRawAddress();
+    std::string_view host;
+    if (raw->sa_family == AF_INET) {
+        auto in = reinterpret_cast<const sockaddr_in *>(raw);
+        host = {reinterpret_cast<const char *>(&in->sin_addr), sizeof(in->sin_addr)};
+    } else if (raw->sa_family == AF_INET6) {
+        auto in6 = reinterpret_cast<const sockaddr_in6 *>(raw);
+        host = {reinterpret_cast<const char *>(&in6->sin6_addr), sizeof(in6->sin6_addr)};
+    }
+    return std::hash<std::string_view>{}(host);
+}
+
+void AdmissionControl::reject(sese::net::http::Response &resp, uint16_t code, uint64_t retry_after) {
+    resp.setCode(code);
+    // Rounded up to whole seconds
+    resp.set("retry-after", std::to_string(std::max<uint64_t>((retry_after + 999999) / 1000000, 1)));
+    resp.set("content-length", std::to_string(resp.getBody().getLength()));
+}
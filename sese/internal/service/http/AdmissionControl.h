@@ -0,0 +1,92 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sese/service/http/HttpService.h>
+#include <sese/net/http/Router.h>
+#include <sese/thread/ThreadPool.h>
+#include <sese/util/Metrics.h>
+#include <sese/util/RateLimiter.h>
+
+namespace sese::internal::service::http {
+
+/// Rate limits of the clients and load shedding of a service, see sese::service::http::HttpService::AdmissionOptions
+class AdmissionControl {
+public:
+    /// Counts an admitted request as in flight until it is released or destroyed
+    class Ticket {
+    public:
+        Ticket() = default;
+
+        ~Ticket() { release(); }
+
+        Ticket(const Ticket &) = delete;
+
+        Ticket &operator=(const Ticket &) = delete;
+
+        Ticket(Ticket &&other) noexcept : in_flight(other.in_flight) { other.in_flight = nullptr; }
+
+        Ticket &operator=(Ticket &&other) noexcept;
+
+        void release() noexcept;
+
+    private:
+        friend class AdmissionControl;
+
+        std::atomic<size_t> *in_flight = nullptr;
+    };
+
+    explicit AdmissionControl(const sese::service::http::HttpService::AdmissionOptions &options);
+
+    /// Decide whether a request is handled, called once its header is received
+    /// @param address Client address
+    /// @param req Request
+    /// @param resp Response, answered with 429 or 503 when the request is rejected
+    /// @param worker_pool Pool executing the servlets, null if disabled
+    /// @param ticket Holds the request in flight when admitted
+    /// @return Whether the request is admitted
+    bool admit(const sese::net::IPAddress::Ptr &address, const sese::net::http::Request &req, sese::net::http::Response &resp, ThreadPool *worker_pool, Ticket &ticket);
+
+    /// Record the time a servlet task waited in the worker pool
+    /// @param microseconds Queueing delay
+    void recordQueueDelay(uint64_t microseconds) noexcept {
+        queue_delay.store(microseconds, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool isQueueDelayLimited() const noexcept { return max_queue_delay != 0; }
+
+private:
+    std::unique_ptr<RateLimiter> client_limiter;
+    sese::net::http::Router route_router;
+    std::vector<std::unique_ptr<RateLimiter>> route_limiters;
+    size_t max_in_flight;
+    /// In microseconds
+    uint64_t max_queue_delay;
+    std::atomic<size_t> in_flight{0};
+    /// Delay of the last servlet task taken from the worker pool
+    std::atomic<uint64_t> queue_delay{0};
+    Counter &rate_limited;
+    Counter &overloaded;
+
+    /// Hash of the host part of an address, the port is ignored
+    static uint64_t hashAddress(const sese::net::IPAddress::Ptr &address) noexcept;
+
+    /// @param resp Response
+    /// @param code Status code
+    /// @param retry_after Microseconds, rounded up to at least one second
+    static void reject(sese::net::http::Response &resp, uint16_t code, uint64_t retry_after);
+};
+
+} // namespace sese::internal::service::http
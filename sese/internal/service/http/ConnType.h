@@ -22,6 +22,10 @@ enum class ConnType {
     FILTER,
     FILE_DOWNLOAD,
     CONTROLLER,
+    /// Upgraded to a websocket once the response is sent
+    WEBSOCKET,
+    /// Sends the events published to a topic until the peer disconnects
+    EVENT_STREAM,
     NONE
 };
 
@@ -16,13 +16,26 @@
 
 #include <sese/net/http/HttpServletContext.h>
 #include <sese/net/http/Range.h>
+#include <sese/net/http/RequestBodyStream.h>
+#include <sese/net/http/ResponseBodyStream.h>
+#include <sese/service/http/WebsocketSession.h>
 #include <sese/io/File.h>
+#include <sese/util/Metrics.h>
 #include <sese/util/StopWatch.h>
 
+#include <sese/internal/service/http/AdmissionControl.h>
 #include <sese/internal/service/http/ConnType.h>
 
 namespace sese::internal::service::http {
 
+/// Kept for each registered route
+struct RouteStats {
+    /// Latency in microseconds
+    sese::Histogram *duration = nullptr;
+    /// Id of the route in the access log
+    uint32_t log_id = 0;
+};
+
 struct Handleable {
     using Ptr = std::shared_ptr<Handleable>;
 
@@ -35,8 +48,38 @@ struct Handleable {
     std::vector<sese::net::http::Range> ranges;
     std::vector<sese::net::http::Range>::iterator range_iterator = ranges.begin();
     sese::net::IPAddress::Ptr remote_address{};
+    /// Path parameters captured by the servlet route
+    sese::net::http::Router::Params path_args;
+    /// Body of a request routed to a streaming servlet, null if the body is buffered
+    sese::net::http::RequestBodyStream::Ptr body_stream;
+    /// The servlet returned before the body was fully received
+    bool response_ready = false;
+    /// Body written incrementally by a servlet on the worker pool, sent only if response_streaming is set
+    sese::net::http::ResponseBodyStream::Ptr response_stream;
+    /// The servlet started the response stream, set before the connection resumes
+    bool response_streaming = false;
+    /// Route taking over the connection after the 101 response
+    const sese::service::http::WebsocketHandler *websocket_handler = nullptr;
+    /// Subscription of an event stream response
+    sese::net::http::EventTopic::Subscriber::Ptr event_subscriber;
+    /// Events taken from the subscriber and not yet written
+    std::vector<sese::net::http::EventTopic::Event> events;
     bool keepalive = false;
     sese::StopWatch stopwatch;
+    /// Statistics of the matched route, null if no route matched
+    const RouteStats *route_stats = nullptr;
+    /// Held from the admission of the request to the start of its response
+    AdmissionControl::Ticket ticket;
+
+    /// Wake up a servlet blocked on the body streams, called when the connection is lost
+    void abortStreams() const {
+        if (body_stream) {
+            body_stream->abort();
+        }
+        if (response_stream) {
+            response_stream->abort();
+        }
+    }
 };
 
 }
\ No newline at end of file
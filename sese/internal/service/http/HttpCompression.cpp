@@ -0,0 +1,97 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/service/http/HttpCompression.h>
+#include <sese/util/Compressor.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+
+static std::string_view trim(std::string_view str) {
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+        str.remove_prefix(1);
+    }
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t')) {
+        str.remove_suffix(1);
+    }
+    return str;
+}
+
+static bool equalsIgnoreCase(std::string_view lv, std::string_view rv) {
+    if (lv.length() != rv.length()) {
+        return false;
+    }
+    for (size_t i = 0; i < lv.length(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(lv[i])) != std::tolower(static_cast<unsigned char>(rv[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double sese::internal::service::http::HttpCompression::quality(std::string_view accept_encoding, std::string_view coding) {
+    double any = 0;
+    while (!accept_encoding.empty()) {
+        auto pos = accept_encoding.find(',');
+        auto item = accept_encoding.substr(0, pos);
+        accept_encoding.remove_prefix(pos == std::string_view::npos ? accept_encoding.length() : pos + 1);
+
+        // e.g. gzip;q=0.8
+        auto semicolon = item.find(';');
+        auto name = trim(item.substr(0, semicolon));
+        double q = 1;
+        if (semicolon != std::string_view::npos) {
+            auto param = trim(item.substr(semicolon + 1));
+            if (param.length() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = std::strtod(std::string(param.substr(2)).c_str(), nullptr);
+            }
+        }
+        if (equalsIgnoreCase(name, coding)) {
+            return q;
+        }
+        if (name == "*") {
+            any = q;
+        }
+    }
+    return any;
+}
+
+bool sese::internal::service::http::HttpCompression::isCompressible(std::string_view content_type, const std::vector<std::string> &types) {
+    for (auto &&type: types) {
+        if (content_type.substr(0, type.length()) == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sese::internal::service::http::HttpCompression::compress(CompressionType type, size_t level, io::ByteBuilder &body) {
+    auto length = body.getReadableSize();
+    if (length > std::numeric_limits<unsigned int>::max()) {
+        return false;
+    }
+    std::string input(length, '\0');
+    body.peek(input.data(), input.length());
+
+    io::ByteBuilder output(length / 2 + 64);
+    Compressor compressor(type, level);
+    compressor.input(input.data(), static_cast<unsigned int>(input.length()));
+    // Incompressible content is sent as is
+    if (compressor.deflate(&output) != 0 || output.getReadableSize() >= length) {
+        return false;
+    }
+    body.swap(output);
+    return true;
+}
@@ -0,0 +1,49 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sese/io/ByteBuilder.h>
+#include <sese/util/ZlibConfig.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sese::internal::service::http {
+
+/// Content coding negotiation and response body compression
+class HttpCompression {
+public:
+    /// Get the quality value of a content coding
+    /// @param accept_encoding Value of Accept-Encoding
+    /// @param coding Content coding, e.g. gzip
+    /// @return Quality value from 0 to 1, 0 if the coding is not acceptable
+    static double quality(std::string_view accept_encoding, std::string_view coding);
+
+    /// Determine whether a content type matches one of the prefixes
+    /// @param content_type Value of Content-Type
+    /// @param types Prefixes of the compressible content types
+    /// @return Result
+    static bool isCompressible(std::string_view content_type, const std::vector<std::string> &types);
+
+    /// Compress the body in place
+    /// @param type ZLIB for deflate, GZIP for gzip
+    /// @param level Compression level
+    /// @param body Body to be compressed
+    /// @return false if failed, the body is left untouched
+    static bool compress(CompressionType type, size_t level, io::ByteBuilder &body);
+};
+
+} // namespace sese::internal::service::http
@@ -15,21 +15,42 @@
 #include <sese/internal/service/http/HttpServiceImpl.h>
 #include <sese/net/http/HttpUtil.h>
 
-sese::internal::service::http::HttpConnection::HttpConnection(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &context, const sese::net::IPAddress::Ptr &addr)
-    : Handleable(), timer(context, asio::chrono::seconds{service->getKeepalive()}),
+#include <cstdio>
+#include <cstring>
+
+static sese::Gauge &open_connections = sese::MetricsRegistry::getInstance()->gauge(
+        "sese_http_open_connections", "Connections open to the HTTP services", {{"protocol", "http/1.1"}}
+);
+
+sese::internal::service::http::HttpConnection::HttpConnection(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker, const sese::net::IPAddress::Ptr &addr)
+    : Handleable(),
+      idle_timeout(service->getKeepalive()),
+      header_timeout(service->getTimeouts().header_timeout),
+      body_timeout(service->getTimeouts().body_timeout),
       expect_length(0),
       real_length(0),
-      service(service) {
+      service(service),
+      worker(worker) {
     remote_address = addr;
+    open_connections.add();
+}
+
+sese::internal::service::http::HttpConnection::~HttpConnection() {
+    open_connections.sub();
 }
 
 void sese::internal::service::http::HttpConnection::readHeader() {
-    node = std::make_unique<IOBufNode>(MTU_VALUE);
+    if (!pending.empty()) {
+        // A pipelined request has already been received
+        resetNode(pending.length());
+        memcpy(node->buffer, pending.data(), pending.length());
+        node->size = pending.length();
+        pending.clear();
+        handleHeader();
+        return;
+    }
+    resetNode(MTU_VALUE);
     asyncReadSome(asio::buffer(node->buffer, MTU_VALUE), [conn = getPtr()](const asio::error_code &error, std::size_t bytes_transferred) {
-        if (conn->keepalive) {
-            conn->keepalive = false;
-            conn->timer.cancel();
-        }
         if (error) {
             // There was an error and it should be disconnected
             conn->disponse();
@@ -37,61 +58,100 @@ void sese::internal::service::http::HttpConnection::readHeader() {
             return;
         }
         conn->node->size = bytes_transferred;
-        bool recv_status = false;
-        bool parse_status = false;
-        for (int i = 0; i < bytes_transferred; ++i) {
-            if (conn->is0x0a && static_cast<char *>(conn->node->buffer)[i] == '\r') {
-                conn->is0x0a = false;
-                recv_status = true;
-                conn->io_buffer.push(std::move(conn->node));
-                parse_status = net::http::HttpUtil::recvRequest(&conn->io_buffer, &conn->request);
-                break;
-            }
-            conn->is0x0a = static_cast<char *>(conn->node->buffer)[i] == '\n';
-        }
-        if (!recv_status) {
-            // Receive incomplete, save existing results and continue receiving
-            // SESE_WARN("read again");
-            conn->io_buffer.push(std::move(conn->node));
-            conn->readHeader();
-            return;
-        }
-        if (!parse_status) {
-            // Parsing failed and should be disconnected
-            // SESE_ERROR("Parsing failed");
-            conn->disponse();
-            return;
-        }
+        conn->handleHeader();
+    });
+}
 
-        auto service = conn->service.lock();
-        service->handleFilter(conn);
+void sese::internal::service::http::HttpConnection::resetNode(size_t capacity) {
+    if (!node || node->CAPACITY < capacity) {
+        node = std::make_unique<IOBufNode>(capacity);
+    }
+    node->read = 0;
+    node->size = 0;
+}
 
-        conn->expect_length = toInteger(conn->request.get("content-length", "0"));
-        conn->real_length = conn->io_buffer.getReadableSize();
-        if (conn->real_length && conn->conn_type != ConnType::FILTER) {
-            // Part of the body
-            streamMove(&conn->request.getBody(), &conn->io_buffer, conn->real_length);
-        }
-        conn->io_buffer.clear();
-        conn->node = nullptr;
-        if (conn->expect_length != conn->real_length) {
-            conn->readBody();
-        } else {
-            conn->handleRequest();
+void sese::internal::service::http::HttpConnection::handleHeader() {
+    if (keepalive) {
+        // The first bytes of the next request, the whole header must follow in time
+        keepalive = false;
+        setTimeout(header_timeout);
+    }
+    bool recv_status = false;
+    bool parse_status = false;
+    for (size_t i = 0; i < node->size; ++i) {
+        if (is0x0a && static_cast<char *>(node->buffer)[i] == '\r') {
+            is0x0a = false;
+            recv_status = true;
+            io_buffer.push(std::move(node));
+            parse_status = net::http::HttpUtil::recvRequest(&io_buffer, &request);
+            break;
         }
-    });
+        is0x0a = static_cast<char *>(node->buffer)[i] == '\n';
+    }
+    if (!recv_status) {
+        // Receive incomplete, save existing results and continue receiving
+        // SESE_WARN("read again");
+        io_buffer.push(std::move(node));
+        readHeader();
+        return;
+    }
+    if (!parse_status) {
+        // Parsing failed and should be disconnected
+        // SESE_ERROR("Parsing failed");
+        disponse();
+        return;
+    }
+
+    auto service = this->service.lock();
+    service->handleFilter(getPtr());
+
+    expect_length = toInteger(request.get("content-length", "0"));
+    // Anything beyond the body belongs to the pipelined requests
+    auto received = io_buffer.getReadableSize();
+    real_length = std::min(received, expect_length);
+    if (expect_length > real_length && service->isStreaming(getPtr())) {
+        handleStreamingRequest();
+        return;
+    }
+    if (real_length && conn_type != ConnType::FILTER) {
+        // Part of the body
+        streamMove(&request.getBody(), &io_buffer, real_length);
+    } else if (real_length) {
+        io_buffer.trunc(real_length);
+    }
+    if (received > real_length) {
+        pending.resize(received - real_length);
+        io_buffer.read(pending.data(), pending.length());
+    }
+    node = io_buffer.reclaim();
+    if (expect_length != real_length) {
+        readBody();
+    } else {
+        handleRequest();
+    }
 }
 
 void sese::internal::service::http::HttpConnection::readBody() {
-    node = std::make_unique<IOBufNode>(MTU_VALUE);
+    setTimeout(body_timeout);
+    resetNode(MTU_VALUE);
     asyncReadSome(asio::buffer(node->buffer, MTU_VALUE), [conn = getPtr()](const asio::error_code &error, std::size_t bytes_transferred) {
         if (error) {
             // There was an error and it should be disconnected
             conn->disponse();
             return;
         }
-        conn->node->size = bytes_transferred;
+        auto length = std::min(bytes_transferred, conn->expect_length - conn->real_length);
+        if (bytes_transferred > length) {
+            // The beginning of the next pipelined request
+            conn->pending.assign(static_cast<char *>(conn->node->buffer) + length, bytes_transferred - length);
+        }
+        conn->node->size = length;
         conn->real_length += conn->node->size;
+        if (conn->body_stream) {
+            auto node = std::move(conn->node);
+            conn->pushBody(node->buffer, node->size);
+            return;
+        }
         auto node_size = conn->node->size;
         conn->io_buffer.push(std::move(conn->node));
         if (conn->conn_type != ConnType::FILTER) {
@@ -100,8 +160,7 @@ void sese::internal::service::http::HttpConnection::readBody() {
         if (conn->real_length >= conn->expect_length) {
             // Theoretically, real_length can't be greater than expect_length,
             // and here is a precaution
-            conn->io_buffer.clear();
-            conn->node = nullptr;
+            conn->node = conn->io_buffer.reclaim();
             conn->handleRequest();
         } else {
             conn->readBody();
@@ -110,13 +169,121 @@ void sese::internal::service::http::HttpConnection::readBody() {
 }
 
 void sese::internal::service::http::HttpConnection::handleRequest() {
+    suspendTimeout();
     auto serv = service.lock();
     assert(serv);
-    serv->handleRequest(shared_from_this());
-    net::http::HttpUtil::sendResponse(&this->dynamic_buffer, &this->response);
-    this->real_length = 0;
-    this->expect_length = this->dynamic_buffer.getReadableSize();
-    this->writeHeader();
+    serv->handleRequest(shared_from_this(), worker.io_context, [conn = getPtr()] {
+        if (conn->body_stream && conn->real_length < conn->expect_length) {
+            // Respond once the rest of the body has been drained
+            conn->response_ready = true;
+            return;
+        }
+        conn->writeResponse();
+    });
+}
+
+void sese::internal::service::http::HttpConnection::handleStreamingRequest() {
+    body_stream = std::make_shared<sese::net::http::RequestBodyStream>(HttpServiceImpl::BODY_STREAM_CAPACITY);
+    body_stream->setDrainCallback([weak_conn = std::weak_ptr(getPtr()), stream = body_stream.get()] {
+        auto conn = weak_conn.lock();
+        if (!conn) {
+            return;
+        }
+        asio::post(conn->worker.io_context, [conn, stream] {
+            if (conn->body_stream.get() == stream && conn->real_length < conn->expect_length) {
+                conn->readBody();
+            }
+        });
+    });
+    std::string part(io_buffer.getReadableSize(), '\0');
+    io_buffer.read(part.data(), part.length());
+    node = io_buffer.reclaim();
+    handleRequest();
+    pushBody(part.data(), part.length());
+}
+
+void sese::internal::service::http::HttpConnection::pushBody(const void *buffer, size_t length) {
+    auto more = body_stream->push(buffer, length);
+    if (real_length >= expect_length) {
+        suspendTimeout();
+        body_stream->finish();
+        if (response_ready) {
+            response_ready = false;
+            writeResponse();
+        }
+    } else if (more) {
+        readBody();
+    } else {
+        // The drain callback resumes reading, the peer is not the one holding up the body
+        suspendTimeout();
+    }
+}
+
+void sese::internal::service::http::HttpConnection::writeResponse() {
+    if (response_streaming) {
+        response_stream->setDataCallback([weak_conn = std::weak_ptr(getPtr()), stream = response_stream.get()] {
+            auto conn = weak_conn.lock();
+            if (!conn) {
+                return;
+            }
+            asio::post(conn->worker.io_context, [conn, stream] {
+                if (conn->response_stream.get() == stream) {
+                    conn->writeChunk();
+                }
+            });
+        });
+    }
+    if (!response_streaming && ranges.empty() && response.getBody().getReadableSize() <= PIPELINE_BUFFER_SIZE) {
+        queueResponse();
+        return;
+    }
+    if (queued_count) {
+        // The responses to the previous requests go first
+        writeQueuedResponses(&HttpConnection::writeResponse);
+        return;
+    }
+    net::http::HttpUtil::sendResponse(&dynamic_buffer, &response);
+    real_length = 0;
+    expect_length = dynamic_buffer.getReadableSize();
+    writeHeader();
+}
+
+void sese::internal::service::http::HttpConnection::queueResponse() {
+    net::http::HttpUtil::sendResponse(&dynamic_buffer, &response);
+    auto header_size = dynamic_buffer.getReadableSize();
+    auto body_size = response.getBody().getReadableSize();
+    auto offset = queued_data.length();
+    queued_data.resize(offset + header_size + body_size);
+    dynamic_buffer.read(queued_data.data() + offset, header_size);
+    dynamic_buffer.freeCapacity();
+    response.getBody().read(queued_data.data() + offset + header_size, body_size);
+    queued_count += 1;
+
+    // Keep collecting while the header of the next request has already been received
+    if (keepalive &&
+        pending.find("\r\n\r\n") != std::string::npos &&
+        queued_data.length() < PIPELINE_BUFFER_SIZE &&
+        queued_count < MAX_PIPELINED_RESPONSES) {
+        checkKeepalive();
+        return;
+    }
+    writeQueuedResponses(&HttpConnection::checkKeepalive);
+}
+
+void sese::internal::service::http::HttpConnection::writeQueuedResponses(void (HttpConnection::*next)()) {
+    writeBlock(queued_data.data(), queued_data.length(), [conn = getPtr(), next](const asio::error_code &error) {
+        if (error) {
+            conn->disponse();
+            return;
+        }
+        if (conn->queued_data.capacity() > PIPELINE_BUFFER_SIZE) {
+            // Only the storage of small responses is worth keeping on an idle connection
+            std::string().swap(conn->queued_data);
+        }
+        conn->queued_data.clear();
+        conn->queued_count = 0;
+        (conn.get()->*next)();
+    });
 }
 
 void sese::internal::service::http::HttpConnection::writeHeader() {
@@ -136,7 +303,17 @@ void sese::internal::service::http::HttpConnection::writeHeader() {
             conn->expect_length = 0;
             conn->real_length = 0;
             if (conn->ranges.size() == 1) {
-                // Single range file
+                // Single range file, prefer sending it without copying
+                auto &&range = *conn->range_iterator;
+                if (conn->sendFile(conn->file->getFd(), static_cast<int64_t>(range.begin), range.len, [conn](const asio::error_code &error) {
+                        if (error) {
+                            conn->disponse();
+                            return;
+                        }
+                        conn->checkKeepalive();
+                    })) {
+                    return;
+                }
                 conn->expect_length = conn->range_iterator->len;
                 if (conn->file->setSeek(static_cast<int64_t>(conn->range_iterator->begin), io::Seek::BEGIN)) {
                     conn->disponse();
@@ -146,6 +323,8 @@ void sese::internal::service::http::HttpConnection::writeHeader() {
             } else if (conn->ranges.size() > 1) {
                 // Multi range file
                 conn->writeRanges();
+            } else if (conn->response_streaming) {
+                conn->writeChunk();
             } else if ((conn->expect_length = conn->response.getBody().getReadableSize())) {
                 // body resp
                 conn->writeBody();
@@ -176,6 +355,49 @@ void sese::internal::service::http::HttpConnection::writeBody() {
     });
 }
 
+void sese::internal::service::http::HttpConnection::writeChunk() {
+    chunk_buffer.resize(CHUNK_HEADER_SIZE + CHUNK_SIZE + 7);
+    auto data = chunk_buffer.data() + CHUNK_HEADER_SIZE;
+    bool end;
+    auto length = response_stream->take(data, CHUNK_SIZE, end);
+    if (length == 0 && !end) {
+        // Nothing has been written yet, resumed by the data callback
+        return;
+    }
+
+    auto begin = data;
+    auto tail = data + length;
+    if (response.exist("transfer-encoding")) {
+        if (length) {
+            char line[CHUNK_HEADER_SIZE];
+            auto n = std::snprintf(line, sizeof(line), "%zx\r\n", length);
+            begin -= n;
+            std::memcpy(begin, line, n);
+            std::memcpy(tail, "\r\n", 2);
+            tail += 2;
+        }
+        if (end) {
+            std::memcpy(tail, "0\r\n\r\n", 5);
+            tail += 5;
+        }
+    }
+    if (begin == tail) {
+        checkKeepalive();
+        return;
+    }
+    this->writeBlock(begin, tail - begin, [conn = getPtr(), end](const asio::error_code &error) {
+        if (error) {
+            conn->disponse();
+            return;
+        }
+        if (end) {
+            conn->checkKeepalive();
+        } else {
+            conn->writeChunk();
+        }
+    });
+}
+
 void sese::internal::service::http::HttpConnection::writeSingleRange() {
     auto l = std::min<size_t>(this->expect_length - this->real_length, MTU_VALUE);
     this->real_length += l;
@@ -267,10 +489,120 @@ void sese::internal::service::http::HttpConnection::writeRanges() {
     }
 }
 
+bool sese::internal::service::http::HttpConnection::sendFile(int, int64_t, size_t, const std::function<void(const asio::error_code &code)> &) {
+    return false;
+}
+
+void sese::internal::service::http::HttpConnection::checkKeepalive() {
+    if (conn_type == ConnType::WEBSOCKET) {
+        upgrade();
+    } else if (conn_type == ConnType::EVENT_STREAM) {
+        startEventStream();
+    } else if (keepalive) {
+        reset();
+        setTimeout(idle_timeout);
+        readHeader();
+    } else {
+        disponse();
+    }
+}
+
+void sese::internal::service::http::HttpConnection::upgrade() {
+    auto conn = getPtr();
+    auto session = std::make_shared<WebsocketSessionImpl>(conn, *websocket_handler);
+    worker.websockets.emplace(session);
+    worker.connections.erase(conn);
+    // The frames sent right after the upgrade request
+    session->start(std::move(pending));
+}
+
+void sese::internal::service::http::HttpConnection::startEventStream() {
+    // The stream stays open while idle
+    cancelTimeout();
+    event_subscriber->setNotifyCallback([weak_conn = std::weak_ptr(getPtr())] {
+        auto conn = weak_conn.lock();
+        if (!conn) {
+            return;
+        }
+        asio::post(conn->worker.io_context, [conn] { conn->writeEvents(); });
+    });
+    waitForClose();
+    writeEvents();
+}
+
+void sese::internal::service::http::HttpConnection::waitForClose() {
+    resetNode(MTU_VALUE);
+    asyncReadSome(asio::buffer(node->buffer, MTU_VALUE), [conn = getPtr()](const asio::error_code &error, std::size_t) {
+        if (error) {
+            conn->disponse();
+            return;
+        }
+        conn->waitForClose();
+    });
+}
+
+void sese::internal::service::http::HttpConnection::writeEvents() {
+    if (!event_subscriber || !event_buffers.empty()) {
+        return;
+    }
+    if (!event_subscriber->take(events)) {
+        // The peer fell too far behind, it resumes from Last-Event-ID after reconnecting
+        closeSocket();
+        disponse();
+        return;
+    }
+    if (events.empty()) {
+        return;
+    }
+    for (auto &&event: events) {
+        event_buffers.emplace_back(asio::buffer(*event));
+    }
+    writeBlocks(event_buffers, [conn = getPtr()](const asio::error_code &error) {
+        conn->events.clear();
+        conn->event_buffers.clear();
+        if (error) {
+            conn->disponse();
+            return;
+        }
+        conn->writeEvents();
+    });
+}
+
+void sese::internal::service::http::HttpConnection::setTimeout(uint32_t seconds) {
+    if (timeout) {
+        worker.wheel.refresh(timeout, seconds);
+        return;
+    }
+    timeout = worker.wheel.delay([weak_conn = std::weak_ptr(getPtr())] {
+        auto conn = weak_conn.lock();
+        if (!conn) {
+            return;
+        }
+        conn->timeout = nullptr;
+        conn->closeSocket();
+        conn->disponse();
+    }, seconds);
+}
+
+void sese::internal::service::http::HttpConnection::cancelTimeout() {
+    if (timeout) {
+        worker.wheel.cancel(timeout);
+        timeout = nullptr;
+    }
+}
+
+void sese::internal::service::http::HttpConnection::suspendTimeout() {
+    if (timeout) {
+        worker.wheel.suspend(timeout);
+    }
+}
+
 void sese::internal::service::http::HttpConnection::disponse() {
-    auto serv = service.lock();
-    assert(serv);
-    serv->connections.erase(shared_from_this());
+    cancelTimeout();
+    abortStreams();
+    // Unsubscribe right away, the connection may outlive the pending operations
+    event_subscriber = nullptr;
+    worker.connections.erase(shared_from_this());
 }
 
 void sese::internal::service::http::HttpConnection::reset() {
@@ -279,6 +611,18 @@ void sese::internal::service::http::HttpConnection::reset() {
     expect_length = 0;
     real_length = 0;
     ranges.clear();
+    path_args.clear();
+    // Hand the descriptor back to the file cache
+    file = nullptr;
+    body_stream = nullptr;
+    response_ready = false;
+    response_stream = nullptr;
+    response_streaming = false;
+    websocket_handler = nullptr;
+    route_stats = nullptr;
+    ticket.release();
+    event_subscriber = nullptr;
+    events.clear();
 
     request.clear();
     request.queryArgsClear();
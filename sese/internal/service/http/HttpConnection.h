@@ -18,6 +18,7 @@
 #include <asio/ssl/stream.hpp>
 
 #include <sese/util/IOBuf.h>
+#include <sese/util/TimeWheel.h>
 #include <sese/net/http/Range.h>
 #include <sese/io/File.h>
 
@@ -25,6 +26,7 @@
 
 namespace sese::internal::service::http {
 class HttpServiceImpl;
+struct HttpWorker;
 
 /// Base implementation of Http connection
 struct HttpConnection : Handleable, std::enable_shared_from_this<HttpConnection> {
@@ -32,34 +34,91 @@ struct HttpConnection : Handleable, std::enable_shared_from_this<HttpConnection>
 
     Ptr getPtr() { return shared_from_this(); } // NOLINT
 
-    HttpConnection(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &io_context, const sese::net::IPAddress::Ptr &addr);
+    HttpConnection(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker, const sese::net::IPAddress::Ptr &addr);
 
-    virtual ~HttpConnection() = default;
+    virtual ~HttpConnection();
 
-    asio::system_timer timer;
+    /// Pending timeout in the wheel of the worker, nullptr if none
+    TimeoutEvent *timeout = nullptr;
+    /// Timeout while waiting for the next request, the keepalive duration
+    uint32_t idle_timeout;
+    /// Timeout of the whole header of a request
+    uint32_t header_timeout;
+    /// Timeout between two reads of a request body
+    uint32_t body_timeout;
 
     void reset();
 
     size_t expect_length;
     size_t real_length;
     char send_buffer[MTU_VALUE]{};
+    /// Views of the events being written, which stay shared with the other subscribers
+    std::vector<asio::const_buffer> event_buffers;
     bool is0x0a = false;
     IOBuf io_buffer;
     std::unique_ptr<IOBufNode> node;
     io::ByteBuilder dynamic_buffer;
+    /// Bytes received beyond the current request, the beginning of the pipelined requests
+    std::string pending;
+    /// Serialized responses waiting to be sent together, the storage is kept for the next requests
+    std::string queued_data;
+    /// Number of responses in queued_data
+    size_t queued_count = 0;
+    /// Framing buffer of a streamed response, allocated on first use
+    std::string chunk_buffer;
+
+    /// Maximum payload of a chunk of a streamed response
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    /// Room reserved in front of the payload for the chunk size line
+    static constexpr size_t CHUNK_HEADER_SIZE = 16;
+    /// Responses up to this size are serialized in memory and may be coalesced
+    static constexpr size_t PIPELINE_BUFFER_SIZE = 16 * 1024;
+    /// Maximum number of responses coalesced into one write
+    static constexpr size_t MAX_PIPELINED_RESPONSES = 16;
 
     std::weak_ptr<HttpServiceImpl> service;
+    /// The I/O loop that owns this connection
+    HttpWorker &worker;
 
+    /// Read the next request, starting with the pipelined data that has already been received
     void readHeader();
 
+    /// Keep the receive node across requests, allocating a new one only if it is missing or too small
+    /// @param capacity Required capacity
+    void resetNode(size_t capacity);
+
+    /// Look for the end of the header in the received data and dispatch the request once it is complete
+    void handleHeader();
+
     void readBody();
 
     void handleRequest();
 
+    /// Start a streaming servlet and feed it the part of the body received with the header
+    void handleStreamingRequest();
+
+    /// Append the received data to the body stream and continue reading unless the stream is full
+    /// @param buffer Received data
+    /// @param length Size of the data
+    void pushBody(const void *buffer, size_t length);
+
+    /// Serialize the response and start writing it
+    void writeResponse();
+
+    /// Serialize a small response, which is held back while the next pipelined request is already received
+    void queueResponse();
+
+    /// Send the queued responses in one write
+    /// @param next Continuation invoked once they are sent
+    void writeQueuedResponses(void (HttpConnection::*next)());
+
     void writeHeader();
 
     void writeBody();
 
+    /// Write the body streamed by the servlet, as chunks if the transfer encoding is chunked
+    void writeChunk();
+
     /// Write block function. This function ensures that all buffers are completely written,
     /// and the connection will be disconnected if an unexpected error occurs
     /// @note This function must be implemented
@@ -67,18 +126,59 @@ struct HttpConnection : Handleable, std::enable_shared_from_this<HttpConnection>
     /// @param length Size of the buffer
     /// @param callback Completion callback function
     virtual void writeBlock(const char *buffer, size_t length,
-                            const std::function<void(const asio::error_code &code)> &callback) = 0;
+                            std::function<void(const asio::error_code &code)> callback) = 0;
+
+    /// Vectored version of writeBlock
+    /// @note This function must be implemented
+    /// @param buffers Buffers
+    /// @param callback Completion callback function
+    virtual void writeBlocks(const std::vector<asio::const_buffer> &buffers,
+                             std::function<void(const asio::error_code &code)> callback) = 0;
 
     /// Read function. This function will call the corresponding asio::async_read_some
     /// @param buffer asio::buffer
     /// @param callback Callback function
     virtual void asyncReadSome(const asio::mutable_buffers_1 &buffer,
-                               const std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> &
+                               std::function<void(const asio::error_code &error, std::size_t bytes_transferred)>
                                callback) = 0;
 
+    /// Send a part of the file from the page cache to the peer without copying it through user space
+    /// @note This function is optional to implement, the default implementation reports it is unsupported
+    /// @param fd File descriptor
+    /// @param offset Offset of the part in the file
+    /// @param length Size of the part
+    /// @param callback Completion callback function
+    /// @return Whether zero-copy sending is supported, the callback will only be called if so
+    virtual bool sendFile(int fd, int64_t offset, size_t length,
+                          const std::function<void(const asio::error_code &code)> &callback);
+
     /// Called when a request is completed to determine whether to disconnect the current connection
+    void checkKeepalive();
+
+    /// Hand the connection over to a websocket session on the same loop once the 101 response is sent
+    void upgrade();
+
+    /// Keep the connection open after the header of an event stream and send the published events
+    void startEventStream();
+
+    /// Discard anything the peer sends, so that the connection is released once it disconnects
+    void waitForClose();
+
+    /// Take the events queued by the subscriber and write them in a single gathered write
+    void writeEvents();
+
+    /// Arm the timeout of the connection, replacing the pending one
+    /// @param seconds Timeout duration
+    void setTimeout(uint32_t seconds);
+
+    void cancelTimeout();
+
+    /// Stop the timeout while the server holds up the connection, keeping the event for the next setTimeout
+    void suspendTimeout();
+
+    /// Close the socket when the timeout expires, so that the pending operations complete with an error
     /// @note This function must be implemented
-    virtual void checkKeepalive() = 0;
+    virtual void closeSocket() = 0;
 
     /// Called before the connection is completely released to perform some cleanup of member variables
     /// @note This function is optional to implement
@@ -99,17 +199,31 @@ struct HttpConnectionImpl final : HttpConnection {
 
     SharedSocket socket;
 
-    HttpConnectionImpl(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &context,
+    HttpConnectionImpl(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker,
                        const sese::net::IPAddress::Ptr &addr, SharedSocket socket);
 
     void writeBlock(const char *buffer, size_t length,
-                    const std::function<void(const asio::error_code &code)> &callback) override;
+                    std::function<void(const asio::error_code &code)> callback) override;
+
+    void writeBlocks(const std::vector<asio::const_buffer> &buffers,
+                     std::function<void(const asio::error_code &code)> callback) override;
 
     void asyncReadSome(const asio::mutable_buffers_1 &buffer,
-                       const std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> &
+                       std::function<void(const asio::error_code &error, std::size_t bytes_transferred)>
                        callback) override;
 
-    void checkKeepalive() override;
+    bool sendFile(int fd, int64_t offset, size_t length,
+                  const std::function<void(const asio::error_code &code)> &callback) override;
+
+    void closeSocket() override;
+
+#ifdef SESE_PLATFORM_LINUX
+    /// The maximum number of bytes sent in one turn of the loop, so that a fast peer cannot monopolize it
+    static constexpr size_t SENDFILE_BUDGET = 4 * 1024 * 1024;
+
+    void doSendFile(int fd, int64_t offset, size_t length,
+                    const std::function<void(const asio::error_code &code)> &callback);
+#endif
 };
 
 /// Http SSL connection implementation
@@ -121,20 +235,29 @@ struct HttpsConnectionImpl final : HttpConnection {
     Ptr getPtr() { return std::reinterpret_pointer_cast<HttpsConnectionImpl>(shared_from_this()); } // NOLINT
 
     SharedStream stream;
+    /// OpenSSL writes to the socket itself, see AsioSSLDirect
+    bool direct;
 
-    HttpsConnectionImpl(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &context,
+    HttpsConnectionImpl(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker,
                         const sese::net::IPAddress::Ptr &addr,SharedStream stream);
 
     ~HttpsConnectionImpl() override;
 
     void writeBlock(const char *buffer, size_t length,
-                    const std::function<void(const asio::error_code &code)> &callback) override;
+                    std::function<void(const asio::error_code &code)> callback) override;
+
+    void writeBlocks(const std::vector<asio::const_buffer> &buffers,
+                     std::function<void(const asio::error_code &code)> callback) override;
 
     void asyncReadSome(const asio::mutable_buffers_1 &buffer,
-                       const std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> &
+                       std::function<void(const asio::error_code &error, std::size_t bytes_transferred)>
                        callback) override;
 
-    void checkKeepalive() override;
+    /// Sent with SSL_sendfile once the kernel encrypts the records
+    bool sendFile(int fd, int64_t offset, size_t length,
+                  const std::function<void(const asio::error_code &code)> &callback) override;
+
+    void closeSocket() override;
 };
 
 }
\ No newline at end of file
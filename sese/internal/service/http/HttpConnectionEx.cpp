@@ -24,10 +24,17 @@
 #include <sese/internal/service/http/HttpConnectionEx.h>
 #include <sese/internal/service/http/HttpServiceImpl.h>
 
-sese::internal::service::http::HttpStream::HttpStream(uint32_t id, uint32_t write_window_size, const sese::net::IPAddress::Ptr &addr) noexcept
+#include <algorithm>
+
+static sese::Gauge &open_connections = sese::MetricsRegistry::getInstance()->gauge(
+        "sese_http_open_connections", "Connections open to the HTTP services", {{"protocol", "h2"}}
+);
+
+sese::internal::service::http::HttpStream::HttpStream(uint32_t id, uint32_t write_window_size, uint32_t read_window_size, const sese::net::IPAddress::Ptr &addr) noexcept
     : Handleable(),
       id(id),
       endpoint_window_size(write_window_size),
+      window_size(read_window_size),
       expect_length(0),
       real_length(0) {
     using namespace sese::net::http;
@@ -45,34 +52,100 @@ void sese::internal::service::http::HttpStream::prepareRange() {
 
 sese::internal::service::http::HttpConnectionEx::HttpConnectionEx(
         const std::shared_ptr<HttpServiceImpl> &service,
-        asio::io_context &io_context,
+        HttpWorker &worker,
         const sese::net::IPAddress::Ptr &addr
 )
-    : timer(io_context, asio::chrono::seconds{service->getKeepalive()}),
+    : idle_timeout(service->getKeepalive()),
+      header_timeout(service->getTimeouts().header_timeout),
+      body_timeout(service->getTimeouts().body_timeout),
       remote_address(addr),
-      service(service) {
+      service(service),
+      worker(worker),
+      options(service->getHttp2Options()),
+      temp_buffer(options.max_frame_size),
+      connection_window_target(options.connection_window_size),
+      stream_window_target(options.stream_window_size) {
+    open_connections.add();
+}
+
+sese::internal::service::http::HttpConnectionEx::~HttpConnectionEx() {
+    open_connections.sub();
 }
 
 void sese::internal::service::http::HttpConnectionEx::close(uint32_t id) {
+    if (auto iterator = streams.find(id); iterator != streams.end()) {
+        iterator->second->abortStreams();
+    }
     streams.erase(id);
     closed_streams.emplace(id);
 }
 
+void sese::internal::service::http::HttpConnectionEx::abortStreams() {
+    for (auto &&[id, stream]: streams) {
+        stream->abortStreams();
+    }
+}
+
+void sese::internal::service::http::HttpConnectionEx::setTimeout(uint32_t seconds) {
+    if (timeout) {
+        worker.wheel.refresh(timeout, seconds);
+        return;
+    }
+    timeout = worker.wheel.delay([weak_conn = std::weak_ptr(getPtr())] {
+        auto conn = weak_conn.lock();
+        if (!conn) {
+            return;
+        }
+        conn->timeout = nullptr;
+        conn->closeSocket();
+        conn->disponse();
+    }, seconds);
+}
+
+void sese::internal::service::http::HttpConnectionEx::cancelTimeout() {
+    if (timeout) {
+        worker.wheel.cancel(timeout);
+        timeout = nullptr;
+    }
+}
+
+void sese::internal::service::http::HttpConnectionEx::suspendTimeout() {
+    if (timeout) {
+        worker.wheel.suspend(timeout);
+    }
+}
+
+void sese::internal::service::http::HttpConnectionEx::updateTimeout() {
+    if (streams.empty()) {
+        setTimeout(idle_timeout);
+        return;
+    }
+    for (auto &&[id, stream]: streams) {
+        // The peer is expected to keep sending the request unless the windows hold it back
+        if (!stream->end_stream && (!stream->end_headers || (window_size && stream->window_size))) {
+            setTimeout(body_timeout);
+            return;
+        }
+    }
+    // The responses are being processed or sent
+    suspendTimeout();
+}
+
 void sese::internal::service::http::HttpConnectionEx::disponse() {
-    auto serv = service.lock();
-    assert(serv);
-    serv->connections2.erase(shared_from_this());
+    cancelTimeout();
+    abortStreams();
+    worker.connections2.erase(shared_from_this());
     // SESE_INFO("timeout {}:{}", remote_address->getAddress(), remote_address->getPort());
 }
 
 void sese::internal::service::http::HttpConnectionEx::readMagic() {
-    readBlock(temp_buffer, 24, [this](const asio::error_code &ec) {
+    readBlock(temp_buffer.data(), 24, [this](const asio::error_code &ec) {
         if (ec) {
             disponse();
             return;
         }
         // The magic number is wrong
-        if (0 != strncmp(temp_buffer, sese::net::http::MAGIC_STRING, 24)) {
+        if (0 != strncmp(temp_buffer.data(), sese::net::http::MAGIC_STRING, 24)) {
             disponse();
             return;
         }
@@ -82,26 +155,32 @@ void sese::internal::service::http::HttpConnectionEx::readMagic() {
 
 void sese::internal::service::http::HttpConnectionEx::readFrameHeader() {
     using namespace sese::net::http;
-    readBlock(temp_buffer, 9, [this](const asio::error_code &ec) {
+    // Frame handlers may already have resumed reading through handleWrite
+    if (is_read) {
+        return;
+    }
+    updateTimeout();
+    readBlock(temp_buffer.data(), 9, [this](const asio::error_code &ec) {
         if (ec) {
             disponse();
             return;
         }
         memset(&frame, 0, sizeof(frame));
-        memcpy(reinterpret_cast<char *>(&frame.length) + 1, temp_buffer + 0, 3);
-        memcpy(&frame.type, temp_buffer + 3, 1);
-        memcpy(&frame.flags, temp_buffer + 4, 1);
-        memcpy(&frame.ident, temp_buffer + 5, 4);
+        memcpy(reinterpret_cast<char *>(&frame.length) + 1, temp_buffer.data() + 0, 3);
+        memcpy(&frame.type, temp_buffer.data() + 3, 1);
+        memcpy(&frame.flags, temp_buffer.data() + 4, 1);
+        memcpy(&frame.ident, temp_buffer.data() + 5, 4);
         frame.length = FromBigEndian32(frame.length);
         frame.ident = FromBigEndian32<uint32_t>(frame.ident);
         frame.ident &= 0x7fffffff;
 
-        if (frame.length > endpoint_max_frame_size) {
+        // The peer is bound by the frame size advertised locally
+        if (frame.length > options.max_frame_size) {
             writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "shutdown", true);
             return;
         }
 
-        readBlock(temp_buffer, frame.length, [this](const asio::error_code &ec0) {
+        readBlock(temp_buffer.data(), frame.length, [this](const asio::error_code &ec0) {
             if (ec0) {
                 disponse();
                 return;
@@ -185,8 +264,13 @@ void sese::internal::service::http::HttpConnectionEx::handleFrameHeader() {
             handlePingFrame();
             break;
         }
+        case FRAME_TYPE_PRIORITY_UPDATE: {
+            handlePriorityUpdateFrame();
+            break;
+        }
         default: {
-            writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "unknown frame type");
+            // Frames of unknown types must be ignored
+            readFrameHeader();
             break;
         }
     }
@@ -210,7 +294,7 @@ uint8_t sese::internal::service::http::HttpConnectionEx::handleSettingsFrame() {
     char buffer[6];
     auto ident = reinterpret_cast<uint16_t *>(&buffer[0]);
     auto value = reinterpret_cast<uint32_t *>(&buffer[2]);
-    auto input = io::InputBufferWrapper(temp_buffer, frame.length);
+    auto input = io::InputBufferWrapper(temp_buffer.data(), frame.length);
 
     while (input.read(buffer, 6) == 6) {
         *ident = FromBigEndian16(*ident);
@@ -218,8 +302,9 @@ uint8_t sese::internal::service::http::HttpConnectionEx::handleSettingsFrame() {
 
         switch (*ident) {
             case SETTINGS_HEADER_TABLE_SIZE:
-                this->req_dynamic_table.resize(*value);
+                // Limits the table of our encoder, the one of our decoder follows our own setting
                 this->header_table_size = *value;
+                resp_dynamic_table.resize(std::min<uint32_t>(*value, RESP_HEADER_TABLE_SIZE));
                 break;
             case SETTINGS_MAX_CONCURRENT_STREAMS:
                 this->max_concurrent_stream = *value == 0 ? 100 : *value;
@@ -240,8 +325,6 @@ uint8_t sese::internal::service::http::HttpConnectionEx::handleSettingsFrame() {
                 break;
             case SETTINGS_MAX_HEADER_LIST_SIZE:
                 this->max_header_list_size = *value;
-                req_dynamic_table.resize(max_header_list_size);
-                resp_dynamic_table.resize(max_header_list_size);
                 break;
             case SETTINGS_INITIAL_WINDOW_SIZE:
                 if (accept_stream_count) {
@@ -261,7 +344,7 @@ uint8_t sese::internal::service::http::HttpConnectionEx::handleSettingsFrame() {
 
 void sese::internal::service::http::HttpConnectionEx::handleWindowUpdate() {
     using namespace sese::net::http;
-    auto data = reinterpret_cast<uint32_t *>(temp_buffer);
+    auto data = reinterpret_cast<uint32_t *>(temp_buffer.data());
     if (frame.length != 4) {
         writeGoawayFrame(frame.ident, 0, GOAWAY_FRAME_SIZE_ERROR, "");
         return;
@@ -274,7 +357,7 @@ void sese::internal::service::http::HttpConnectionEx::handleWindowUpdate() {
 
     if (frame.ident == 0) {
         if (sese::isAdditionOverflow<
-                    int32_t>(static_cast<int32_t>(endpoint_init_window_size), static_cast<int32_t>(i))) {
+                    int32_t>(static_cast<int32_t>(endpoint_window_size), static_cast<int32_t>(i))) {
             writeGoawayFrame(frame.ident, 0, GOAWAY_FLOW_CONTROL_ERROR, "");
             return;
         }
@@ -292,7 +375,8 @@ void sese::internal::service::http::HttpConnectionEx::handleWindowUpdate() {
         }
     }
 
-    readFrameHeader();
+    // Resume the streams waiting for the window
+    handleWrite();
 }
 
 void sese::internal::service::http::HttpConnectionEx::handleGoawayFrame() {
@@ -315,13 +399,13 @@ void sese::internal::service::http::HttpConnectionEx::handleGoawayFrame() {
     }
 
     uint32_t latest_stream;
-    memcpy(&latest_stream, temp_buffer, sizeof(latest_stream));
+    memcpy(&latest_stream, temp_buffer.data(), sizeof(latest_stream));
     latest_stream = FromBigEndian32(latest_stream);
     uint32_t error_code;
-    memcpy(&error_code, temp_buffer + 4, sizeof(latest_stream));
+    memcpy(&error_code, temp_buffer.data() + 4, sizeof(latest_stream));
     error_code = FromBigEndian32(error_code);
     if (frame.length - 8) {
-        auto msg = std::string(temp_buffer + 8, frame.length - 8);
+        auto msg = std::string(temp_buffer.data() + 8, frame.length - 8);
         // SESE_WARN("FAILED: LS {} CODE {} MSG {}", latest_stream, error_code, msg);
         if (msg == "shutdown") {
             return;
@@ -335,11 +419,6 @@ void sese::internal::service::http::HttpConnectionEx::handleGoawayFrame() {
 void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
     using namespace sese::net::http;
 
-    // if (keepalive) {
-    // keepalive = false;
-    timer.cancel();
-    // }
-
     // if (expect_ack) {
     //     writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "expect ack");
     //     return;
@@ -363,11 +442,9 @@ void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
                 writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "");
                 return;
             }
-            if (streams.size() > MAX_CONCURRENT_STREAMS) {
-                writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "shutdown", true);
-                return;
-            }
-            stream = std::make_shared<HttpStream>(frame.ident, endpoint_init_window_size, remote_address);
+            stream = std::make_shared<HttpStream>(frame.ident, endpoint_init_window_size, options.stream_window_size, remote_address);
+            // Only the stream beyond the advertised limit is refused, the others are kept
+            stream->refused = streams.size() >= options.max_concurrent_streams;
             streams[frame.ident] = stream;
             accept_stream_count += 1;
             latest_stream_ident = frame.ident;
@@ -390,13 +467,19 @@ void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
     uint8_t offset = 0;
     uint8_t padded = 0;
     stream->continue_type = frame.type;
+    // The Pad Length and priority fields are part of the payload, a shorter frame would read them from the previous one
+    size_t fields = (frame.flags & FRAME_FLAG_PADDED ? 1 : 0) + (frame.flags & FRAME_FLAG_PRIORITY ? 5 : 0);
+    if (frame.length < fields) {
+        writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
+        return;
+    }
     if (frame.flags & FRAME_FLAG_PADDED) {
         padded = temp_buffer[0];
         offset += 1;
     }
     if (frame.flags & FRAME_FLAG_PRIORITY) {
         uint32_t dependency;
-        memcpy(&dependency, temp_buffer + offset, 4);
+        memcpy(&dependency, temp_buffer.data() + offset, 4);
         dependency = FromBigEndian32(dependency);
         offset += 4;
         uint8_t priority = temp_buffer[offset]; // NOLINT
@@ -408,12 +491,12 @@ void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
         }
     }
 
-    if (padded > frame.length) {
+    if (padded > frame.length - offset) {
         writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
         return;
     }
 
-    stream->temp_buffer.write(temp_buffer + offset, frame.length - padded - offset);
+    stream->temp_buffer.write(temp_buffer.data() + offset, frame.length - padded - offset);
 
     if (frame.flags & FRAME_FLAG_END_HEADERS) {
         stream->end_headers = true;
@@ -423,12 +506,21 @@ void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
     }
 
     if (stream->end_headers) {
-        auto rt = HPackUtil::decode(&stream->temp_buffer, stream->temp_buffer.getReadableSize(), req_dynamic_table, stream->request, false, true, header_table_size);
+        auto rt = HPackUtil::decode(&stream->temp_buffer, stream->temp_buffer.getReadableSize(), req_dynamic_table, stream->request, false, true, HEADER_TABLE_SIZE);
         stream->temp_buffer.freeCapacity();
         if (rt) {
             writeGoawayFrame(frame.ident, 0, rt, "");
             return;
         }
+        if (stream->refused) {
+            streams.erase(frame.ident);
+            closed_streams.emplace(frame.ident);
+            if (!stream->end_stream) {
+                refused_streams.emplace(frame.ident);
+            }
+            writeRstStreamFrame(frame.ident, 0, GOAWAY_REFUSED_STREAM);
+            return;
+        }
         // if (stream->request.exist("trailer") ||
         //     stream->request.exist("te")) {
         //     writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
@@ -440,19 +532,18 @@ void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
             writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
             return;
         }
+        stream->urgency = parseUrgency(stream->request.get("priority", ""), stream->urgency);
 
         auto service = this->service.lock();
         service->handleFilter(stream);
 
         if (stream->end_stream) {
             handleRequest(stream);
-
-            HttpConverter::convert2Http2(&stream->response);
-            Header header;
-            HPackUtil::encode(&stream->temp_buffer, resp_dynamic_table, header, stream->response);
-
             handleWrite();
         } else {
+            if (service->isStreaming(stream)) {
+                handleStreamingRequest(stream);
+            }
             readFrameHeader();
         }
     } else {
@@ -463,15 +554,7 @@ void sese::internal::service::http::HttpConnectionEx::handleHeadersFrame() {
 void sese::internal::service::http::HttpConnectionEx::handleDataFrame() {
     using namespace sese::net::http;
 
-    // if (keepalive) {
-    // keepalive = false;
-    timer.cancel();
-    // }
-
-    if (expect_ack) {
-        writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "expect ack");
-        return;
-    }
+    // The peer may send DATA before it acknowledges our SETTINGS, so expect_ack is not checked
 
     if (frame.ident == 0 ||
         frame.ident % 2 != 1) {
@@ -479,6 +562,21 @@ void sese::internal::service::http::HttpConnectionEx::handleDataFrame() {
         return;
     }
 
+    if (refused_streams.contains(frame.ident)) {
+        // The body of a refused stream is discarded, but it still counts against the window of the connection
+        if (frame.length > window_size) {
+            writeGoawayFrame(frame.ident, 0, GOAWAY_FLOW_CONTROL_ERROR, "");
+            return;
+        }
+        window_size -= frame.length;
+        if (frame.flags & FRAME_FLAG_END_STREAM) {
+            refused_streams.erase(frame.ident);
+        }
+        replenishWindows(nullptr);
+        readFrameHeader();
+        return;
+    }
+
     if (closed_streams.contains(frame.ident)) {
         writeGoawayFrame(frame.ident, 0, GOAWAY_STREAM_CLOSED, "");
         return;
@@ -492,6 +590,7 @@ void sese::internal::service::http::HttpConnectionEx::handleDataFrame() {
     auto stream = iterator->second;
     if (stream->end_stream) {
         writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
+        return;
     }
 
     stream->continue_type = frame.type;
@@ -505,32 +604,42 @@ void sese::internal::service::http::HttpConnectionEx::handleDataFrame() {
     window_size -= frame.length;
     stream->window_size -= frame.length;
 
-    if (window_size < INIT_WINDOW_SIZE / 2) {
-        writeWindowUpdateFrame(0, 0, INIT_WINDOW_SIZE);
-        window_size += INIT_WINDOW_SIZE;
-    }
-    if (stream->window_size < INIT_WINDOW_SIZE / 2) {
-        writeWindowUpdateFrame(stream->id, 0, INIT_WINDOW_SIZE);
-        stream->window_size += INIT_WINDOW_SIZE;
-    }
-
+    auto data = temp_buffer.data();
+    size_t length = frame.length;
     if (frame.flags & FRAME_FLAG_PADDED) {
-        uint8_t padded = temp_buffer[0];
-        if (padded > frame.length) {
+        // The Pad Length field is part of the payload, which an empty frame does not have
+        if (frame.length == 0 || temp_buffer[0] >= frame.length) {
             writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
             return;
         }
+        uint8_t padded = temp_buffer[0];
+        data = temp_buffer.data() + 1;
+        length = frame.length - padded - 1;
+    }
 
-        if (stream->conn_type != ConnType::FILTER) {
-            stream->request.getBody().write(temp_buffer + 1, frame.length - padded - 1);
-        }
-    } else {
-        if (stream->conn_type != ConnType::FILTER) {
-            stream->request.getBody().write(temp_buffer, frame.length);
-        }
+    // A full body stream holds back the window of the stream until the servlet drains it
+    bool more = true;
+    if (stream->body_stream) {
+        more = stream->body_stream->push(data, length);
+    } else if (stream->conn_type != ConnType::FILTER) {
+        stream->request.getBody().write(data, length);
     }
 
+    // Writing resumes reading into temp_buffer, so the PING and the windows are only queued after the payload is consumed
+    sampleBdp(frame.length);
+    replenishWindows(more ? stream : nullptr);
+
     if (frame.flags & FRAME_FLAG_END_STREAM) {
+        stream->end_stream = true;
+        if (stream->body_stream) {
+            stream->body_stream->finish();
+            if (stream->response_ready) {
+                stream->response_ready = false;
+                stream->do_response = true;
+            }
+            handleWrite();
+            return;
+        }
         if (stream->conn_type != ConnType::FILTER) {
             // If it is intercepted, the body will not be read,
             // and there is no need to verify the length
@@ -549,11 +658,6 @@ void sese::internal::service::http::HttpConnectionEx::handleDataFrame() {
         }
 
         handleRequest(stream);
-
-        HttpConverter::convert2Http2(&stream->response);
-        Header header;
-        HPackUtil::encode(&stream->temp_buffer, resp_dynamic_table, header, stream->response);
-
         handleWrite();
     } else {
         readFrameHeader();
@@ -586,7 +690,7 @@ void sese::internal::service::http::HttpConnectionEx::handleRstStreamFrame() {
     close(stream->id);
 
     uint32_t code;
-    memcpy(temp_buffer, &code, 4);
+    memcpy(temp_buffer.data(), &code, 4);
     code = FromBigEndian32(code);
 
     readFrameHeader();
@@ -608,7 +712,7 @@ void sese::internal::service::http::HttpConnectionEx::handlePriorityFrame() {
     HttpStream::Ptr stream;
     auto iterator = streams.find(frame.ident);
     if (iterator == streams.end()) {
-        stream = std::make_shared<HttpStream>(frame.ident, endpoint_init_window_size, remote_address);
+        stream = std::make_shared<HttpStream>(frame.ident, endpoint_init_window_size, options.stream_window_size, remote_address);
         streams[frame.ident] = stream;
         accept_stream_count += 1;
     } else {
@@ -621,11 +725,11 @@ void sese::internal::service::http::HttpConnectionEx::handlePriorityFrame() {
     uint32_t stream_dependency = 0;
     uint8_t weight = 0;
 
-    memcpy(&stream_dependency, temp_buffer, 4);
+    memcpy(&stream_dependency, temp_buffer.data(), 4);
     stream_dependency = FromBigEndian32(stream_dependency);
     exclusive_flag = (stream_dependency & 0x80000000) >> 31; // NOLINT
     stream_dependency &= 0x7FFFFFFF;
-    memcpy(&weight, temp_buffer + 4, 1);
+    memcpy(&weight, temp_buffer.data() + 4, 1);
 
     if (stream_dependency == frame.ident) {
         writeGoawayFrame(frame.ident, 0, GOAWAY_PROTOCOL_ERROR, "");
@@ -634,13 +738,31 @@ void sese::internal::service::http::HttpConnectionEx::handlePriorityFrame() {
     readFrameHeader();
 }
 
-void sese::internal::service::http::HttpConnectionEx::handlePingFrame() {
+void sese::internal::service::http::HttpConnectionEx::handlePriorityUpdateFrame() {
     using namespace sese::net::http;
+    if (frame.ident != 0) {
+        writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "");
+        return;
+    }
+    if (frame.length < 4) {
+        writeGoawayFrame(0, 0, GOAWAY_FRAME_SIZE_ERROR, "");
+        return;
+    }
 
-    // if (keepalive) {
-    // keepalive = false;
-    timer.cancel();
-    // }
+    uint32_t ident;
+    memcpy(&ident, temp_buffer.data(), 4);
+    ident = FromBigEndian32(ident) & 0x7FFFFFFF;
+    // Updates for streams that are not open are dropped
+    auto iterator = streams.find(ident);
+    if (iterator != streams.end()) {
+        auto &&stream = iterator->second;
+        stream->urgency = parseUrgency({temp_buffer.data() + 4, frame.length - 4}, stream->urgency);
+    }
+    readFrameHeader();
+}
+
+void sese::internal::service::http::HttpConnectionEx::handlePingFrame() {
+    using namespace sese::net::http;
 
     if (frame.ident != 0) {
         writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "", true);
@@ -651,7 +773,11 @@ void sese::internal::service::http::HttpConnectionEx::handlePingFrame() {
         return;
     }
     if (frame.flags & SETTINGS_FLAGS_ACK) {
-        writeGoawayFrame(0, 0, GOAWAY_PROTOCOL_ERROR, "unexpected ping with ack");
+        // Only the measuring PING is sent locally, other acknowledgements are ignored
+        if (bdp_ping_outstanding && 0 == memcmp(temp_buffer.data(), BDP_PING_PAYLOAD, 8)) {
+            updateBdp();
+        }
+        readFrameHeader();
         return;
     }
 
@@ -661,7 +787,7 @@ void sese::internal::service::http::HttpConnectionEx::handlePingFrame() {
     frame->ident = 0;
     frame->flags = SETTINGS_FLAGS_ACK;
     frame->buildFrameHeader();
-    memcpy(frame->getFrameContentBuffer(), temp_buffer, 8);
+    memcpy(frame->getFrameContentBuffer(), temp_buffer.data(), 8);
 
     pre_vector.push_back(std::move(frame));
     handleWrite();
@@ -670,8 +796,118 @@ void sese::internal::service::http::HttpConnectionEx::handlePingFrame() {
 void sese::internal::service::http::HttpConnectionEx::handleRequest(const HttpStream::Ptr &stream) { // NOLINT
     auto serv = service.lock();
     assert(serv);
-    serv->handleRequest(stream);
-    stream->do_response = true;
+    serv->handleRequest(stream, worker.io_context, [conn = getPtr(), stream] {
+        if (stream->conn_type == ConnType::EVENT_STREAM) {
+            // Invoked on the publishing thread
+            stream->event_subscriber->setNotifyCallback([weak_conn = std::weak_ptr(conn)] {
+                if (auto conn = weak_conn.lock()) {
+                    asio::post(conn->worker.io_context, [conn] { conn->handleWrite(); });
+                }
+            });
+        }
+        if (stream->response_streaming) {
+            stream->response_stream->setDataCallback([weak_conn = std::weak_ptr(conn)] {
+                if (auto conn = weak_conn.lock()) {
+                    asio::post(conn->worker.io_context, [conn] { conn->handleWrite(); });
+                }
+            });
+        }
+        if (stream->body_stream && !stream->end_stream) {
+            // Respond once the rest of the body has been drained
+            stream->response_ready = true;
+            return;
+        }
+        stream->do_response = true;
+        conn->handleWrite();
+    });
+}
+
+void sese::internal::service::http::HttpConnectionEx::handleStreamingRequest(const HttpStream::Ptr &stream) {
+    stream->body_stream = std::make_shared<sese::net::http::RequestBodyStream>(HttpServiceImpl::BODY_STREAM_CAPACITY);
+    stream->body_stream->setDrainCallback([weak_conn = std::weak_ptr(getPtr()), id = stream->id, body = stream->body_stream.get()] {
+        auto conn = weak_conn.lock();
+        if (!conn) {
+            return;
+        }
+        asio::post(conn->worker.io_context, [conn, id, body] {
+            auto iterator = conn->streams.find(id);
+            if (iterator == conn->streams.end() || iterator->second->body_stream.get() != body) {
+                return;
+            }
+            auto &&stream = iterator->second;
+            if (!stream->end_stream) {
+                conn->replenishWindows(stream);
+            }
+        });
+    });
+    handleRequest(stream);
+}
+
+void sese::internal::service::http::HttpConnectionEx::encodeHeaders(const HttpStream::Ptr &stream) {
+    using namespace sese::net::http;
+    HttpConverter::convert2Http2(&stream->response);
+    HPackUtil::encode(&stream->temp_buffer, resp_dynamic_table, stream->response);
+    stream->header_encoded = true;
+}
+
+uint8_t sese::internal::service::http::HttpConnectionEx::parseUrgency(std::string_view value, uint8_t urgency) {
+    // Structured field dictionary such as "u=1, i", only the urgency is used
+    while (!value.empty()) {
+        auto end = std::min(value.find(','), value.size());
+        auto item = value.substr(0, end);
+        value.remove_prefix(std::min(end + 1, value.size()));
+        while (!item.empty() && item.front() == ' ') {
+            item.remove_prefix(1);
+        }
+        if (item.size() >= 3 && item[0] == 'u' && item[1] == '=' && item[2] >= '0' && item[2] <= '7' &&
+            (item.size() == 3 || item[3] == ' ' || item[3] == ';')) {
+            urgency = static_cast<uint8_t>(item[2] - '0');
+        }
+    }
+    return urgency;
+}
+
+sese::internal::service::http::HttpStream::Ptr sese::internal::service::http::HttpConnectionEx::scheduleStream(const std::vector<uint32_t> &blocked) {
+    if (endpoint_window_size == 0) {
+        return nullptr;
+    }
+    HttpStream::Ptr result;
+    for (auto &&[id, stream]: streams) {
+        if (!stream->do_response || !stream->header_encoded || !stream->temp_buffer.eof() ||
+            stream->endpoint_window_size == 0 ||
+            std::find(blocked.begin(), blocked.end(), id) != blocked.end()) {
+            continue;
+        }
+        // The most urgent stream first, streams of the same urgency take turns
+        if (!result ||
+            stream->urgency < result->urgency ||
+            (stream->urgency == result->urgency && stream->scheduled < result->scheduled)) {
+            result = stream;
+        }
+    }
+    return result;
+}
+
+bool sese::internal::service::http::HttpConnectionEx::writeDataFrame(const HttpStream::Ptr &stream) {
+    if (stream->conn_type == ConnType::FILE_DOWNLOAD) {
+        if (stream->ranges.size() == 1) {
+            return writeDataFrame4SingleRange(stream);
+        }
+        if (stream->ranges.size() > 1) {
+            return writeDataFrame4Ranges(stream);
+        }
+        return false;
+    }
+    if (stream->response_streaming) {
+        return writeDataFrame4Stream(stream);
+    }
+    if (stream->conn_type == ConnType::EVENT_STREAM) {
+        return writeDataFrame4Events(stream);
+    }
+    if (!stream->response.getBody().eof()) {
+        return writeDataFrame4Body(stream);
+    }
+    return true;
 }
 
 void sese::internal::service::http::HttpConnectionEx::handleWrite() {
@@ -683,82 +919,71 @@ void sese::internal::service::http::HttpConnectionEx::handleWrite() {
         return;
     }
 
-    // if (keepalive) {
-    timer.cancel();
-    // }
-
+    // Header blocks are not flow controlled and must not be interleaved with other frames, so they are sent first
     for (auto &&current = streams.begin(); current != streams.end();) {
         auto stream = current->second;
         // The flow did not enter a response state
-        if (!stream->do_response) {
+        if (!stream->do_response || (stream->header_encoded && stream->temp_buffer.eof())) {
             ++current;
             continue;
         }
-        // General responses
-        if (stream->conn_type == ConnType::NONE ||
-            stream->conn_type == ConnType::FILTER ||
-            stream->conn_type == ConnType::CONTROLLER) {
-            if (!stream->temp_buffer.eof()) {
-                if (writeHeadersFrame(stream)) {
-                    current = streams.erase(current);
-                    closed_streams.emplace(stream->id);
-                } else {
-                    ++current;
-                }
-                continue;
-            }
-            if (!stream->response.getBody().eof()) {
-                if (writeDataFrame4Body(stream)) {
-                    current = streams.erase(current);
-                    closed_streams.emplace(stream->id);
-                } else {
-                    ++current;
-                }
-                continue;
-            }
-
+        // Responses may complete out of order, so the header block is encoded when it is about to be sent,
+        // which keeps the dynamic table in the same order as the peer decodes it
+        if (!stream->header_encoded) {
+            encodeHeaders(stream);
+        }
+        auto verify_end_stream = stream->conn_type != ConnType::FILE_DOWNLOAD &&
+                                 stream->conn_type != ConnType::EVENT_STREAM &&
+                                 !stream->response_streaming;
+        if (writeHeadersFrame(stream, verify_end_stream)) {
             current = streams.erase(current);
             closed_streams.emplace(stream->id);
-        }
-        // File downloads
-        else if (stream->conn_type == ConnType::FILE_DOWNLOAD) {
-            if (!stream->temp_buffer.eof()) {
-                writeHeadersFrame(stream, false); // NOLINT
-                ++current;
-                continue;
-            }
-            // Single range file
-            if (stream->ranges.size() == 1) {
-                if (writeDataFrame4SingleRange(stream)) {
-                    current = streams.erase(current);
-                    closed_streams.emplace(stream->id);
-                } else {
-                    ++current;
-                }
-            }
-            // Multi-range file
-            else if (stream->ranges.size() > 1) {
-                if (writeDataFrame4Ranges(stream)) {
-                    current = streams.erase(current);
-                    closed_streams.emplace(stream->id);
-                } else {
-                    ++current;
-                }
-            }
         } else {
             ++current;
         }
     }
 
+    // DATA frames of the ready streams are collected into a single write
+    size_t batch = 0;
+    std::vector<uint32_t> blocked;
+    while (batch < WRITE_BATCH_SIZE) {
+        auto stream = scheduleStream(blocked);
+        if (!stream) {
+            break;
+        }
+        auto count = pre_vector.size();
+        auto done = writeDataFrame(stream);
+        if (pre_vector.size() == count) {
+            // Nothing is available to be sent for now
+            blocked.emplace_back(stream->id);
+        } else {
+            auto length = pre_vector.back()->length;
+            endpoint_window_size -= length;
+            stream->endpoint_window_size -= length;
+            stream->scheduled = ++schedule_sequence;
+            batch += length + 9;
+        }
+        if (done) {
+            streams.erase(stream->id);
+            closed_streams.emplace(stream->id);
+        }
+    }
+
+    updateTimeout();
+
     if (!pre_vector.empty()) {
         vector.clear();
         vector.swap(pre_vector);
         asio_buffers.clear();
         asio_buffers.reserve(vector.size());
         for (auto &&item: vector) {
-            asio_buffers.emplace_back(asio::buffer(item->getFrameBuffer(), item->getFrameLength()));
+            if (item->payload) {
+                asio_buffers.emplace_back(asio::buffer(item->getFrameBuffer(), 9));
+                asio_buffers.emplace_back(asio::buffer(item->payload->data() + item->payload_offset, item->length));
+            } else {
+                asio_buffers.emplace_back(asio::buffer(item->getFrameBuffer(), item->getFrameLength()));
+            }
         }
-        checkKeepalive();
         writeBlocks(asio_buffers, [conn = getPtr()](const asio::error_code &ec) {
             if (ec) {
                 conn->disponse();
@@ -830,10 +1055,10 @@ void sese::internal::service::http::HttpConnectionEx::writeRstStreamFrame(
 void sese::internal::service::http::HttpConnectionEx::writeSettingsFrame() {
     using namespace sese::net::http;
     std::vector<std::pair<uint16_t, uint32_t>> values = {
-            {SETTINGS_INITIAL_WINDOW_SIZE, INIT_WINDOW_SIZE},
-            {SETTINGS_MAX_FRAME_SIZE, MAX_FRAME_SIZE},
+            {SETTINGS_INITIAL_WINDOW_SIZE, options.stream_window_size},
+            {SETTINGS_MAX_FRAME_SIZE, options.max_frame_size},
             {SETTINGS_HEADER_TABLE_SIZE, HEADER_TABLE_SIZE},
-            {SETTINGS_MAX_CONCURRENT_STREAMS, MAX_CONCURRENT_STREAMS}
+            {SETTINGS_MAX_CONCURRENT_STREAMS, options.max_concurrent_streams}
     };
 
     auto frame = std::make_unique<Http2Frame>(values.size() * 6);
@@ -856,6 +1081,11 @@ void sese::internal::service::http::HttpConnectionEx::writeSettingsFrame() {
 
     expect_ack = true;
     pre_vector.push_back(std::move(frame));
+    // The window of the connection is not covered by SETTINGS and can only be enlarged by WINDOW_UPDATE
+    if (window_size < connection_window_target) {
+        writeWindowUpdateFrame(0, 0, connection_window_target - window_size);
+        window_size = connection_window_target;
+    }
     handleWrite();
 }
 
@@ -868,6 +1098,67 @@ void sese::internal::service::http::HttpConnectionEx::writeAckFrame() {
     handleWrite();
 }
 
+void sese::internal::service::http::HttpConnectionEx::replenishWindows(const HttpStream::Ptr &stream) {
+    if (window_size < connection_window_target / 2) {
+        writeWindowUpdateFrame(0, 0, connection_window_target - window_size);
+        window_size = connection_window_target;
+    }
+    if (stream && stream->window_size < stream_window_target / 2) {
+        writeWindowUpdateFrame(stream->id, 0, stream_window_target - stream->window_size);
+        stream->window_size = stream_window_target;
+    }
+}
+
+void sese::internal::service::http::HttpConnectionEx::sampleBdp(uint32_t length) {
+    using namespace sese::net::http;
+    if (!options.auto_tune) {
+        return;
+    }
+    if (bdp_ping_outstanding) {
+        bdp_sample += length;
+        return;
+    }
+    if (stream_window_target >= options.max_window_size) {
+        return;
+    }
+
+    // The payload received until the ACK arrives is what the peer can send in one round trip
+    bdp_ping_outstanding = true;
+    bdp_ping_time = std::chrono::steady_clock::now();
+    bdp_sample = length;
+
+    auto frame = std::make_unique<Http2Frame>(8);
+    frame->type = FRAME_TYPE_PING;
+    frame->length = 8;
+    frame->ident = 0;
+    frame->flags = 0;
+    frame->buildFrameHeader();
+    memcpy(frame->getFrameContentBuffer(), BDP_PING_PAYLOAD, 8);
+    pre_vector.push_back(std::move(frame));
+    handleWrite();
+}
+
+void sese::internal::service::http::HttpConnectionEx::updateBdp() {
+    bdp_ping_outstanding = false;
+    auto rtt = std::chrono::duration<double>(std::chrono::steady_clock::now() - bdp_ping_time).count();
+    auto bandwidth = static_cast<double>(bdp_sample) / std::max(rtt, 1e-6);
+    // A sample far below the window means the peer is not limited by it,
+    // a lower bandwidth means the round trip was inflated by queuing rather than by the window
+    if (bdp_sample * 3 < static_cast<uint64_t>(stream_window_target) * 2 || bandwidth < bdp_bandwidth) {
+        return;
+    }
+    bdp_bandwidth = bandwidth;
+
+    auto target = static_cast<uint32_t>(std::min<uint64_t>(bdp_sample * 2, options.max_window_size));
+    if (target <= stream_window_target) {
+        return;
+    }
+    stream_window_target = target;
+    connection_window_target = std::max(connection_window_target, target);
+    // The open streams are enlarged by their next WINDOW_UPDATE
+    replenishWindows(nullptr);
+}
+
 void sese::internal::service::http::HttpConnectionEx::writeWindowUpdateFrame(uint32_t stream_id, uint8_t flags, uint32_t window_size) {
     auto frame = std::make_unique<sese::net::http::Http2Frame>(4);
     frame->type = sese::net::http::FRAME_TYPE_WINDOW_UPDATE;
@@ -882,16 +1173,42 @@ void sese::internal::service::http::HttpConnectionEx::writeWindowUpdateFrame(uin
 }
 
 bool sese::internal::service::http::HttpConnectionEx::writeHeadersFrame(const HttpStream::Ptr &stream, bool verify_end_stream) {
+    auto result = verify_end_stream && stream->response.getBody().eof();
+    auto type = sese::net::http::FRAME_TYPE_HEADERS;
+    while (!stream->temp_buffer.eof()) {
+        auto frame = std::make_unique<sese::net::http::Http2Frame>(max_frame_size);
+        frame->ident = stream->id;
+        auto len = stream->temp_buffer.read(frame->getFrameContentBuffer(), max_frame_size);
+        frame->type = type;
+        frame->length = static_cast<uint32_t>(len);
+        if (stream->temp_buffer.eof()) {
+            frame->flags |= sese::net::http::FRAME_FLAG_END_HEADERS;
+        }
+        // END_STREAM is only carried by the HEADERS frame
+        if (result && type == sese::net::http::FRAME_TYPE_HEADERS) {
+            frame->flags |= sese::net::http::FRAME_FLAG_END_STREAM;
+        }
+        frame->buildFrameHeader();
+        pre_vector.push_back(std::move(frame));
+        type = sese::net::http::FRAME_TYPE_CONTINUATION;
+    }
+    return result;
+}
+
+bool sese::internal::service::http::HttpConnectionEx::writeDataFrame4Body(const HttpStream::Ptr &stream) {
+    // The window size is insufficient
+    if (endpoint_window_size == 0 ||
+        stream->endpoint_window_size == 0) {
+        return false;
+    }
     auto result = false;
     auto frame = std::make_unique<sese::net::http::Http2Frame>(max_frame_size);
     frame->ident = stream->id;
-    auto len = stream->temp_buffer.read(frame->getFrameContentBuffer(), max_frame_size);
-    frame->type = sese::net::http::FRAME_TYPE_HEADERS;
+    auto remind = std::min({endpoint_window_size, stream->endpoint_window_size, max_frame_size});
+    auto len = stream->response.getBody().read(frame->getFrameContentBuffer(), remind);
+    frame->type = sese::net::http::FRAME_TYPE_DATA;
     frame->length = static_cast<uint32_t>(len);
-    if (stream->temp_buffer.eof()) {
-        frame->flags |= sese::net::http::FRAME_FLAG_END_HEADERS;
-    }
-    if (verify_end_stream && stream->response.getBody().eof()) {
+    if (stream->response.getBody().eof()) {
         frame->flags |= sese::net::http::FRAME_FLAG_END_STREAM;
         result = true;
     }
@@ -900,26 +1217,84 @@ bool sese::internal::service::http::HttpConnectionEx::writeHeadersFrame(const Ht
     return result;
 }
 
-bool sese::internal::service::http::HttpConnectionEx::writeDataFrame4Body(const HttpStream::Ptr &stream) {
-    // The window size is insufficient
+bool sese::internal::service::http::HttpConnectionEx::writeDataFrame4Stream(const HttpStream::Ptr &stream) {
+    // The window size is insufficient, resumed by WINDOW_UPDATE
     if (endpoint_window_size == 0 ||
         stream->endpoint_window_size == 0) {
         return false;
     }
-    auto result = false;
     auto frame = std::make_unique<sese::net::http::Http2Frame>(max_frame_size);
     frame->ident = stream->id;
     auto remind = std::min({endpoint_window_size, stream->endpoint_window_size, max_frame_size});
-    auto len = stream->response.getBody().read(frame->getFrameContentBuffer(), remind);
+    bool end;
+    auto len = stream->response_stream->take(frame->getFrameContentBuffer(), remind, end);
+    if (len == 0 && !end) {
+        // Nothing has been written yet, resumed by the data callback
+        return false;
+    }
     frame->type = sese::net::http::FRAME_TYPE_DATA;
     frame->length = static_cast<uint32_t>(len);
-    if (stream->response.getBody().eof()) {
+    if (end) {
         frame->flags |= sese::net::http::FRAME_FLAG_END_STREAM;
-        result = true;
     }
     frame->buildFrameHeader();
     pre_vector.push_back(std::move(frame));
-    return result;
+    return end;
+}
+
+bool sese::internal::service::http::HttpConnectionEx::writeDataFrame4Events(const HttpStream::Ptr &stream) {
+    // The window size is insufficient, resumed by WINDOW_UPDATE
+    if (endpoint_window_size == 0 ||
+        stream->endpoint_window_size == 0) {
+        return false;
+    }
+    auto remind = std::min({endpoint_window_size, stream->endpoint_window_size, max_frame_size});
+    // The body written by the servlet goes first
+    if (!stream->response.getBody().eof()) {
+        auto frame = std::make_unique<sese::net::http::Http2Frame>(max_frame_size);
+        frame->ident = stream->id;
+        auto len = stream->response.getBody().read(frame->getFrameContentBuffer(), remind);
+        frame->type = sese::net::http::FRAME_TYPE_DATA;
+        frame->length = static_cast<uint32_t>(len);
+        frame->buildFrameHeader();
+        pre_vector.push_back(std::move(frame));
+        return false;
+    }
+    if (stream->event_index == stream->events.size()) {
+        stream->events.clear();
+        stream->event_index = 0;
+        if (!stream->event_subscriber->take(stream->events)) {
+            // The peer fell too far behind, the stream ends so that it resumes from Last-Event-ID
+            auto frame = std::make_unique<sese::net::http::Http2Frame>(0);
+            frame->ident = stream->id;
+            frame->type = sese::net::http::FRAME_TYPE_DATA;
+            frame->length = 0;
+            frame->flags |= sese::net::http::FRAME_FLAG_END_STREAM;
+            frame->buildFrameHeader();
+            pre_vector.push_back(std::move(frame));
+            return true;
+        }
+        if (stream->events.empty()) {
+            // Resumed by the notify callback
+            return false;
+        }
+    }
+    auto &&event = stream->events[stream->event_index];
+    auto len = std::min<size_t>(remind, event->length() - stream->event_offset);
+    auto frame = std::make_unique<sese::net::http::Http2Frame>(0);
+    frame->ident = stream->id;
+    frame->type = sese::net::http::FRAME_TYPE_DATA;
+    frame->length = static_cast<uint32_t>(len);
+    frame->payload = event;
+    frame->payload_offset = stream->event_offset;
+    frame->buildFrameHeader();
+    pre_vector.push_back(std::move(frame));
+    stream->event_offset += len;
+    if (stream->event_offset == event->length()) {
+        stream->event_index += 1;
+        stream->event_offset = 0;
+    }
+    return false;
 }
 
 bool sese::internal::service::http::HttpConnectionEx::writeDataFrame4SingleRange(const HttpStream::Ptr &stream) {
@@ -1006,6 +1381,8 @@ bool sese::internal::service::http::HttpConnectionEx::writeDataFrame4Ranges(cons
         auto l = std::min<size_t>(stream->expect_length - stream->real_length, remind);
         stream->real_length += l;
         stream->file->read(frame->getFrameContentBuffer(), l);
+        frame->type = sese::net::http::FRAME_TYPE_DATA;
+        frame->length = static_cast<uint32_t>(l);
         frame->buildFrameHeader();
         pre_vector.push_back(std::move(frame));
     }
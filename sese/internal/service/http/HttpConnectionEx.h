@@ -23,19 +23,25 @@
 #include <sese/net/http/Http2Frame.h>
 #include <sese/internal/service/http/Handleable.h>
 #include <sese/net/IPv6Address.h>
+#include <sese/service/http/HttpService.h>
+#include <sese/util/TimeWheel.h>
 
+#include <chrono>
 #include <memory>
 #include <queue>
 #include <set>
+#include <string_view>
+#include <vector>
 
 
 namespace sese::internal::service::http {
 class HttpServiceImpl;
+struct HttpWorker;
 
 struct HttpStream : Handleable {
     using Ptr = std::shared_ptr<HttpStream>;
 
-    explicit HttpStream(uint32_t id, uint32_t write_window_size, const sese::net::IPAddress::Ptr &addr) noexcept;
+    explicit HttpStream(uint32_t id, uint32_t write_window_size, uint32_t read_window_size, const sese::net::IPAddress::Ptr &addr) noexcept;
 
     /// Initialize the current file compartment and iterate over the iterator
     void prepareRange();
@@ -43,12 +49,22 @@ struct HttpStream : Handleable {
     uint32_t id;
     /// Write to the peer window size
     uint32_t endpoint_window_size;
-    /// Local read window
-    uint32_t window_size = 0;
+    /// Local read window, starts at the initial window size advertised in the SETTINGS frame
+    uint32_t window_size;
     uint16_t continue_type = 0;
     bool end_headers = false;
     bool end_stream = false;
     bool do_response = false;
+    bool header_encoded = false;
+    /// Opened beyond the concurrency limit, its header block is only decoded to keep the dynamic table in sync
+    bool refused = false;
+    /// Urgency of RFC 9218, 0 is the most urgent
+    uint8_t urgency = 3;
+    /// Schedule sequence of the latest DATA frame, used to take turns between streams of the same urgency
+    uint64_t scheduled = 0;
+    /// Position of the next DATA frame in the events taken from the subscriber
+    size_t event_index = 0;
+    size_t event_offset = 0;
 
     size_t expect_length;
     size_t real_length;
@@ -63,16 +79,25 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
 
     Ptr getPtr() { return shared_from_this(); } // NOLINT
 
-    HttpConnectionEx(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &io_context, const sese::net::IPAddress::Ptr &addr);
+    HttpConnectionEx(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker, const sese::net::IPAddress::Ptr &addr);
 
-    virtual ~HttpConnectionEx() = default;
+    virtual ~HttpConnectionEx();
 
     bool keepalive = false;
-    asio::system_timer timer;
+    /// Pending timeout in the wheel of the worker, nullptr if none
+    TimeoutEvent *timeout = nullptr;
+    /// Timeout while no stream is open, the keepalive duration
+    uint32_t idle_timeout;
+    /// Timeout of the connection preface
+    uint32_t header_timeout;
+    /// Timeout between two frames while a request is being received
+    uint32_t body_timeout;
 
     sese::net::IPAddress::Ptr remote_address;
 
     std::weak_ptr<HttpServiceImpl> service;
+    /// The I/O loop that owns this connection
+    HttpWorker &worker;
 
     bool is_read = false;
     bool is_write = false;
@@ -80,19 +105,26 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
     uint32_t accept_stream_count = 0;
     uint32_t latest_stream_ident = 0;
 
-    // The maximum local frame size
+    // The maximum size of the frames written
     static constexpr uint32_t MAX_FRAME_SIZE = 16384;
-    // Local initial window value
-    static constexpr uint32_t INIT_WINDOW_SIZE = 65535;
+    // Initial window of the protocol, used until the SETTINGS frame is applied
+    static constexpr uint32_t DEFAULT_WINDOW_SIZE = 65535;
     // Default dynamic table size
     static constexpr uint32_t HEADER_TABLE_SIZE = 8192;
-    // The size of a single connection concurrency
-    static constexpr uint32_t MAX_CONCURRENT_STREAMS = 16;
+    // The maximum size of the table used to encode responses, the default of the peer
+    static constexpr uint32_t RESP_HEADER_TABLE_SIZE = 4096;
+    // DATA frames collected into a single write
+    static constexpr size_t WRITE_BATCH_SIZE = 4 * MAX_FRAME_SIZE;
+    // Opaque data of the PING measuring the round trip time
+    static constexpr char BDP_PING_PAYLOAD[8] = {'s', 'e', 's', 'e', '-', 'b', 'd', 'p'};
 
     sese::net::http::Http2FrameInfo frame{};
+    // Local settings, copied from the service
+    const sese::service::http::HttpService::Http2Options options;
     // Temporary cache, which is used to read the initial connection magic number and frame header,
-    // and take the maximum frame size
-    char temp_buffer[MAX_FRAME_SIZE]{};
+    // and take the maximum local frame size
+    std::vector<char> temp_buffer;
+    // The table size of the peer decoder
     uint32_t header_table_size = 4096;
     uint32_t enable_push = 0;
     uint32_t max_concurrent_stream = 0;
@@ -101,7 +133,19 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
     // Write to the peer window size
     uint32_t endpoint_window_size = 65535;
     // The size of the local read window
-    uint32_t window_size = 65535;
+    uint32_t window_size = DEFAULT_WINDOW_SIZE;
+    // Read window restored on each WINDOW_UPDATE of the connection, grown by the auto-tuning
+    uint32_t connection_window_target;
+    // Read window restored on each WINDOW_UPDATE of a stream, grown by the auto-tuning
+    uint32_t stream_window_target;
+    // Whether a PING measuring the round trip time is waiting for its ACK
+    bool bdp_ping_outstanding = false;
+    // Time at which the measuring PING was sent
+    std::chrono::steady_clock::time_point bdp_ping_time;
+    // DATA payload received since the measuring PING was sent
+    uint64_t bdp_sample = 0;
+    // Highest bandwidth observed in bytes per second
+    double bdp_bandwidth = 0;
     // The maximum size of the peer frame
     uint32_t endpoint_max_frame_size = 16384;
     // The frame size used
@@ -111,6 +155,9 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
     sese::net::http::DynamicTable resp_dynamic_table;
     std::map<uint32_t, HttpStream::Ptr> streams;
     std::set<uint32_t> closed_streams;
+    /// Streams refused before the end of their request, the DATA frames the peer sent meanwhile are discarded
+    std::set<uint32_t> refused_streams;
+    uint64_t schedule_sequence = 0;
 
     /// Send queues
     std::vector<sese::net::http::Http2Frame::Ptr> pre_vector;
@@ -121,10 +168,27 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
     /// @param id Stream ID
     void close(uint32_t id);
 
-    virtual void checkKeepalive() = 0;
+    /// Arm the timeout of the connection, replacing the pending one
+    /// @param seconds Timeout duration
+    void setTimeout(uint32_t seconds);
+
+    void cancelTimeout();
+
+    /// Stop the timeout while the server holds up the connection, keeping the event for the next setTimeout
+    void suspendTimeout();
+
+    /// Arm the timeout matching the state of the streams, called whenever a frame is read or written
+    void updateTimeout();
+
+    /// Close the socket when the timeout expires, so that the pending operations complete with an error
+    /// @note This function must be implemented
+    virtual void closeSocket() = 0;
 
     void disponse();
 
+    /// Wake up the streaming servlets of all streams, called when the connection is lost
+    void abortStreams();
+
     /// Write block function. This function ensures that the specified buffer is completely written,
     /// and calls back immediately if an error occurs
     /// @param buffers Buffer
@@ -168,10 +232,37 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
 
     void handlePriorityFrame();
 
+    /// Update the urgency of a stream, see RFC 9218 section 7.1
+    void handlePriorityUpdateFrame();
+
     void handlePingFrame();
 
     void handleRequest(const HttpStream::Ptr &stream);
 
+    /// Start a streaming servlet, the DATA frames of the stream are then fed to its body stream
+    /// @param stream Operating stream
+    void handleStreamingRequest(const HttpStream::Ptr &stream);
+
+    /// Convert the response and encode it into the header block of the stream
+    /// @param stream Operating stream
+    void encodeHeaders(const HttpStream::Ptr &stream);
+
+    /// Parse the urgency of a priority field value
+    /// @param value Field value such as "u=1, i"
+    /// @param urgency Urgency used if the value does not specify one
+    /// @return Urgency
+    static uint8_t parseUrgency(std::string_view value, uint8_t urgency);
+
+    /// Select the stream whose DATA frame is sent next
+    /// @param blocked Streams that have nothing to send at the moment
+    /// @return nullptr if no stream can be sent
+    HttpStream::Ptr scheduleStream(const std::vector<uint32_t> &blocked);
+
+    /// Write the next DATA frame of a stream, the caller accounts for the windows
+    /// @param stream Operating stream
+    /// @return Whether the current stream has been fully processed
+    bool writeDataFrame(const HttpStream::Ptr &stream);
+
     void handleWrite();
 
     void writeSettingsFrame();
@@ -199,6 +290,17 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
         uint32_t window_size
     );
 
+    /// Restore the read windows that fell below half of their targets
+    /// @param stream Stream that received a DATA frame, nullptr to only check the connection
+    void replenishWindows(const HttpStream::Ptr &stream);
+
+    /// Count the DATA payload for the bandwidth-delay product estimation, starting a measurement if none is running
+    /// @param length Payload length of the DATA frame
+    void sampleBdp(uint32_t length);
+
+    /// Grow the window targets from the sample of the measurement that just finished
+    void updateBdp();
+
     /// Write HEADERS frame
     /// @param stream Operating stream
     /// @param verify_end_stream Whether to determine END_STREAM through response body
@@ -210,6 +312,17 @@ struct HttpConnectionEx : std::enable_shared_from_this<HttpConnectionEx> {
     /// @return Whether the current stream has been fully processed
     bool writeDataFrame4Body(const HttpStream::Ptr &stream);
 
+    /// Write the body streamed by the servlet into a DATA frame, limited by the windows of the peer
+    /// @param stream Operating stream
+    /// @return Whether the current stream has been fully processed
+    bool writeDataFrame4Stream(const HttpStream::Ptr &stream);
+
+    /// Write the events published to the subscribed topic into a DATA frame referencing the shared event,
+    /// limited by the windows of the peer
+    /// @param stream Operating stream
+    /// @return Whether the current stream has been fully processed
+    bool writeDataFrame4Events(const HttpStream::Ptr &stream);
+
     /// Write single-range file response into a DATA frame
     /// @param stream Operating stream
     /// @return Whether the current stream has been fully processed
@@ -238,7 +351,7 @@ struct HttpConnectionExImpl final : HttpConnectionEx {
 
     SharedSocket socket;
 
-    HttpConnectionExImpl(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &context,
+    HttpConnectionExImpl(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker,
                          const sese::net::IPAddress::Ptr &addr, SharedSocket socket);
 
     void writeBlocks(const std::vector<asio::const_buffer> &buffers,
@@ -250,7 +363,7 @@ struct HttpConnectionExImpl final : HttpConnectionEx {
     void readBlock(char *buffer, size_t length,
                    const std::function<void(const asio::error_code &code)> &callback) override;
 
-    void checkKeepalive() override;
+    void closeSocket() override;
 };
 
 struct HttpsConnectionExImpl final : HttpConnectionEx {
@@ -261,8 +374,10 @@ struct HttpsConnectionExImpl final : HttpConnectionEx {
     Ptr getPtr() { return std::reinterpret_pointer_cast<HttpsConnectionExImpl>(shared_from_this()); } // NOLINT
 
     SharedStream stream;
+    /// OpenSSL writes to the socket itself, see AsioSSLDirect
+    bool direct;
 
-    HttpsConnectionExImpl(const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &context,
+    HttpsConnectionExImpl(const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker,
                           const sese::net::IPAddress::Ptr &addr, SharedStream stream);
 
     void writeBlocks(const std::vector<asio::const_buffer> &buffers,
@@ -274,7 +389,7 @@ struct HttpsConnectionExImpl final : HttpConnectionEx {
     void readBlock(char *buffer, size_t length,
                    const std::function<void(const asio::error_code &code)> &callback) override;
 
-    void checkKeepalive() override;
+    void closeSocket() override;
 };
 
 }
\ No newline at end of file
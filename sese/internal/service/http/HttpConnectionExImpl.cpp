@@ -14,14 +14,15 @@
 
 #include <sese/Config.h>
 #include <sese/internal/service/http/HttpConnectionEx.h>
+#include <sese/internal/net/AsioSSLDirect.h>
 
 sese::internal::service::http::HttpConnectionExImpl::HttpConnectionExImpl(
         const std::shared_ptr<HttpServiceImpl> &service,
-        asio::io_context &context,
+        HttpWorker &worker,
         const sese::net::IPAddress::Ptr &addr,
         SharedSocket socket
 )
-    : HttpConnectionEx(service, context, addr),
+    : HttpConnectionEx(service, worker, addr),
       socket(std::move(socket)) {
 }
 
@@ -59,29 +60,31 @@ void sese::internal::service::http::HttpConnectionExImpl::readBlock(char *buffer
     );
 }
 
-void sese::internal::service::http::HttpConnectionExImpl::checkKeepalive() {
-    // if (keepalive) {
-    timer.async_wait([conn = getPtr()](const asio::error_code &error) {
-        if (error == asio::error::operation_aborted) {
-        } else {
-            conn->socket->close();
-        }
-    });
-    // }
+void sese::internal::service::http::HttpConnectionExImpl::closeSocket() {
+    asio::error_code error;
+    this->socket->close(error);
 }
 
 sese::internal::service::http::HttpsConnectionExImpl::HttpsConnectionExImpl(
         const std::shared_ptr<HttpServiceImpl> &service,
-        asio::io_context &context,
+        HttpWorker &worker,
         const sese::net::IPAddress::Ptr &addr,
         SharedStream stream
 )
-    : HttpConnectionEx(service, context, addr),
+    : HttpConnectionEx(service, worker, addr),
       stream(std::move(stream)) {
+    direct = net::AsioSSLDirect::isAttached(*this->stream);
 }
 
 void sese::internal::service::http::HttpsConnectionExImpl::writeBlocks(const std::vector<asio::const_buffer> &buffers, const std::function<void(const asio::error_code &code)> &callback) {
     is_write = true;
+    if (direct) {
+        net::AsioSSLDirect::write(this->stream, buffers, [conn = getPtr(), callback](const asio::error_code &error) {
+            conn->is_write = false;
+            callback(error);
+        });
+        return;
+    }
     async_write(*this->stream, buffers, [conn = getPtr(), callback](const asio::error_code &error, size_t) {
         conn->is_write = false;
         callback(error);
@@ -90,6 +93,13 @@ void sese::internal::service::http::HttpsConnectionExImpl::writeBlocks(const std
 
 void sese::internal::service::http::HttpsConnectionExImpl::writeBlock(const void *buffer, size_t size, const std::function<void(const asio::error_code &code)> &callback) {
     is_write = true;
+    if (direct) {
+        net::AsioSSLDirect::write(this->stream, static_cast<const char *>(buffer), size, [conn = getPtr(), callback](const asio::error_code &error) {
+            conn->is_write = false;
+            callback(error);
+        });
+        return;
+    }
     async_write(*this->stream, asio::buffer(buffer, size), [conn = getPtr(), callback](const asio::error_code &error, size_t) {
         conn->is_write = false;
         callback(error);
@@ -108,13 +118,7 @@ void sese::internal::service::http::HttpsConnectionExImpl::readBlock(char *buffe
     });
 }
 
-void sese::internal::service::http::HttpsConnectionExImpl::checkKeepalive() {
-    // if (keepalive) {
-    timer.async_wait([conn = getPtr()](const asio::error_code &error) {
-        if (error == asio::error::operation_aborted) {
-        } else {
-            conn->stream->lowest_layer().close();
-        }
-    });
-    // }
+void sese::internal::service::http::HttpsConnectionExImpl::closeSocket() {
+    asio::error_code error;
+    this->stream->lowest_layer().close(error);
 }
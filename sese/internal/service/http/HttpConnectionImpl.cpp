@@ -14,84 +14,155 @@
 
 #include <sese/internal/service/http/HttpServiceImpl.h>
 #include <sese/internal/net/AsioIPConvert.h>
+#include <sese/internal/net/AsioSSLDirect.h>
+
+#ifdef SESE_PLATFORM_LINUX
+#include <sys/sendfile.h>
+#endif
 
 sese::internal::service::http::HttpConnectionImpl::HttpConnectionImpl(
         const std::shared_ptr<HttpServiceImpl> &service,
-        asio::io_context &context,
+        HttpWorker &worker,
         const sese::net::IPAddress::Ptr &addr,
         SharedSocket socket
 )
-    : HttpConnection(service, context, addr), socket(std::move(socket)) {
+    : HttpConnection(service, worker, addr), socket(std::move(socket)) {
 }
 
-void sese::internal::service::http::HttpConnectionImpl::writeBlock(const char *buffer, size_t length, const std::function<void(const asio::error_code &code)> &callback) {
-    async_write(*this->socket, asio::buffer(buffer, length), [conn = shared_from_this(), buffer, length, callback](const asio::error_code &error, std::size_t wrote) {
+void sese::internal::service::http::HttpConnectionImpl::writeBlock(const char *buffer, size_t length, std::function<void(const asio::error_code &code)> callback) {
+    async_write(*this->socket, asio::buffer(buffer, length), [conn = shared_from_this(), buffer, length, callback = std::move(callback)](const asio::error_code &error, std::size_t wrote) mutable {
         if (error || wrote == length) {
             callback(error);
         } else {
-            conn->writeBlock(buffer + wrote, length - wrote, callback);
+            conn->writeBlock(buffer + wrote, length - wrote, std::move(callback));
         }
     });
 }
 
-void sese::internal::service::http::HttpConnectionImpl::asyncReadSome(const asio::mutable_buffers_1 &buffer, const std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> &callback) {
-    this->socket->async_read_some(buffer, callback);
+void sese::internal::service::http::HttpConnectionImpl::writeBlocks(const std::vector<asio::const_buffer> &buffers, std::function<void(const asio::error_code &code)> callback) {
+    async_write(*this->socket, buffers, [conn = shared_from_this(), callback = std::move(callback)](const asio::error_code &error, std::size_t) {
+        callback(error);
+    });
 }
 
-void sese::internal::service::http::HttpConnectionImpl::checkKeepalive() {
-    if (this->keepalive) {
-        this->reset();
-        this->timer.async_wait([conn = getPtr()](const asio::error_code &error) {
-            if (error.value() == asio::error::operation_aborted) {
-            } else {
-                conn->socket->cancel();
-                conn->disponse();
-            }
-        });
-        this->readHeader();
-    } else {
-        this->disponse();
+void sese::internal::service::http::HttpConnectionImpl::asyncReadSome(const asio::mutable_buffers_1 &buffer, std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> callback) {
+    this->socket->async_read_some(buffer, std::move(callback));
+}
+
+bool sese::internal::service::http::HttpConnectionImpl::sendFile(int fd, int64_t offset, size_t length, const std::function<void(const asio::error_code &code)> &callback) {
+#ifdef SESE_PLATFORM_LINUX
+    asio::error_code error;
+    this->socket->native_non_blocking(true, error);
+    if (error) {
+        return false;
+    }
+    doSendFile(fd, offset, length, callback);
+    return true;
+#else
+    return HttpConnection::sendFile(fd, offset, length, callback);
+#endif
+}
+
+#ifdef SESE_PLATFORM_LINUX
+void sese::internal::service::http::HttpConnectionImpl::doSendFile(int fd, int64_t offset, size_t length, const std::function<void(const asio::error_code &code)> &callback) {
+    size_t budget = SENDFILE_BUDGET;
+    while (length && budget) {
+        auto off = static_cast<off_t>(offset);
+        auto wrote = ::sendfile(this->socket->native_handle(), fd, &off, std::min(length, budget));
+        if (wrote > 0) {
+            offset += wrote;
+            length -= wrote;
+            budget -= wrote;
+        } else if (wrote == 0) {
+            // The file has been truncated
+            callback(asio::error::eof);
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            callback(asio::error_code(errno, asio::error::get_system_category()));
+            return;
+        }
     }
+    if (length == 0) {
+        callback({});
+        return;
+    }
+    // Wait until the socket is writable again or the loop has handled others
+    this->socket->async_wait(Socket::wait_write, [conn = getPtr(), fd, offset, length, callback](const asio::error_code &error) {
+        if (error) {
+            callback(error);
+            return;
+        }
+        conn->doSendFile(fd, offset, length, callback);
+    });
+}
+#endif
+
+void sese::internal::service::http::HttpConnectionImpl::closeSocket() {
+    asio::error_code error;
+    this->socket->close(error);
 }
 
 sese::internal::service::http::HttpsConnectionImpl::HttpsConnectionImpl(
-        const std::shared_ptr<HttpServiceImpl> &service, asio::io_context &context,
+        const std::shared_ptr<HttpServiceImpl> &service, HttpWorker &worker,
         const sese::net::IPAddress::Ptr &addr, SharedStream stream
 )
-    : HttpConnection(service, context, addr), stream(std::move(stream)) {
+    : HttpConnection(service, worker, addr), stream(std::move(stream)) {
+    direct = net::AsioSSLDirect::isAttached(*this->stream);
     remote_address = net::convert(this->stream->next_layer().remote_endpoint());
 }
 
 sese::internal::service::http::HttpsConnectionImpl::~HttpsConnectionImpl() {
+    if (direct) {
+        net::AsioSSLDirect::shutdown(*this->stream);
+        return;
+    }
     asio::error_code error = this->stream->shutdown(error);
 }
 
-void sese::internal::service::http::HttpsConnectionImpl::writeBlock(const char *buffer, size_t length, const std::function<void(const asio::error_code &code)> &callback) {
-    this->stream->async_write_some(asio::buffer(buffer, length), [conn = getPtr(), buffer, length, callback](const asio::error_code &error, size_t wrote) {
+void sese::internal::service::http::HttpsConnectionImpl::writeBlock(const char *buffer, size_t length, std::function<void(const asio::error_code &code)> callback) {
+    if (direct) {
+        net::AsioSSLDirect::write(this->stream, buffer, length, [conn = getPtr(), callback = std::move(callback)](const asio::error_code &error) {
+            callback(error);
+        });
+        return;
+    }
+    this->stream->async_write_some(asio::buffer(buffer, length), [conn = getPtr(), buffer, length, callback = std::move(callback)](const asio::error_code &error, size_t wrote) mutable {
         if (error || wrote == length) {
             callback(error);
         } else {
-            conn->writeBlock(buffer + wrote, length - wrote, callback);
+            conn->writeBlock(buffer + wrote, length - wrote, std::move(callback));
         }
     });
 }
 
-void sese::internal::service::http::HttpsConnectionImpl::asyncReadSome(const asio::mutable_buffers_1 &buffer, const std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> &callback) {
-    this->stream->async_read_some(buffer, callback);
-}
-
-void sese::internal::service::http::HttpsConnectionImpl::checkKeepalive() {
-    if (this->keepalive) {
-        this->reset();
-        this->timer.async_wait([conn = getPtr()](const asio::error_code &error) {
-            if (error == asio::error::operation_aborted) {
-            } else {
-                conn->stream->lowest_layer().cancel();
-                conn->disponse();
-            }
+void sese::internal::service::http::HttpsConnectionImpl::writeBlocks(const std::vector<asio::const_buffer> &buffers, std::function<void(const asio::error_code &code)> callback) {
+    if (direct) {
+        net::AsioSSLDirect::write(this->stream, buffers, [conn = getPtr(), callback = std::move(callback)](const asio::error_code &error) {
+            callback(error);
         });
-        this->readHeader();
-    } else {
-        this->disponse();
+        return;
     }
+    async_write(*this->stream, buffers, [conn = getPtr(), callback = std::move(callback)](const asio::error_code &error, std::size_t) {
+        callback(error);
+    });
+}
+
+void sese::internal::service::http::HttpsConnectionImpl::asyncReadSome(const asio::mutable_buffers_1 &buffer, std::function<void(const asio::error_code &error, std::size_t bytes_transferred)> callback) {
+    this->stream->async_read_some(buffer, std::move(callback));
+}
+
+bool sese::internal::service::http::HttpsConnectionImpl::sendFile(int fd, int64_t offset, size_t length, const std::function<void(const asio::error_code &code)> &callback) {
+    // Without kTLS the file is encrypted in user space through the buffered path
+    return direct && net::AsioSSLDirect::sendFile(this->stream, fd, offset, length, [conn = getPtr(), callback](const asio::error_code &error) {
+        callback(error);
+    });
+}
+
+void sese::internal::service::http::HttpsConnectionImpl::closeSocket() {
+    asio::error_code error;
+    this->stream->lowest_layer().close(error);
 }
@@ -0,0 +1,350 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/service/http/HttpFileCache.h>
+#include <sese/net/http/HttpUtil.h>
+#include <sese/text/DateTimeFormatter.h>
+#include <sese/util/DateTime.h>
+#include <sese/util/Util.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+
+#ifdef SESE_PLATFORM_LINUX
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+sese::internal::service::http::HttpFileCache::HttpFileCache(size_t capacity, std::vector<std::string> sibling_suffixes)
+    : capacity(capacity), sibling_suffixes(std::move(sibling_suffixes)) {
+}
+
+sese::internal::service::http::HttpFileCache::~HttpFileCache() {
+#ifdef SESE_PLATFORM_LINUX
+    if (thread) {
+        uint64_t value = 1;
+        [[maybe_unused]] auto len = ::write(wake_fd, &value, sizeof(value));
+        thread->join();
+    }
+    if (inotify_fd != -1) {
+        close(inotify_fd);
+        close(wake_fd);
+    }
+#else
+    // The callbacks lock the mutex, so the notifiers are stopped without holding it
+    for (auto &&[dir, watch]: watches) {
+        if (watch.notifier) {
+            watch.notifier->shutdown();
+        }
+    }
+#endif
+}
+
+sese::internal::service::http::HttpFileCache::Entry::Ptr sese::internal::service::http::HttpFileCache::load(const std::string &path) const {
+    std::error_code error;
+    auto filename = std::filesystem::path(path);
+    auto status = std::filesystem::status(filename, error);
+    if (error || !std::filesystem::is_regular_file(status)) {
+        return nullptr;
+    }
+    auto size = std::filesystem::file_size(filename, error);
+    if (error) {
+        return nullptr;
+    }
+    auto last_write_time = std::filesystem::last_write_time(filename, error);
+    if (error) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<Entry>();
+    entry->size = size;
+    entry->mtime = to_time_t(last_write_time);
+    if (filename.has_extension()) {
+        auto ext = filename.extension().string().substr(1);
+        auto type = sese::net::http::HttpUtil::content_type_map.find(ext);
+        if (type != sese::net::http::HttpUtil::content_type_map.end()) {
+            entry->content_type = type->second;
+        }
+    }
+    uint64_t time = entry->mtime * 1000 * 1000;
+    entry->last_modified = text::DateTimeFormatter::format(DateTime(time, 0), TIME_GREENWICH_MEAN_PATTERN);
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%" PRIx64 "-%zx\"", static_cast<uint64_t>(entry->mtime), entry->size);
+    entry->etag = etag;
+    // Looked up once here, so that the absence of a sibling is cached with the file
+    for (size_t i = 0; i < sibling_suffixes.size(); ++i) {
+        if (std::filesystem::is_regular_file(path + sibling_suffixes[i], error)) {
+            entry->siblings |= 1u << i;
+        }
+    }
+    return entry;
+}
+
+sese::internal::service::http::HttpFileCache::Entry::Ptr sese::internal::service::http::HttpFileCache::get(const std::string &path) {
+    if (capacity == 0) {
+        return load(path);
+    }
+
+    auto filename = std::filesystem::path(path).lexically_normal();
+    auto key = filename.string();
+    uint64_t current_generation;
+    {
+        std::lock_guard lock(mutex);
+        auto iterator = map.find(key);
+        if (iterator != map.end()) {
+            list.splice(list.begin(), list, iterator->second);
+            return iterator->second->entry;
+        }
+        current_generation = generation;
+    }
+
+    auto entry = load(key);
+    if (!entry) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(mutex);
+    // Invalidated while loading, the metadata may already be stale
+    if (current_generation != generation || map.count(key)) {
+        return entry;
+    }
+    auto dir = filename.parent_path().string();
+    if (!watch(dir)) {
+        return entry;
+    }
+    list.emplace_front(Item{key, std::move(dir), entry, nullptr});
+    map[key] = list.begin();
+    while (list.size() > capacity) {
+        erase(std::prev(list.end()));
+    }
+    return entry;
+}
+
+sese::io::File::Ptr sese::internal::service::http::HttpFileCache::open(const std::string &path) {
+    if (capacity == 0) {
+        return io::File::create(path, io::File::B_READ);
+    }
+
+    auto key = std::filesystem::path(path).lexically_normal().string();
+    Entry::Ptr entry;
+    {
+        std::lock_guard lock(mutex);
+        auto iterator = map.find(key);
+        if (iterator == map.end()) {
+            return io::File::create(path, io::File::B_READ);
+        }
+        auto &&item = *iterator->second;
+        // The descriptor is shared with the cache only, so its position can be reused
+        if (item.file && item.file.use_count() == 1) {
+            return item.file;
+        }
+        if (item.file) {
+            return io::File::create(path, io::File::B_READ);
+        }
+        entry = item.entry;
+    }
+
+    auto file = io::File::create(path, io::File::B_READ);
+    if (!file) {
+        return nullptr;
+    }
+    std::lock_guard lock(mutex);
+    // Keep the descriptor only if it still belongs to the cached metadata
+    auto iterator = map.find(key);
+    if (iterator != map.end() && iterator->second->entry == entry && !iterator->second->file) {
+        iterator->second->file = file;
+    }
+    return file;
+}
+
+#ifdef SESE_PLATFORM_LINUX
+
+bool sese::internal::service::http::HttpFileCache::watch(const std::string &dir) {
+    auto iterator = watches.find(dir);
+    if (iterator != watches.end()) {
+        iterator->second.count += iterator->second.wd != -1;
+        return iterator->second.wd != -1;
+    }
+
+    if (inotify_fd == -1) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd == -1) {
+            return false;
+        }
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (wake_fd == -1) {
+            close(inotify_fd);
+            inotify_fd = -1;
+            return false;
+        }
+        thread = std::make_unique<Thread>([this] { readEvents(); }, "HttpFileCache");
+        thread->start();
+    }
+
+    // A moved or deleted directory drops its entries, as the watch no longer matches the path
+    auto wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVE | IN_DELETE_SELF | IN_MOVE_SELF);
+    // Another path of the same directory would share the watch, its files are not cached
+    if (wd != -1 && watch_dirs.count(wd)) {
+        wd = -1;
+    }
+    auto &&watch = watches[dir];
+    watch.wd = wd;
+    if (wd == -1) {
+        return false;
+    }
+    watch.count = 1;
+    watch_dirs[wd] = dir;
+    return true;
+}
+
+sese::internal::service::http::HttpFileCache::List::iterator sese::internal::service::http::HttpFileCache::erase(List::iterator iterator) {
+    auto watch = watches.find(iterator->dir);
+    if (watch != watches.end() && --watch->second.count == 0) {
+        inotify_rm_watch(inotify_fd, watch->second.wd);
+        watch_dirs.erase(watch->second.wd);
+        watches.erase(watch);
+    }
+    map.erase(iterator->path);
+    return list.erase(iterator);
+}
+
+void sese::internal::service::http::HttpFileCache::readEvents() {
+    pollfd fds[2]{{inotify_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+    // Events are variable-length, keep the buffer aligned for inotify_event
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        auto len = read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            continue;
+        }
+        for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event *>(ptr)->len) {
+            auto event = reinterpret_cast<inotify_event *>(ptr);
+            if (event->mask & IN_Q_OVERFLOW) {
+                clear();
+                continue;
+            }
+            std::string path;
+            {
+                std::lock_guard lock(mutex);
+                auto dir = watch_dirs.find(event->wd);
+                // Removed with its last entry
+                if (dir == watch_dirs.end()) {
+                    continue;
+                }
+                path = dir->second;
+            }
+            if (event->len) {
+                path = (std::filesystem::path(path) / event->name).string();
+            }
+            invalidate(path);
+        }
+    }
+}
+
+#else
+
+bool sese::internal::service::http::HttpFileCache::watch(const std::string &dir) {
+    auto iterator = watches.find(dir);
+    if (iterator != watches.end()) {
+        iterator->second.count += iterator->second.notifier != nullptr;
+        return iterator->second.notifier != nullptr;
+    }
+
+    auto notifier = system::FileNotifier::create(dir);
+    if (notifier) {
+        auto on_change = [this, dir](std::string_view name) {
+            invalidate((std::filesystem::path(dir) / name).string());
+        };
+        notifier->setOnCreate(on_change);
+        notifier->setOnModify(on_change);
+        notifier->setOnDelete(on_change);
+        notifier->setOnMove([on_change](std::string_view src, std::string_view dst) {
+            on_change(src);
+            on_change(dst);
+        });
+        notifier->start();
+    }
+    auto &&watch = watches[dir];
+    watch.notifier = std::move(notifier);
+    watch.count = watch.notifier != nullptr;
+    return watch.notifier != nullptr;
+}
+
+sese::internal::service::http::HttpFileCache::List::iterator sese::internal::service::http::HttpFileCache::erase(List::iterator iterator) {
+    // Stopping a notifier waits for its callback, which may be waiting for the mutex, so it runs until the cache is destroyed
+    auto watch = watches.find(iterator->dir);
+    if (watch != watches.end() && watch->second.count) {
+        --watch->second.count;
+    }
+    map.erase(iterator->path);
+    return list.erase(iterator);
+}
+
+#endif
+
+void sese::internal::service::http::HttpFileCache::invalidate(const std::string &path) {
+    std::lock_guard lock(mutex);
+    generation += 1;
+    for (auto iterator = list.begin(); iterator != list.end();) {
+        auto &&item_path = iterator->path;
+        if (item_path.compare(0, path.length(), path) == 0 &&
+            (item_path.length() == path.length() || item_path[path.length()] == std::filesystem::path::preferred_separator)) {
+            iterator = erase(iterator);
+        } else {
+            ++iterator;
+        }
+    }
+    for (auto &&suffix: sibling_suffixes) {
+        if (path.length() > suffix.length() && path.compare(path.length() - suffix.length(), suffix.length(), suffix) == 0) {
+            auto iterator = map.find(path.substr(0, path.length() - suffix.length()));
+            if (iterator != map.end()) {
+                erase(iterator->second);
+            }
+        }
+    }
+}
+
+void sese::internal::service::http::HttpFileCache::clear() {
+    std::lock_guard lock(mutex);
+    generation += 1;
+    while (!list.empty()) {
+        erase(list.begin());
+    }
+}
+
+size_t sese::internal::service::http::HttpFileCache::size() {
+    std::lock_guard lock(mutex);
+    return list.size();
+}
+
+size_t sese::internal::service::http::HttpFileCache::watchCount() {
+    std::lock_guard lock(mutex);
+    size_t count = 0;
+    for (auto &&[dir, watch]: watches) {
+        count += watch.count != 0;
+    }
+    return count;
+}
@@ -0,0 +1,139 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sese/Config.h>
+#include <sese/io/File.h>
+#include <sese/system/FileNotifier.h>
+#include <sese/thread/Thread.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sese::internal::service::http {
+
+/// Bounded LRU cache of the metadata and descriptors of mounted static files.
+/// Entries are invalidated by watching the directory of each cached file, a directory is no longer watched
+/// once its last entry is dropped. On Linux all directories share one inotify descriptor read by one thread,
+/// elsewhere each directory has a FileNotifier
+class HttpFileCache {
+public:
+    /// Immutable metadata of a regular file
+    struct Entry {
+        using Ptr = std::shared_ptr<const Entry>;
+
+        size_t size = 0;
+        /// Last modification time in seconds since the epoch
+        int64_t mtime = 0;
+        /// Resolved from the extension, empty if unknown
+        std::string content_type;
+        /// Formatted for the last-modified header
+        std::string last_modified;
+        /// Validator derived from the modification time and the size, including the quotes
+        std::string etag;
+        /// Bit i is set if the file named with the i-th sibling suffix of the cache exists next to it
+        uint32_t siblings = 0;
+    };
+
+    /// @param capacity Maximum number of entries, 0 disables caching
+    /// @param sibling_suffixes Suffixes of the files whose existence is recorded in the entries, such as precompressed variants
+    explicit HttpFileCache(size_t capacity, std::vector<std::string> sibling_suffixes = {});
+
+    ~HttpFileCache();
+
+    /// Look up the metadata of a regular file without opening it
+    /// @param path File path
+    /// @return nullptr if the file does not exist or is not a regular file
+    Entry::Ptr get(const std::string &path);
+
+    /// Open a file for reading
+    /// @param path File path
+    /// @return The cached descriptor if no other connection is using it, otherwise a new one, nullptr if failed
+    io::File::Ptr open(const std::string &path);
+
+    /// Drop the entry of the path and every entry below it, or the entry of the file a sibling belongs to
+    /// @param path File or directory path
+    void invalidate(const std::string &path);
+
+    void clear();
+
+    [[nodiscard]] size_t size();
+
+    /// @return Number of directories currently watched
+    [[nodiscard]] size_t watchCount();
+
+private:
+    struct Item {
+        std::string path;
+        std::string dir;
+        Entry::Ptr entry;
+        /// Opened on the first download
+        io::File::Ptr file;
+    };
+    using List = std::list<Item>;
+
+    [[nodiscard]] Entry::Ptr load(const std::string &path) const;
+
+    /// A watched directory
+    struct Watch {
+#ifdef SESE_PLATFORM_LINUX
+        /// Watch descriptor, -1 if the directory cannot be watched
+        int wd = -1;
+#else
+        /// nullptr if the directory cannot be watched
+        system::FileNotifier::Ptr notifier;
+#endif
+        /// Number of cached entries in the directory
+        size_t count = 0;
+    };
+
+    /// Watch the directory of a new entry, the mutex must be held
+    /// @return false if the directory cannot be watched, files in it are not cached
+    bool watch(const std::string &dir);
+
+    /// Drop an entry from the list and stop watching its directory if it was the last one there, the mutex must be held
+    /// @return The next item
+    List::iterator erase(List::iterator iterator);
+
+#ifdef SESE_PLATFORM_LINUX
+    /// Read the inotify events until the cache is destroyed
+    void readEvents();
+#endif
+
+    size_t capacity;
+    std::vector<std::string> sibling_suffixes;
+    std::mutex mutex;
+    /// Most recently used first
+    List list;
+    std::unordered_map<std::string, List::iterator> map;
+    /// Directories that have been watched, those that cannot be watched are remembered so that they are not retried
+    std::map<std::string, Watch> watches;
+#ifdef SESE_PLATFORM_LINUX
+    /// Created with the first watch
+    int inotify_fd = -1;
+    /// Wakes the reading thread up on destruction
+    int wake_fd = -1;
+    std::unordered_map<int, std::string> watch_dirs;
+    Thread::Ptr thread;
+#endif
+    /// Bumped on every invalidation so that entries loaded concurrently are not cached stale
+    uint64_t generation = 0;
+};
+
+} // namespace sese::internal::service::http
@@ -15,9 +15,11 @@
 #include <sese/internal/service/http/HttpServiceImpl.h>
 #include <sese/internal/net/AsioIPConvert.h>
 #include <sese/internal/net/AsioSSLContextConvert.h>
-#include <sese/net/http/HttpUtil.h>
+#include <sese/internal/net/AsioSSLDirect.h>
+#include <sese/internal/service/http/HttpCompression.h>
+#include <sese/net/ReusableSocket.h>
+#include <sese/net/ws/WebsocketAuthenticator.h>
 #include <sese/text/DateTimeFormatter.h>
-#include <sese/util/DateTime.h>
 #include <sese/text/StringBuilder.h>
 #include <sese/util/Util.h>
 
@@ -25,88 +27,265 @@
 
 #include <filesystem>
 
+#ifdef SESE_PLATFORM_LINUX
+#include <netinet/tcp.h>
+#include <unistd.h>
+#endif
+
+/// Content codings of the precompressed siblings in order of preference
+static constexpr std::pair<const char *, const char *> PRECOMPRESSED_SUFFIXES[] = {
+        {"zstd", ".zst"},
+        {"gzip", ".gz"}
+};
+
+/// Suffixes of the siblings whose existence the file cache records
+static std::vector<std::string> siblingSuffixes(bool precompressed) {
+    std::vector<std::string> suffixes;
+    if (precompressed) {
+        for (auto &&[coding, suffix]: PRECOMPRESSED_SUFFIXES) {
+            suffixes.emplace_back(suffix);
+        }
+    }
+    return suffixes;
+}
+
+static std::vector<sese::internal::service::http::HttpWorker::Ptr> createWorkers(size_t threads) {
+    std::vector<sese::internal::service::http::HttpWorker::Ptr> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(std::make_unique<sese::internal::service::http::HttpWorker>());
+    }
+    return workers;
+}
+
+/// Weak comparison of an entity tag against the list of If-None-Match
+static bool matchETag(std::string_view tags, std::string_view etag) {
+    auto opaque = [](std::string_view tag) {
+        return tag.substr(0, 2) == "W/" ? tag.substr(2) : tag;
+    };
+    etag = opaque(etag);
+    while (!tags.empty()) {
+        auto pos = tags.find(',');
+        auto tag = tags.substr(0, pos);
+        while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+            tag.remove_prefix(1);
+        }
+        while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+            tag.remove_suffix(1);
+        }
+        if (tag == "*" || opaque(tag) == etag) {
+            return true;
+        }
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        tags.remove_prefix(pos + 1);
+    }
+    return false;
+}
+
+/// Case-insensitive search of a token in a comma-separated list, such as the connection header
+static bool hasToken(std::string_view list, std::string_view token) {
+    while (!list.empty()) {
+        auto pos = list.find(',');
+        auto item = list.substr(0, pos);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) {
+            item.remove_prefix(1);
+        }
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.length() == token.length() && strncasecmp(item.data(), token.data(), token.length()) == 0) {
+            return true;
+        }
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        list.remove_prefix(pos + 1);
+    }
+    return false;
+}
+
+/// Parse an HTTP date
+/// @return Seconds since the epoch, -1 if the text is invalid
+static int64_t parseHttpDate(const std::string &text) {
+    if (text.length() < 11) {
+        return -1;
+    }
+    auto time = static_cast<int64_t>(sese::text::DateTimeFormatter::parseFromGreenwich(text));
+    return time > 0 ? time : -1;
+}
+
 sese::internal::service::http::HttpServiceImpl::HttpServiceImpl(
         const sese::net::IPAddress::Ptr &address,
         SSLContextPtr ssl_context,
-        uint32_t keepalive,
+        const Options &options,
         std::string &serv_name,
         MountPointMap &mount_points,
         ServletMap &servlets,
+        WebsocketMap &websockets,
         FilterCallback &tail_filter,
         FilterMap &filters,
         ConnectionCallback &connection_callback
 )
-    : HttpService(address, std::move(ssl_context), keepalive, serv_name, mount_points, servlets, tail_filter, filters, connection_callback),
-      io_context(),
-      ssl_context(std::nullopt),
-      acceptor(io_context) {
-    thread = std::make_unique<Thread>(
+    : HttpService(address, std::move(ssl_context), options, serv_name, mount_points, servlets, websockets, tail_filter, filters, connection_callback),
+      admission_control(this->admission),
+      workers(createWorkers(this->threads)),
+      file_cache(this->file_cache_size, siblingSuffixes(this->compression.precompressed)),
+      ssl_context(std::nullopt) {
+    if (this->worker_threads) {
+        worker_pool = std::make_unique<ThreadPool>("HttpServiceWorkerPool", this->worker_threads);
+    }
+    workers.front()->thread = std::make_unique<Thread>(
             [this] {
-                if (this->ssl_context.has_value()) {
-                    this->handleSSLAccept();
-                } else {
-                    this->handleAccept();
-                }
-                this->io_context.run();
+                this->startAccept(*this->workers.front());
+                this->workers.front()->tick();
+                this->workers.front()->io_context.run();
             },
             "HttpServiceAcceptor"
     );
+    for (size_t i = 1; i < workers.size(); ++i) {
+        auto worker = workers[i].get();
+        // Keep the loop running while there are no connections
+        worker->thread = std::make_unique<Thread>(
+                [this, worker] {
+                    auto guard = asio::make_work_guard(worker->io_context);
+                    this->startAccept(*worker);
+                    worker->tick();
+                    worker->io_context.run();
+                },
+                "HttpServiceWorker"
+        );
+    }
 }
 
 bool sese::internal::service::http::HttpServiceImpl::startup() {
-    auto addr = net::convert(address);
-    auto endpoint = asio::ip::tcp::endpoint(addr, address->getPort());
-
     if (HttpService::ssl_context) {
         ssl_context = net::convert(std::move(HttpService::ssl_context));
     }
 
+    buildRoutes();
+
     if (ssl_context) {
         auto ctx = ssl_context->native_handle();
         // SSL_CTX_set_alpn_protos(ctx, alpn_protos, sizeof(alpn_protos));
         SSL_CTX_set_alpn_select_cb(ctx, alpnCallback, nullptr);
         SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE);
+#if defined(SESE_PLATFORM_LINUX) && defined(SSL_OP_ENABLE_KTLS)
+        ktls = SSL_CTX_get_options(ctx) & SSL_OP_ENABLE_KTLS;
+#endif
     }
 
-    error = acceptor.open(
-            addr.is_v4()
-                    ? asio::basic_socket_acceptor<asio::ip::tcp>::protocol_type::v4()
-                    : asio::basic_socket_acceptor<asio::ip::tcp>::protocol_type::v6(),
-            error
-    );
-    if (error)
-        return false;
+#ifdef SESE_PLATFORM_LINUX
+    // Other platforms deliver the connections of reused ports to a single socket
+    reuse_port = listen.reuse_port && workers.size() > 1;
+#endif
+    for (auto &&worker: workers) {
+        worker->acceptor = std::make_unique<asio::ip::tcp::acceptor>(worker->io_context);
+        if (!openAcceptor(*worker->acceptor)) {
+            return false;
+        }
+        if (!reuse_port) {
+            break;
+        }
+    }
 
-    error = acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), error);
-    if (error)
-        return false;
+    for (auto &&worker: workers) {
+        worker->thread->start();
+    }
 
-    error = acceptor.bind(endpoint, error);
-    if (error)
-        return false;
+    return true;
+}
 
-    error = acceptor.listen(asio::socket_base::max_listen_connections, error);
-    if (error)
-        return false;
+bool sese::internal::service::http::HttpServiceImpl::openAcceptor(asio::ip::tcp::acceptor &acceptor) {
+    auto addr = net::convert(address);
+    auto endpoint = asio::ip::tcp::endpoint(addr, address->getPort());
+    auto protocol = addr.is_v4() ? asio::ip::tcp::v4() : asio::ip::tcp::v6();
 
-    thread->start();
+#ifdef SESE_PLATFORM_LINUX
+    if (reuse_port) {
+        // Bound with SO_REUSEADDR and SO_REUSEPORT
+        auto fd = sese::net::ReusableSocket(address).makeRawSocket();
+        if (fd == -1) {
+            error = asio::error_code(errno, asio::error::get_system_category());
+            return false;
+        }
+        error = acceptor.assign(protocol, fd, error);
+        if (error) {
+            ::close(fd);
+            return false;
+        }
+    }
+#endif
+    if (!acceptor.is_open()) {
+        error = acceptor.open(protocol, error);
+        if (error)
+            return false;
 
-    return true;
+        error = acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), error);
+        if (error)
+            return false;
+
+        error = acceptor.bind(endpoint, error);
+        if (error)
+            return false;
+    }
+
+#ifdef SESE_PLATFORM_LINUX
+    if (listen.defer_accept) {
+        int seconds = static_cast<int>(std::min<uint32_t>(listen.defer_accept, INT32_MAX));
+        if (0 != setsockopt(acceptor.native_handle(), IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof(seconds))) {
+            error = asio::error_code(errno, asio::error::get_system_category());
+            return false;
+        }
+    }
+#endif
+
+    auto backlog = listen.backlog ? static_cast<int>(listen.backlog) : asio::socket_base::max_listen_connections;
+    error = acceptor.listen(backlog, error);
+    return !error;
 }
 
 bool sese::internal::service::http::HttpServiceImpl::shutdown() {
-    asio::post(acceptor.get_executor(), [this] {
-        error = acceptor.close(error);
-    });
-    asio::post(io_context.get_executor(), [this] {
-        io_context.stop();
-    });
-    sese::sleep(0s);
-    connections.clear();
-    connections2.clear();
+    for (auto &&worker: workers) {
+        asio::post(worker->io_context.get_executor(), [worker = worker.get()] {
+            if (worker->acceptor) {
+                asio::error_code error;
+                error = worker->acceptor->close(error);
+            }
+            worker->io_context.stop();
+        });
+    }
     // Use asio::post to ensure the thread exits normally and determines whether it can be joined
-    if (thread->joinable()) {
-        thread->join();
+    for (auto &&worker: workers) {
+        if (worker->thread->joinable()) {
+            worker->thread->join();
+        }
+    }
+    // Wake up the streaming servlets waiting for a body that will never arrive or be sent
+    for (auto &&worker: workers) {
+        for (auto &&conn: worker->connections) {
+            conn->abortStreams();
+        }
+        for (auto &&conn: worker->connections2) {
+            conn->abortStreams();
+        }
+    }
+    // The sessions may still be referenced by the application, their connections must not outlive the loops
+    for (auto &&worker: workers) {
+        for (auto &&session: worker->websockets) {
+            session->abort();
+        }
+        worker->websockets.clear();
+    }
+    // Wait for the running servlets, their continuations are dropped with the stopped loops
+    if (worker_pool) {
+        worker_pool->shutdown();
+    }
+    // The loops have stopped, so connections can be released safely from here
+    for (auto &&worker: workers) {
+        worker->connections.clear();
+        worker->connections2.clear();
     }
     return !error;
 }
@@ -119,22 +298,109 @@ std::string sese::internal::service::http::HttpServiceImpl::getLastErrorMessage(
     return error.message();
 }
 
-void sese::internal::service::http::HttpServiceImpl::handleFilter(const Handleable::Ptr &conn) const {
+void sese::internal::service::http::HttpServiceImpl::buildRoutes() {
+    filter_router.clear();
+    filter_routes.clear();
+    filter_stats.clear();
+    for (auto &&[uri_prefix, callback]: filters) {
+        filter_router.insertPrefix(uri_prefix, filter_routes.size());
+        filter_routes.emplace_back(&callback);
+        filter_stats.emplace_back(getRouteStats("filter", uri_prefix));
+    }
+
+    mount_router.clear();
+    mount_routes.clear();
+    mount_stats.clear();
+    for (auto &&item: mount_points) {
+        mount_router.insertPrefix(item.first, mount_routes.size());
+        mount_routes.emplace_back(&item);
+        mount_stats.emplace_back(getRouteStats("mount", item.first));
+    }
+
+    servlet_router.clear();
+    servlet_routes.clear();
+    servlet_stats.clear();
+    for (auto &&item: servlets) {
+        if (servlet_router.insert(item.first, servlet_routes.size())) {
+            servlet_routes.emplace_back(&item.second);
+            servlet_stats.emplace_back(getRouteStats("servlet", item.first));
+        } else {
+            SESE_WARN("Invalid or duplicate servlet route: {}", item.first);
+        }
+    }
+
+    websocket_router.clear();
+    websocket_routes.clear();
+    websocket_stats.clear();
+    for (auto &&item: websockets) {
+        if (websocket_router.insert(item.first, websocket_routes.size())) {
+            websocket_routes.emplace_back(&item.second);
+            websocket_stats.emplace_back(getRouteStats("websocket", item.first));
+        } else {
+            SESE_WARN("Invalid or duplicate websocket route: {}", item.first);
+        }
+    }
+
+    unmatched_stats = getRouteStats("none", "");
+    for (size_t i = 0; i < responses.size(); ++i) {
+        responses[i] = &MetricsRegistry::getInstance()->counter(
+                "sese_http_responses_total", "Responses sent by the HTTP services", {{"code", std::to_string(i + 1) + "xx"}}
+        );
+    }
+}
+
+sese::internal::service::http::RouteStats sese::internal::service::http::HttpServiceImpl::getRouteStats(const char *type, const std::string &route) const {
+    RouteStats stats;
+    stats.duration = &MetricsRegistry::getInstance()->histogram(
+            "sese_http_request_duration_seconds",
+            "Time from the end of the request header to the start of the response",
+            {{"type", type}, {"route", route}},
+            1e-6
+    );
+    if (access_log) {
+        stats.log_id = access_log->registerRoute(route);
+    }
+    return stats;
+}
+
+bool sese::internal::service::http::HttpServiceImpl::isStreaming(const Handleable::Ptr &conn) const {
+    if (!worker_pool || conn->conn_type != ConnType::NONE) {
+        return false;
+    }
+    auto &&uri = conn->request.getUri();
+    if (mount_router.matchLongestPrefix(uri) != sese::net::http::Router::NPOS) {
+        return false;
+    }
+    auto id = servlet_router.match(uri);
+    return id != sese::net::http::Router::NPOS && servlet_routes[id]->isStreaming();
+}
+
+void sese::internal::service::http::HttpServiceImpl::handleFilter(const Handleable::Ptr &conn) {
     auto &&req = conn->request;
     auto &&resp = conn->response;
-    for (auto &&[uri_prefix, callback]: filters) {
-        if (text::StringBuilder::startsWith(req.getUri(), uri_prefix)) {
-            if (callback(req, resp)) {
-                conn->conn_type = ConnType::NONE;
-            } else {
-                conn->conn_type = ConnType::FILTER;
-                break;
-            }
+    if (!admission_control.admit(conn->remote_address, req, resp, worker_pool.get(), conn->ticket)) {
+        conn->conn_type = ConnType::FILTER;
+        return;
+    }
+    std::vector<size_t> ids;
+    // From the shortest prefix to the longest
+    filter_router.matchPrefixes(req.getUri(), ids);
+    for (auto &&id: ids) {
+        if ((*filter_routes[id])(req, resp)) {
+            conn->conn_type = ConnType::NONE;
+        } else {
+            conn->conn_type = ConnType::FILTER;
+            conn->route_stats = &filter_stats[id];
+            break;
         }
     }
 }
 
-void sese::internal::service::http::HttpServiceImpl::handleRequest(const Handleable::Ptr &conn) const {
+void sese::internal::service::http::HttpServiceImpl::handleRequest(
+        const Handleable::Ptr &conn,
+        asio::io_context &io_context,
+        const std::function<void()> &callback
+) {
     conn->stopwatch.stop();
     auto &&req = conn->request;
     auto &&resp = conn->response;
@@ -150,58 +416,168 @@ void sese::internal::service::http::HttpServiceImpl::handleRequest(const Handlea
     //     }
     // }
 
-    // Mount point matching
+    // Mount point matching, the longest prefix wins
     if (conn->conn_type == ConnType::NONE) {
-        for (auto &&[uri_prefix, mount_point]: mount_points) {
-            if (text::StringBuilder::startsWith(req.getUri(), uri_prefix)) {
-                conn->conn_type = ConnType::FILE_DOWNLOAD;
-                filename = mount_point + "/" + req.getUri().substr(uri_prefix.length());
-                // Confirm the file name and proceed to the next step
-                break;
-            }
+        auto id = mount_router.matchLongestPrefix(req.getUri());
+        if (id != sese::net::http::Router::NPOS) {
+            auto &&[uri_prefix, mount_point] = *mount_routes[id];
+            conn->conn_type = ConnType::FILE_DOWNLOAD;
+            conn->route_stats = &mount_stats[id];
+            filename = mount_point + "/" + req.getUri().substr(uri_prefix.length());
+        }
+    }
+
+    if (conn->conn_type == ConnType::NONE && !websocket_routes.empty()) {
+        auto id = websocket_router.match(req.getUri(), &conn->path_args);
+        if (id != sese::net::http::Router::NPOS) {
+            conn->route_stats = &websocket_stats[id];
+            handleUpgrade(conn, *websocket_routes[id]);
+            goto uni_handle;
         }
     }
 
     if (conn->conn_type == ConnType::NONE) {
-        auto iterator = servlets.find(req.getUri());
-        if (iterator == servlets.end()) {
+        auto id = servlet_router.match(req.getUri(), &conn->path_args);
+        if (id != sese::net::http::Router::NPOS) {
+            conn->route_stats = &servlet_stats[id];
+        }
+        if (id == sese::net::http::Router::NPOS) {
             resp.setCode(404);
+        } else if ((servlet_routes[id]->isAsync() || conn->body_stream) && worker_pool) {
+            conn->conn_type = ConnType::CONTROLLER;
+            if (worker_pool->size() >= worker_queue_size) {
+                // The queue is full, fail fast instead of stalling the loop
+                if (conn->body_stream) {
+                    conn->body_stream->close();
+                }
+                resp.setCode(503);
+                resp.set("content-length", std::to_string(resp.getBody().getLength()));
+                goto uni_handle;
+            }
+            auto &servlet = *servlet_routes[id];
+            conn->response_stream = std::make_shared<sese::net::http::ResponseBodyStream>(BODY_STREAM_CAPACITY);
+            std::chrono::steady_clock::time_point queued_at;
+            if (admission_control.isQueueDelayLimited()) {
+                queued_at = std::chrono::steady_clock::now();
+            }
+            worker_pool->postTask([serv = shared_from_this(), conn, &servlet, &io_context, callback, queued_at] {
+                if (serv->admission_control.isQueueDelayLimited()) {
+                    auto delay = std::chrono::steady_clock::now() - queued_at;
+                    serv->admission_control.recordQueueDelay(std::chrono::duration_cast<std::chrono::microseconds>(delay).count());
+                }
+                auto response_stream = conn->response_stream;
+                auto ctx = sese::net::http::HttpServletContext(conn->request, conn->response, conn->remote_address, conn->path_args);
+                ctx.setInputStream(conn->body_stream.get());
+                ctx.setResponseStarter([serv, conn, &io_context, callback] {
+                    return serv->startResponseStream(conn, io_context, callback);
+                });
+                ctx.setSubscriber([conn](const sese::net::http::EventTopic::Ptr &topic) {
+                    return subscribe(conn, topic);
+                });
+                servlet.invoke(ctx);
+                if (conn->body_stream) {
+                    // The rest of the body is drained by the connection
+                    conn->body_stream->close();
+                }
+                if (conn->response_streaming) {
+                    // The connection is already sending the body and may reset once it is finished
+                    response_stream->finish();
+                    return;
+                }
+                if (conn->event_subscriber) {
+                    startEventStream(conn);
+                } else {
+                    serv->compressResponse(conn);
+                    conn->response.set("content-length", std::to_string(conn->response.getBody().getLength()));
+                }
+                // Resume the connection on its own loop
+                asio::post(io_context, [serv, conn, callback] {
+                    serv->handleResponse(conn);
+                    callback();
+                });
+            });
+            return;
         } else {
-            auto ctx = sese::net::http::HttpServletContext(req, resp, conn->remote_address);
-            iterator->second.invoke(ctx);
+            auto ctx = sese::net::http::HttpServletContext(req, resp, conn->remote_address, conn->path_args);
+            ctx.setSubscriber([conn](const sese::net::http::EventTopic::Ptr &topic) {
+                return subscribe(conn, topic);
+            });
+            servlet_routes[id]->invoke(ctx);
+            if (conn->event_subscriber) {
+                startEventStream(conn);
+                goto uni_handle;
+            }
             conn->conn_type = ConnType::CONTROLLER;
+            compressResponse(conn);
         }
         resp.set("content-length", std::to_string(resp.getBody().getLength()));
     } else if (conn->conn_type == ConnType::FILE_DOWNLOAD) {
-        if (!exists(filename) ||
-            !is_regular_file(filename) ||
-            is_directory(filename)) {
+        auto path = filename.string();
+        auto entry = file_cache.get(path);
+        if (!entry) {
             resp.setCode(404);
             resp.set("content-length", std::to_string(resp.getBody().getLength()));
             conn->conn_type = ConnType::NONE;
             goto uni_handle;
         }
 
-        conn->file = io::File::create(filename.string(), io::File::B_READ);
+        // Prefer a precompressed sibling, ranges are always served from the original file
+        if (compression.precompressed && !req.exist("range")) {
+            auto &&accept_encoding = req.get("accept-encoding", "");
+            for (size_t i = 0; i < std::size(PRECOMPRESSED_SUFFIXES); ++i) {
+                if (!(entry->siblings & (1u << i))) {
+                    continue;
+                }
+                auto &&[coding, suffix] = PRECOMPRESSED_SUFFIXES[i];
+                auto sibling = file_cache.get(path + suffix);
+                if (!sibling) {
+                    continue;
+                }
+                resp.set("vary", "accept-encoding");
+                if (HttpCompression::quality(accept_encoding, coding) > 0) {
+                    auto variant = std::make_shared<HttpFileCache::Entry>(*sibling);
+                    // Keep the validators of the encodings apart
+                    variant->etag.insert(variant->etag.length() - 1, std::string("-") + coding);
+                    variant->content_type = entry->content_type;
+                    entry = std::move(variant);
+                    path += suffix;
+                    resp.set("content-encoding", coding);
+                    break;
+                }
+            }
+        }
+
+        resp.set("etag", entry->etag);
+        resp.set("last-modified", entry->last_modified);
+        // Revalidation is answered before the file is opened
+        if (isNotModified(req, *entry)) {
+            resp.setCode(304);
+            conn->conn_type = ConnType::NONE;
+            goto uni_handle;
+        }
+
+        conn->file = file_cache.open(path);
         if (!conn->file) {
             resp.setCode(500);
             resp.set("content-length", std::to_string(resp.getBody().getLength()));
+            conn->conn_type = ConnType::NONE;
             goto uni_handle;
         }
 
-        if (filename.has_extension()) {
-            auto ext = filename.extension().string().substr(1);
-            auto type = sese::net::http::HttpUtil::content_type_map.find(ext);
-            if (type == sese::net::http::HttpUtil::content_type_map.end()) {
-                resp.set("content-type", conn->content_type);
-            } else {
-                resp.set("content-type", type->second);
-                conn->content_type = type->second;
-            }
+        if (!entry->content_type.empty()) {
+            resp.set("content-type", entry->content_type);
+            conn->content_type = entry->content_type;
+        } else if (filename.has_extension()) {
+            resp.set("content-type", conn->content_type);
         }
 
-        conn->filesize = file_size(filename);
-        conn->ranges = sese::net::http::Range::parse(req.get("Range", ""), conn->filesize);
+        conn->filesize = entry->size;
+        // A stale If-Range turns the request into a full download
+        if (req.exist("if-range") && !isRangeValid(req.get("if-range"), *entry)) {
+            conn->ranges.clear();
+        } else {
+            conn->ranges = sese::net::http::Range::parse(req.get("Range", ""), conn->filesize);
+        }
         if (conn->ranges.empty()) {
             // No range file, manually set range
             conn->ranges.emplace_back(0, conn->filesize);
@@ -247,14 +623,67 @@ void sese::internal::service::http::HttpServiceImpl::handleRequest(const Handlea
             resp.set("content-length", std::to_string(content_length));
             resp.setCode(206);
         }
-
-        auto last_modified = last_write_time(filename);
-        uint64_t time = to_time_t(last_modified) * 1000 * 1000;
-        resp.set("last-modified", text::DateTimeFormatter::format(DateTime(time, 0), TIME_GREENWICH_MEAN_PATTERN));
     }
 
 uni_handle:
-    if (req.getVersion() == sese::net::http::HttpVersion::VERSION_1_1) {
+    handleResponse(conn);
+    callback();
+}
+
+void sese::internal::service::http::HttpServiceImpl::handleUpgrade(const Handleable::Ptr &conn, const sese::service::http::WebsocketHandler &handler) {
+    auto &&req = conn->request;
+    auto &&resp = conn->response;
+    auto &&key = req.get("sec-websocket-key", "");
+    // HTTP/2 streams cannot be upgraded, so no upgrade header is offered to them
+    bool http1 = req.getVersion() == sese::net::http::HttpVersion::VERSION_1_1;
+    if (!http1 ||
+        req.getType() != sese::net::http::RequestType::GET ||
+        !hasToken(req.get("connection", ""), "upgrade") ||
+        !hasToken(req.get("upgrade", ""), "websocket") ||
+        req.get("sec-websocket-version", "") != "13" ||
+        key.length() != 24) {
+        resp.setCode(426);
+        if (http1) {
+            resp.set("upgrade", "websocket");
+        }
+        resp.set("sec-websocket-version", "13");
+        resp.set("content-length", "0");
+        conn->conn_type = ConnType::CONTROLLER;
+        return;
+    }
+    auto accept = sese::net::ws::WebsocketAuthenticator::toResult(key.c_str());
+    resp.setCode(101);
+    resp.set("upgrade", "websocket");
+    resp.set("connection", "upgrade");
+    resp.set("sec-websocket-accept", accept.get());
+    conn->conn_type = ConnType::WEBSOCKET;
+    conn->websocket_handler = &handler;
+}
+
+bool sese::internal::service::http::HttpServiceImpl::subscribe(const Handleable::Ptr &conn, const sese::net::http::EventTopic::Ptr &topic) {
+    // A response has a single body
+    if (conn->response_streaming || conn->event_subscriber) {
+        return false;
+    }
+    conn->event_subscriber = topic->subscribe();
+    return true;
+}
+
+void sese::internal::service::http::HttpServiceImpl::startEventStream(const Handleable::Ptr &conn) {
+    auto &&resp = conn->response;
+    resp.set("content-type", "text/event-stream");
+    resp.set("cache-control", "no-cache");
+    conn->conn_type = ConnType::EVENT_STREAM;
+}
+
+void sese::internal::service::http::HttpServiceImpl::handleResponse(const Handleable::Ptr &conn) const {
+    auto &&req = conn->request;
+    auto &&resp = conn->response;
+    if (req.getVersion() == sese::net::http::HttpVersion::VERSION_1_1 && conn->conn_type == ConnType::EVENT_STREAM) {
+        // The stream has no length, it ends when the connection is closed
+        conn->keepalive = false;
+        resp.set("connection", "close");
+    } else if (req.getVersion() == sese::net::http::HttpVersion::VERSION_1_1 && conn->conn_type != ConnType::WEBSOCKET) {
         auto keepalive_str = req.get("connection", "close");
         conn->keepalive = strcmpDoNotCase(keepalive_str.c_str(), "keep-alive");
 
@@ -265,40 +694,195 @@ uni_handle:
     }
     resp.set("server", this->serv_name);
     resp.set("accept-range", "bytes");
-    if (tail_filter && (resp.getCode() != 200 && resp.getCode() != 201)) {
+    if (tail_filter && !conn->response_streaming && conn->conn_type != ConnType::WEBSOCKET && conn->conn_type != ConnType::EVENT_STREAM && (resp.getCode() != 200 && resp.getCode() != 201 && resp.getCode() != 304)) {
         if(tail_filter(req, resp)) {
             resp.set("content-length", std::to_string(resp.getBody().getReadableSize()));
             conn->conn_type = ConnType::CONTROLLER;
         }
     }
-    SESE_INFO("{} {} {} in {}ms", sese::net::http::requestTypeToString(req.getType()), req.getUri(), resp.getCode(), conn->stopwatch.stop().getTotalMilliseconds());
+    conn->ticket.release();
+    auto elapsed = conn->stopwatch.stop();
+    auto latency = static_cast<uint64_t>(elapsed.getTotalMicroseconds());
+    (conn->route_stats ? conn->route_stats : &unmatched_stats)->duration->record(latency);
+    auto code_class = static_cast<size_t>(resp.getCode() / 100);
+    if (code_class >= 1 && code_class <= responses.size()) {
+        responses[code_class - 1]->inc();
+    }
+    // The access log replaces the line written synchronously to the logger
+    if (access_log) {
+        logAccess(conn, latency);
+    } else {
+        SESE_INFO("{} {} {} in {}ms", sese::net::http::requestTypeToString(req.getType()), req.getUri(), resp.getCode(), elapsed.getTotalMilliseconds());
+    }
 }
 
-void sese::internal::service::http::HttpServiceImpl::handleAccept() {
-    auto accept_socket = std::make_shared<HttpConnectionImpl::Socket>(io_context);
-    acceptor.async_accept(
+void sese::internal::service::http::HttpServiceImpl::logAccess(const Handleable::Ptr &conn, uint64_t latency) const {
+    using Record = sese::service::http::AccessLog::Record;
+    auto record = access_log->begin();
+    if (!record) {
+        return;
+    }
+    auto &&req = conn->request;
+    auto &&resp = conn->response;
+    record->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    record->latency = latency;
+    record->route = conn->route_stats ? conn->route_stats->log_id : 0;
+    record->status = static_cast<uint16_t>(resp.getCode());
+    record->method = static_cast<uint8_t>(req.getType());
+    record->version = static_cast<uint8_t>(req.getVersion());
+    // Streamed bodies have no length in advance
+    auto content_length = resp.find("content-length");
+    record->bytes = content_length == resp.end() ? -1 : static_cast<int64_t>(toInteger(content_length->second));
+    record->family = 0;
+    if (conn->remote_address) {
+        auto raw = conn->remote_address->getRawAddress();
+        if (raw->sa_family == AF_INET) {
+            record->family = AF_INET;
+            std::memcpy(record->address, &reinterpret_cast<const sockaddr_in *>(raw)->sin_addr, sizeof(in_addr));
+        } else if (raw->sa_family == AF_INET6) {
+            record->family = AF_INET6;
+            std::memcpy(record->address, &reinterpret_cast<const sockaddr_in6 *>(raw)->sin6_addr, sizeof(in6_addr));
+        }
+    }
+    Record::copy(record->uri, record->uri_length, req.getUri());
+    auto referer = req.find("referer");
+    Record::copy(record->referer, record->referer_length, referer == req.end() ? std::string_view() : referer->second);
+    auto user_agent = req.find("user-agent");
+    Record::copy(record->user_agent, record->user_agent_length, user_agent == req.end() ? std::string_view() : user_agent->second);
+    access_log->commit();
+}
+
+sese::io::OutputStream *sese::internal::service::http::HttpServiceImpl::startResponseStream(
+        const Handleable::Ptr &conn,
+        asio::io_context &io_context,
+        const std::function<void()> &callback
+) {
+    auto &&req = conn->request;
+    auto &&resp = conn->response;
+    if (conn->event_subscriber) {
+        return nullptr;
+    }
+    if (conn->body_stream) {
+        // The servlet may block writing, so it no longer reads the request body
+        conn->body_stream->close();
+    }
+    // Data written before the stream is started is sent first
+    std::string head(resp.getBody().getReadableSize(), '\0');
+    resp.getBody().read(head.data(), head.length());
+    resp.getBody().freeCapacity();
+    if (req.getVersion() == sese::net::http::HttpVersion::VERSION_1_1) {
+        resp.set("transfer-encoding", "chunked");
+    }
+    auto response_stream = conn->response_stream;
+    conn->response_streaming = true;
+    asio::post(io_context, [serv = shared_from_this(), conn, callback] {
+        serv->handleResponse(conn);
+        callback();
+    });
+    if (!head.empty()) {
+        response_stream->write(head.data(), head.length());
+    }
+    return response_stream.get();
+}
+
+void sese::internal::service::http::HttpServiceImpl::compressResponse(const Handleable::Ptr &conn) const {
+    auto &&req = conn->request;
+    auto &&resp = conn->response;
+    if (!compression.enable ||
+        (resp.getCode() != 200 && resp.getCode() != 201) ||
+        resp.exist("content-encoding") ||
+        resp.getBody().getReadableSize() < compression.min_length ||
+        !HttpCompression::isCompressible(resp.get("content-type", ""), compression.types)) {
+        return;
+    }
+
+    auto vary = resp.get("vary", "");
+    resp.set("vary", vary.empty() ? "accept-encoding" : vary + ", accept-encoding");
+    auto &&accept_encoding = req.get("accept-encoding", "");
+    auto gzip = HttpCompression::quality(accept_encoding, "gzip");
+    auto deflate = HttpCompression::quality(accept_encoding, "deflate");
+    if (gzip > 0 && gzip >= deflate) {
+        if (HttpCompression::compress(CompressionType::GZIP, compression.level, resp.getBody())) {
+            resp.set("content-encoding", "gzip");
+        }
+    } else if (deflate > 0) {
+        if (HttpCompression::compress(CompressionType::ZLIB, compression.level, resp.getBody())) {
+            resp.set("content-encoding", "deflate");
+        }
+    }
+}
+
+bool sese::internal::service::http::HttpServiceImpl::isNotModified(sese::net::http::Request &req, const HttpFileCache::Entry &entry) {
+    if (req.getType() != sese::net::http::RequestType::GET &&
+        req.getType() != sese::net::http::RequestType::HEAD) {
+        return false;
+    }
+    // If-None-Match takes precedence over If-Modified-Since
+    if (req.exist("if-none-match")) {
+        return matchETag(req.get("if-none-match"), entry.etag);
+    }
+    if (req.exist("if-modified-since")) {
+        auto since = parseHttpDate(req.get("if-modified-since"));
+        return since != -1 && entry.mtime <= since;
+    }
+    return false;
+}
+
+bool sese::internal::service::http::HttpServiceImpl::isRangeValid(const std::string &if_range, const HttpFileCache::Entry &entry) {
+    // If-Range requires a strong comparison
+    if (!if_range.empty() && if_range.front() == '"') {
+        return if_range == entry.etag;
+    }
+    return parseHttpDate(if_range) == entry.mtime;
+}
+
+sese::internal::service::http::HttpWorker &sese::internal::service::http::HttpServiceImpl::nextWorker() {
+    auto &worker = *workers[next_worker];
+    next_worker = (next_worker + 1) % workers.size();
+    return worker;
+}
+
+void sese::internal::service::http::HttpServiceImpl::startAccept(HttpWorker &owner) {
+    if (!owner.acceptor) {
+        return;
+    }
+    if (ssl_context.has_value()) {
+        handleSSLAccept(owner);
+    } else {
+        handleAccept(owner);
+    }
+}
+
+void sese::internal::service::http::HttpServiceImpl::handleAccept(HttpWorker &owner) {
+    // A single acceptor hands the connections out to the loops in turn
+    auto &worker = reuse_port ? owner : nextWorker();
+    auto accept_socket = std::make_shared<HttpConnectionImpl::Socket>(worker.io_context);
+    owner.acceptor->async_accept(
             *accept_socket,
-            [this, accept_socket](const asio::error_code &e) {
-                if (!acceptor.is_open()) {
+            [this, &owner, &worker, accept_socket](const asio::error_code &e) {
+                if (!owner.acceptor->is_open()) {
                     return;
                 }
                 if (e.value() == 0) {
                     auto remote_address = sese::internal::net::convert(accept_socket->remote_endpoint());
                     if (connection_callback && !connection_callback(remote_address)) {
-                        this->handleAccept();
+                        this->handleAccept(owner);
                         return;
                     }
                     auto conn = std::make_shared<HttpConnectionImpl>(
                             shared_from_this(),
-                            io_context,
+                            worker,
                             remote_address,
                             accept_socket
                     );
-                    this->connections.emplace(conn);
-                    conn->readHeader();
-                    // conn->readMagic();
+                    // The connection set belongs to the worker's loop, which may be the current one
+                    asio::dispatch(worker.io_context, [&worker, conn, timeout = timeouts.header_timeout] {
+                        worker.connections.emplace(conn);
+                        conn->setTimeout(timeout);
+                        conn->readHeader();
+                    });
                 }
-                this->handleAccept();
+                this->handleAccept(owner);
             }
     );
 }
@@ -326,67 +910,87 @@ int sese::internal::service::http::HttpServiceImpl::alpnCallback(
     return SSL_TLSEXT_ERR_OK;
 }
 
-void sese::internal::service::http::HttpServiceImpl::handleSSLAccept() {
-    auto accept_socket = std::make_shared<HttpConnectionImpl::Socket>(io_context);
-    acceptor.async_accept(
+void sese::internal::service::http::HttpServiceImpl::handleSSLAccept(HttpWorker &owner) {
+    auto &worker = reuse_port ? owner : nextWorker();
+    auto accept_socket = std::make_shared<HttpConnectionImpl::Socket>(worker.io_context);
+    owner.acceptor->async_accept(
             *accept_socket,
-            [this, accept_socket](const asio::error_code &e) {
-                if (!acceptor.is_open()) {
+            [this, &owner, &worker, accept_socket](const asio::error_code &e) {
+                if (!owner.acceptor->is_open()) {
                     return;
                 }
                 if (e.value() == 0) {
                     auto remote_address = sese::internal::net::convert(accept_socket->remote_endpoint());
                     if (connection_callback && !connection_callback(remote_address)) {
-                        this->handleSSLAccept();
+                        this->handleSSLAccept(owner);
                         return;
                     }
                     auto accept_stream = std::make_shared<HttpsConnectionImpl::Stream>(
                             std::move(*accept_socket), ssl_context.value()
                     );
-                    accept_stream->async_handshake(
-                            asio::ssl::stream_base::server,
-                            [this, remote_address, accept_stream](const asio::error_code &e) {
-                                if (e.value() == 0) {
-                                    const uint8_t *data = nullptr;
-                                    uint32_t data_length;
-                                    SSL_get0_alpn_selected(accept_stream->native_handle(), &data, &data_length);
-                                    auto proto = std::string_view(reinterpret_cast<const char *>(data), data_length);
-                                    if (proto == "http/1.1") {
-                                        // SESE_INFO("selected http/1.1");
-                                        auto conn = std::make_shared<HttpsConnectionImpl>(
-                                                shared_from_this(),
-                                                io_context,
-                                                remote_address,
-                                                accept_stream
-                                        );
-                                        this->connections.emplace(conn);
-                                        conn->readHeader();
-                                    } else if (proto == "h2") {
-                                        // SESE_INFO("selected http/2");
-                                        auto conn = std::make_shared<HttpsConnectionExImpl>(
-                                                shared_from_this(),
-                                                io_context,
-                                                remote_address,
-                                                accept_stream
-                                        );
-                                        this->connections2.emplace(conn);
-                                        conn->readMagic();
-                                    } else {
-                                        // SESE_WARN("unknown proto");
-                                        auto conn = std::make_shared<HttpsConnectionImpl>(
-                                                shared_from_this(),
-                                                io_context,
-                                                remote_address,
-                                                accept_stream
-                                        );
-                                        this->connections.emplace(conn);
-                                        conn->readHeader();
-                                    }
-                                }
-                            }
+                    // The handshake completes on the worker's loop, where the timeouts are kept
+                    asio::dispatch(worker.io_context, [this, &worker, remote_address, accept_stream] {
+                        handleHandshake(worker, remote_address, accept_stream);
+                    });
+                }
+                this->handleSSLAccept(owner);
+            }
+    );
+}
+
+void sese::internal::service::http::HttpServiceImpl::handleHandshake(
+        HttpWorker &worker,
+        const sese::net::IPAddress::Ptr &remote_address,
+        const std::shared_ptr<HttpsConnectionImpl::Stream> &accept_stream
+) {
+    // A peer that stalls the handshake is cut off like one that stalls its request header
+    auto timeout = std::make_shared<TimeoutEvent *>();
+    *timeout = worker.wheel.delay([timeout, accept_stream] {
+        *timeout = nullptr;
+        asio::error_code error;
+        error = accept_stream->lowest_layer().close(error);
+    }, timeouts.header_timeout);
+    // OpenSSL only enables kTLS while writing to the socket itself, a failure keeps the stream on asio
+    if (ktls) {
+        net::AsioSSLDirect::attach(*accept_stream);
+    }
+    accept_stream->async_handshake(
+            asio::ssl::stream_base::server,
+            [this, &worker, remote_address, accept_stream, timeout](const asio::error_code &e) {
+                if (*timeout) {
+                    worker.wheel.cancel(*timeout);
+                    *timeout = nullptr;
+                }
+                if (e.value() != 0) {
+                    return;
+                }
+                const uint8_t *data = nullptr;
+                uint32_t data_length;
+                SSL_get0_alpn_selected(accept_stream->native_handle(), &data, &data_length);
+                auto proto = std::string_view(reinterpret_cast<const char *>(data), data_length);
+                if (proto == "h2") {
+                    // SESE_INFO("selected http/2");
+                    auto conn = std::make_shared<HttpsConnectionExImpl>(
+                            shared_from_this(),
+                            worker,
+                            remote_address,
+                            accept_stream
+                    );
+                    worker.connections2.emplace(conn);
+                    conn->setTimeout(timeouts.header_timeout);
+                    conn->readMagic();
+                } else {
+                    // http/1.1 or no protocol selected
+                    auto conn = std::make_shared<HttpsConnectionImpl>(
+                            shared_from_this(),
+                            worker,
+                            remote_address,
+                            accept_stream
                     );
+                    worker.connections.emplace(conn);
+                    conn->setTimeout(timeouts.header_timeout);
+                    conn->readHeader();
                 }
-                this->handleSSLAccept();
             }
     );
 }
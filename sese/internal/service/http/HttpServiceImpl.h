@@ -14,11 +14,17 @@
 
 #pragma once
 
+#include <array>
 #include <optional>
 #include <sese/service/http/HttpService.h>
+#include <sese/thread/ThreadPool.h>
+#include <sese/net/http/Router.h>
 
+#include <sese/internal/service/http/AdmissionControl.h>
 #include <sese/internal/service/http/HttpConnection.h>
 #include <sese/internal/service/http/HttpConnectionEx.h>
+#include <sese/internal/service/http/HttpWorker.h>
+#include <sese/internal/service/http/HttpFileCache.h>
 
 namespace sese::internal::service::http {
 
@@ -32,10 +38,11 @@ public:
     HttpServiceImpl(
         const sese::net::IPAddress::Ptr &address,
         SSLContextPtr ssl_context,
-        uint32_t keepalive,
+        const Options &options,
         std::string &serv_name,
         MountPointMap &mount_points,
         ServletMap &servlets,
+        WebsocketMap &websockets,
         FilterCallback &tail_filter,
         FilterMap &filters,
         ConnectionCallback &connection_callback
@@ -51,26 +58,156 @@ public:
 
     uint32_t getKeepalive() const { return keepalive; }
 
-    void handleFilter(const Handleable::Ptr &conn) const;
+    [[nodiscard]] const Http2Options &getHttp2Options() const { return http2; }
 
-    void handleRequest(const Handleable::Ptr &conn) const;
+    [[nodiscard]] const TimeoutOptions &getTimeouts() const { return timeouts; }
+
+    /// Admit the request and invoke the filters matching its URI, the body of an intercepted request is discarded
+    /// @param conn Connection or stream
+    void handleFilter(const Handleable::Ptr &conn);
+
+    /// Buffered bytes of a streamed body above which the connection stops reading a request,
+    /// or the servlet blocks writing a response
+    static constexpr size_t BODY_STREAM_CAPACITY = 256 * 1024;
+
+    /// Determine whether the request is routed to a streaming servlet,
+    /// in which case the connection creates the body stream and dispatches the request as soon as the header is received
+    /// @param conn Connection or stream
+    /// @return Result
+    [[nodiscard]] bool isStreaming(const Handleable::Ptr &conn) const;
+
+    /// Dispatch the request to a mount point or servlet.
+    /// The callback is invoked directly when the request is handled inline,
+    /// otherwise the servlet runs on the worker pool and the callback is posted back to io_context
+    /// @param conn Connection or stream
+    /// @param io_context The loop that owns the connection
+    /// @param callback Invoked when the response is ready to be written
+    void handleRequest(const Handleable::Ptr &conn, asio::io_context &io_context, const std::function<void()> &callback);
+
+    /// Fill in the common response headers and run the tail filter
+    /// @param conn Connection or stream
+    void handleResponse(const Handleable::Ptr &conn) const;
 
 private:
-    asio::io_context io_context;
+    /// Declared before the loops, the requests they still own release their tickets when destroyed
+    AdmissionControl admission_control;
+    /// I/O loops, the first one also runs the acceptor unless each of them has its own
+    std::vector<HttpWorker::Ptr> workers;
+    size_t next_worker = 0;
+    /// Whether every loop accepts through its own listening socket and keeps the connections it accepts
+    bool reuse_port = false;
+    /// Executes the servlets marked as asynchronous, null if disabled
+    ThreadPool::Ptr worker_pool;
+    /// Metadata and descriptors of the mounted static files
+    HttpFileCache file_cache;
     std::optional<asio::ssl::context> ssl_context;
-    asio::ip::tcp::acceptor acceptor;
+    /// Whether the TLS connections write to their sockets directly, so that OpenSSL can use kTLS
+    bool ktls = false;
     asio::error_code error;
 
     static constexpr unsigned char ALPN_PROTOS[] = "\x2h2\x8http/1.1";
 
     static int alpnCallback(SSL *ssl, const uint8_t **out, uint8_t *out_length, const uint8_t *in, uint32_t in_length, void *data);
 
-    void handleAccept();
-
-    void handleSSLAccept();
+    /// Open, bind and listen on the address of the service
+    /// @param acceptor Acceptor to open
+    /// @return Whether successful, the reason is kept in error
+    bool openAcceptor(asio::ip::tcp::acceptor &acceptor);
+
+    /// Start accepting connections if the worker has a listening socket
+    /// @param owner Worker running the acceptor
+    void startAccept(HttpWorker &owner);
+
+    void handleAccept(HttpWorker &owner);
+
+    void handleSSLAccept(HttpWorker &owner);
+
+    /// Complete the TLS handshake on the loop of the worker and create the connection for the negotiated protocol
+    /// @param worker Worker owning the connection
+    /// @param remote_address Peer address
+    /// @param accept_stream Accepted stream
+    void handleHandshake(HttpWorker &worker, const sese::net::IPAddress::Ptr &remote_address, const std::shared_ptr<HttpsConnectionImpl::Stream> &accept_stream);
+
+    /// Compile the registered filters, mount points and servlets into routers
+    void buildRoutes();
+
+    sese::net::http::Router filter_router;
+    std::vector<const FilterCallback *> filter_routes;
+    sese::net::http::Router mount_router;
+    std::vector<const MountPointMap::value_type *> mount_routes;
+    sese::net::http::Router servlet_router;
+    std::vector<const sese::net::http::Servlet *> servlet_routes;
+    sese::net::http::Router websocket_router;
+    std::vector<const sese::service::http::WebsocketHandler *> websocket_routes;
+
+    /// Statistics of the routes, indexed like the routes
+    std::vector<RouteStats> filter_stats;
+    std::vector<RouteStats> mount_stats;
+    std::vector<RouteStats> servlet_stats;
+    std::vector<RouteStats> websocket_stats;
+    /// Statistics of the requests no route matched
+    RouteStats unmatched_stats;
+    /// Responses by status class, from 1xx to 5xx
+    std::array<sese::Counter *, 5> responses{};
+
+    /// Get the statistics of a route, the latency histogram is shared by the services
+    /// @param type Kind of the route
+    /// @param route Registered pattern or prefix
+    /// @return Statistics
+    [[nodiscard]] RouteStats getRouteStats(const char *type, const std::string &route) const;
+
+    /// Copy the request into the access log
+    /// @param conn Connection or stream
+    /// @param latency Microseconds since the end of the request header
+    void logAccess(const Handleable::Ptr &conn, uint64_t latency) const;
+
+    /// Validate the upgrade request of a websocket route and prepare the 101 response,
+    /// the connection is upgraded once it is sent. Invalid requests are answered with 426
+    /// @param conn Connection or stream
+    /// @param handler Callbacks of the route
+    static void handleUpgrade(const Handleable::Ptr &conn, const sese::service::http::WebsocketHandler &handler);
+
+    /// Commit the response of a servlet on the worker pool and resume the connection, which then sends the body
+    /// while the servlet is still writing it. Called on the worker pool
+    /// @param conn Connection or stream
+    /// @param io_context The loop of the connection
+    /// @param callback Invoked on the loop once the response is ready
+    /// @return Body stream, nullptr if the response is subscribed to a topic
+    sese::io::OutputStream *startResponseStream(
+            const Handleable::Ptr &conn,
+            asio::io_context &io_context,
+            const std::function<void()> &callback
+    );
 
-    std::set<HttpConnection::Ptr> connections;
-    std::set<HttpConnectionEx::Ptr> connections2;
+    /// Subscribe the response of a servlet to a topic, the events follow the body written by the servlet
+    /// @param conn Connection or stream
+    /// @param topic Topic
+    /// @return false if the response is already streaming or subscribed
+    static bool subscribe(const Handleable::Ptr &conn, const sese::net::http::EventTopic::Ptr &topic);
+
+    /// Turn a subscribed servlet response into an event stream, sent once the servlet returns
+    /// @param conn Connection or stream
+    static void startEventStream(const Handleable::Ptr &conn);
+
+    /// Compress the servlet response according to Accept-Encoding
+    /// @param conn Connection or stream
+    void compressResponse(const Handleable::Ptr &conn) const;
+
+    /// Evaluate If-None-Match and If-Modified-Since
+    /// @param req Request
+    /// @param entry The requested file
+    /// @return true if the response should be 304
+    static bool isNotModified(sese::net::http::Request &req, const HttpFileCache::Entry &entry);
+
+    /// Evaluate If-Range
+    /// @param if_range Entity tag or HTTP date
+    /// @param entry The requested file
+    /// @return false if the range should be ignored and the whole file sent
+    static bool isRangeValid(const std::string &if_range, const HttpFileCache::Entry &entry);
+
+    /// Select the I/O loop for a new connection in a round-robin manner
+    /// @return The selected worker
+    HttpWorker &nextWorker();
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sese/thread/Thread.h>
+#include <sese/util/TimeWheel.h>
+
+#include <sese/internal/service/http/HttpConnection.h>
+#include <sese/internal/service/http/HttpConnectionEx.h>
+#include <sese/internal/service/http/WebsocketSessionImpl.h>
+
+#include <set>
+
+namespace sese::internal::service::http {
+
+/// A single I/O loop of the HTTP service.
+/// The connection sets are only accessed from the thread that runs the loop
+struct HttpWorker {
+    using Ptr = std::unique_ptr<HttpWorker>;
+
+    asio::io_context io_context;
+    Thread::Ptr thread;
+    /// Listening socket accepting on this loop, null if the loop does not accept
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
+    std::set<HttpConnection::Ptr> connections;
+    std::set<HttpConnectionEx::Ptr> connections2;
+    /// Upgraded connections, each session owns its connection
+    std::set<WebsocketSessionImpl::Ptr> websockets;
+    /// Timeouts of the connections, shared so that arming one does not touch the timer queue of the loop
+    TimeWheel wheel;
+    asio::steady_timer ticker{io_context};
+
+    /// Check the wheel once a second until the loop stops
+    void tick() {
+        ticker.expires_after(std::chrono::seconds(1));
+        ticker.async_wait([this](const asio::error_code &error) {
+            if (!error) {
+                wheel.check();
+                tick();
+            }
+        });
+    }
+};
+
+}
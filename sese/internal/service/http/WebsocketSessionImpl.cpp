@@ -0,0 +1,280 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/service/http/WebsocketSessionImpl.h>
+#include <sese/internal/service/http/HttpWorker.h>
+
+#include <cstring>
+
+using sese::net::ws::Opcode;
+using sese::net::ws::WebsocketFrame;
+
+static sese::Gauge &open_sessions = sese::MetricsRegistry::getInstance()->gauge(
+        "sese_http_websocket_sessions", "Connections upgraded to websockets, also counted as HTTP/1.1 connections"
+);
+
+sese::internal::service::http::WebsocketSessionImpl::WebsocketSessionImpl(HttpConnection::Ptr conn, const sese::service::http::WebsocketHandler &handler)
+    : conn(std::move(conn)),
+      handler(handler),
+      path_args(std::move(this->conn->path_args)),
+      remote_address(this->conn->remote_address),
+      worker(this->conn->worker) {
+    request.swap(this->conn->request);
+    open_sessions.add();
+}
+
+sese::internal::service::http::WebsocketSessionImpl::~WebsocketSessionImpl() {
+    open_sessions.sub();
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::start(std::string &&received) {
+    capacity = std::max(RECV_BUFFER_SIZE, received.length());
+    buffer = std::make_unique<char[]>(capacity);
+    memcpy(buffer.get(), received.data(), received.length());
+    end = received.length();
+    if (handler.idle_timeout == 0) {
+        conn->cancelTimeout();
+    }
+    if (handler.on_open) {
+        handler.on_open(shared_from_this());
+    }
+    if (!finished) {
+        handleData();
+    }
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::send(const Frame &frame) {
+    if (released) {
+        return;
+    }
+    asio::dispatch(worker.io_context, [session = shared_from_this(), frame] {
+        if (!session->close_sent && !session->finished) {
+            session->push(frame);
+        }
+    });
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::close(uint16_t code, const std::string &reason) {
+    if (released) {
+        return;
+    }
+    asio::dispatch(worker.io_context, [session = shared_from_this(), code, reason] {
+        if (!session->close_sent && !session->finished) {
+            session->sendClose(code, reason);
+        }
+    });
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::abort() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+    released = true;
+    if (handler.on_close) {
+        handler.on_close(shared_from_this(), 1001);
+    }
+    conn = nullptr;
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::read() {
+    if (handler.idle_timeout && !close_sent) {
+        conn->setTimeout(handler.idle_timeout);
+    }
+    conn->asyncReadSome(asio::buffer(buffer.get() + end, capacity - end), [session = shared_from_this()](const asio::error_code &error, std::size_t bytes_transferred) {
+        if (session->finished) {
+            return;
+        }
+        if (error) {
+            session->finish(1006);
+            return;
+        }
+        session->end += bytes_transferred;
+        session->handleData();
+    });
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::handleData() {
+    auto self = shared_from_this();
+    while (!finished && !close_received) {
+        if (!in_frame) {
+            auto size = WebsocketFrame::parse(buffer.get() + begin, end - begin, header);
+            if (size == 0) {
+                break;
+            }
+            // Frames of a client are always masked, and no extension is negotiated
+            if (size < 0 || !header.masked || header.rsv) {
+                fail(1002);
+                return;
+            }
+            if (header.isControl()) {
+                // Control frames are small enough to be handled once complete
+                auto length = static_cast<size_t>(header.payload_length);
+                if (end - begin < static_cast<size_t>(size) + length) {
+                    break;
+                }
+                auto payload = buffer.get() + begin + size;
+                WebsocketFrame::unmask(payload, length, header.mask_key);
+                begin += size + length;
+                handleControl(header.opcode, payload, length);
+                continue;
+            }
+            if ((header.opcode == Opcode::CONTINUATION) != in_message) {
+                // A continuation without a message, or a new message interleaved with a fragmented one
+                fail(1002);
+                return;
+            }
+            if (!in_message) {
+                message_opcode = header.opcode;
+                in_message = true;
+            }
+            begin += size;
+            in_frame = true;
+            remaining = header.payload_length;
+            offset = 0;
+        }
+
+        auto length = static_cast<size_t>(std::min<uint64_t>(end - begin, remaining));
+        if (length == 0 && remaining) {
+            break;
+        }
+        // Deliver the part received so far in place, it is never copied into a message buffer
+        auto data = buffer.get() + begin;
+        WebsocketFrame::unmask(data, length, header.mask_key, offset);
+        begin += length;
+        remaining -= length;
+        offset += length;
+        bool last = false;
+        if (remaining == 0) {
+            in_frame = false;
+            if (header.fin) {
+                in_message = false;
+                last = true;
+            }
+        }
+        if (handler.on_message) {
+            handler.on_message(self, message_opcode, data, length, last);
+        }
+    }
+    if (finished || close_received) {
+        return;
+    }
+
+    // Keep the incomplete header at the front of the buffer
+    if (begin == end) {
+        begin = end = 0;
+    } else if (begin) {
+        memmove(buffer.get(), buffer.get() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    read();
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::handleControl(Opcode opcode, const char *payload, size_t length) {
+    if (opcode == Opcode::PING) {
+        if (!close_sent) {
+            push(WebsocketFrame::make(Opcode::PONG, payload, length));
+        }
+    } else if (opcode == Opcode::CLOSE) {
+        close_received = true;
+        if (length == 1) {
+            fail(1002);
+            return;
+        }
+        if (length >= 2) {
+            close_code = static_cast<uint16_t>(static_cast<uint8_t>(payload[0]) << 8 | static_cast<uint8_t>(payload[1]));
+        }
+        if (!close_sent) {
+            // Echo the status code
+            sendClose(close_code);
+        } else if (write_count == 0) {
+            finish(close_code);
+        }
+    }
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::push(const Frame &frame) {
+    queued_bytes += frame->length();
+    queue.emplace_back(frame);
+    if (queued_bytes > MAX_QUEUED_BYTES) {
+        // The peer does not read, drop it rather than buffering without bound
+        finish(1006);
+        return;
+    }
+    if (write_count == 0) {
+        flush();
+    }
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::flush() {
+    buffers.clear();
+    for (size_t i = 0; i < queue.size() && i < MAX_WRITE_FRAMES; ++i) {
+        buffers.emplace_back(asio::buffer(*queue[i]));
+    }
+    write_count = buffers.size();
+    conn->writeBlocks(buffers, [session = shared_from_this()](const asio::error_code &error) {
+        if (session->finished) {
+            return;
+        }
+        if (error) {
+            session->finish(1006);
+            return;
+        }
+        for (size_t i = 0; i < session->write_count; ++i) {
+            session->queued_bytes -= session->queue.front()->length();
+            session->queue.pop_front();
+        }
+        session->write_count = 0;
+        if (!session->queue.empty()) {
+            session->flush();
+        } else if (session->close_sent && session->close_received) {
+            session->finish(session->close_code);
+        }
+    });
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::sendClose(uint16_t code, const std::string &reason) {
+    close_sent = true;
+    // The peer has a limited time to answer, after which the socket is closed and the session finished by the failed operation
+    conn->setTimeout(CLOSE_TIMEOUT);
+    push(WebsocketFrame::makeClose(code, reason));
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::fail(uint16_t code) {
+    // Nothing more is read, the connection is released once the close frame is sent
+    close_received = true;
+    close_code = code;
+    if (!close_sent) {
+        sendClose(code);
+    } else if (write_count == 0) {
+        finish(code);
+    }
+}
+
+void sese::internal::service::http::WebsocketSessionImpl::finish(uint16_t code) {
+    if (finished) {
+        return;
+    }
+    auto self = shared_from_this();
+    finished = true;
+    released = true;
+    conn->cancelTimeout();
+    conn->closeSocket();
+    if (handler.on_close) {
+        handler.on_close(self, code);
+    }
+    worker.websockets.erase(self);
+    conn = nullptr;
+}
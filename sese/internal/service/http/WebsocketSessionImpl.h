@@ -0,0 +1,129 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sese/service/http/WebsocketSession.h>
+
+#include <sese/internal/service/http/HttpConnection.h>
+
+#include <atomic>
+#include <deque>
+
+namespace sese::internal::service::http {
+
+/// Websocket session taking over an upgraded HTTP/1.1 connection, its state is only accessed from the loop of the connection
+struct WebsocketSessionImpl final : sese::service::http::WebsocketSession, std::enable_shared_from_this<WebsocketSessionImpl> {
+    using Ptr = std::shared_ptr<WebsocketSessionImpl>;
+    using Frame = sese::net::ws::WebsocketFrame::Ptr;
+
+    /// Size of the receive buffer, large frames are delivered in parts of at most this size
+    static constexpr size_t RECV_BUFFER_SIZE = 16 * 1024;
+    /// Bytes waiting to be sent above which the peer is considered too slow and is disconnected
+    static constexpr size_t MAX_QUEUED_BYTES = 4 * 1024 * 1024;
+    /// Maximum number of frames gathered into one write
+    static constexpr size_t MAX_WRITE_FRAMES = 16;
+    /// Time the peer has to complete the closing handshake
+    static constexpr uint32_t CLOSE_TIMEOUT = 5;
+
+    /// @param conn Upgraded connection, owned by the session from now on
+    /// @param handler Callbacks of the route
+    WebsocketSessionImpl(HttpConnection::Ptr conn, const sese::service::http::WebsocketHandler &handler);
+
+    ~WebsocketSessionImpl() override;
+
+    /// Start reading frames
+    /// @param received Bytes received after the upgrade request
+    void start(std::string &&received);
+
+    void send(const Frame &frame) override;
+
+    void close(uint16_t code, const std::string &reason) override;
+
+    [[nodiscard]] const sese::net::http::Request &getRequest() const override { return request; }
+
+    [[nodiscard]] const sese::net::http::Router::Params &getPathArgs() const override { return path_args; }
+
+    [[nodiscard]] sese::net::IPAddress::Ptr getRemoteAddress() const override { return remote_address; }
+
+    /// Release the connection without the closing handshake once the loop has stopped,
+    /// so that a session still referenced by the application does not outlive the service with it
+    void abort();
+
+private:
+    void read();
+
+    /// Decode the received frames and deliver the payloads
+    void handleData();
+
+    void handleControl(sese::net::ws::Opcode opcode, const char *payload, size_t length);
+
+    /// Queue a frame and start writing unless a write is in progress
+    void push(const Frame &frame);
+
+    void flush();
+
+    /// Queue a close frame, the connection is released once the peer has answered
+    void sendClose(uint16_t code, const std::string &reason = {});
+
+    /// Close the session because the peer violated the protocol
+    /// @param code Status code sent to the peer
+    void fail(uint16_t code);
+
+    /// Release the connection and report the status code
+    void finish(uint16_t code);
+
+    HttpConnection::Ptr conn;
+    const sese::service::http::WebsocketHandler &handler;
+    /// Taken over from the connection, they remain valid after it is released
+    sese::net::http::Request request;
+    sese::net::http::Router::Params path_args;
+    sese::net::IPAddress::Ptr remote_address;
+    /// The loop of the connection
+    HttpWorker &worker;
+    /// Set once the connection is released, frames sent from then on are dropped
+    std::atomic_bool released = false;
+
+    std::unique_ptr<char[]> buffer;
+    size_t capacity = RECV_BUFFER_SIZE;
+    /// Unprocessed bytes are buffer[begin, end)
+    size_t begin = 0;
+    size_t end = 0;
+
+    /// Header of the frame whose payload is being received
+    sese::net::ws::FrameHeader header;
+    bool in_frame = false;
+    /// Payload of the current frame not received yet
+    uint64_t remaining = 0;
+    /// Payload of the current frame already delivered, which selects the byte of the masking key
+    uint64_t offset = 0;
+    /// Opcode of the first frame of a fragmented message
+    sese::net::ws::Opcode message_opcode = sese::net::ws::Opcode::TEXT;
+    bool in_message = false;
+
+    /// Frames waiting to be sent, the first write_count of them are being written
+    std::deque<Frame> queue;
+    size_t queued_bytes = 0;
+    size_t write_count = 0;
+    std::vector<asio::const_buffer> buffers;
+
+    bool close_sent = false;
+    /// No more frames are read, the peer has sent a close frame or violated the protocol
+    bool close_received = false;
+    bool finished = false;
+    /// Status code received from the peer
+    uint16_t close_code = 1005;
+};
+
+}
@@ -21,7 +21,11 @@
 using namespace sese::log;
 using namespace std::chrono_literals;
 
-AsyncLogger::AsyncLogger() : Logger() {
+AsyncLogger::AsyncLogger()
+    : Logger(),
+      records(MetricsRegistry::getInstance()->counter("sese_log_records_total", "Records accepted by the asynchronous logger")),
+      writtenBytes(MetricsRegistry::getInstance()->counter("sese_log_written_bytes_total", "Bytes handed to the appenders by the asynchronous logger")),
+      droppedBytes(MetricsRegistry::getInstance()->counter("sese_log_dropped_bytes_total", "Bytes discarded by the asynchronous logger")) {
     currentBuffer = new io::FixedBuilder(RECORD_BUFFER_SIZE);
     nextBuffer = new io::FixedBuilder(RECORD_BUFFER_SIZE);
 
@@ -42,6 +46,7 @@ void AsyncLogger::log(const Event::Ptr &event) noexcept {
     std::unique_lock locker(mutex);
     if (builtInAppender->getLevel() <= event->getLevel()) {
         std::string content = formatter->dump(event);
+        records.inc();
         if (currentBuffer->getWriteableSize() > content.length()) {
             currentBuffer->write(content.data(), content.length());
         } else {
@@ -68,6 +73,7 @@ void AsyncLogger::dump(const void *buffer, size_t length) noexcept {
 
         if (nextBuffer) {
             if (nextBuffer->getSize() > length) {
+                droppedBytes.inc(length);
                 return;
             }
             currentBuffer = nextBuffer;
@@ -104,7 +110,8 @@ void AsyncLogger::loop() noexcept {
         // Too many buffers make the chance of triggering very small
         // GCOVR_EXCL_START
         if (buffer2_write.size() > 25) {
-            std::for_each(buffer2_write.begin() + 2, buffer2_write.end(), [](io::FixedBuilder *buffer) {
+            std::for_each(buffer2_write.begin() + 2, buffer2_write.end(), [this](io::FixedBuilder *buffer) {
+                droppedBytes.inc(buffer->getReadableSize());
                 delete buffer;
             });
             buffer2_write.erase(buffer2_write.begin() + 2, buffer2_write.end());
@@ -113,6 +120,7 @@ void AsyncLogger::loop() noexcept {
 
         for (const auto &buffer: buffer2_write) {
             builtInAppender->dump(buffer->data(), buffer->getReadableSize());
+            writtenBytes.inc(buffer->getReadableSize());
         }
         for (auto &appender: appenderVector) {
             for (const auto &buffer: buffer2_write) {
@@ -25,6 +25,7 @@
 #include <sese/log/Logger.h>
 #include <sese/thread/Thread.h>
 #include <sese/io/FixedBuilder.h>
+#include <sese/util/Metrics.h>
 
 #include <atomic>
 #include <mutex>
@@ -55,5 +56,10 @@ protected:
     std::condition_variable conditionVariable;
     std::atomic_bool isShutdown{};
     sese::Thread::Ptr thread;
+
+    Counter &records;
+    Counter &writtenBytes;
+    /// Bytes discarded because the appenders could not keep up
+    Counter &droppedBytes;
 };
 } // namespace sese::log
\ No newline at end of file
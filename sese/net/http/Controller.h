@@ -57,6 +57,22 @@ public:
 
     void invoke(HttpServletContext &ctx) const;
 
+    /// Set whether the servlet is executed on the worker pool of the service instead of the I/O thread,
+    /// which is suitable for blocking callbacks such as database queries
+    /// @param async Whether to execute asynchronously
+    void setAsync(bool async) { this->async = async; }
+
+    [[nodiscard]] bool isAsync() const { return async; }
+
+    /// Set whether the request body is streamed to the servlet instead of being buffered.
+    /// A streaming servlet is invoked on the worker pool as soon as the header is received,
+    /// and reads the body through HttpServletContext::getInputStream while it is being received
+    /// @note Requires the worker pool of the service, otherwise the body is buffered as usual
+    /// @param streaming Whether to stream the body
+    void setStreaming(bool streaming) { this->streaming = streaming; }
+
+    [[nodiscard]] bool isStreaming() const { return streaming; }
+
     Servlet &operator=(Callback callback) {
         setCallback(std::move(callback));
         return *this;
@@ -73,6 +89,10 @@ private:
     std::set<std::string> expect_headers;
     /// Request handling callback function, 500 if not met
     Callback callback;
+    /// Whether to execute on the worker pool
+    bool async = false;
+    /// Whether the request body is streamed
+    bool streaming = false;
 };
 
 /// HTTP controller
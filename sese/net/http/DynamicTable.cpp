@@ -19,38 +19,95 @@
 
 using namespace sese::net::http;
 
-DynamicTable::DynamicTable(size_t max) noexcept {
+namespace {
+
+struct StaticIndex {
+    /// The lowest index of each name
+    std::unordered_map<std::string, size_t> names;
+    std::unordered_map<DynamicTable::Header, size_t, DynamicTable::HeaderHash> fields;
+
+    StaticIndex() noexcept {
+        for (size_t i = PREDEFINED_HEADERS.size() - 1; i > 0; --i) {
+            auto &&[key, value] = PREDEFINED_HEADERS[i];
+            names[key] = i;
+            fields[{key, value}] = i;
+        }
+    }
+};
+
+const StaticIndex &staticIndex() noexcept {
+    static const StaticIndex INDEX;
+    return INDEX;
+}
+
+} // namespace
+
+DynamicTable::DynamicTable(size_t max) noexcept : ring(8) {
     this->max = max;
 }
 
 void DynamicTable::resize(size_t max) noexcept {
+    if (max == this->max) {
+        return;
+    }
     this->max = max;
+    smallest_size = size_updated ? std::min(smallest_size, max) : max;
+    size_updated = true;
     while (size > max) {
-        decltype(auto) header = queue.back();
-        size -= header.first.size() + header.second.size() + 4;
-        queue.pop_front();
+        evict();
     }
 }
 
+void DynamicTable::evict() noexcept {
+    auto sequence = inserted - count;
+    auto &&header = ring[head];
+    size -= header.first.size() + header.second.size() + 32;
+
+    // Older duplicates were evicted before, so only the newest entry is indexed
+    auto name = names.find(header.first);
+    if (name != names.end() && name->second == sequence) {
+        names.erase(name);
+    }
+    auto field = fields.find(header);
+    if (field != fields.end() && field->second == sequence) {
+        fields.erase(field);
+    }
+
+    header = Header();
+    head = (head + 1) & (ring.size() - 1);
+    count -= 1;
+}
 
 bool DynamicTable::set(const std::string &key, const std::string &value) noexcept {
-    if (key.size() > std::numeric_limits<size_t>::max() - value.size()) {
+    if (key.size() > std::numeric_limits<size_t>::max() - value.size() - 32) {
         return false;
     }
 
-    auto addition = key.size() + value.size() + 4;
+    auto addition = key.size() + value.size() + 32;
+    while (count && size + addition > max) {
+        evict();
+    }
     if (addition > max) {
         return false;
     }
 
-    while (size + addition > max) {
-        decltype(auto) header = queue.back();
-        size -= header.first.size() + header.second.size() + 4;
-        queue.pop_front();
+    if (count == ring.size()) {
+        std::vector<Header> larger(ring.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            larger[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+        }
+        ring = std::move(larger);
+        head = 0;
     }
 
+    auto &&header = ring[(head + count) & (ring.size() - 1)];
+    header.first = key;
+    header.second = value;
+    names[key] = inserted;
+    fields[header] = inserted;
     size += addition;
-    queue.emplace_back(key, value);
+    count += 1;
+    inserted += 1;
     return true;
 }
 
@@ -63,9 +120,54 @@ std::optional<DynamicTable::Header> DynamicTable::get(size_t index) const noexce
         return PREDEFINED_HEADERS[index];
     }
 
-    if (index < PREDEFINED_HEADERS.size() + queue.size()) {
-        return queue[queue.size() - 1 - (index - PREDEFINED_HEADERS.size())];
+    if (index < PREDEFINED_HEADERS.size() + count) {
+        return at(count - 1 - (index - PREDEFINED_HEADERS.size()));
     }
 
     return std::nullopt;
 }
+
+size_t DynamicTable::find(const std::string &key, const std::string &value, bool &matched, size_t name_index) const noexcept {
+    auto &&index = staticIndex();
+    matched = true;
+    if (name_index) {
+        // The entries of a name are adjacent in the static table
+        for (auto i = name_index; i < PREDEFINED_HEADERS.size() && PREDEFINED_HEADERS[i].first == key; ++i) {
+            if (PREDEFINED_HEADERS[i].second == value) {
+                return i;
+            }
+        }
+    } else {
+        auto static_field = index.fields.find({key, value});
+        if (static_field != index.fields.end()) {
+            return static_field->second;
+        }
+    }
+    auto field = fields.find({key, value});
+    if (field != fields.end()) {
+        return PREDEFINED_HEADERS.size() + (inserted - 1 - field->second);
+    }
+
+    matched = false;
+    if (name_index) {
+        return name_index;
+    }
+    auto static_name = index.names.find(key);
+    if (static_name != index.names.end()) {
+        return static_name->second;
+    }
+    auto name = names.find(key);
+    if (name != names.end()) {
+        return PREDEFINED_HEADERS.size() + (inserted - 1 - name->second);
+    }
+    return 0;
+}
+
+bool DynamicTable::takeSizeUpdate(size_t &smallest) noexcept {
+    if (!size_updated) {
+        return false;
+    }
+    smallest = smallest_size;
+    size_updated = false;
+    return true;
+}
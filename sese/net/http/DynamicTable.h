@@ -15,47 +15,119 @@
 /**
  * @file DynamicTable.h
  * @author kaoru
- * @version 0.2
+ * @version 0.3
  * @brief HTTP 2 dynamic table
  * @date September 13, 2023
  */
 
 #pragma once
 
-#include <deque>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace sese::net::http {
 
-/// HTTP 2 dynamic table
+/// HTTP 2 dynamic table.
+/// Entries are kept in a ring buffer and indexed by hash, so both insertion with eviction and lookup are O(1)
 class DynamicTable {
 public:
     using Header = std::pair<std::string, std::string>;
 
+    struct HeaderHash {
+        size_t operator()(const Header &header) const noexcept {
+            auto hash = std::hash<std::string>{}(header.first);
+            return hash ^ (std::hash<std::string>{}(header.second) + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+        }
+    };
+
+    /// Iterates from the oldest entry to the newest
+    class Iterator {
+    public:
+        Iterator(const DynamicTable *table, size_t pos) noexcept : table(table), pos(pos) {}
+
+        const Header &operator*() const noexcept { return table->at(pos); }
+
+        const Header *operator->() const noexcept { return &table->at(pos); }
+
+        Iterator &operator++() noexcept {
+            pos += 1;
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const noexcept { return pos == other.pos; }
+
+        bool operator!=(const Iterator &other) const noexcept { return pos != other.pos; }
+
+    private:
+        const DynamicTable *table;
+        size_t pos;
+    };
+
     explicit DynamicTable(size_t max = 4096) noexcept;
 
     virtual ~DynamicTable() noexcept = default;
 
+    /// Change the maximum size, entries are evicted until the table fits
+    /// @param max Maximum size
     void resize(size_t max) noexcept;
 
     [[nodiscard]] size_t getMaxSize() const noexcept { return max; }
 
-    [[nodiscard]] size_t getCount() const noexcept { return queue.size(); }
+    [[nodiscard]] size_t getCount() const noexcept { return count; }
 
     [[nodiscard]] size_t getSize() const noexcept { return size; }
 
+    /// Insert an entry, the oldest entries are evicted to make room
+    /// @param key Field name
+    /// @param value Field value
+    /// @return false if the entry is larger than the maximum size, the table is emptied in this case
     bool set(const std::string &key, const std::string &value) noexcept;
 
+    /// Get an entry of the static table or the dynamic table
+    /// @param index HPACK index
+    /// @return std::nullopt if the index is out of range
     [[nodiscard]] std::optional<Header> get(size_t index) const noexcept;
 
-    [[nodiscard]] auto begin() const { return queue.begin(); }
+    /// Search the static table and the dynamic table, the static table is preferred
+    /// @param key Lowercase field name
+    /// @param value Field value
+    /// @param matched Set to whether the value matches as well
+    /// @param name_index Index of the name in the static table if already known, see Header::getNameIndex
+    /// @return HPACK index of the entry, 0 if the name is not found
+    size_t find(const std::string &key, const std::string &value, bool &matched, size_t name_index = 0) const noexcept;
+
+    /// Take the pending size update, the encoder must signal it at the beginning of the next header block
+    /// @param smallest The smallest maximum size since the last update
+    /// @return false if the maximum size has not changed
+    bool takeSizeUpdate(size_t &smallest) noexcept;
 
-    [[nodiscard]] auto end() const { return queue.end(); }
+    [[nodiscard]] Iterator begin() const noexcept { return {this, 0}; }
+
+    [[nodiscard]] Iterator end() const noexcept { return {this, count}; }
 
 protected:
+    /// @param pos Position from the oldest entry
+    [[nodiscard]] const Header &at(size_t pos) const noexcept { return ring[(head + pos) & (ring.size() - 1)]; }
+
+    void evict() noexcept;
+
     size_t max;
     size_t size = 0;
-    std::deque<Header> queue;
+    /// Capacity is always a power of 2
+    std::vector<Header> ring;
+    /// Position of the oldest entry
+    size_t head = 0;
+    size_t count = 0;
+    /// Number of entries ever inserted, the newest entry has the sequence number inserted - 1
+    uint64_t inserted = 0;
+    /// Sequence number of the newest entry of each name
+    std::unordered_map<std::string, uint64_t> names;
+    /// Sequence number of the newest entry of each field
+    std::unordered_map<Header, uint64_t, HeaderHash> fields;
+    bool size_updated = false;
+    size_t smallest_size = 0;
 };
-} // namespace sese::net::http
\ No newline at end of file
+} // namespace sese::net::http
@@ -0,0 +1,133 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/http/EventTopic.h>
+
+#include <algorithm>
+#include <iterator>
+
+using sese::net::http::EventTopic;
+
+EventTopic::Subscriber::Subscriber(size_t backlog, OverflowPolicy policy)
+    : capacity(std::max<size_t>(backlog, 1)), policy(policy) {
+}
+
+bool EventTopic::Subscriber::push(const Event &event) {
+    NotifyCallback callback;
+    bool result = true;
+    {
+        std::lock_guard lock(mutex);
+        if (overflowed) {
+            return false;
+        }
+        if (backlog.size() >= capacity) {
+            result = false;
+            if (policy == OverflowPolicy::DISCONNECT) {
+                overflowed = true;
+                backlog.clear();
+            } else {
+                backlog.pop_front();
+            }
+        }
+        if (!overflowed) {
+            backlog.emplace_back(event);
+        }
+        if (waiting) {
+            waiting = false;
+            callback = on_notify;
+        }
+    }
+    if (callback) {
+        callback();
+    }
+    return result;
+}
+
+bool EventTopic::Subscriber::take(std::vector<Event> &events) {
+    std::lock_guard lock(mutex);
+    if (overflowed) {
+        return false;
+    }
+    if (backlog.empty()) {
+        waiting = true;
+        return true;
+    }
+    std::move(backlog.begin(), backlog.end(), std::back_inserter(events));
+    backlog.clear();
+    return true;
+}
+
+void EventTopic::Subscriber::setNotifyCallback(NotifyCallback &&callback) {
+    std::lock_guard lock(mutex);
+    on_notify = std::move(callback);
+}
+
+EventTopic::EventTopic(size_t backlog, OverflowPolicy policy) : backlog(backlog), policy(policy) {
+}
+
+EventTopic::Event EventTopic::serialize(std::string_view data, std::string_view event, std::string_view id) {
+    auto result = std::make_shared<std::string>();
+    result->reserve(data.length() + event.length() + id.length() + 24);
+    if (!event.empty()) {
+        result->append("event: ").append(event).append("\n");
+    }
+    if (!id.empty()) {
+        result->append("id: ").append(id).append("\n");
+    }
+    // A line break in the data starts another data field, the client joins them with line feeds
+    while (true) {
+        auto pos = data.find('\n');
+        auto line = data.substr(0, pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        result->append("data: ").append(line).append("\n");
+        if (pos == std::string_view::npos) {
+            break;
+        }
+        data.remove_prefix(pos + 1);
+    }
+    result->append("\n");
+    return result;
+}
+
+void EventTopic::publish(const Event &event) {
+    std::lock_guard lock(mutex);
+    uint64_t failed = 0;
+    auto end = std::remove_if(subscribers.begin(), subscribers.end(), [&](const std::weak_ptr<Subscriber> &weak) {
+        auto subscriber = weak.lock();
+        if (!subscriber) {
+            return true;
+        }
+        if (!subscriber->push(event)) {
+            failed += 1;
+        }
+        return false;
+    });
+    subscribers.erase(end, subscribers.end());
+    dropped += failed;
+}
+
+EventTopic::Subscriber::Ptr EventTopic::subscribe() {
+    auto subscriber = std::make_shared<Subscriber>(backlog, policy);
+    std::lock_guard lock(mutex);
+    subscribers.emplace_back(subscriber);
+    return subscriber;
+}
+
+size_t EventTopic::getSubscriberCount() {
+    std::lock_guard lock(mutex);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [](auto &&weak) { return weak.expired(); }), subscribers.end());
+    return subscribers.size();
+}
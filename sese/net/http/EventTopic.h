@@ -0,0 +1,131 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file EventTopic.h
+ * @brief Server-Sent Events topic
+ * @author kaoru
+ * @date October 17, 2026
+ */
+
+#pragma once
+
+#include <sese/Config.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sese::net::http {
+
+/// Events published to the responses subscribed by servlets, see HttpServletContext::subscribe.
+/// Each event is serialized once in the text/event-stream format and the same buffer is written to every subscriber
+class EventTopic final {
+public:
+    using Ptr = std::shared_ptr<EventTopic>;
+    /// Serialized event shared by the subscribers
+    using Event = std::shared_ptr<const std::string>;
+
+    /// What happens when a subscriber falls behind by more than the backlog
+    enum class OverflowPolicy {
+        /// Discard the oldest event not sent yet
+        DROP_OLDEST,
+        /// Close the response, so that the client reconnects and resynchronizes
+        DISCONNECT
+    };
+
+    /// Events waiting to be sent to a single response
+    class Subscriber final {
+    public:
+        using Ptr = std::shared_ptr<Subscriber>;
+        using NotifyCallback = std::function<void()>;
+
+        /// @param backlog Maximum number of events waiting to be sent
+        /// @param policy Overflow policy
+        Subscriber(size_t backlog, OverflowPolicy policy);
+
+        /// Queue an event, called by the topic on the publisher thread
+        /// @param event Serialized event
+        /// @return false if an event was discarded or the subscriber overflowed
+        bool push(const Event &event);
+
+        /// Take the queued events, called by the connection.
+        /// If nothing is queued, the notify callback is invoked once an event arrives
+        /// @param events The events are appended to it
+        /// @return false if the subscriber overflowed and the response must be closed
+        bool take(std::vector<Event> &events);
+
+        /// Set the callback invoked on the publisher thread when an event arrives for a waiting connection
+        /// @param callback Callback function
+        void setNotifyCallback(NotifyCallback &&callback);
+
+    private:
+        std::mutex mutex;
+        std::deque<Event> backlog;
+        size_t capacity;
+        OverflowPolicy policy;
+        bool waiting = false;
+        bool overflowed = false;
+        NotifyCallback on_notify;
+    };
+
+    /// @param backlog Maximum number of events waiting to be sent to each subscriber
+    /// @param policy Overflow policy
+    explicit EventTopic(size_t backlog = 256, OverflowPolicy policy = OverflowPolicy::DROP_OLDEST);
+
+    /// Serialize an event, each line of the data becomes a data field
+    /// @param data Data
+    /// @param event Event type, omitted if empty
+    /// @param id Event ID, omitted if empty
+    /// @return Serialized event
+    static Event serialize(std::string_view data, std::string_view event = {}, std::string_view id = {});
+
+    /// Deliver an event to every subscriber
+    /// @note Thread safe
+    /// @param event Serialized event
+    void publish(const Event &event);
+
+    /// Serialize and deliver an event to every subscriber
+    /// @note Thread safe
+    /// @param data Data
+    /// @param event Event type, omitted if empty
+    /// @param id Event ID, omitted if empty
+    void publish(std::string_view data, std::string_view event = {}, std::string_view id = {}) {
+        publish(serialize(data, event, id));
+    }
+
+    /// Create a subscriber with the backlog of the topic, it is unsubscribed once released
+    /// @return Subscriber
+    Subscriber::Ptr subscribe();
+
+    /// Get the number of live subscribers
+    [[nodiscard]] size_t getSubscriberCount();
+
+    /// Get the number of events discarded or not delivered because a subscriber fell behind
+    [[nodiscard]] uint64_t getDroppedCount() const { return dropped; }
+
+private:
+    std::mutex mutex;
+    std::vector<std::weak_ptr<Subscriber>> subscribers;
+    size_t backlog;
+    OverflowPolicy policy;
+    std::atomic<uint64_t> dropped = 0;
+};
+
+} // namespace sese::net::http
@@ -38,6 +38,7 @@
 #include "sese/text/StringBuilder.h"
 
 #include <cmath>
+#include <cctype>
 #include <algorithm>
 
 #ifdef _WIN32
@@ -228,177 +229,114 @@ uint32_t HPackUtil::decode(
     return 0;
 }
 
-size_t HPackUtil::encode(OutputStream *dest, DynamicTable &table, Header &once_header,
-                         Header &indexed_header) noexcept {
-    size_t size = 0;
-    // HANDLES INDEXED HEADERS
-    for (const auto &item: indexed_header) {
-        // Dynamic table queries
-        {
-            auto iterator_key = table.end();
-            auto iterator_all = table.end();
-            for (auto header = table.begin(); header != table.end(); ++header) {
-                if (header->first == item.first) {
-                    iterator_key = header;
-                    if (header->second == item.second) {
-                        iterator_all = header;
-                        break;
-                    }
-                }
-            }
-
-            // auto iterator = std::find_if(table.begin(), table.end(), isHitAll);
-            if (iterator_all != table.end()) {
-                /// Corresponds to case 0
-                size_t index = table.getCount() - 1 - (iterator_all - table.begin()) + PREDEFINED_HEADERS.size();
-                size += encodeIndexCase0(dest, index);
-                continue;
-            }
-
-            // iterator = std::find_if(table.begin(), table.end(), isHit);
-            // Exists in a dynamic table
-            if (iterator_key != table.end()) {
-                size_t index = table.getCount() - 1 - (iterator_key - table.begin()) + PREDEFINED_HEADERS.size();
-                /// Corresponding to case 1
-                size += encodeIndexCase1(dest, index);
-                size += encodeString(dest, item.second);
-                /// Add a dynamic table
-                table.set(item.first, item.second);
-                continue;
-            }
-        }
-        // Static table queries
-        {
-            auto iterator_key = PREDEFINED_HEADERS.end();
-            auto iterator_all = PREDEFINED_HEADERS.end();
-            for (auto header = PREDEFINED_HEADERS.begin(); header != PREDEFINED_HEADERS.end(); ++header) {
-                if (header->first == item.first) {
-                    iterator_key = header;
-                    if (header->second == item.second) {
-                        iterator_all = header;
-                        break;
-                    }
-                }
-            }
-
-            // auto iterator = std::find_if(predefined_headers.begin(), predefined_headers.end(), isHitAll);
-            if (iterator_all != PREDEFINED_HEADERS.end()) {
-                /// Corresponds to case 0
-                size_t index = iterator_all - PREDEFINED_HEADERS.begin();
-                size += encodeIndexCase0(dest, index);
-                continue;
-            }
-
-            // iterator = std::find_if(predefined_headers.begin(), predefined_headers.end(), isHit);
-            if (iterator_key != PREDEFINED_HEADERS.end()) {
-                size_t index = iterator_key - PREDEFINED_HEADERS.begin();
-                /// Corresponding to case 1
-                size += encodeIndexCase1(dest, index);
-                size += encodeString(dest, item.second);
-                /// Add a dynamic table
-                table.set(item.first, item.second);
-                continue;
-            }
-        }
-
-        /// Add a dynamic table
-        {
-            size += encodeIndexCase1(dest, 0);
-            size += encodeString(dest, item.first);
-            size += encodeString(dest, item.second);
-            table.set(item.first, item.second);
-            continue;
-        }
+HPackUtil::Indexing HPackUtil::chooseIndexing(const std::string &key, const std::string &value, const DynamicTable &table) noexcept {
+    /// Credentials must not be stored by any intermediary, see RFC 7541 section 7.1.3
+    if (key == "authorization" || key == "proxy-authorization" || key == "cookie" || key == "set-cookie") {
+        return Indexing::NEVER;
+    }
+    /// Values that rarely repeat would only evict useful entries
+    if (key == ":path" || key == "age" || key == "content-length" || key == "content-range" || key == "etag" ||
+        key == "last-modified" || key == "location" || key == "if-modified-since" || key == "if-none-match") {
+        return Indexing::WITHOUT;
+    }
+    if ((key.size() + value.size() + 32) * 4 > table.getMaxSize() * 3) {
+        return Indexing::WITHOUT;
     }
+    return Indexing::INCREMENTAL;
+}
 
-    // DISPOSE OF SINGLE-USE HEADERS
-    for (const auto &item: once_header) {
-        // Dynamic table queries
-        {
-            auto iterator_key = table.end();
-            auto iterator_all = table.end();
-            for (auto header = table.begin(); header != table.end(); ++header) {
-                if (header->first == item.first) {
-                    iterator_key = header;
-                    if (header->second == item.second) {
-                        iterator_all = header;
-                        break;
-                    }
-                }
-            }
+size_t HPackUtil::encodeField(OutputStream *dest, DynamicTable &table, const std::string &key, const std::string &value, Indexing indexing, size_t name_index) noexcept {
+    bool matched;
+    auto index = table.find(key, value, matched, name_index);
+    if (matched) {
+        /// Corresponds to case 0
+        return encodeIndexCase0(dest, index);
+    }
 
-            // auto iterator = std::find_if(table.begin(), table.end(), isHit);
-            if (iterator_all != table.end()) {
-                /// Case 0
-                size += encodeIndexCase0(dest, iterator_all - table.begin() + 62);
-                continue;
-            }
+    size_t size;
+    switch (indexing) {
+        case Indexing::INCREMENTAL:
+            size = encodeIndexCase1(dest, index);
+            break;
+        case Indexing::WITHOUT:
+            size = encodeIndexCase2(dest, index);
+            break;
+        default:
+            size = encodeIndexCase3(dest, index);
+            break;
+    }
+    if (index == 0) {
+        size += encodeString(dest, key);
+    }
+    size += encodeString(dest, value);
+    if (indexing == Indexing::INCREMENTAL) {
+        table.set(key, value);
+    }
+    return size;
+}
 
-            if (iterator_key != table.end()) {
-                /// Case 2
-                size += encodeIndexCase2(dest, iterator_key - table.begin() + 62);
-                size += encodeString(dest, item.second);
-                continue;
-            }
+size_t HPackUtil::encodeFields(OutputStream *dest, DynamicTable &table, Header &header, bool once) noexcept {
+    size_t size = 0;
+    std::string lowercase;
+    auto encode_item = [&](Header::Iterator iterator) {
+        auto &&item = *iterator;
+        auto name_index = header.getNameIndex(iterator);
+        /// Field names must be lowercase in HTTP 2, the predefined names already are
+        const std::string *key = &lowercase;
+        if (name_index) {
+            key = &PREDEFINED_HEADERS[name_index].first;
+        } else {
+            lowercase.resize(item.first.size());
+            std::transform(item.first.begin(), item.first.end(), lowercase.begin(), [](char ch) {
+                return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+            });
         }
-
-        // Static table queries
-        {
-            auto iterator_key = PREDEFINED_HEADERS.end();
-            auto iterator_all = PREDEFINED_HEADERS.end();
-            for (auto header = PREDEFINED_HEADERS.begin(); header != PREDEFINED_HEADERS.end(); ++header) {
-                if (header->first == item.first) {
-                    iterator_key = header;
-                    if (header->second == item.second) {
-                        iterator_all = header;
-                        break;
-                    }
-                }
-            }
-
-            // auto iterator = std::find_if(predefined_headers.begin(), predefined_headers.end(), isHit);
-            if (iterator_all != PREDEFINED_HEADERS.end()) {
-                /// Case 0
-                size += encodeIndexCase0(dest, iterator_all - PREDEFINED_HEADERS.begin());
-                continue;
-            }
-            if (iterator_key != PREDEFINED_HEADERS.end()) {
-                /// Case 2
-                size += encodeIndexCase2(dest, iterator_key - PREDEFINED_HEADERS.begin());
-                size += encodeString(dest, item.second);
-                continue;
-            }
+        auto indexing = chooseIndexing(*key, item.second, table);
+        if (once && indexing == Indexing::INCREMENTAL) {
+            indexing = Indexing::WITHOUT;
         }
-
-        // There is no indexed data
-        {
-            size += encodeIndexCase3(dest, 0);
-            size += encodeString(dest, item.first);
-            size += encodeString(dest, item.second);
-            continue;
+        size += encodeField(dest, table, *key, item.second, indexing, name_index);
+    };
+    /// The pseudo-header fields must precede the regular fields, see RFC 9113 section 8.3
+    for (auto iterator = header.begin(); iterator != header.end(); ++iterator) {
+        if (!iterator->first.empty() && iterator->first[0] == ':') {
+            encode_item(iterator);
+        }
+    }
+    for (auto iterator = header.begin(); iterator != header.end(); ++iterator) {
+        if (iterator->first.empty() || iterator->first[0] != ':') {
+            encode_item(iterator);
         }
     }
 
-    /// Cookies are not compressed here
-    auto once_cookies = once_header.getCookies();
-    auto indexed_cookies = indexed_header.getCookies();
-    if (once_cookies) {
-        for (const auto &cookie: *once_cookies) {
-            auto str = buildCookieString(cookie.second);
-            size += encodeIndexCase2(dest, 0);
-            size += encodeString(dest, "Set-Cookie");
-            size += encodeString(dest, str);
+    auto cookies = header.getCookies();
+    if (cookies) {
+        const std::string set_cookie = "set-cookie";
+        for (const auto &cookie: *cookies) {
+            size += encodeField(dest, table, set_cookie, buildCookieString(cookie.second), Indexing::NEVER);
         }
     }
-    if (indexed_cookies) {
-        for (const auto &cookie: *indexed_cookies) {
-            auto str = buildCookieString(cookie.second);
-            size += encodeIndexCase2(dest, 0);
-            size += encodeString(dest, "Set-Cookie");
-            size += encodeString(dest, str);
+    return size;
+}
+
+size_t HPackUtil::encode(OutputStream *dest, DynamicTable &table, Header &header) noexcept {
+    size_t size = 0;
+    size_t smallest;
+    if (table.takeSizeUpdate(smallest)) {
+        /// The smallest size must be signaled if the table has been shrunk in between, see RFC 7541 section 4.2
+        if (smallest < table.getMaxSize()) {
+            size += encodeSizeUpdate(dest, smallest);
         }
+        size += encodeSizeUpdate(dest, table.getMaxSize());
     }
+    size += encodeFields(dest, table, header, false);
+    return size;
+}
 
+size_t HPackUtil::encode(OutputStream *dest, DynamicTable &table, Header &once_header,
+                         Header &indexed_header) noexcept {
+    auto size = encode(dest, table, indexed_header);
+    size += encodeFields(dest, table, once_header, true);
     return size;
 }
 
@@ -435,7 +373,8 @@ int HPackUtil::decodeString(InputStream *src, std::string &dest) noexcept {
     if (len > UINT16_MAX) {
         return -1;
     }
-    char buffer[UINT16_MAX]{};
+    // Only the first len bytes are used, so the buffer is not zeroed
+    char buffer[UINT16_MAX];
     if (len != src->read(buffer, len)) {
         return -1;
     }
@@ -445,9 +384,9 @@ int HPackUtil::decodeString(InputStream *src, std::string &dest) noexcept {
         if (result == std::nullopt) {
             return -1;
         }
-        dest = result.value();
+        dest = std::move(result.value());
     } else {
-        dest = buffer;
+        dest.assign(buffer, len);
     }
     return static_cast<int>(1 + l + len);
 }
@@ -549,6 +488,31 @@ size_t HPackUtil::encodeIndexCase3(OutputStream *dest, size_t index) noexcept {
     }
 }
 
+size_t HPackUtil::encodeSizeUpdate(OutputStream *dest, size_t max_size) noexcept {
+    const auto PREFIX = static_cast<uint8_t>(std::pow(2, 5) - 1);
+    uint8_t buf;
+    if (max_size < PREFIX) {
+        buf = 0b0010'0000 | (static_cast<uint8_t>(max_size) & 0b0001'1111);
+        dest->write(&buf, 1);
+        return 1;
+    } else {
+        buf = 0b0010'0000 | 0b0001'1111;
+        dest->write(&buf, 1);
+        size_t size = 1;
+        max_size -= PREFIX;
+        while (max_size >= 128) {
+            buf = max_size % 128 + 128;
+            dest->write(&buf, 1);
+            max_size = max_size / 128;
+            size += 1;
+        }
+        buf = static_cast<uint8_t>(max_size);
+        dest->write(&buf, 1);
+        size += 1;
+        return size;
+    }
+}
+
 size_t HPackUtil::encodeString(OutputStream *dest, const std::string &str) noexcept {
     const auto PREFIX = static_cast<uint8_t>(std::pow(2, 7) - 1);
     auto str_len = str.length();
@@ -58,15 +58,39 @@ public:
         uint32_t limit = 8192
     ) noexcept;
 
+    /// Compress HEADERS in HPACK format.
+    /// Fields are looked up in the static table and the dynamic table, credentials and cookies are never indexed
+    /// \param dest Destination stream
+    /// \param table Dynamic table used for compression, a pending size update is signaled first
+    /// \param header Fields to be compressed
+    /// \return Size of the buffer generated by compression
+    static size_t encode(OutputStream *dest, DynamicTable &table, Header &header) noexcept;
+
     /// Attempt to compress HEADERS in HPACK format
     /// \param dest Destination stream
     /// \param table Dynamic table used for compression
-    /// \param once_header Non-indexed fields
-    /// \param indexed_header Indexed fields
+    /// \param once_header Fields never added to the dynamic table
+    /// \param indexed_header Fields added to the dynamic table where worthwhile
     /// \return Size of the buffer generated by compression
     static size_t encode(OutputStream *dest, DynamicTable &table, Header &once_header, Header &indexed_header) noexcept;
 
 private:
+    /// Representation of a literal field
+    enum class Indexing {
+        /// Case 1, added to the dynamic table
+        INCREMENTAL,
+        /// Case 2
+        WITHOUT,
+        /// Case 3, intermediaries must not index it either
+        NEVER
+    };
+
+    static Indexing chooseIndexing(const std::string &key, const std::string &value, const DynamicTable &table) noexcept;
+
+    static size_t encodeField(OutputStream *dest, DynamicTable &table, const std::string &key, const std::string &value, Indexing indexing, size_t name_index = 0) noexcept;
+
+    static size_t encodeFields(OutputStream *dest, DynamicTable &table, Header &header, bool once) noexcept;
+
     static int decodeInteger(uint8_t &buf, InputStream *src, uint32_t &dest, uint8_t n) noexcept;
 
     static int decodeString(InputStream *src, std::string &dest) noexcept;
@@ -79,6 +103,8 @@ private:
 
     static size_t encodeIndexCase3(OutputStream *dest, size_t index) noexcept;
 
+    static size_t encodeSizeUpdate(OutputStream *dest, size_t max_size) noexcept;
+
     static size_t encodeString(OutputStream *dest, const std::string &str) noexcept;
 
     static std::string buildCookieString(const Cookie::Ptr &cookie) noexcept;
@@ -13,50 +13,200 @@
 // limitations under the License.
 
 #include <sese/net/http/Header.h>
+#include <sese/net/http/HPACK.h>
 
-#include <cctype>
-// #include <algorithm>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SESE_HEADER_SSE2
+#endif
 
 using namespace sese::net::http;
 
+namespace {
+
+#ifdef SESE_HEADER_SSE2
+/// Fold the upper case letters of 16 bytes to lower case
+inline __m128i toLower(__m128i bytes) noexcept {
+    auto upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+/// Load up to 8 bytes, the missing ones are zero
+inline uint64_t load(const char *data, size_t length) noexcept {
+    uint64_t word = 0;
+    if (length == 8) {
+        memcpy(&word, data, 8);
+        return word;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        word |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+    }
+    return word;
+}
+
+/// Fold the upper case letters of 8 bytes to lower case at once
+inline uint64_t toLower(uint64_t word) noexcept {
+    constexpr uint64_t ONES = 0x0101010101010101u;
+    constexpr uint64_t HIGH = ONES * 0x80;
+    auto heptets = word & ~HIGH;
+    auto above_z = heptets + ONES * (0x7F - 'Z');
+    auto from_a = heptets + ONES * (0x80 - 'A');
+    auto upper = from_a & ~above_z & ~word & HIGH;
+    return word | (upper >> 2);
+}
+
+/// Names of the HPACK static table in an open addressing table of their hashes
+struct StaticNames {
+    static constexpr size_t SLOTS = 256;
+    uint32_t hashes[SLOTS]{};
+    /// The lowest index of each name, 0 marks an empty slot
+    uint8_t indexes[SLOTS]{};
+
+    StaticNames() noexcept {
+        for (size_t i = 1; i < PREDEFINED_HEADERS.size(); ++i) {
+            auto &&name = PREDEFINED_HEADERS[i].first;
+            auto hash = Header::hashName(name);
+            if (find(name, hash)) {
+                continue;
+            }
+            auto slot = hash & (SLOTS - 1);
+            while (indexes[slot]) {
+                slot = (slot + 1) & (SLOTS - 1);
+            }
+            hashes[slot] = hash;
+            indexes[slot] = static_cast<uint8_t>(i);
+        }
+    }
+
+    [[nodiscard]] uint8_t find(std::string_view name, uint32_t hash) const noexcept {
+        for (auto slot = hash & (SLOTS - 1); indexes[slot]; slot = (slot + 1) & (SLOTS - 1)) {
+            if (hashes[slot] == hash && Header::equalName(PREDEFINED_HEADERS[indexes[slot]].first, name)) {
+                return indexes[slot];
+            }
+        }
+        return 0;
+    }
+};
+
+const StaticNames &staticNames() noexcept {
+    static const StaticNames NAMES;
+    return NAMES;
+}
+
+} // namespace
+
 Header::Header(const std::initializer_list<KeyValueType> &initializer_list) noexcept {
     for (const auto &item: initializer_list) {
-        headers.insert(item);
+        // The first occurrence wins, as it did with the map
+        if (find(item.first) == end()) {
+            set(item.first, item.second);
+        }
     }
 }
 
-#if defined(SESE_PLATFORM_WINDOWS) && !defined(__MINGW32__)
-#define XX std::tolower
-#else
-#define XX ::tolower
+uint32_t Header::hashName(std::string_view name) noexcept {
+    // Eight bytes per round, names are short
+    uint64_t hash = 0x9E3779B97F4A7C15u ^ name.length();
+    while (!name.empty()) {
+        auto length = std::min<size_t>(name.length(), 8);
+        hash = (hash ^ toLower(load(name.data(), length))) * 0xFF51AFD7ED558CCDu;
+        hash ^= hash >> 32;
+        name.remove_prefix(length);
+    }
+    return static_cast<uint32_t>(hash);
+}
+
+bool Header::equalName(std::string_view lv, std::string_view rv) noexcept {
+    if (lv.length() != rv.length()) {
+        return false;
+    }
+    size_t i = 0;
+#ifdef SESE_HEADER_SSE2
+    for (; i + 16 <= lv.length(); i += 16) {
+        auto l = toLower(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lv.data() + i)));
+        auto r = toLower(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rv.data() + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) != 0xFFFF) {
+            return false;
+        }
+    }
 #endif
+    for (; i < lv.length(); i += 8) {
+        auto length = std::min<size_t>(lv.length() - i, 8);
+        if (toLower(load(lv.data() + i, length)) != toLower(load(rv.data() + i, length))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Header::Iterator Header::find(std::string_view key) noexcept {
+    auto hash = hashName(key);
+    for (size_t i = 0; i < count; ++i) {
+        if (infos[i].hash == hash && equalName(fields[i].first, key)) {
+            return fields.begin() + static_cast<std::ptrdiff_t>(i);
+        }
+    }
+    return end();
+}
+
+void Header::set(std::string_view key, std::string_view value) noexcept {
+    auto hash = hashName(key);
+    for (size_t i = 0; i < count; ++i) {
+        if (infos[i].hash == hash && equalName(fields[i].first, key)) {
+            fields[i].second.assign(value);
+            return;
+        }
+    }
 
-void Header::set(const std::string &key, const std::string &value) noexcept {
-    // auto temp = key;
-    // std::transform(temp.begin(), temp.end(), temp.begin(), XX);
-    // headers[temp] = value;
-    headers[key] = value;
+    if (count == fields.size()) {
+        fields.emplace_back();
+        infos.emplace_back();
+    }
+    // Reuse the storage of a cleared field
+    auto &&field = fields[count];
+    field.first.assign(key);
+    field.second.assign(value);
+    infos[count] = {hash, staticNames().find(key, hash)};
+    count += 1;
+}
+
+void Header::clear() noexcept {
+    /// Only the storage of a usual number of fields is worth keeping
+    constexpr size_t MAX_KEPT_FIELDS = 64;
+    count = 0;
+    if (fields.size() > MAX_KEPT_FIELDS) {
+        fields.resize(MAX_KEPT_FIELDS);
+        infos.resize(MAX_KEPT_FIELDS);
+    }
 }
 
 const std::string &Header::get(const std::string &key, const std::string &default_value) noexcept {
-    // auto temp = key;
-    // std::transform(temp.begin(), temp.end(), temp.begin(), XX);
-    // auto res = headers.find(temp);
-    auto res = headers.find(key);
-    if (res == headers.end()) {
+    auto res = find(key);
+    if (res == end()) {
         return default_value;
     } else {
         return res->second;
     }
 }
 
-#undef XX
+const std::string &Header::get(const std::string &key) {
+    auto res = find(key);
+    if (res == end()) {
+        throw std::out_of_range("Header::get");
+    }
+    return res->second;
+}
 
 #if SESE_CXX_STANDARD > 201700L
 
 std::string_view Header::getView(const std::string &key, const std::string &default_value) noexcept {
-    auto res = headers.find(key);
-    if (res == headers.end()) {
+    auto res = find(key);
+    if (res == end()) {
         return default_value;
     } else {
         return res->second;
@@ -65,6 +215,16 @@ std::string_view Header::getView(const std::string &key, const std::string &defa
 
 #endif
 
+size_t Header::getNameIndex(Iterator iterator) const noexcept {
+    return infos[static_cast<size_t>(iterator - fields.begin())].name_index;
+}
+
+void Header::swapFields(Header &another) noexcept {
+    fields.swap(another.fields);
+    infos.swap(another.infos);
+    std::swap(count, another.count);
+}
+
 const CookieMap::Ptr &Header::getCookies() const {
     return cookies;
 }
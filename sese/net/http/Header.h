@@ -22,9 +22,11 @@
 #pragma once
 
 #include <sese/net/http/CookieMap.h>
-#include <sese/container/StrCaseMap.h>
 #include <sese/Util.h>
 
+#include <string_view>
+#include <vector>
+
 #ifdef _WIN32
 #pragma warning(disable : 4251)
 #endif
@@ -40,38 +42,61 @@ enum class HttpVersion {
 
 /**
  * @brief HTTP Header Key-Value Collection
+ * @details Fields are kept in a flat array in the order they are set, along with a case-insensitive hash of each name.
+ * Names predefined by the HPACK static table are recognized once when the field is set.
+ * Cleared fields keep their strings, so refilling the header of the next request does not allocate
  */
 class Header {
 public:
     using Ptr = std::unique_ptr<Header>;
     using KeyValueType = std::pair<std::string, std::string>;
+    /// Iterates in the order the fields were set, the name must not be modified through it
+    using Iterator = std::vector<KeyValueType>::iterator;
 
     explicit Header() = default;
     Header(const std::initializer_list<KeyValueType> &initializer_list) noexcept;
     virtual ~Header() = default;
 
-    void set(const std::string &key, const std::string &value) noexcept;
+    void set(std::string_view key, std::string_view value) noexcept;
     const std::string &get(const std::string &key, const std::string &default_value) noexcept;
 #if SESE_CXX_STANDARD > 201700L
     std::string_view getView(const std::string &key, const std::string &default_value) noexcept;
 #endif
-    std::map<std::string, std::string>::iterator begin() noexcept { return headers.begin(); }
-    std::map<std::string, std::string>::iterator end() noexcept { return headers.end(); }
-    auto find(const std::string &key) noexcept { return headers.find(key); }
+    Iterator begin() noexcept { return fields.begin(); }
+    Iterator end() noexcept { return fields.begin() + static_cast<std::ptrdiff_t>(count); }
+    Iterator find(std::string_view key) noexcept;
 
-    void clear() { headers.clear(); }
-    [[nodiscard]] bool empty() const { return headers.empty(); }
-    [[nodiscard]] size_t size() const { return headers.size(); }
+    /// Remove all fields, their storage is reused by the following set calls
+    void clear() noexcept;
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] size_t size() const { return count; }
 
     /// Determine if a field exists
     /// @param key Header field name
     /// @return Result
-    bool exist(const std::string &key) { return headers.find(key) != headers.end(); }
+    bool exist(const std::string &key) { return find(key) != end(); }
     /// Call this when certain the field exists
     /// @see sese::net::http::Header::exist
     /// @param key Header field name
+    /// @throw std::out_of_range If the field does not exist
     /// @return Value
-    const std::string &get(const std::string &key) { return headers.at(key); }
+    const std::string &get(const std::string &key);
+
+    /// Index of the name of a field in the HPACK static table
+    /// @param iterator Field
+    /// @return The lowest index of the name, 0 if the name is not predefined
+    [[nodiscard]] size_t getNameIndex(Iterator iterator) const noexcept;
+
+    /// Case-insensitive hash of a field name
+    /// @param name Field name
+    /// @return Hash
+    static uint32_t hashName(std::string_view name) noexcept;
+
+    /// Compare field names ignoring case
+    /// @param lv Field name
+    /// @param rv Field name
+    /// @return Whether the names are equal
+    static bool equalName(std::string_view lv, std::string_view rv) noexcept;
 
     /// Get the current Cookie map
     /// \retval nullptr if the current map is empty
@@ -89,7 +114,22 @@ public:
     void setCookie(const Cookie::Ptr &cookie);
 
 protected:
-    StrCaseMap<std::string> headers;
+    /// Exchange the fields with another header, the cookies are not included
+    void swapFields(Header &another) noexcept;
+
+    /// Lookup data of a field, kept apart from the strings so that a search scans a compact array
+    struct FieldInfo {
+        uint32_t hash;
+        /// Index of the name in the HPACK static table, 0 if not predefined
+        uint8_t name_index;
+    };
+
+    /// The fields in use come first, the rest is the storage of cleared fields
+    std::vector<KeyValueType> fields;
+    std::vector<FieldInfo> infos;
+    /// Number of fields in use
+    size_t count = 0;
     CookieMap::Ptr cookies = nullptr;
 };
+
 } // namespace sese::net::http
@@ -24,6 +24,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 
 namespace sese::net::http {
 
@@ -44,6 +45,7 @@ constexpr static uint8_t FRAME_TYPE_WINDOW_UPDATE = 0x8;
 constexpr static uint8_t FRAME_TYPE_CONTINUATION = 0x9;
 constexpr static uint8_t FRAME_TYPE_ALTSVC = 0xa;
 constexpr static uint8_t FRAME_TYPE_ORIGIN = 0xc;
+constexpr static uint8_t FRAME_TYPE_PRIORITY_UPDATE = 0x10;
 
 constexpr static uint8_t GOAWAY_NO_ERROR = 0x0;
 constexpr static uint8_t GOAWAY_PROTOCOL_ERROR = 0x1;
@@ -90,6 +92,11 @@ struct Http2Frame {
 
     std::unique_ptr<char []> frame;
 
+    /// Payload shared with other frames instead of being copied, the buffer then only holds the frame header
+    std::shared_ptr<const std::string> payload;
+    /// Offset of the content in the shared payload
+    size_t payload_offset = 0;
+
     explicit Http2Frame(size_t frame_size);
 
     /// Get buffer including frame header
@@ -15,8 +15,13 @@
 #pragma once
 
 #include <sese/net/IPv6Address.h>
+#include <sese/net/http/EventTopic.h>
 #include <sese/net/http/Request.h>
 #include <sese/net/http/Response.h>
+#include <sese/net/http/Router.h>
+
+#include <algorithm>
+#include <functional>
 
 namespace sese::net::http {
 
@@ -26,16 +31,91 @@ public:
         : req(req), resp(resp), remote_address(remote_address) {
     }
 
+    HttpServletContext(Request &req, Response &resp, const IPAddress::Ptr &remote_address, const Router::Params &path_args)
+        : req(req), resp(resp), remote_address(remote_address), path_args(&path_args) {
+    }
+
     [[nodiscard]] auto &getReq() const { return req; }
     [[nodiscard]] auto &getResp() const { return resp; }
     [[nodiscard]] auto getRemoteAddress() const { return remote_address; }
-    [[nodiscard]] io::InputStream *getInputStream() const { return &req.getBody(); }
+    /// Get the request body, which is read while it is being received for a streaming servlet
+    /// @see sese::net::http::Servlet::setStreaming
+    [[nodiscard]] io::InputStream *getInputStream() const { return input ? input : &req.getBody(); }
     [[nodiscard]] io::OutputStream *getOutputStream() const { return &resp.getBody(); }
 
+    /// Commit the status and the header, and write the rest of the body incrementally.
+    /// HTTP/1.1 uses chunked transfer encoding and HTTP/2 sends DATA frames as the peer's window permits,
+    /// a write blocks while the buffer is full. Data already written to getOutputStream is sent first.
+    /// The unread part of a streamed request body is discarded, and the response must not be modified afterward
+    /// @note Only available to servlets executed on the worker pool
+    /// @see sese::net::http::Servlet::setAsync
+    /// @return Body stream, null if unavailable
+    [[nodiscard]] io::OutputStream *getResponseStream() {
+        if (!output && starter) {
+            output = starter();
+        }
+        return output;
+    }
+
+    /// Set the function that starts the response stream, called by the service
+    /// @param response_starter Invoked on the first call to getResponseStream
+    void setResponseStarter(std::function<io::OutputStream *()> &&response_starter) { this->starter = std::move(response_starter); }
+
+    /// Keep the response open as a text/event-stream and send it the events published to the topic from now on.
+    /// The status, the header and the data already written to getOutputStream are sent first.
+    /// HTTP/1.1 responses are delimited by closing the connection, HTTP/2 responses end with the stream
+    /// @param topic Topic
+    /// @return false if unavailable, e.g. the response stream has been started
+    bool subscribe(const EventTopic::Ptr &topic) {
+        return subscriber && subscriber(topic);
+    }
+
+    /// Set the function that subscribes the response to a topic, called by the service
+    /// @param callback Invoked by subscribe
+    void setSubscriber(std::function<bool(const EventTopic::Ptr &)> &&callback) { this->subscriber = std::move(callback); }
+
+    /// Replace the buffered request body
+    /// @param input_stream Body stream, null to restore the buffered body
+    void setInputStream(io::InputStream *input_stream) { this->input = input_stream; }
+
+    /// Determine if a path parameter captured by the route exists, e.g. `id` in /users/{id}
+    /// @param key Parameter name
+    /// @return Result
+    [[nodiscard]] bool pathArgExist(const std::string &key) const;
+
+    /// Get a path parameter captured by the route
+    /// @param key Parameter name
+    /// @param default_value Returned when the parameter does not exist
+    /// @return Value
+    [[nodiscard]] const std::string &getPathArg(const std::string &key, const std::string &default_value) const;
+
 private:
     Request &req;
     Response &resp;
     const IPAddress::Ptr &remote_address;
+    const Router::Params *path_args = nullptr;
+    io::InputStream *input = nullptr;
+    std::function<io::OutputStream *()> starter;
+    std::function<bool(const EventTopic::Ptr &)> subscriber;
+    io::OutputStream *output = nullptr;
 };
 
+inline bool HttpServletContext::pathArgExist(const std::string &key) const {
+    if (!path_args) {
+        return false;
+    }
+    return std::any_of(path_args->begin(), path_args->end(), [&key](auto &&item) { return item.first == key; });
+}
+
+inline const std::string &HttpServletContext::getPathArg(const std::string &key, const std::string &default_value) const {
+    if (path_args) {
+        for (auto &&[name, value]: *path_args) {
+            if (name == key) {
+                return value;
+            }
+        }
+    }
+    return default_value;
+}
+
 } // namespace sese::net::http
\ No newline at end of file
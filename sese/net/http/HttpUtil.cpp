@@ -25,7 +25,26 @@
 using namespace sese::net::http;
 using sese::text::StringBuilder;
 
-bool HttpUtil::getLine(InputStream *source, StringBuilder &builder) noexcept {
+/// The line being parsed, kept by each thread so that parsing a header does not allocate once it has grown
+static thread_local std::string line_buffer;
+
+/// Split a line into the parts separated by spaces, as the start line of a request or a response
+/// @return Number of parts, a trailing space does not start a new part
+static size_t splitStartLine(std::string_view line, std::string_view (&parts)[3]) {
+    size_t count = 0;
+    while (!line.empty()) {
+        auto end = std::min(line.find(' '), line.length());
+        if (count < 3) {
+            parts[count] = line.substr(0, end);
+        }
+        count += 1;
+        line.remove_prefix(std::min(end + 1, line.length()));
+    }
+    return count;
+}
+
+bool HttpUtil::getLine(InputStream *source, std::string &line) noexcept {
+    line.clear();
     char ch;
     for (size_t i = 0; i < HTTP_MAX_SINGLE_LINE + 1; i++) {
         size_t size = source->read(&ch, 1);
@@ -34,7 +53,7 @@ bool HttpUtil::getLine(InputStream *source, StringBuilder &builder) noexcept {
         }
 
         if (ch != '\r') {
-            builder.append(ch);
+            line.push_back(ch);
         } else {
             // The remaining '\n', the result of the read is no longer important
             source->read(&ch, 1);
@@ -45,37 +64,15 @@ bool HttpUtil::getLine(InputStream *source, StringBuilder &builder) noexcept {
 }
 
 bool HttpUtil::recvRequest(InputStream *source, RequestHeader *request) noexcept {
-    StringBuilder builder;
-    if (!getLine(source, builder)) {
+    auto &&line = line_buffer;
+    if (!getLine(source, line)) {
         return false;
     }
-    auto first_lines = builder.split(" ");
-    if (first_lines.size() != 3) return false;
-    builder.clear();
+    std::string_view first_lines[3];
+    if (splitStartLine(line, first_lines) != 3) return false;
 
     // method
-    // GCOVR_EXCL_START
-    // if ("GET" == first_lines[0]) {
-    //     request->setType(RequestType::GET);
-    // } else if ("POST" == first_lines[0]) {
-    //     request->setType(RequestType::POST);
-    // } else if ("OPTIONS" == first_lines[0]) {
-    //     request->setType(RequestType::OPTIONS);
-    // } else if ("HEAD" == first_lines[0]) {
-    //     request->setType(RequestType::HEAD);
-    // } else if ("PUT" == first_lines[0]) {
-    //     request->setType(RequestType::PUT);
-    // } else if ("DELETE" == first_lines[0]) {
-    //     request->setType(RequestType::DELETE);
-    // } else if ("TRACE" == first_lines[0]) {
-    //     request->setType(RequestType::TRACE);
-    // } else if ("CONNECT" == first_lines[0]) {
-    //     request->setType(RequestType::CONNECT);
-    // } else {
-    //     request->setType(RequestType::ANOTHER);
-    // }
-    request->setType(stringToRequestType(first_lines[0]));
-    // GCOVR_EXCL_STOP
+    request->setType(stringToRequestType(std::string(first_lines[0])));
 
     // url
     request->setUrl(first_lines[1]);
@@ -88,7 +85,7 @@ bool HttpUtil::recvRequest(InputStream *source, RequestHeader *request) noexcept
     }
 
     // keys & values
-    if (!recvHeader(source, builder, request, false)) return false;
+    if (!recvHeader(source, line, request, false)) return false;
 
     return true;
 }
@@ -151,10 +148,10 @@ bool HttpUtil::sendRequest(OutputStream *dest, RequestHeader *request) noexcept
 }
 
 bool HttpUtil::recvResponse(InputStream *source, ResponseHeader *response) noexcept {
-    StringBuilder builder;
-    if (!getLine(source, builder)) return false;
-    auto first_lines = builder.split(" ");
-    builder.clear();
+    auto &&line = line_buffer;
+    if (!getLine(source, line)) return false;
+    std::string_view first_lines[3];
+    if (splitStartLine(line, first_lines) < 2) return false;
 
     // version
     if ("HTTP/1.1" == first_lines[0]) {
@@ -164,10 +161,10 @@ bool HttpUtil::recvResponse(InputStream *source, ResponseHeader *response) noexc
     }
 
     // status code
-    response->setCode(static_cast<uint16_t>(_atoi64(first_lines[1].c_str())));
+    response->setCode(static_cast<uint16_t>(_atoi64(std::string(first_lines[1]).c_str())));
 
     // keys & values
-    if (!recvHeader(source, builder, response, true)) return false;
+    if (!recvHeader(source, line, response, true)) return false;
 
     return true;
 }
@@ -191,34 +188,30 @@ bool HttpUtil::sendResponse(OutputStream *dest, ResponseHeader *response) noexce
     return true;
 }
 
-bool HttpUtil::recvHeader(InputStream *source, StringBuilder &builder, Header *header, bool is_resp) noexcept {
+bool HttpUtil::recvHeader(InputStream *source, std::string &line, Header *header, bool is_resp) noexcept {
     CookieMap::Ptr cookies;
     if (is_resp) {
         cookies = std::make_shared<CookieMap>();
     }
 
     while (true) {
-        if (!getLine(source, builder)) {
+        if (!getLine(source, line)) {
             return false;
         }
 
         // \r\n${No content}\r\n
-        if (builder.empty()) {
+        if (line.empty()) {
             break;
         } else {
-            // auto pair = builder.split(": ");
-            // if (pair.size() != 2) return false;
-            auto line = builder.toString();
-            builder.clear();
             auto pos = line.find_first_of(": ");
             if (pos == std::string::npos) {
                 return false;
             }
-            auto key = line.substr(0, pos);
-            auto value = line.substr(pos + 2);
+            auto key = std::string_view(line).substr(0, pos);
+            auto value = std::string_view(line).substr(std::min(pos + 2, line.length()));
             if (is_resp) {
-                if (strcasecmp(key.c_str(), "Set-Cookie") == 0) {
-                    auto cookie = parseFromSetCookie(value);
+                if (key.length() == 10 && strncasecmp(key.data(), "Set-Cookie", 10) == 0) {
+                    auto cookie = parseFromSetCookie(std::string(value));
                     if (cookie != nullptr) {
                         cookies->add(cookie);
                     }
@@ -226,8 +219,8 @@ bool HttpUtil::recvHeader(InputStream *source, StringBuilder &builder, Header *h
                     header->set(key, value);
                 }
             } else {
-                if (strcasecmp(key.c_str(), "Cookie") == 0) {
-                    cookies = parseFromCookie(value);
+                if (key.length() == 6 && strncasecmp(key.data(), "Cookie", 6) == 0) {
+                    cookies = parseFromCookie(std::string(value));
                 } else {
                     header->set(key, value);
                 }
@@ -79,9 +79,13 @@ public:
     static std::map<std::string, std::string> content_type_map;
 
 private:
-    static bool getLine(InputStream *source, text::StringBuilder &builder) noexcept;
+    /// Read a line without the line break
+    /// @param source Source stream
+    /// @param line Replaced with the line
+    /// @return false if the stream ended or the line is too long
+    static bool getLine(InputStream *source, std::string &line) noexcept;
 
-    inline static bool recvHeader(InputStream *source, text::StringBuilder &builder, Header *header, bool is_resp = false) noexcept;
+    inline static bool recvHeader(InputStream *source, std::string &line, Header *header, bool is_resp = false) noexcept;
     inline static bool sendHeader(OutputStream *dest, Header *header, bool is_resp = false) noexcept;
 
     inline static bool sendSetCookie(OutputStream *dest, const CookieMap::Ptr &cookies) noexcept;
@@ -15,164 +15,183 @@
 #include "sese/net/http/Huffman.h"
 #include "sese/net/http/HPACK.h"
 
-#include <limits>
+#include <array>
 
 using namespace sese::net::http;
 
-huffman_node_t::huffman_node_t(
-    huffman_node_t *l,
-    huffman_node_t *r,
-    int16_t c
-) noexcept : m_left(l),
-             m_right(r),
-             m_code(c) {
-}
-
-huffman_tree_t::huffman_tree_t() noexcept : m_root(new huffman_node_t) {
-    for (std::size_t idx = 0; idx < HUFFMAN_TABLE.size(); idx++) {
-        const bits_t &bits = HUFFMAN_TABLE.at(idx);
-        huffman_node_t *current = m_root;
-
-        for (const auto &bit: bits) {
-            if (bit) {
-                if (nullptr == current->right()) {
-                    current->right(new huffman_node_t);
+namespace {
+
+/// The symbol is emitted by this transition
+constexpr uint8_t HUFFMAN_EMIT = 0x01;
+/// The input may end after this transition, the remaining bits are a valid padding
+constexpr uint8_t HUFFMAN_ACCEPT = 0x02;
+/// The transition decodes EOS or leaves the tree
+constexpr uint8_t HUFFMAN_FAIL = 0x04;
+
+struct HuffmanTransition {
+    uint8_t state;
+    uint8_t flags;
+    uint8_t symbol;
+};
+
+/// 257 symbols make 256 internal nodes, so every state fits into a byte
+constexpr size_t HUFFMAN_STATES = 256;
+
+struct HuffmanTables {
+    /// Transitions of each state indexed by the next 4 bits
+    std::array<std::array<HuffmanTransition, 16>, HUFFMAN_STATES> decode{};
+    /// Right aligned code of each symbol
+    std::array<uint32_t, 257> code{};
+    /// Code length of each symbol in bits
+    std::array<uint8_t, 257> length{};
+
+    HuffmanTables() noexcept {
+        // Children of the internal nodes, a negative value refers to the symbol -(child + 1)
+        std::vector<std::array<int16_t, 2>> children(1, {0, 0});
+        // Whether the node is reached by 1 bits only within 7 bits, i.e. a prefix of EOS usable as padding
+        std::vector<bool> padding(1, true);
+        std::vector<uint8_t> depth(1, 0);
+
+        for (size_t symbol = 0; symbol < HUFFMAN_TABLE.size(); ++symbol) {
+            const bits_t &bits = HUFFMAN_TABLE[symbol];
+            uint32_t value = 0;
+            int16_t node = 0;
+            for (size_t i = 0; i < bits.size(); ++i) {
+                auto bit = bits[i] ? 1 : 0;
+                value = value << 1 | bit;
+                if (i + 1 == bits.size()) {
+                    children[node][bit] = static_cast<int16_t>(-static_cast<int16_t>(symbol) - 1);
+                    break;
                 }
-                current = current->right();
-            } else {
-                if (nullptr == current->left()) {
-                    current->left(new huffman_node_t);
+                if (children[node][bit] == 0) {
+                    children[node][bit] = static_cast<int16_t>(children.size());
+                    children.push_back({0, 0});
+                    padding.push_back(padding[node] && bit == 1 && depth[node] < 7);
+                    depth.push_back(static_cast<uint8_t>(depth[node] + 1));
                 }
-
-                current = current->left();
+                node = children[node][bit];
             }
+            code[symbol] = value;
+            length[symbol] = static_cast<uint8_t>(bits.size());
         }
 
-        current->code(static_cast<int16_t>(idx));
+        for (size_t state = 0; state < children.size(); ++state) {
+            for (uint8_t nibble = 0; nibble < 16; ++nibble) {
+                auto &&transition = decode[state][nibble];
+                int16_t node = static_cast<int16_t>(state);
+                for (int i = 3; i >= 0; --i) {
+                    auto child = children[node][nibble >> i & 1];
+                    if (child < 0) {
+                        auto symbol = -child - 1;
+                        // EOS must not appear in a string literal
+                        if (symbol == 256) {
+                            transition.flags = HUFFMAN_FAIL;
+                            break;
+                        }
+                        // The shortest code is 5 bits, so at most one symbol is emitted per step
+                        transition.flags |= HUFFMAN_EMIT;
+                        transition.symbol = static_cast<uint8_t>(symbol);
+                        node = 0;
+                    } else {
+                        node = child;
+                    }
+                }
+                if (transition.flags & HUFFMAN_FAIL) {
+                    continue;
+                }
+                transition.state = static_cast<uint8_t>(node);
+                if (padding[node]) {
+                    transition.flags |= HUFFMAN_ACCEPT;
+                }
+            }
+        }
     }
-}
+};
 
-huffman_tree_t::~huffman_tree_t() noexcept {
-    delete_node(m_root);
+const HuffmanTables &tables() noexcept {
+    static const HuffmanTables TABLES;
+    return TABLES;
 }
 
-void huffman_tree_t::delete_node(huffman_node_t *n) noexcept { // NOLINT
-    if (nullptr != n->right()) {
-        delete_node(n->right());
-    }
-    if (nullptr != n->left()) {
-        delete_node(n->left());
-    }
+} // namespace
 
-    delete n;
-}
-
-std::optional<std::string> huffman_tree_t::decode(const char *src, size_t len) const {
+std::optional<std::string> HuffmanDecoder::decode(const char *src, size_t len) const {
+    auto &&table = tables().decode;
     std::string dst;
-    huffman_node_t *current(m_root);
-
-    if (len > std::numeric_limits<unsigned int>::max()) {
-        // throw std::invalid_argument("HPACK::huffman_tree_t::decode(): Overly long input string");
-        return std::nullopt;
-    }
-
-    for (unsigned int idx = 0; idx < len; ++idx) {
-        // bool has_value = false;
-        for (int8_t j = 7; j >= 0; j--) {
-            auto result = src[idx] & (1 << j);
-            if (result > 0) {
-                if (nullptr == current->right()) {
-                    // throw std::runtime_error(
-                    //        "HPACK::huffman_tree_t::decode(): Internal state error (right == nullptr)");
-                    return std::nullopt;
-                }
-                current = current->right();
-            } else {
-                if (nullptr == current->left()) {
-                    // throw std::runtime_error("HPACK::huffman_tree_t::decode(): Internal state error (left == nullptr)");
-                    return std::nullopt;
-                }
-                current = current->left();
+    // Every symbol takes at least 5 bits
+    dst.reserve(len * 8 / 5);
+
+    uint8_t state = 0;
+    bool accept = true;
+    for (size_t idx = 0; idx < len; ++idx) {
+        auto byte = static_cast<uint8_t>(src[idx]);
+        for (auto nibble: {byte >> 4, byte & 0x0F}) {
+            auto &&transition = table[state][nibble];
+            if (transition.flags & HUFFMAN_FAIL) {
+                return std::nullopt;
             }
-            if (current->code() >= 0) {
-                int16_t code = current->code();
-
-                if (257 == code) {
-                    dst += static_cast<char>((code & 0xFF00) >> 8 & 0xFF);
-                }
-
-                dst += static_cast<char>(code & 0xFF);
-                current = m_root;
-                // has_value = true;
+            if (transition.flags & HUFFMAN_EMIT) {
+                dst.push_back(static_cast<char>(transition.symbol));
             }
+            state = transition.state;
+            accept = transition.flags & HUFFMAN_ACCEPT;
         }
-        // if (!has_value) {
-        //     return std::nullopt;
-        // }
     }
 
+    if (!accept) {
+        return std::nullopt;
+    }
     return dst;
 }
 
-huffman_encoder_t::huffman_encoder_t() noexcept : m_byte(0), m_count(8) {
-}
-
-bool huffman_encoder_t::write_bit(uint8_t bit) noexcept {
-    m_byte |= bit;
-    m_count--;
-
-    if (0 == m_count) {
-        m_count = 8;
-        return true;
-    } else
-        m_byte <<= 1;
-
-    return false;
+size_t HuffmanEncoder::encodedLength(const uint8_t *src, size_t len) noexcept {
+    auto &&length = tables().length;
+    size_t bits = 0;
+    for (size_t i = 0; i < len; ++i) {
+        bits += length[src[i]];
+    }
+    return (bits + 7) / 8;
 }
 
-std::vector<uint8_t> huffman_encoder_t::encode(const std::vector<uint8_t> &src) noexcept {
-    std::vector<uint8_t> ret(0);
-
-    for (auto &byte: src) {
-        bits_t bits = HUFFMAN_TABLE.at(byte);
-
-        for (decltype(auto) bit: bits) {
-            if (write_bit(bit)) {
-                ret.push_back(m_byte);
-                m_byte = 0;
-                m_count = 8;
-            }
+void HuffmanEncoder::encode(const uint8_t *src, size_t len, std::vector<uint8_t> &dest) noexcept {
+    auto &&table = tables();
+    auto offset = dest.size();
+    dest.resize(offset + encodedLength(src, len));
+    auto out = dest.data() + offset;
+
+    // The longest code is 30 bits, so at most 37 bits are pending before flushing
+    uint64_t accumulator = 0;
+    uint32_t pending = 0;
+    for (size_t i = 0; i < len; ++i) {
+        accumulator = accumulator << table.length[src[i]] | table.code[src[i]];
+        pending += table.length[src[i]];
+        while (pending >= 8) {
+            pending -= 8;
+            *out++ = static_cast<uint8_t>(accumulator >> pending);
         }
     }
 
-    // Apparently the remainder unused bits
-    // are to be set to 1, some sources refer
-    // to this as the EOS bit, but the code
-    // for EOS is like 30-bits of 1's so its
-    // clearly not the EOS code.
-    if (8 != m_count && 0 != m_count) {
-        m_byte = (m_byte << (m_count - 1));
-        m_byte |= (0xFF >> (8 - m_count));
-        ret.push_back(m_byte);
-        m_byte = 0;
-        m_count = 8;
+    // The remaining bits are padded with the most significant bits of EOS
+    if (pending) {
+        *out = static_cast<uint8_t>(accumulator << (8 - pending) | 0xFF >> pending);
     }
+}
 
+std::vector<uint8_t> HuffmanEncoder::encode(const std::vector<uint8_t> &src) const noexcept {
+    std::vector<uint8_t> ret;
+    encode(src.data(), src.size(), ret);
     return ret;
 }
 
-std::vector<uint8_t> huffman_encoder_t::encode(const std::string &src) noexcept {
-    std::vector<uint8_t> s(src.begin(), src.end());
-    return encode(s);
+std::vector<uint8_t> HuffmanEncoder::encode(const std::string &src) const noexcept {
+    std::vector<uint8_t> ret;
+    encode(reinterpret_cast<const uint8_t *>(src.data()), src.size(), ret);
+    return ret;
 }
 
-std::vector<uint8_t> huffman_encoder_t::encode(const char *ptr) noexcept {
-    std::string str(ptr);
-
+std::vector<uint8_t> HuffmanEncoder::encode(const char *ptr) const noexcept {
     if (nullptr == ptr) {
-        // throw std::invalid_argument("HPACK::huffman_encoder_t::encode(): Invalid nullptr parameter");
         return {};
     }
-
-    return encode(str);
+    return encode(std::string(ptr));
 }
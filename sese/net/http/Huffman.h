@@ -16,11 +16,10 @@
  * @file Huffman.h
  * @brief HTTP2 Huffman Decoding and Encoding Implementation
  * @verbatim
-   This file is sourced from
-   https://github.com/jnferguson/hpack-rfc7541.git
-   in part
+   The decoder is a flat state machine consuming 4 bits per step,
+   the states are the internal nodes of the HPACK Huffman tree,
+   see RFC 7541 Appendix B
    @endverbatim
- * @bug The original implementation had a data truncation bug, which has been fixed here, see huffman_tree_t::decode
  */
 
 #pragma once
@@ -32,72 +31,39 @@
 
 namespace sese::net::http {
 
-/// Huffman node
-class huffman_node_t {
-protected:
-    huffman_node_t *m_left;
-    huffman_node_t *m_right;
-    int16_t m_code;
-
+/// Table-driven Huffman decoder
+class HuffmanDecoder {
 public:
-    explicit huffman_node_t(huffman_node_t *l = nullptr, huffman_node_t *r = nullptr, int16_t c = -1) noexcept;
-
-    virtual ~huffman_node_t() {
-        m_left = nullptr;
-        m_right = nullptr;
-        m_code = 0;
-    }
-
-    [[nodiscard]] int16_t code() const { return m_code; }
-
-    void code(int16_t c) { m_code = c; }
-
-    huffman_node_t *left() { return m_left; }
-
-    void left(huffman_node_t *l) { m_left = l; }
-
-    huffman_node_t *right() { return m_right; }
-
-    void right(huffman_node_t *r) { m_right = r; }
-};
-
-/// Huffman Tree
-class huffman_tree_t {
-protected:
-    huffman_node_t *m_root;
-
-    void delete_node(huffman_node_t *n) noexcept;
-
-public:
-    huffman_tree_t() noexcept;
-
-    virtual ~huffman_tree_t() noexcept;
-
+    /// Decode a Huffman encoded string literal
+    /// @param src Encoded data
+    /// @param len Encoded data length
+    /// @return std::nullopt if the data contains the EOS symbol or is not padded with the most significant bits of EOS
     std::optional<std::string> decode(const char *src, size_t len) const;
 };
 
-/// Huffman Encoder
-class huffman_encoder_t {
-private:
-    uint8_t m_byte;
-    uint8_t m_count;
-
-protected:
-    inline bool write_bit(uint8_t bit) noexcept;
-
+/// Table-driven Huffman encoder, stateless and safe to share between threads
+class HuffmanEncoder {
 public:
-    huffman_encoder_t() noexcept;
+    std::vector<uint8_t> encode(const std::vector<uint8_t> &src) const noexcept;
 
-    virtual ~huffman_encoder_t() noexcept = default;
+    std::vector<uint8_t> encode(const std::string &src) const noexcept;
 
-    std::vector<uint8_t> encode(const std::vector<uint8_t> &src) noexcept;
+    std::vector<uint8_t> encode(const char *ptr) const noexcept;
 
-    std::vector<uint8_t> encode(const std::string &src) noexcept;
+    /// Encode into the end of a buffer
+    /// @param src Data to be encoded
+    /// @param len Data length
+    /// @param dest Encoded data is appended here
+    static void encode(const uint8_t *src, size_t len, std::vector<uint8_t> &dest) noexcept;
 
-    std::vector<uint8_t> encode(const char *ptr) noexcept;
+    /// Calculate the encoded length
+    /// @param src Data to be encoded
+    /// @param len Data length
+    /// @return Encoded length in bytes, including the padding
+    static size_t encodedLength(const uint8_t *src, size_t len) noexcept;
 };
 
-using HuffmanEncoder = huffman_encoder_t;
-using HuffmanDecoder = huffman_tree_t;
+using huffman_encoder_t = HuffmanEncoder;
+using huffman_tree_t = HuffmanDecoder;
 
-} // namespace sese::net::http
\ No newline at end of file
+} // namespace sese::net::http
@@ -21,7 +21,7 @@ void sese::net::http::Request::swap(sese::net::http::Request &another) noexcept
     std::swap(uri, another.uri);
     std::swap(version, another.version);
     std::swap(cookies, another.cookies);
-    std::swap(headers, another.headers);
+    swapFields(another);
     std::swap(query_args, another.query_args);
     body.swap(another.body);
 }
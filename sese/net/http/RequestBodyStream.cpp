@@ -0,0 +1,110 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/http/RequestBodyStream.h>
+
+#include <algorithm>
+#include <cstring>
+
+sese::net::http::RequestBodyStream::RequestBodyStream(size_t capacity)
+    : capacity(capacity) {
+}
+
+int64_t sese::net::http::RequestBodyStream::read(void *buf, size_t length) {
+    DrainCallback callback;
+    int64_t result;
+    {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [this] { return buffered || finished || aborted; });
+        if (aborted) {
+            return -1;
+        }
+        result = 0;
+        while (length && !chunks.empty()) {
+            auto &&chunk = chunks.front();
+            auto size = std::min(length, chunk.length() - offset);
+            std::memcpy(static_cast<char *>(buf) + result, chunk.data() + offset, size);
+            result += static_cast<int64_t>(size);
+            length -= size;
+            offset += size;
+            if (offset == chunk.length()) {
+                chunks.pop_front();
+                offset = 0;
+            }
+        }
+        buffered -= result;
+        // Resume the producer once half of the buffer is available
+        if (paused && buffered <= capacity / 2) {
+            paused = false;
+            callback = on_drain;
+        }
+    }
+    if (callback) {
+        callback();
+    }
+    return result;
+}
+
+bool sese::net::http::RequestBodyStream::push(const void *buf, size_t length) {
+    std::lock_guard lock(mutex);
+    if (closed) {
+        return true;
+    }
+    if (length == 0) {
+        return buffered <= capacity;
+    }
+    chunks.emplace_back(static_cast<const char *>(buf), length);
+    buffered += length;
+    cv.notify_one();
+    if (buffered > capacity) {
+        paused = true;
+        return false;
+    }
+    return true;
+}
+
+void sese::net::http::RequestBodyStream::finish() {
+    std::lock_guard lock(mutex);
+    finished = true;
+    cv.notify_one();
+}
+
+void sese::net::http::RequestBodyStream::abort() {
+    std::lock_guard lock(mutex);
+    aborted = true;
+    cv.notify_one();
+}
+
+void sese::net::http::RequestBodyStream::close() {
+    DrainCallback callback;
+    {
+        std::lock_guard lock(mutex);
+        closed = true;
+        buffered = 0;
+        chunks.clear();
+        offset = 0;
+        if (paused) {
+            paused = false;
+            callback = on_drain;
+        }
+    }
+    if (callback) {
+        callback();
+    }
+}
+
+void sese::net::http::RequestBodyStream::setDrainCallback(DrainCallback &&callback) {
+    std::lock_guard lock(mutex);
+    on_drain = std::move(callback);
+}
@@ -0,0 +1,87 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file RequestBodyStream.h
+ * @brief Request body streamed to a servlet
+ * @author kaoru
+ * @date October 17, 2026
+ */
+
+#pragma once
+
+#include <sese/io/InputStream.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace sese::net::http {
+
+/// Request body fed incrementally by the connection and read by a streaming servlet on another thread.
+/// The buffered size is bounded, the connection stops reading when it is exceeded and resumes on the drain callback
+class RequestBodyStream final : public io::InputStream {
+public:
+    using Ptr = std::shared_ptr<RequestBodyStream>;
+    using DrainCallback = std::function<void()>;
+
+    /// @param capacity Buffered bytes above which the producer should pause
+    explicit RequestBodyStream(size_t capacity);
+
+    /// Read the body, block until data is available
+    /// @param buffer Buffer
+    /// @param length Buffer size
+    /// @return Bytes read, 0 at the end of the body, -1 if the connection was lost
+    int64_t read(void *buffer, size_t length) override;
+
+    /// Append received data, called by the connection
+    /// @param buffer Data
+    /// @param length Data size
+    /// @return false if the buffer is full, the producer should pause until the drain callback is invoked
+    bool push(const void *buffer, size_t length);
+
+    /// Mark the end of the body, called by the connection
+    void finish();
+
+    /// Wake up the reader with an error, called by the connection when it is lost
+    void abort();
+
+    /// Stop reading, the remaining data is discarded so that the connection can drain it.
+    /// Called once the servlet returns
+    void close();
+
+    /// Set the callback invoked on the reader thread when a paused producer may continue.
+    /// The servlet thread may hold the stream after the connection is gone, so the callback must not keep the connection alive
+    /// @param callback Callback function
+    void setDrainCallback(DrainCallback &&callback);
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    /// Received chunks, released as soon as they are consumed
+    std::deque<std::string> chunks;
+    /// Read position in the first chunk
+    size_t offset = 0;
+    size_t capacity;
+    size_t buffered = 0;
+    bool paused = false;
+    bool finished = false;
+    bool aborted = false;
+    bool closed = false;
+    DrainCallback on_drain;
+};
+
+} // namespace sese::net::http
@@ -16,6 +16,8 @@
 #include <sese/net/http/RequestHeader.h>
 #include <sese/text/StringBuilder.h>
 
+#include <algorithm>
+
 using namespace sese;
 
 const std::string &net::http::RequestHeader::getQueryArg(const std::string &key, const std::string &default_value) const {
@@ -60,30 +62,36 @@ std::string net::http::RequestHeader::getUrl() const {
     return builder.toString();
 }
 
-void net::http::RequestHeader::setUrl(const std::string &request_url) {
+void net::http::RequestHeader::setUrl(std::string_view request_url) {
     auto pos = request_url.find('?');
-    if (pos == std::string::npos) {
-        uri = PercentConverter::decode(request_url.c_str());
+    PercentConverter::decode(request_url.substr(0, pos), uri);
+    if (pos == std::string_view::npos) {
         return;
     }
 
-    uri = PercentConverter::decode(request_url.substr(0, pos).c_str());
     auto query_string = request_url.substr(pos + 1);
-    auto query_items = text::StringBuilder::split(query_string, "&");
-    for (auto &&item: query_items) {
-        auto pair = text::StringBuilder::split(item, "=");
-        if (pair.size() == 1 && !pair.empty()) {
-            auto key = PercentConverter::decode(pair[0].c_str());
-            query_args[key] = "";
-        } else if (pair.size() == 2) {
-            auto key = PercentConverter::decode(pair[0].c_str());
-            auto value = PercentConverter::decode(pair[1].c_str());
-            query_args[key] = value;
+    while (!query_string.empty()) {
+        auto end = std::min(query_string.find('&'), query_string.length());
+        auto item = query_string.substr(0, end);
+        query_string.remove_prefix(std::min(end + 1, query_string.length()));
+        if (item.empty()) {
+            continue;
         }
-        // GCOVR_EXCL_START
-        else {
+        // "key", "key=" and "key=value" are accepted, an item with more parts is ignored
+        auto equal = item.find('=');
+        auto parts = std::count(item.begin(), item.end(), '=') + (item.back() == '=' ? 0 : 1);
+        if (parts > 2) {
             continue;
         }
-        // GCOVR_EXCL_STOP
+        query_args_pool.assign(query_args, [&](std::string &key, std::string &value) {
+            PercentConverter::decode(item.substr(0, equal), key);
+            if (parts == 1) {
+                value.clear();
+            } else {
+                auto rest = item.substr(equal + 1);
+                PercentConverter::decode(rest.substr(0, rest.find('=')), value);
+            }
+            return true;
+        });
     }
 }
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <sese/net/http/Header.h>
+#include <sese/container/MapNodePool.h>
 
 #ifdef DELETE
 #undef DELETE
@@ -117,7 +118,8 @@ public:
     void setQueryArg(const std::string &key, const std::string &value);
     [[nodiscard]] size_t queryArgsSize() const { return query_args.size(); }
     [[nodiscard]] bool queryArgsEmpty() const { return query_args.empty(); }
-    void queryArgsClear() { return query_args.clear(); }
+    /// Remove all query arguments, their storage is reused by the next setUrl
+    void queryArgsClear() { query_args_pool.clear(query_args); }
     bool queryArgsExist(const std::string &key) { return query_args.find(key) != query_args.end(); }
     /// Call this when certain the field exists
     /// @see sese::net::http::RequestHeader::queryArgsExist
@@ -129,7 +131,7 @@ public:
     void setVersion(HttpVersion new_version) { this->version = new_version; }
 
     [[nodiscard]] std::string getUrl() const;
-    void setUrl(const std::string &request_url);
+    void setUrl(std::string_view request_url);
 
 protected:
     RequestType type = RequestType::GET;
@@ -137,6 +139,7 @@ protected:
     HttpVersion version = HttpVersion::VERSION_1_1;
 
     std::map<std::string, std::string> query_args;
+    MapNodePool<std::map<std::string, std::string>> query_args_pool;
 };
 
 // GCOVR_EXCL_STOP
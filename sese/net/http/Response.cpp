@@ -20,7 +20,7 @@ void sese::net::http::Response::swap(sese::net::http::Response &another) noexcep
     std::swap(version, another.version);
     std::swap(statusCode, another.statusCode);
     std::swap(cookies, another.cookies);
-    std::swap(headers, another.headers);
+    swapFields(another);
     body.swap(another.body);
 }
 
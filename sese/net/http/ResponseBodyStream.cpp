@@ -0,0 +1,98 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <sese/net/http/ResponseBodyStream.h>
+
+#include <algorithm>
+#include <cstring>
+
+sese::net::http::ResponseBodyStream::ResponseBodyStream(size_t capacity)
+    : capacity(capacity) {
+}
+
+int64_t sese::net::http::ResponseBodyStream::write(const void *buf, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    DataCallback callback;
+    {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [this] { return buffered < capacity || aborted; });
+        if (aborted) {
+            return -1;
+        }
+        chunks.emplace_back(static_cast<const char *>(buf), length);
+        buffered += length;
+        if (waiting) {
+            waiting = false;
+            callback = on_data;
+        }
+    }
+    if (callback) {
+        callback();
+    }
+    return static_cast<int64_t>(length);
+}
+
+size_t sese::net::http::ResponseBodyStream::take(void *buf, size_t length, bool &end) {
+    std::lock_guard lock(mutex);
+    size_t result = 0;
+    while (length && !chunks.empty()) {
+        auto &&chunk = chunks.front();
+        auto size = std::min(length, chunk.length() - offset);
+        std::memcpy(static_cast<char *>(buf) + result, chunk.data() + offset, size);
+        result += size;
+        length -= size;
+        offset += size;
+        if (offset == chunk.length()) {
+            chunks.pop_front();
+            offset = 0;
+        }
+    }
+    buffered -= result;
+    end = finished && chunks.empty();
+    if (result) {
+        cv.notify_one();
+    } else if (!end) {
+        waiting = true;
+    }
+    return result;
+}
+
+void sese::net::http::ResponseBodyStream::finish() {
+    DataCallback callback;
+    {
+        std::lock_guard lock(mutex);
+        finished = true;
+        if (waiting) {
+            waiting = false;
+            callback = on_data;
+        }
+    }
+    if (callback) {
+        callback();
+    }
+}
+
+void sese::net::http::ResponseBodyStream::abort() {
+    std::lock_guard lock(mutex);
+    aborted = true;
+    cv.notify_one();
+}
+
+void sese::net::http::ResponseBodyStream::setDataCallback(DataCallback &&callback) {
+    std::lock_guard lock(mutex);
+    on_data = std::move(callback);
+}
@@ -0,0 +1,85 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+/**
+ * @file ResponseBodyStream.h
+ * @brief Response body streamed from a servlet
+ * @author kaoru
+ * @date October 17, 2026
+ */
+
+#pragma once
+
+#include <sese/io/OutputStream.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace sese::net::http {
+
+/// Response body written incrementally by a servlet on the worker pool and sent by the connection.
+/// The buffered size is bounded, the servlet blocks while it is exceeded
+class ResponseBodyStream final : public io::OutputStream {
+public:
+    using Ptr = std::shared_ptr<ResponseBodyStream>;
+    using DataCallback = std::function<void()>;
+
+    /// @param capacity Buffered bytes above which the writer blocks
+    explicit ResponseBodyStream(size_t capacity);
+
+    /// Write a part of the body, block while the buffer is full
+    /// @param buffer Data
+    /// @param length Data size
+    /// @return Bytes written, -1 if the connection was lost
+    int64_t write(const void *buffer, size_t length) override;
+
+    /// Take buffered data, called by the connection.
+    /// If nothing is available and the body is not finished, the data callback is invoked once there is
+    /// @param buffer Output buffer
+    /// @param length Buffer size
+    /// @param end Set when the whole body has been taken
+    /// @return Bytes taken
+    size_t take(void *buffer, size_t length, bool &end);
+
+    /// Mark the end of the body, called once the servlet returns
+    void finish();
+
+    /// Wake up the writer with an error, called by the connection when it is lost
+    void abort();
+
+    /// Set the callback invoked on the writer thread when data becomes available to a waiting connection.
+    /// The servlet thread may hold the stream after the connection is gone, so the callback must not keep the connection alive
+    /// @param callback Callback function
+    void setDataCallback(DataCallback &&callback);
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    /// Written chunks, released as soon as they are sent
+    std::deque<std::string> chunks;
+    /// Read position in the first chunk
+    size_t offset = 0;
+    size_t capacity;
+    size_t buffered = 0;
+    bool waiting = false;
+    bool finished = false;
+    bool aborted = false;
+    DataCallback on_data;
+};
+
+} // namespace sese::net::http
@@ -0,0 +1,218 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/http/Router.h>
+
+#include <algorithm>
+
+struct sese::net::http::Router::Node {
+    /// Static edge label, empty for the root and parameter nodes
+    std::string prefix;
+    /// The first character of each static child, used to select the edge
+    std::string indices;
+    std::vector<std::unique_ptr<Node>> children;
+    /// Child matching a single path segment
+    std::unique_ptr<Node> param;
+    /// Index of the exact route ending here
+    size_t exact = NPOS;
+    /// Index of the prefix route ending here
+    size_t prefix_id = NPOS;
+    /// Parameter names of the exact route ending here
+    std::vector<std::string> names;
+};
+
+sese::net::http::Router::Router() : root(std::make_unique<Node>()) {
+}
+
+sese::net::http::Router::~Router() = default;
+
+sese::net::http::Router::Router(Router &&) noexcept = default;
+
+sese::net::http::Router &sese::net::http::Router::operator=(Router &&) noexcept = default;
+
+sese::net::http::Router::Node *sese::net::http::Router::insertStatic(Node *node, std::string_view str) {
+    while (!str.empty()) {
+        auto pos = node->indices.find(str[0]);
+        if (pos == std::string::npos) {
+            auto child = std::make_unique<Node>();
+            child->prefix = str;
+            node->indices.push_back(str[0]);
+            node->children.emplace_back(std::move(child));
+            return node->children.back().get();
+        }
+
+        auto child = node->children[pos].get();
+        size_t common = 0;
+        auto max = std::min(child->prefix.length(), str.length());
+        while (common < max && child->prefix[common] == str[common]) {
+            common += 1;
+        }
+
+        if (common < child->prefix.length()) {
+            // Split the edge at the common part
+            auto middle = std::make_unique<Node>();
+            middle->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            middle->indices.push_back(child->prefix[0]);
+            middle->children.emplace_back(std::move(node->children[pos]));
+            node->children[pos] = std::move(middle);
+            child = node->children[pos].get();
+        }
+
+        node = child;
+        str.remove_prefix(common);
+    }
+    return node;
+}
+
+bool sese::net::http::Router::insert(const std::string &pattern, size_t id) {
+    std::vector<std::string> names;
+    auto node = root.get();
+    std::string_view rest = pattern;
+    while (!rest.empty()) {
+        auto begin = rest.find('{');
+        node = insertStatic(node, rest.substr(0, begin));
+        if (begin == std::string_view::npos) {
+            break;
+        }
+        auto end = rest.find('}', begin);
+        if (end == std::string_view::npos || end == begin + 1) {
+            return false;
+        }
+        // A parameter must be followed by the end of the pattern or a new segment
+        if (end + 1 < rest.length() && rest[end + 1] != '/') {
+            return false;
+        }
+        if (!node->param) {
+            node->param = std::make_unique<Node>();
+        }
+        names.emplace_back(rest.substr(begin + 1, end - begin - 1));
+        node = node->param.get();
+        rest.remove_prefix(end + 1);
+    }
+
+    if (node->exact != NPOS) {
+        return false;
+    }
+    node->exact = id;
+    node->names = std::move(names);
+    return true;
+}
+
+bool sese::net::http::Router::insertPrefix(const std::string &prefix, size_t id) {
+    auto node = insertStatic(root.get(), prefix);
+    if (node->prefix_id != NPOS) {
+        return false;
+    }
+    node->prefix_id = id;
+    return true;
+}
+
+const sese::net::http::Router::Node *sese::net::http::Router::matchNode(const Node *node, std::string_view path, std::vector<std::string_view> &values) {
+    if (path.empty()) {
+        return node->exact == NPOS ? nullptr : node;
+    }
+
+    auto pos = node->indices.find(path[0]);
+    if (pos != std::string::npos) {
+        auto child = node->children[pos].get();
+        if (path.substr(0, child->prefix.length()) == child->prefix) {
+            auto result = matchNode(child, path.substr(child->prefix.length()), values);
+            if (result) {
+                return result;
+            }
+        }
+    }
+
+    if (node->param) {
+        auto end = std::min(path.find('/'), path.length());
+        if (end == 0) {
+            return nullptr;
+        }
+        values.emplace_back(path.substr(0, end));
+        auto result = matchNode(node->param.get(), path.substr(end), values);
+        if (result) {
+            return result;
+        }
+        values.pop_back();
+    }
+    return nullptr;
+}
+
+size_t sese::net::http::Router::match(std::string_view path, Params *params) const {
+    // Kept by each thread so that matching does not allocate once it has grown
+    static thread_local std::vector<std::string_view> values;
+    values.clear();
+    auto node = matchNode(root.get(), path, values);
+    if (!node) {
+        return NPOS;
+    }
+    if (params) {
+        params->clear();
+        for (size_t i = 0; i < values.size(); ++i) {
+            params->emplace_back(node->names[i], values[i]);
+        }
+    }
+    return node->exact;
+}
+
+size_t sese::net::http::Router::matchLongestPrefix(std::string_view path) const {
+    size_t result = NPOS;
+    const Node *node = root.get();
+    while (true) {
+        if (node->prefix_id != NPOS) {
+            result = node->prefix_id;
+        }
+        if (path.empty()) {
+            break;
+        }
+        auto pos = node->indices.find(path[0]);
+        if (pos == std::string::npos) {
+            break;
+        }
+        auto child = node->children[pos].get();
+        if (path.substr(0, child->prefix.length()) != child->prefix) {
+            break;
+        }
+        path.remove_prefix(child->prefix.length());
+        node = child;
+    }
+    return result;
+}
+
+void sese::net::http::Router::matchPrefixes(std::string_view path, std::vector<size_t> &ids) const {
+    const Node *node = root.get();
+    while (true) {
+        if (node->prefix_id != NPOS) {
+            ids.emplace_back(node->prefix_id);
+        }
+        if (path.empty()) {
+            break;
+        }
+        auto pos = node->indices.find(path[0]);
+        if (pos == std::string::npos) {
+            break;
+        }
+        auto child = node->children[pos].get();
+        if (path.substr(0, child->prefix.length()) != child->prefix) {
+            break;
+        }
+        path.remove_prefix(child->prefix.length());
+        node = child;
+    }
+}
+
+void sese::net::http::Router::clear() {
+    root = std::make_unique<Node>();
+}
@@ -0,0 +1,90 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @file Router.h
+ * @brief Radix tree based HTTP router
+ * @author kaoru
+ * @date October 17, 2026
+ */
+
+#pragma once
+
+#include <sese/Config.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sese::net::http {
+
+/// Radix tree based HTTP router.
+/// Routes are identified by the index assigned by the caller, lookups cost O(path length)
+class Router {
+public:
+    /// Captured path parameters, in the order they appear in the pattern
+    using Params = std::vector<std::pair<std::string, std::string>>;
+
+    static constexpr size_t NPOS = static_cast<size_t>(-1);
+
+    Router();
+
+    ~Router();
+
+    Router(Router &&) noexcept;
+
+    Router &operator=(Router &&) noexcept;
+
+    /// Register a route that must match the entire path
+    /// @param pattern Route pattern, `{name}` captures a single path segment, e.g. /users/{id}
+    /// @param id Route index
+    /// @return false if the pattern is invalid or already registered
+    bool insert(const std::string &pattern, size_t id);
+
+    /// Register a prefix route, the pattern is matched literally
+    /// @param prefix URI prefix
+    /// @param id Route index
+    /// @return false if the prefix is already registered
+    bool insertPrefix(const std::string &prefix, size_t id);
+
+    /// Match a route against the entire path, static segments take precedence over parameters
+    /// @param path Request path
+    /// @param params Captured path parameters, may be null
+    /// @return Route index, NPOS if not found
+    size_t match(std::string_view path, Params *params = nullptr) const;
+
+    /// Find the longest prefix route of the path
+    /// @param path Request path
+    /// @return Route index, NPOS if not found
+    [[nodiscard]] size_t matchLongestPrefix(std::string_view path) const;
+
+    /// Find all prefix routes of the path
+    /// @param path Request path
+    /// @param ids Route indexes ordered from the shortest prefix to the longest
+    void matchPrefixes(std::string_view path, std::vector<size_t> &ids) const;
+
+    void clear();
+
+private:
+    struct Node;
+
+    static Node *insertStatic(Node *node, std::string_view str);
+
+    static const Node *matchNode(const Node *node, std::string_view path, std::vector<std::string_view> &values);
+
+    std::unique_ptr<Node> root;
+};
+
+} // namespace sese::net::http
@@ -0,0 +1,188 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sese/net/ws/WebsocketFrame.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SESE_WS_SSE2
+#ifdef __AVX2__
+#include <immintrin.h>
+#define SESE_WS_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SESE_WS_NEON
+#endif
+
+using sese::net::ws::FrameHeader;
+using sese::net::ws::Opcode;
+using sese::net::ws::WebsocketFrame;
+
+static bool isValidOpcode(uint8_t opcode) {
+    switch (static_cast<Opcode>(opcode)) {
+        case Opcode::CONTINUATION:
+        case Opcode::TEXT:
+        case Opcode::BINARY:
+        case Opcode::CLOSE:
+        case Opcode::PING:
+        case Opcode::PONG:
+            return true;
+        default:
+            return false;
+    }
+}
+
+int64_t WebsocketFrame::parse(const void *buffer, size_t length, FrameHeader &header) noexcept {
+    auto bytes = static_cast<const uint8_t *>(buffer);
+    if (length < 2) {
+        return 0;
+    }
+    if (!isValidOpcode(bytes[0] & 0x0F)) {
+        return -1;
+    }
+    header.fin = bytes[0] & 0x80;
+    header.rsv = (bytes[0] >> 4) & 0x07;
+    header.opcode = static_cast<Opcode>(bytes[0] & 0x0F);
+    header.masked = bytes[1] & 0x80;
+
+    size_t size = 2;
+    uint64_t payload_length = bytes[1] & 0x7F;
+    size_t extended = payload_length == 126 ? 2 : payload_length == 127 ? 8 : 0;
+    if (length < size + extended + (header.masked ? 4 : 0)) {
+        return 0;
+    }
+    if (extended) {
+        payload_length = 0;
+        for (size_t i = 0; i < extended; ++i) {
+            payload_length = payload_length << 8 | bytes[size + i];
+        }
+        size += extended;
+        // The length must be encoded in the fewest bytes and its most significant bit must be zero
+        if ((extended == 2 && payload_length < 126) ||
+            (extended == 8 && (payload_length <= 0xFFFF || payload_length >> 63))) {
+            return -1;
+        }
+    }
+    header.payload_length = payload_length;
+    if (header.isControl() && (!header.fin || payload_length > MAX_CONTROL_PAYLOAD)) {
+        return -1;
+    }
+    if (header.masked) {
+        memcpy(header.mask_key, bytes + size, 4);
+        size += 4;
+    }
+    return static_cast<int64_t>(size);
+}
+
+size_t WebsocketFrame::serialize(const FrameHeader &header, void *buffer) noexcept {
+    auto bytes = static_cast<uint8_t *>(buffer);
+    bytes[0] = static_cast<uint8_t>((header.fin ? 0x80 : 0) | (header.rsv & 0x07) << 4 | static_cast<uint8_t>(header.opcode));
+    auto mask_bit = static_cast<uint8_t>(header.masked ? 0x80 : 0);
+    size_t size;
+    if (header.payload_length < 126) {
+        bytes[1] = static_cast<uint8_t>(mask_bit | header.payload_length);
+        size = 2;
+    } else if (header.payload_length <= 0xFFFF) {
+        bytes[1] = mask_bit | 126;
+        bytes[2] = static_cast<uint8_t>(header.payload_length >> 8);
+        bytes[3] = static_cast<uint8_t>(header.payload_length);
+        size = 4;
+    } else {
+        bytes[1] = mask_bit | 127;
+        for (int i = 0; i < 8; ++i) {
+            bytes[2 + i] = static_cast<uint8_t>(header.payload_length >> (56 - 8 * i));
+        }
+        size = 10;
+    }
+    if (header.masked) {
+        memcpy(bytes + size, header.mask_key, 4);
+        size += 4;
+    }
+    return size;
+}
+
+void WebsocketFrame::unmask(void *data, size_t length, const uint8_t key[4], uint64_t offset) noexcept {
+    // Rotate the key so that it starts at the first byte of data
+    uint8_t rotated[4];
+    for (size_t i = 0; i < 4; ++i) {
+        rotated[i] = key[(offset + i) & 3];
+    }
+    uint32_t word;
+    memcpy(&word, rotated, 4);
+
+    // Every step consumes a multiple of 4 bytes, so the key stays aligned with the data
+    auto bytes = static_cast<uint8_t *>(data);
+#ifdef SESE_WS_AVX2
+    auto mask256 = _mm256_set1_epi32(static_cast<int>(word));
+    for (; length >= 32; length -= 32, bytes += 32) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(bytes), _mm256_xor_si256(block, mask256));
+    }
+#endif
+#ifdef SESE_WS_SSE2
+    auto mask128 = _mm_set1_epi32(static_cast<int>(word));
+    for (; length >= 16; length -= 16, bytes += 16) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), _mm_xor_si128(block, mask128));
+    }
+#endif
+#ifdef SESE_WS_NEON
+    auto mask128 = vreinterpretq_u8_u32(vdupq_n_u32(word));
+    for (; length >= 16; length -= 16, bytes += 16) {
+        vst1q_u8(bytes, veorq_u8(vld1q_u8(bytes), mask128));
+    }
+#endif
+    auto mask64 = static_cast<uint64_t>(word) | static_cast<uint64_t>(word) << 32;
+    for (; length >= 8; length -= 8, bytes += 8) {
+        uint64_t block;
+        memcpy(&block, bytes, 8);
+        block ^= mask64;
+        memcpy(bytes, &block, 8);
+    }
+    for (size_t i = 0; i < length; ++i) {
+        bytes[i] ^= rotated[i & 3];
+    }
+}
+
+WebsocketFrame::Ptr WebsocketFrame::make(Opcode opcode, const void *data, size_t length, bool fin) {
+    FrameHeader header;
+    header.fin = fin;
+    header.opcode = opcode;
+    header.payload_length = length;
+    uint8_t buffer[MAX_HEADER_SIZE];
+    auto size = serialize(header, buffer);
+
+    auto frame = std::make_shared<std::string>(size + length, '\0');
+    memcpy(frame->data(), buffer, size);
+    if (length) {
+        memcpy(frame->data() + size, data, length);
+    }
+    return frame;
+}
+
+WebsocketFrame::Ptr WebsocketFrame::makeClose(uint16_t code, const std::string &reason) {
+    if (code == 1005) {
+        return make(Opcode::CLOSE, nullptr, 0);
+    }
+    char payload[MAX_CONTROL_PAYLOAD];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code);
+    auto length = std::min(reason.length(), MAX_CONTROL_PAYLOAD - 2);
+    memcpy(payload + 2, reason.data(), length);
+    return make(Opcode::CLOSE, payload, length + 2);
+}
@@ -0,0 +1,103 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file WebsocketFrame.h
+/// \brief Websocket frame codec
+/// \author kaoru
+/// \date October 17, 2026
+
+#pragma once
+
+#include "sese/Config.h"
+#include "sese/util/NotInstantiable.h"
+
+#include <memory>
+#include <string>
+
+namespace sese::net::ws {
+
+/// Frame opcodes defined by RFC 6455
+enum class Opcode : uint8_t {
+    CONTINUATION = 0x0,
+    TEXT = 0x1,
+    BINARY = 0x2,
+    CLOSE = 0x8,
+    PING = 0x9,
+    PONG = 0xA
+};
+
+/// Decoded frame header
+struct FrameHeader {
+    bool fin = true;
+    /// Reserved bits, non-zero only if an extension was negotiated
+    uint8_t rsv = 0;
+    Opcode opcode = Opcode::TEXT;
+    bool masked = false;
+    uint8_t mask_key[4]{};
+    uint64_t payload_length = 0;
+
+    /// Whether the opcode is a control frame, which may not be fragmented
+    [[nodiscard]] bool isControl() const { return static_cast<uint8_t>(opcode) & 0x8; }
+};
+
+/// Websocket frame codec
+class WebsocketFrame final : public NotInstantiable {
+public:
+    WebsocketFrame() = delete;
+
+    /// Serialized frame shared by every connection it is sent to
+    using Ptr = std::shared_ptr<const std::string>;
+
+    /// Largest possible frame header
+    static constexpr size_t MAX_HEADER_SIZE = 14;
+    /// Largest payload of a control frame
+    static constexpr size_t MAX_CONTROL_PAYLOAD = 125;
+
+    /// Decode a frame header
+    /// \param buffer Received data
+    /// \param length Size of the data
+    /// \param header Decoded header
+    /// \return Size of the header, 0 if more data is needed, -1 if the header is invalid
+    static int64_t parse(const void *buffer, size_t length, FrameHeader &header) noexcept;
+
+    /// Encode a frame header
+    /// \param header Header to encode
+    /// \param buffer Output buffer of at least MAX_HEADER_SIZE bytes
+    /// \return Size of the header
+    static size_t serialize(const FrameHeader &header, void *buffer) noexcept;
+
+    /// Apply the masking key in place, masking and unmasking are the same operation.
+    /// The payload of a frame may be unmasked in several parts as it is received
+    /// \param data Payload
+    /// \param length Size of the payload
+    /// \param key Masking key
+    /// \param offset Position of data in the payload of the frame
+    static void unmask(void *data, size_t length, const uint8_t key[4], uint64_t offset = 0) noexcept;
+
+    /// Serialize an unmasked frame, as sent by a server
+    /// \param opcode Opcode
+    /// \param data Payload
+    /// \param length Size of the payload
+    /// \param fin Whether this is the last frame of the message
+    /// \return Serialized frame
+    static Ptr make(Opcode opcode, const void *data, size_t length, bool fin = true);
+
+    /// Serialize a close frame
+    /// \param code Status code, 1005 sends an empty payload
+    /// \param reason Reason, truncated to fit a control frame
+    /// \return Serialized frame
+    static Ptr makeClose(uint16_t code, const std::string &reason = {});
+};
+
+} // namespace sese::net::ws
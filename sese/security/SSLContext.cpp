@@ -16,14 +16,142 @@
 #include <openssl/x509.h>
 #include <openssl/err.h>
 #include <openssl/ssl.h>
+#include <openssl/rand.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
 
 #include <sese/security/SSLContext.h>
 #include <sese/log/Marco.h>
 
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <mutex>
 
 using namespace sese::security;
 
+namespace {
+
+/// Session ticket keys of a context, stored in its ex_data and freed with it.
+/// A key encrypts tickets for one interval and decrypts them for one more
+struct TicketKeys {
+    struct Key {
+        unsigned char name[16];
+        unsigned char aes_key[32];
+        unsigned char hmac_key[32];
+        /// Creation time in milliseconds, 0 if the key is unused
+        int64_t created;
+    };
+
+    std::mutex mutex;
+    /// Rotation interval in milliseconds
+    int64_t interval = 0;
+    Key current{};
+    Key previous{};
+
+    static bool generate(Key &key) {
+        key.created = now();
+        return RAND_bytes(key.name, sizeof(key.name)) == 1 &&
+               RAND_priv_bytes(key.aes_key, sizeof(key.aes_key)) == 1 &&
+               RAND_priv_bytes(key.hmac_key, sizeof(key.hmac_key)) == 1;
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Generate a new current key once the interval has elapsed and drop the expired previous one,
+    /// the mutex must be held
+    void rotate() {
+        auto time = now();
+        if (time - current.created >= interval) {
+            Key key{};
+            if (generate(key)) {
+                previous = current;
+                current = key;
+            }
+        }
+        if (previous.created && time - previous.created >= interval * 2) {
+            previous = Key{};
+        }
+    }
+};
+
+int getTicketKeysIndex() {
+    static int index = SSL_CTX_get_ex_new_index(
+            0, nullptr, nullptr, nullptr,
+            [](void *, void *ptr, CRYPTO_EX_DATA *, int, long, void *) {
+                delete static_cast<TicketKeys *>(ptr);
+            }
+    );
+    return index;
+}
+
+/// Select the key of a ticket
+/// @return 1 if the ticket is encrypted by the current key, 2 if it should be renewed, 0 if the key is unknown
+int findTicketKey(SSL *ssl, unsigned char *key_name, int enc, TicketKeys::Key &key) {
+    auto keys = static_cast<TicketKeys *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), getTicketKeysIndex()));
+    if (keys == nullptr) {
+        return -1;
+    }
+    std::lock_guard lock(keys->mutex);
+    keys->rotate();
+    if (enc) {
+        key = keys->current;
+        std::memcpy(key_name, key.name, sizeof(key.name));
+        return 1;
+    }
+    if (std::memcmp(key_name, keys->current.name, sizeof(key.name)) == 0) {
+        key = keys->current;
+        return 1;
+    }
+    if (keys->previous.created && std::memcmp(key_name, keys->previous.name, sizeof(key.name)) == 0) {
+        key = keys->previous;
+        return 2;
+    }
+    return 0;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int ticketKeyCallback(SSL *ssl, unsigned char *key_name, unsigned char *iv, EVP_CIPHER_CTX *cipher, EVP_MAC_CTX *mac, int enc) {
+#else
+int ticketKeyCallback(SSL *ssl, unsigned char *key_name, unsigned char *iv, EVP_CIPHER_CTX *cipher, HMAC_CTX *mac, int enc) {
+#endif
+    TicketKeys::Key key{};
+    auto rt = findTicketKey(ssl, key_name, enc, key);
+    if (rt <= 0) {
+        return rt;
+    }
+    if (enc) {
+        if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1 ||
+            EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1) {
+            return -1;
+        }
+    } else if (EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1) {
+        return -1;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[] = {
+            OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac_key, sizeof(key.hmac_key)),
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char *>("SHA256"), 0),
+            OSSL_PARAM_construct_end()
+    };
+    if (EVP_MAC_CTX_set_params(mac, params) != 1) {
+        return -1;
+    }
+#else
+    if (HMAC_Init_ex(mac, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), nullptr) != 1) {
+        return -1;
+    }
+#endif
+    return rt;
+}
+
+} // namespace
+
 SSLContext::SSLContext(const void *method) noexcept {
     context = SSL_CTX_new(static_cast<const SSL_METHOD *>(method));
 }
@@ -61,6 +189,71 @@ bool SSLContext::authPrivateKey() const noexcept {
     return 1 == SSL_CTX_check_private_key(static_cast<SSL_CTX *>(context));
 }
 
+bool SSLContext::setSessionCache(size_t size, int64_t timeout) const noexcept {
+    assert(context);
+    auto ctx = static_cast<SSL_CTX *>(context);
+    if (size == 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        return true;
+    }
+    // Sessions are only resumed within the same context id, which is required once peers are verified
+    constexpr unsigned char ID_CONTEXT[] = "sese";
+    if (SSL_CTX_set_session_id_context(ctx, ID_CONTEXT, sizeof(ID_CONTEXT) - 1) != 1) {
+        return false;
+    }
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, static_cast<long>(size));
+    SSL_CTX_set_timeout(ctx, static_cast<long>(timeout));
+    return true;
+}
+
+bool SSLContext::setSessionTickets(int64_t interval) const noexcept {
+    assert(context);
+    auto ctx = static_cast<SSL_CTX *>(context);
+    auto index = getTicketKeysIndex();
+    if (index < 0) {
+        return false;
+    }
+    if (interval <= 0) {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+        return true;
+    }
+
+    auto keys = static_cast<TicketKeys *>(SSL_CTX_get_ex_data(ctx, index));
+    if (keys == nullptr) {
+        keys = new TicketKeys;
+        if (!TicketKeys::generate(keys->current) || SSL_CTX_set_ex_data(ctx, index, keys) != 1) {
+            delete keys;
+            return false;
+        }
+    }
+    {
+        std::lock_guard lock(keys->mutex);
+        keys->interval = interval * 1000;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKeyCallback);
+#else
+    SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketKeyCallback);
+#endif
+    SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+    return true;
+}
+
+bool SSLContext::setKtls(bool enable) const noexcept {
+    assert(context);
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+    if (enable) {
+        SSL_CTX_set_options(static_cast<SSL_CTX *>(context), SSL_OP_ENABLE_KTLS);
+    } else {
+        SSL_CTX_clear_options(static_cast<SSL_CTX *>(context), SSL_OP_ENABLE_KTLS);
+    }
+    return true;
+#else
+    return !enable;
+#endif
+}
+
 // bool SSLContext::verifyAndLoad(const char *file) noexcept {
 //     SSL_CTX_set_verify((SSL_CTX *) context, SSL_VERIFY_PEER, nullptr);
 //     return 1 == SSL_CTX_load_verify_locations((SSL_CTX *) context, file, nullptr);
@@ -95,6 +288,20 @@ std::unique_ptr<SSLContext> SSLContext::copy() const noexcept {
 
     auto ssl_context = MAKE_UNIQUE_PRIVATE(SSLContext);
     ssl_context->context = new_ctx;
+
+    // The copy shares the session settings but neither the cached sessions nor the ticket keys
+    if (SSL_CTX_get_session_cache_mode(origin) == SSL_SESS_CACHE_OFF) {
+        ssl_context->setSessionCache(0, 0);
+    } else {
+        ssl_context->setSessionCache(SSL_CTX_sess_get_cache_size(origin), SSL_CTX_get_timeout(origin));
+    }
+    auto keys = static_cast<TicketKeys *>(SSL_CTX_get_ex_data(origin, getTicketKeysIndex()));
+    if (SSL_CTX_get_options(origin) & SSL_OP_NO_TICKET) {
+        ssl_context->setSessionTickets(0);
+    } else if (keys) {
+        std::lock_guard lock(keys->mutex);
+        ssl_context->setSessionTickets(keys->interval / 1000);
+    }
     return std::move(ssl_context);
 }
 
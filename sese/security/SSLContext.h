@@ -49,6 +49,22 @@ public:
     /// \return Verification result
     bool authPrivateKey() const noexcept;
 
+    /// \brief Configure the server-side session cache, evicting the oldest sessions when it is full
+    /// \param size Maximum number of cached sessions, 0 disables the cache
+    /// \param timeout Lifetime of a session in seconds
+    /// \return Setting result
+    bool setSessionCache(size_t size, int64_t timeout) const noexcept;
+    /// \brief Issue session tickets protected by keys generated in memory and rotated periodically.
+    /// Tickets encrypted by the previous key are still accepted and renewed with the current one
+    /// \param interval Rotation interval in seconds, 0 disables session tickets
+    /// \return Setting result
+    bool setSessionTickets(int64_t interval) const noexcept;
+    /// \brief Let OpenSSL hand the record encryption to the kernel (kTLS) once the handshake is done.
+    /// The kernel is only used when it supports the negotiated cipher, otherwise OpenSSL keeps encrypting in user space
+    /// \param enable Whether to enable kTLS
+    /// \return false if OpenSSL is built without kTLS
+    bool setKtls(bool enable) const noexcept;
+
     /// \brief Create a TCP socket from the current context
     /// \param family Protocol family
     /// \param flags Flags
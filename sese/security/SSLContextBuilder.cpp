@@ -25,9 +25,16 @@ SSLContext::Ptr SSLContextBuilder::SSL4Client() noexcept {
 }
 
 SSLContext::Ptr SSLContextBuilder::SSL4Server() noexcept {
+    return SSL4Server(SessionOptions{});
+}
+
+SSLContext::Ptr SSLContextBuilder::SSL4Server(const SessionOptions &options) noexcept {
     // auto method = SSLv23_server_method();
     auto method = TLS_server_method();
-    return std::make_shared<SSLContext>(method);
+    auto context = std::make_shared<SSLContext>(method);
+    context->setSessionCache(options.cache_size, options.timeout);
+    context->setSessionTickets(options.ticket_rotation);
+    return context;
 }
 
 std::unique_ptr<SSLContext> SSLContextBuilder::UniqueSSL4Client() noexcept {
@@ -36,6 +43,13 @@ std::unique_ptr<SSLContext> SSLContextBuilder::UniqueSSL4Client() noexcept {
 }
 
 std::unique_ptr<SSLContext> SSLContextBuilder::UniqueSSL4Server() noexcept {
+    return UniqueSSL4Server(SessionOptions{});
+}
+
+std::unique_ptr<SSLContext> SSLContextBuilder::UniqueSSL4Server(const SessionOptions &options) noexcept {
     auto *method = TLS_server_method();
-    return std::make_unique<SSLContext>(method);
+    auto context = std::make_unique<SSLContext>(method);
+    context->setSessionCache(options.cache_size, options.timeout);
+    context->setSessionTickets(options.ticket_rotation);
+    return context;
 }
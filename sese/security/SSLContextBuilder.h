@@ -30,18 +30,36 @@ class  SSLContextBuilder final : public NotInstantiable {
 public:
     SSLContextBuilder() = delete;
 
+    /// Session resumption options of a server context
+    struct SessionOptions {
+        /// Maximum number of sessions kept in the in-memory cache, 0 disables the cache
+        size_t cache_size = 20480;
+        /// Lifetime of a session in seconds
+        int64_t timeout = 7200;
+        /// Interval in seconds between session ticket key rotations, 0 disables session tickets
+        int64_t ticket_rotation = 3600;
+    };
+
     /// \brief Build SSL context for client
     /// \return Client SSL context
     static SSLContext::Ptr SSL4Client() noexcept;
-    /// \brief Build SSL context for server
+    /// \brief Build SSL context for server with the default session resumption options
     /// \return Server SSL context
     static SSLContext::Ptr SSL4Server() noexcept;
+    /// \brief Build SSL context for server
+    /// \param options Session resumption options
+    /// \return Server SSL context
+    static SSLContext::Ptr SSL4Server(const SessionOptions &options) noexcept;
     /// \brief Build SSL context for client
     /// \return Client SSL context
     static std::unique_ptr<SSLContext> UniqueSSL4Client() noexcept;
-    /// \brief Build SSL context for server
+    /// \brief Build SSL context for server with the default session resumption options
     /// \return Server SSL context
     static std::unique_ptr<SSLContext> UniqueSSL4Server() noexcept;
+    /// \brief Build SSL context for server
+    /// \param options Session resumption options
+    /// \return Server SSL context
+    static std::unique_ptr<SSLContext> UniqueSSL4Server(const SessionOptions &options) noexcept;
 };
 } // namespace sese::security
 
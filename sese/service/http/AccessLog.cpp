@@ -0,0 +1,314 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/service/http/AccessLog.h>
+#include <sese/net/IPv4Address.h>
+#include <sese/net/IPv6Address.h>
+#include <sese/net/http/Header.h>
+#include <sese/net/http/RequestHeader.h>
+#include <sese/text/DateTimeFormatter.h>
+#include <sese/util/DateTime.h>
+
+#include <filesystem>
+
+using sese::service::http::AccessLog;
+
+static std::atomic<uint64_t> next_id{1};
+
+AccessLog::Ring::Ring(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    records = std::make_unique<Record[]>(size);
+    mask = size - 1;
+}
+
+AccessLog::Ptr AccessLog::create(const std::string &path, const Options &options) {
+    auto file = io::FileStream::create(path, io::FileStream::B_WRITE_APPEND);
+    if (!file) {
+        return nullptr;
+    }
+    return Ptr(new AccessLog(path, options, std::move(file)));
+}
+
+AccessLog::AccessLog(std::string path, const Options &options, io::FileStream::Ptr file)
+    : id(next_id.fetch_add(1, std::memory_order_relaxed)),
+      path(std::move(path)),
+      options(options),
+      file(std::move(file)),
+      written(MetricsRegistry::getInstance()->counter("sese_http_access_log_records_total", "Records written to the access log", {{"path", this->path}})),
+      dropped(MetricsRegistry::getInstance()->counter("sese_http_access_log_dropped_records_total", "Records dropped because the access log could not keep up", {{"path", this->path}})) {
+    std::error_code error;
+    file_size = std::filesystem::file_size(this->path, error);
+    if (error) {
+        file_size = 0;
+    }
+    // Id 0 is the requests no route matched
+    routes.emplace_back();
+    thread = std::make_unique<Thread>([this] { loop(); }, "AccessLog");
+    thread->start();
+}
+
+AccessLog::~AccessLog() {
+    {
+        std::lock_guard lock(mutex);
+        shutdown = true;
+    }
+    condition_variable.notify_one();
+    thread->join();
+    if (file) {
+        file->close();
+    }
+}
+
+uint32_t AccessLog::registerRoute(const std::string &name) {
+    std::lock_guard lock(mutex);
+    auto iterator = std::find(routes.begin(), routes.end(), name);
+    if (iterator != routes.end()) {
+        return static_cast<uint32_t>(iterator - routes.begin());
+    }
+    routes.emplace_back(name);
+    return static_cast<uint32_t>(routes.size() - 1);
+}
+
+AccessLog::Ring *AccessLog::getRing() {
+    // Usually a single log per thread, the entries of destroyed logs are never matched again
+    static thread_local std::vector<std::pair<uint64_t, Ring *>> cache;
+    for (auto &&[log_id, ring]: cache) {
+        if (log_id == id) {
+            return ring;
+        }
+    }
+    auto ring = std::make_unique<Ring>(options.ring_size);
+    auto result = ring.get();
+    {
+        std::lock_guard lock(mutex);
+        rings.emplace_back(std::move(ring));
+    }
+    cache.emplace_back(id, result);
+    return result;
+}
+
+AccessLog::Record *AccessLog::begin() noexcept {
+    Ring *ring;
+    try {
+        ring = getRing();
+    } catch (...) {
+        dropped.inc();
+        return nullptr;
+    }
+    auto head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) > ring->mask) {
+        dropped.inc();
+        return nullptr;
+    }
+    return &ring->records[head & ring->mask];
+}
+
+void AccessLog::commit() noexcept {
+    // begin has already created the ring of the thread
+    auto ring = getRing();
+    ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void AccessLog::loop() {
+    std::vector<std::string> names;
+    std::string buffer;
+    std::unique_lock lock(mutex);
+    while (!shutdown) {
+        condition_variable.wait_for(lock, std::chrono::milliseconds(options.flush_interval));
+        lock.unlock();
+        drain(names, buffer);
+        lock.lock();
+    }
+    lock.unlock();
+    // The records committed before the shutdown
+    drain(names, buffer);
+}
+
+void AccessLog::drain(std::vector<std::string> &names, std::string &buffer) {
+    std::vector<Ring *> current;
+    {
+        std::lock_guard lock(mutex);
+        current.reserve(rings.size());
+        for (auto &&ring: rings) {
+            current.emplace_back(ring.get());
+        }
+        // Routes are only appended
+        names.insert(names.end(), routes.begin() + static_cast<std::ptrdiff_t>(names.size()), routes.end());
+    }
+
+    static const std::string UNKNOWN_ROUTE;
+    uint64_t count = 0;
+    buffer.clear();
+    for (auto &&ring: current) {
+        auto tail = ring->tail.load(std::memory_order_relaxed);
+        auto head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            auto &&record = ring->records[tail & ring->mask];
+            format(record, record.route < names.size() ? names[record.route] : UNKNOWN_ROUTE, options.format, buffer);
+            count += 1;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    if (buffer.empty()) {
+        return;
+    }
+    if (!file) {
+        // Neither the log file nor the rotated one could be reopened
+        dropped.inc(count);
+        return;
+    }
+    file->write(buffer.data(), buffer.length());
+    (void) file->flush();
+    file_size += buffer.length();
+    written.inc(count);
+    if (options.max_size && file_size >= options.max_size) {
+        rotate();
+    }
+}
+
+void AccessLog::rotate() {
+    file->close();
+    std::error_code error;
+    if (options.max_files == 0) {
+        std::filesystem::remove(path, error);
+    } else {
+        for (auto i = options.max_files; i > 1; --i) {
+            std::filesystem::rename(path + "." + std::to_string(i - 1), path + "." + std::to_string(i), error);
+        }
+        std::filesystem::rename(path, path + ".1", error);
+    }
+    auto reopened = io::FileStream::create(path, io::FileStream::B_WRITE_APPEND);
+    if (reopened) {
+        file = std::move(reopened);
+        file_size = 0;
+    } else {
+        // Keep appending to the rotated file rather than losing the records
+        file = io::FileStream::create(options.max_files ? path + ".1" : path, io::FileStream::B_WRITE_APPEND);
+    }
+}
+
+/// Escape the quotes, backslashes and control characters as \xHH
+static void appendEscaped(std::string &output, const char *data, size_t length) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < length; ++i) {
+        auto ch = static_cast<unsigned char>(data[i]);
+        if (ch == '"' || ch == '\\' || ch < 0x20 || ch >= 0x7f) {
+            output += "\\x";
+            output += HEX[ch >> 4];
+            output += HEX[ch & 0xf];
+        } else {
+            output += static_cast<char>(ch);
+        }
+    }
+}
+
+/// Append a JSON string, including the quotes
+static void appendJson(std::string &output, const char *data, size_t length) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    output += '"';
+    for (size_t i = 0; i < length; ++i) {
+        auto ch = static_cast<unsigned char>(data[i]);
+        if (ch == '"' || ch == '\\') {
+            output += '\\';
+            output += static_cast<char>(ch);
+        } else if (ch < 0x20 || ch >= 0x7f) {
+            // Truncated fields may end in the middle of a UTF-8 sequence, so the bytes are not passed through
+            output += "\\u00";
+            output += HEX[ch >> 4];
+            output += HEX[ch & 0xf];
+        } else {
+            output += static_cast<char>(ch);
+        }
+    }
+    output += '"';
+}
+
+static std::string formatAddress(const AccessLog::Record &record) {
+    if (record.family == AF_INET) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        std::memcpy(&address.sin_addr, record.address, sizeof(address.sin_addr));
+        return sese::net::IPv4Address(address).getAddress();
+    }
+    if (record.family == AF_INET6) {
+        return sese::net::IPv6Address(record.address).getAddress();
+    }
+    return "-";
+}
+
+void AccessLog::format(const Record &record, const std::string &route, Format format, std::string &output) {
+    auto method = sese::net::http::requestTypeToString(static_cast<sese::net::http::RequestType>(record.method));
+    auto version = static_cast<sese::net::http::HttpVersion>(record.version) == sese::net::http::HttpVersion::VERSION_2 ? "HTTP/2.0" : "HTTP/1.1";
+    auto time = DateTime(static_cast<uint64_t>(record.timestamp), 0);
+    if (format == Format::COMBINED) {
+        output += formatAddress(record);
+        output += " - - [";
+        output += text::DateTimeFormatter::format(time, "dd/MMM/yyyy:HH:mm:ss");
+        output += " +0000] \"";
+        output += method;
+        output += ' ';
+        appendEscaped(output, record.uri, record.uri_length);
+        output += ' ';
+        output += version;
+        output += "\" ";
+        output += std::to_string(record.status);
+        output += ' ';
+        output += record.bytes < 0 ? "-" : std::to_string(record.bytes);
+        output += " \"";
+        if (record.referer_length) {
+            appendEscaped(output, record.referer, record.referer_length);
+        } else {
+            output += '-';
+        }
+        output += "\" \"";
+        if (record.user_agent_length) {
+            appendEscaped(output, record.user_agent, record.user_agent_length);
+        } else {
+            output += '-';
+        }
+        output += "\"\n";
+        return;
+    }
+
+    output += "{\"time\":\"";
+    output += text::DateTimeFormatter::format(time, TIME_SHORT_PATTERN);
+    output += "\",\"remote\":\"";
+    output += formatAddress(record);
+    output += "\",\"method\":\"";
+    output += method;
+    output += "\",\"uri\":";
+    appendJson(output, record.uri, record.uri_length);
+    output += ",\"protocol\":\"";
+    output += version;
+    output += "\",\"status\":";
+    output += std::to_string(record.status);
+    output += ",\"bytes\":";
+    output += record.bytes < 0 ? "null" : std::to_string(record.bytes);
+    output += ",\"route\":";
+    if (route.empty()) {
+        output += "null";
+    } else {
+        appendJson(output, route.data(), route.length());
+    }
+    output += ",\"latency_us\":";
+    output += std::to_string(record.latency);
+    output += ",\"referer\":";
+    appendJson(output, record.referer, record.referer_length);
+    output += ",\"user_agent\":";
+    appendJson(output, record.user_agent, record.user_agent_length);
+    output += "}\n";
+}
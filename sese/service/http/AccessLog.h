@@ -0,0 +1,177 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// @file AccessLog.h
+/// @brief Asynchronous access log of the HTTP services
+/// @author kaoru
+/// @date October 17, 2026
+
+#pragma once
+
+#include <sese/io/FileStream.h>
+#include <sese/thread/Thread.h>
+#include <sese/util/Metrics.h>
+#include <sese/util/Noncopyable.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <string_view>
+
+namespace sese::service::http {
+
+/// Access log of the HTTP services.
+/// The I/O threads copy a fixed-size record of each request into a ring of their own and never format or write anything,
+/// a background thread formats the records and appends them to a file rotated by size.
+/// Records that do not fit in a full ring are dropped and counted
+class AccessLog final : public Noncopyable {
+public:
+    using Ptr = std::shared_ptr<AccessLog>;
+
+    enum class Format {
+        /// NCSA combined log format
+        COMBINED,
+        /// One JSON object per line, including the route and the latency
+        JSON
+    };
+
+    struct Options {
+        Format format = Format::COMBINED;
+        /// Size in bytes above which the file is rotated, 0 disables rotation
+        size_t max_size = 64 * 1024 * 1024;
+        /// Number of rotated files kept as path.1 to path.N, the oldest is removed
+        size_t max_files = 5;
+        /// Records buffered by each thread, rounded up to a power of two
+        size_t ring_size = 1024;
+        /// Milliseconds between two writes of the background thread
+        uint32_t flush_interval = 200;
+    };
+
+    /// Copy of a request taken when its response starts, the strings are truncated to their capacity
+    struct Record {
+        /// Microseconds since the epoch
+        int64_t timestamp;
+        /// Microseconds from the end of the request header to the start of the response
+        uint64_t latency;
+        /// Length of the response body, -1 if it is not known in advance
+        int64_t bytes;
+        /// Route registered with registerRoute, 0 if no route matched
+        uint32_t route;
+        uint16_t status;
+        /// sese::net::http::RequestType
+        uint8_t method;
+        /// sese::net::http::HttpVersion
+        uint8_t version;
+        /// AF_INET, AF_INET6 or 0 if unknown
+        uint16_t family;
+        uint8_t address[16];
+        uint16_t uri_length;
+        uint16_t referer_length;
+        uint16_t user_agent_length;
+        char uri[256];
+        char referer[128];
+        char user_agent[128];
+
+        /// Copy a string into one of the fields
+        /// @param field Field
+        /// @param length Length of the field
+        /// @param value String
+        template<size_t N>
+        static void copy(char (&field)[N], uint16_t &length, std::string_view value) noexcept {
+            length = static_cast<uint16_t>(std::min(value.length(), N));
+            std::memcpy(field, value.data(), length);
+        }
+    };
+
+    /// Open the log file and start the background thread
+    /// @param path Log file, appended to if it exists
+    /// @param options Options
+    /// @return nullptr if the file cannot be opened
+    static Ptr create(const std::string &path, const Options &options);
+
+    /// Write the remaining records and close the file
+    ~AccessLog() override;
+
+    /// Register the name of a route, the same name gets the same id
+    /// @param name Route, e.g. the URI pattern of a servlet
+    /// @return Id stored in Record::route
+    uint32_t registerRoute(const std::string &name);
+
+    /// Reserve the next record of the calling thread, which must then call commit
+    /// @return nullptr if the ring of the thread is full, the record is then counted as dropped
+    Record *begin() noexcept;
+
+    /// Publish the record reserved by the calling thread
+    void commit() noexcept;
+
+    /// @return Records written to the file
+    [[nodiscard]] uint64_t getWritten() const noexcept { return written.value(); }
+
+    /// @return Records dropped because a ring was full
+    [[nodiscard]] uint64_t getDropped() const noexcept { return dropped.value(); }
+
+    /// Format a record
+    /// @param record Record
+    /// @param route Name of the route
+    /// @param format Format
+    /// @param output Appended with the line, including the line feed
+    static void format(const Record &record, const std::string &route, Format format, std::string &output);
+
+private:
+    /// Single producer, single consumer queue of records
+    struct Ring {
+        explicit Ring(size_t capacity);
+
+        std::unique_ptr<Record[]> records;
+        size_t mask;
+        /// Written by the producer
+        alignas(64) std::atomic<size_t> head{0};
+        /// Written by the background thread
+        alignas(64) std::atomic<size_t> tail{0};
+    };
+
+    AccessLog(std::string path, const Options &options, io::FileStream::Ptr file);
+
+    /// Ring of the calling thread, created on first use
+    Ring *getRing();
+
+    void loop();
+
+    /// Format and write the records of every ring
+    /// @param names Names of the routes, completed with the routes registered since the last call
+    /// @param buffer Reused for the formatted lines
+    void drain(std::vector<std::string> &names, std::string &buffer);
+
+    /// Rename the file to path.1, shifting the rotated files, and reopen it
+    void rotate();
+
+    /// Distinguishes the instances in the cache of the threads, addresses may be reused
+    uint64_t id;
+    std::string path;
+    Options options;
+    io::FileStream::Ptr file;
+    size_t file_size = 0;
+
+    std::mutex mutex;
+    std::condition_variable condition_variable;
+    bool shutdown = false;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<std::string> routes;
+    Thread::Ptr thread;
+
+    Counter &written;
+    Counter &dropped;
+};
+
+} // namespace sese::service::http
@@ -14,7 +14,9 @@
 
 #include <sese/internal/service/http/HttpServiceImpl.h>
 #include <sese/service/http/HttpServer.h>
+#include <sese/util/Metrics.h>
 #include <sese/Log.h>
+#include <algorithm>
 #include <utility>
 
 using namespace sese::service::http;
@@ -27,6 +29,21 @@ void HttpServer::regServlet(const net::http::Servlet &servlet) {
     this->servlets.emplace(servlet.getUri(), servlet);
 }
 
+void HttpServer::regWebsocket(const std::string &uri, const WebsocketHandler &handler) {
+    this->websockets[uri] = handler;
+}
+
+void HttpServer::regMetrics(const std::string &uri) {
+    net::http::Servlet servlet(net::http::RequestType::GET, uri);
+    servlet = [](net::http::HttpServletContext &ctx) {
+        std::string text;
+        MetricsRegistry::getInstance()->expose(text);
+        ctx.getResp().set("content-type", "text/plain; version=0.0.4; charset=utf-8");
+        ctx.getResp().getBody().write(text.data(), text.length());
+    };
+    regServlet(servlet);
+}
+
 void HttpServer::regTailFilter(const HttpService::FilterCallback &tail_filter) {
     this->tail_filter = tail_filter;
 }
@@ -36,12 +53,92 @@ void HttpServer::regFilter(const std::string &uri_prefix, const HttpService::Fil
 }
 
 void HttpServer::setKeepalive(uint32_t seconds) {
-    keepalive = std::max<uint32_t>(seconds, 5);
+    options.keepalive = std::max<uint32_t>(seconds, 5);
+}
+
+void HttpServer::setHeaderTimeout(uint32_t seconds) {
+    options.timeouts.header_timeout = std::max<uint32_t>(seconds, 1);
+}
+
+void HttpServer::setBodyTimeout(uint32_t seconds) {
+    options.timeouts.body_timeout = std::max<uint32_t>(seconds, 1);
+}
+
+void HttpServer::setReusePort(bool enable) {
+    options.listen.reuse_port = enable;
+}
+
+void HttpServer::setDeferAccept(uint32_t seconds) {
+    options.listen.defer_accept = seconds;
+}
+
+void HttpServer::setBacklog(uint32_t backlog) {
+    options.listen.backlog = std::min<uint32_t>(backlog, INT32_MAX);
+}
+
+void HttpServer::setThreads(size_t threads) {
+    options.threads = std::max<size_t>(threads, 1);
+}
+
+void HttpServer::setWorkerPool(size_t threads, size_t queue_size) {
+    options.worker_threads = threads;
+    options.worker_queue_size = queue_size;
+}
+
+void HttpServer::setRateLimit(double rate, uint32_t burst) {
+    options.admission.client.rate = rate;
+    options.admission.client.burst = std::max<uint32_t>(burst, 1);
+}
+
+void HttpServer::regRateLimit(const std::string &uri_prefix, double rate, uint32_t burst) {
+    options.admission.routes[uri_prefix] = {rate, std::max<uint32_t>(burst, 1)};
+}
+
+void HttpServer::setLoadShedding(size_t max_in_flight, uint32_t max_queue_delay) {
+    options.admission.max_in_flight = max_in_flight;
+    options.admission.max_queue_delay = max_queue_delay;
+}
+
+void HttpServer::setAccessLog(const AccessLog::Ptr &access_log) {
+    options.access_log = access_log;
+}
+
+void HttpServer::setFileCache(size_t capacity) {
+    options.file_cache_size = capacity;
+}
+
+void HttpServer::setCompression(size_t min_length, size_t level) {
+    options.compression.enable = true;
+    options.compression.min_length = min_length;
+    options.compression.level = std::clamp<size_t>(level, 1, 9);
+}
+
+void HttpServer::regCompressibleType(const std::string &type_prefix) {
+    options.compression.types.emplace_back(type_prefix);
+}
+
+void HttpServer::setPrecompressed(bool enable) {
+    options.compression.precompressed = enable;
+}
+
+void HttpServer::setHttp2Window(uint32_t stream_window_size, uint32_t connection_window_size) {
+    options.http2.stream_window_size = std::clamp<uint32_t>(stream_window_size, 65535, INT32_MAX);
+    options.http2.connection_window_size = std::clamp<uint32_t>(connection_window_size, 65535, INT32_MAX);
+}
+
+void HttpServer::setHttp2AutoTune(bool enable, uint32_t max_window_size) {
+    options.http2.auto_tune = enable;
+    options.http2.max_window_size = std::clamp<uint32_t>(max_window_size, 65535, INT32_MAX);
+}
+
+void HttpServer::setHttp2Limits(uint32_t max_frame_size, uint32_t max_concurrent_streams) {
+    options.http2.max_frame_size = std::clamp<uint32_t>(max_frame_size, 16384, 16777215);
+    options.http2.max_concurrent_streams = std::max<uint32_t>(max_concurrent_streams, 1);
 }
 
 void HttpServer::regService(const net::IPAddress::Ptr &address, std::unique_ptr<security::SSLContext> context) {
     auto service = internal::service::http::HttpServiceImpl::create(
-        address, std::move(context), keepalive, name, mount_points, servlets, tail_filter, filters, connection_callback
+        address, std::move(context), options, name, mount_points, servlets, websockets, tail_filter, filters, connection_callback
     );
     this->services.push_back(service);
 }
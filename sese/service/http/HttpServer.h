@@ -35,20 +35,33 @@ public:
     template<class CTL, class... ARGS>
     void regController(ARGS &&...args);
 
-    /// Register file system mount point
+    /// Register file system mount point, the longest matching prefix is selected
     /// @param uri_prefix URI prefix
     /// @param local Local path
     void regMountPoint(const std::string &uri_prefix, const std::string &local);
 
-    /// Register filter
+    /// Register filter, all matching filters are invoked from the shortest prefix to the longest
     /// \param uri_prefix URI prefix
     /// \param callback Callback function. If the function returns true, it needs further processing, i.e., continue to determine subsequent mount points, controllers, etc. Otherwise, intercept the current request and respond directly.
     void regFilter(const std::string &uri_prefix, const HttpService::FilterCallback &callback);
 
-    /// Register HTTP application
+    /// Register HTTP application, the URI may capture path segments such as /users/{id},
+    /// see net::http::HttpServletContext::getPathArg
     /// @param servlet HTTP application
     void regServlet(const net::http::Servlet &servlet);
 
+    /// Register websocket route. A GET request with a valid upgrade header is answered with 101 and its connection is
+    /// handed over to a session on the same I/O thread, other requests to the URI are answered with 426.
+    /// Filters are invoked on the upgrade request like on any other. Only HTTP/1.1 connections can be upgraded
+    /// @param uri URI, which may capture path segments like a servlet, see WebsocketSession::getPathArgs
+    /// @param handler Callbacks of the sessions
+    void regWebsocket(const std::string &uri, const WebsocketHandler &handler);
+
+    /// Register a servlet exposing the metrics of the process in the Prometheus text format,
+    /// including the latency of each route of the services, see MetricsRegistry
+    /// @param uri URI
+    void regMetrics(const std::string &uri = "/metrics");
+
     /// This method is used to register a post-processing filter that will be executed after other all servlets, controllers, and mount points process exceptions.
     /// If you need to finally modify or process the response (e.g., custom 404 pages), you can use this feature.
     /// The return value indicates whether the interception has been processed. After interception, the response type will change to Controller and accept the relevant processing.
@@ -59,6 +72,93 @@ public:
     /// @param seconds Keepalive duration, minimum value is 5
     void setKeepalive(uint32_t seconds);
 
+    /// Set the time allowed to receive the complete header of a request, which protects against slow clients holding connections
+    /// @param seconds Timeout duration, minimum value is 1
+    void setHeaderTimeout(uint32_t seconds);
+
+    /// Set the maximum time between two reads of a request body
+    /// @param seconds Timeout duration, minimum value is 1
+    void setBodyTimeout(uint32_t seconds);
+
+    /// Open a listening socket with SO_REUSEPORT for each thread, so that the kernel balances the new connections between them
+    /// instead of a single acceptor handing them out. Only effective on Linux
+    /// @param enable Whether to open a listening socket for each thread
+    void setReusePort(bool enable);
+
+    /// Report accepted connections only once their first data arrives (TCP_DEFER_ACCEPT), only effective on Linux
+    /// @param seconds Time the kernel waits for the data, 0 disables it
+    void setDeferAccept(uint32_t seconds);
+
+    /// Set the maximum length of the queue of pending connections
+    /// @param backlog Queue length, 0 uses the system maximum
+    void setBacklog(uint32_t backlog);
+
+    /// Set the number of I/O threads per service, accepted connections are assigned to them in a round-robin manner
+    /// @note Servlets and filters may be invoked concurrently when the value is greater than 1
+    /// @param threads Number of I/O threads, minimum value is 1
+    void setThreads(size_t threads);
+
+    /// Set the worker pool executing the servlets marked as asynchronous, see net::http::Servlet::setAsync
+    /// @param threads Number of worker threads, 0 disables the pool and asynchronous servlets run on the I/O threads
+    /// @param queue_size Maximum number of queued servlet tasks, requests beyond it are answered with 503
+    void setWorkerPool(size_t threads, size_t queue_size = 1024);
+
+    /// Limit the requests of each client address with a token bucket, limited clients are answered with 429 before their body is read
+    /// @param rate Requests per second, 0 disables the limit
+    /// @param burst Requests a client may send at once, minimum value is 1
+    void setRateLimit(double rate, uint32_t burst);
+
+    /// Limit the requests of each client address on the URIs starting with a prefix, in addition to setRateLimit.
+    /// Only the limit of the longest matching prefix applies
+    /// @param uri_prefix URI prefix
+    /// @param rate Requests per second
+    /// @param burst Requests a client may send at once, minimum value is 1
+    void regRateLimit(const std::string &uri_prefix, double rate, uint32_t burst);
+
+    /// Answer new requests with 503 while the service is overloaded, before their body is read
+    /// @param max_in_flight Requests handled at once, from the end of their header to the start of their response, 0 disables it
+    /// @param max_queue_delay Milliseconds servlet tasks may wait in the worker pool while it is still queueing, 0 disables it
+    void setLoadShedding(size_t max_in_flight, uint32_t max_queue_delay = 0);
+
+    /// Log the requests of the services, which record them without formatting or writing on the I/O threads
+    /// @param access_log Log shared by the services, see AccessLog::create, null disables logging
+    void setAccessLog(const AccessLog::Ptr &access_log);
+
+    /// Set the capacity of the static file cache.
+    /// Cached files keep their descriptors open and are invalidated when their directory changes
+    /// @param capacity Maximum number of cached files, 0 disables the cache
+    void setFileCache(size_t capacity);
+
+    /// Enable on-the-fly compression of servlet responses.
+    /// Bodies of compressible content types are encoded with gzip or deflate according to Accept-Encoding
+    /// @param min_length Bodies shorter than this are sent as is
+    /// @param level Compression level, from 1 to 9
+    void setCompression(size_t min_length = 1024, size_t level = 6);
+
+    /// Register an additional compressible content type
+    /// @param type_prefix Prefix of the content type, e.g. application/wasm
+    void regCompressibleType(const std::string &type_prefix);
+
+    /// Serve the precompressed siblings of mounted files, e.g. app.js.zst and app.js.gz for app.js
+    /// @param enable Whether to look up the siblings
+    void setPrecompressed(bool enable);
+
+    /// Set the receive windows of HTTP 2 connections, larger windows let a single stream upload faster over links with a high latency
+    /// @param stream_window_size Initial window of each stream, minimum value is 65535
+    /// @param connection_window_size Window of the whole connection, minimum value is 65535
+    void setHttp2Window(uint32_t stream_window_size, uint32_t connection_window_size);
+
+    /// Grow the receive windows of HTTP 2 connections when the round trip time measured with PING frames
+    /// shows that the peer is limited by them, enabled by default
+    /// @param enable Whether to tune the windows
+    /// @param max_window_size Upper bound of the windows, each stream may buffer that much before the servlet reads it
+    void setHttp2AutoTune(bool enable, uint32_t max_window_size = 1024 * 1024);
+
+    /// Set the limits advertised to HTTP 2 peers
+    /// @param max_frame_size Largest frame payload accepted, clamped between 16384 and 16777215
+    /// @param max_concurrent_streams Maximum number of streams opened at once, minimum value is 1
+    void setHttp2Limits(uint32_t max_frame_size, uint32_t max_concurrent_streams);
+
     /// Register HTTP service
     /// @param address Listening address
     /// @param context SSL service context, if null, SSL is not enabled
@@ -82,11 +182,12 @@ public:
 
 private:
     std::string name;
-    uint32_t keepalive = 5;
+    HttpService::Options options;
     std::vector<HttpService::Ptr> services;
     std::vector<net::http::Controller::Ptr> controllers;
     HttpService::MountPointMap mount_points;
     HttpService::ServletMap servlets;
+    HttpService::WebsocketMap websockets;
     HttpService::FilterMap filters;
     HttpService::FilterCallback tail_filter;
     HttpService::ConnectionCallback connection_callback;
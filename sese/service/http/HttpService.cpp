@@ -15,15 +15,17 @@
 #include <sese/service/http/HttpService.h>
 #include <sese/internal/service/http/HttpServiceImpl.h>
 
+#include <algorithm>
 #include <memory>
 
 sese::service::http::HttpService::Ptr sese::service::http::HttpService::create(
         const net::IPAddress::Ptr &address,
         SSLContextPtr ssl_context,
-        uint32_t keepalive,
+        const Options &options,
         std::string &serv_name,
         MountPointMap &mount_points,
         ServletMap &servlets,
+        WebsocketMap &websockets,
         FilterCallback &tail_filter,
         FilterMap &filters,
         ConnectionCallback &connection_callback
@@ -31,10 +33,11 @@ sese::service::http::HttpService::Ptr sese::service::http::HttpService::create(
     return std::make_shared<internal::service::http::HttpServiceImpl>(
             address,
             std::move(ssl_context),
-            keepalive,
+            options,
             serv_name,
             mount_points,
             servlets,
+            websockets,
             tail_filter,
             filters,
             connection_callback
@@ -44,19 +47,31 @@ sese::service::http::HttpService::Ptr sese::service::http::HttpService::create(
 sese::service::http::HttpService::HttpService(
         net::IPAddress::Ptr address,
         SSLContextPtr ssl_context,
-        uint32_t keepalive,
+        const Options &options,
         std::string &serv_name,
         MountPointMap &mount_points,
         ServletMap &servlets,
+        WebsocketMap &websockets,
         FilterCallback &tail_filter,
         FilterMap &filters,
         ConnectionCallback &connection_callback
 ) : address(std::move(address)),
     ssl_context(std::move(ssl_context)),
-    keepalive(keepalive),
+    keepalive(options.keepalive),
+    threads(std::max<size_t>(options.threads, 1)),
+    worker_threads(options.worker_threads),
+    worker_queue_size(options.worker_queue_size),
+    file_cache_size(options.file_cache_size),
+    compression(options.compression),
+    http2(options.http2),
+    timeouts(options.timeouts),
+    listen(options.listen),
+    admission(options.admission),
+    access_log(options.access_log),
     serv_name(serv_name),
     mount_points(mount_points),
     servlets(servlets),
+    websockets(websockets),
     tail_filter(tail_filter),
     filters(filters),
     connection_callback(connection_callback) {
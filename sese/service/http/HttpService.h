@@ -20,12 +20,15 @@
 #pragma once
 
 #include <sese/service/Service.h>
+#include <sese/service/http/AccessLog.h>
+#include <sese/service/http/WebsocketSession.h>
 #include <sese/net/http/Controller.h>
 #include <sese/net/IPv6Address.h>
 #include <sese/security/SSLContext.h>
 #include <sese/thread/Thread.h>
 
 #include <unordered_map>
+#include <vector>
 
 namespace sese::service::http {
 
@@ -39,14 +42,108 @@ public:
     using FilterMap = std::unordered_map<std::string, FilterCallback>;
     using MountPointMap = std::unordered_map<std::string, std::string>;
     using ServletMap = std::unordered_map<std::string, net::http::Servlet>;
+    using WebsocketMap = std::unordered_map<std::string, WebsocketHandler>;
+
+    /// Response compression settings
+    struct CompressionOptions {
+        /// Compress servlet responses on the fly
+        bool enable = false;
+        /// Bodies shorter than this are sent as is
+        size_t min_length = 1024;
+        /// Compression level, from 1 to 9
+        size_t level = 6;
+        /// Prefixes of the compressible content types
+        std::vector<std::string> types{"text/", "application/json", "application/javascript", "application/xml", "image/svg+xml"};
+        /// Serve the .zst and .gz siblings of mounted files to the clients accepting them
+        bool precompressed = false;
+    };
+
+    /// HTTP 2 connection settings
+    struct Http2Options {
+        /// Initial receive window of each stream, advertised by SETTINGS_INITIAL_WINDOW_SIZE
+        uint32_t stream_window_size = 65535;
+        /// Receive window of the whole connection
+        uint32_t connection_window_size = 65535;
+        /// Largest frame payload accepted from the peer, from 16384 to 16777215
+        uint32_t max_frame_size = 16384;
+        /// Maximum number of streams the peer may open at once
+        uint32_t max_concurrent_streams = 16;
+        /// Grow the receive windows to the bandwidth-delay product measured with PING frames.
+        /// A peer can inflate the measured round trip, so every stream may then buffer up to max_window_size
+        bool auto_tune = true;
+        /// Upper bound of the auto-tuned windows
+        uint32_t max_window_size = 1024 * 1024;
+    };
+
+    /// Timeouts of the connections in seconds, connections idle between requests are closed after the keepalive duration
+    struct TimeoutOptions {
+        /// Time allowed to receive the complete header of a request, counted from its first byte or from the connection
+        uint32_t header_timeout = 30;
+        /// Maximum time between two reads of a request body
+        uint32_t body_timeout = 60;
+    };
+
+    /// Listening socket settings
+    struct ListenOptions {
+        /// Open a listening socket with SO_REUSEPORT for each I/O loop, so that the kernel balances the connections between them.
+        /// Only effective on Linux, other platforms do not balance reused ports
+        bool reuse_port = false;
+        /// Seconds during which an accepted connection is not reported until data arrives (TCP_DEFER_ACCEPT), 0 disables it, Linux only
+        uint32_t defer_accept = 0;
+        /// Maximum length of the queue of pending connections, 0 uses the system maximum
+        uint32_t backlog = 0;
+    };
+
+    /// Token bucket limiting the requests of each client
+    struct RateLimit {
+        /// Requests per second, 0 disables the limit
+        double rate = 0;
+        /// Requests a client may send at once before being limited to the rate
+        uint32_t burst = 1;
+    };
+
+    /// Admission of the requests, decided once the header is received so that the body of a rejected request is never parsed.
+    /// Limited clients are answered with 429 and overload is answered with 503, both with Retry-After
+    struct AdmissionOptions {
+        /// Limit of each client address over all the URIs
+        RateLimit client;
+        /// Limits of each client address on the URIs starting with a prefix, only the longest matching prefix applies
+        std::unordered_map<std::string, RateLimit> routes;
+        /// Requests handled at once, from the end of their header to the start of their response, 0 disables it
+        size_t max_in_flight = 0;
+        /// Milliseconds servlet tasks may wait in the worker pool while it is still queueing, 0 disables it
+        uint32_t max_queue_delay = 0;
+    };
+
+    /// Settings of a service
+    struct Options {
+        /// Keepalive duration in seconds
+        uint32_t keepalive = 5;
+        /// Number of I/O loops, each loop runs on its own thread
+        size_t threads = 1;
+        /// Number of threads executing asynchronous servlets, 0 means they are executed on the I/O loops
+        size_t worker_threads = 0;
+        /// Maximum number of queued servlet tasks, requests beyond it are answered with 503
+        size_t worker_queue_size = 1024;
+        /// Maximum number of cached static files, 0 disables the cache
+        size_t file_cache_size = 128;
+        CompressionOptions compression;
+        Http2Options http2;
+        TimeoutOptions timeouts;
+        ListenOptions listen;
+        AdmissionOptions admission;
+        /// Null if the requests are not logged
+        AccessLog::Ptr access_log;
+    };
 
     static HttpService::Ptr create(
             const net::IPAddress::Ptr &address,
             SSLContextPtr ssl_context,
-            uint32_t keepalive,
+            const Options &options,
             std::string &serv_name,
             MountPointMap &mount_points,
             ServletMap &servlets,
+            WebsocketMap &websockets,
             FilterCallback &tail_filter,
             FilterMap &filters,
             ConnectionCallback &connection_callback
@@ -56,10 +153,11 @@ protected:
     HttpService(
             net::IPAddress::Ptr address,
             SSLContextPtr ssl_context,
-            uint32_t keepalive,
+            const Options &options,
             std::string &serv_name,
             MountPointMap &mount_points,
             ServletMap &servlets,
+            WebsocketMap &websockets,
             FilterCallback &tail_filter,
             FilterMap &filters,
             ConnectionCallback &connection_callback
@@ -67,11 +165,27 @@ protected:
 
     net::IPAddress::Ptr address;
     SSLContextPtr ssl_context;
-    Thread::Ptr thread;
     uint32_t keepalive = 30;
+    /// Number of I/O loops, each loop runs on its own thread
+    size_t threads = 1;
+    /// Number of threads executing asynchronous servlets, 0 means they are executed on the I/O loops
+    size_t worker_threads = 0;
+    /// Maximum number of queued servlet tasks, requests beyond it are answered with 503
+    size_t worker_queue_size = 0;
+    /// Maximum number of cached static files, 0 disables the cache
+    size_t file_cache_size = 0;
+    CompressionOptions compression;
+    Http2Options http2;
+    TimeoutOptions timeouts;
+    ListenOptions listen;
+    AdmissionOptions admission;
+    /// Null if the requests are not logged
+    AccessLog::Ptr access_log;
     std::string &serv_name;
     MountPointMap &mount_points;
     ServletMap &servlets;
+    /// Routes upgraded to websockets, matched like the servlets
+    WebsocketMap &websockets;
     FilterCallback &tail_filter;
     FilterMap &filters;
     ConnectionCallback &connection_callback;
@@ -0,0 +1,22 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/service/http/WebsocketSession.h>
+
+void sese::service::http::WebsocketSession::broadcast(const std::vector<Ptr> &sessions, net::ws::Opcode opcode, const void *data, size_t length) {
+    auto frame = net::ws::WebsocketFrame::make(opcode, data, length);
+    for (auto &&session: sessions) {
+        session->send(frame);
+    }
+}
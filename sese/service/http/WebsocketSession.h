@@ -0,0 +1,96 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// @file WebsocketSession.h
+/// @brief Server side websocket session
+/// @author kaoru
+/// @date October 17, 2026
+
+#pragma once
+
+#include <sese/net/ws/WebsocketFrame.h>
+#include <sese/net/http/Request.h>
+#include <sese/net/http/Router.h>
+#include <sese/net/IPAddress.h>
+
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace sese::service::http {
+
+/// A websocket connection upgraded from an HTTP/1.1 request, it runs on the I/O loop that accepted the request
+class WebsocketSession {
+public:
+    using Ptr = std::shared_ptr<WebsocketSession>;
+
+    virtual ~WebsocketSession() = default;
+
+    /// Queue a serialized frame. The same frame may be sent to any number of sessions without being copied
+    /// @note Thread safe, the frame is written by the I/O loop of the session
+    /// @param frame Frame created by net::ws::WebsocketFrame::make
+    virtual void send(const net::ws::WebsocketFrame::Ptr &frame) = 0;
+
+    /// Send a text message in a single frame
+    /// @param text Text encoded in UTF-8
+    void sendText(std::string_view text) {
+        send(net::ws::WebsocketFrame::make(net::ws::Opcode::TEXT, text.data(), text.length()));
+    }
+
+    /// Send a binary message in a single frame
+    /// @param data Payload
+    /// @param length Size of the payload
+    void sendBinary(const void *data, size_t length) {
+        send(net::ws::WebsocketFrame::make(net::ws::Opcode::BINARY, data, length));
+    }
+
+    /// Start the closing handshake, the frames queued before are still sent
+    /// @note Thread safe
+    /// @param code Status code
+    /// @param reason Reason, truncated to 123 bytes
+    virtual void close(uint16_t code = 1000, const std::string &reason = {}) = 0;
+
+    /// Get the upgrade request
+    [[nodiscard]] virtual const net::http::Request &getRequest() const = 0;
+
+    /// Get the path parameters captured by the route
+    [[nodiscard]] virtual const net::http::Router::Params &getPathArgs() const = 0;
+
+    [[nodiscard]] virtual net::IPAddress::Ptr getRemoteAddress() const = 0;
+
+    /// Serialize a message once and queue the same frame to every session
+    /// @param sessions Receivers
+    /// @param opcode TEXT or BINARY
+    /// @param data Payload
+    /// @param length Size of the payload
+    static void broadcast(const std::vector<Ptr> &sessions, net::ws::Opcode opcode, const void *data, size_t length);
+};
+
+/// Callbacks of a websocket route, they are invoked on the I/O loop of the session and must not block
+struct WebsocketHandler {
+    using OpenCallback = std::function<void(const WebsocketSession::Ptr &session)>;
+    /// A message is delivered in parts as it is received, each fragment or the part of a frame that has arrived,
+    /// so that it is never reassembled. The data is unmasked in the receive buffer and is only valid during the call
+    using MessageCallback = std::function<void(const WebsocketSession::Ptr &session, net::ws::Opcode opcode, const char *data, size_t length, bool last)>;
+    /// Called once, the code is 1006 if the connection was lost without a close frame
+    using CloseCallback = std::function<void(const WebsocketSession::Ptr &session, uint16_t code)>;
+
+    OpenCallback on_open;
+    MessageCallback on_message;
+    CloseCallback on_close;
+    /// Close the sessions that receive nothing for this many seconds, 0 disables it
+    uint32_t idle_timeout = 0;
+};
+
+} // namespace sese::service::http
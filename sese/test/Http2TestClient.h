@@ -0,0 +1,175 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <sese/io/ByteBuilder.h>
+#include <sese/io/InputBufferWrapper.h>
+#include <sese/net/Address.h>
+#include <sese/net/http/DynamicTable.h>
+#include <sese/net/http/HPackUtil.h>
+#include <sese/net/http/Http2Frame.h>
+#include <sese/security/SSLContextBuilder.h>
+#include <sese/security/SecuritySocket.h>
+#include <sese/util/Endian.h>
+
+#include <openssl/ssl.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Minimal HTTP 2 client exchanging raw frames with the server under test.
+/// Reads fail after a few seconds without data instead of blocking the test
+class Http2TestClient {
+public:
+    struct Frame {
+        uint8_t type = 0;
+        uint8_t flags = 0;
+        uint32_t ident = 0;
+        std::string payload;
+    };
+
+    /// Connect, negotiate h2 and send the preface with the settings
+    /// @param port Port of the server on localhost
+    /// @param settings Identifiers and values of the SETTINGS frame
+    /// @return false if the connection or the handshake failed
+    bool connect(uint16_t port, const std::vector<std::pair<uint16_t, uint32_t>> &settings = {}) {
+        context = sese::security::SSLContextBuilder::SSL4Client();
+        constexpr unsigned char ALPN[] = {2, 'h', '2'};
+        SSL_CTX_set_alpn_protos(static_cast<SSL_CTX *>(context->getContext()), ALPN, sizeof(ALPN));
+        socket = std::make_unique<sese::security::SecuritySocket>(context, sese::net::Socket::Family::IPv4, IPPROTO_IP);
+#ifdef _WIN32
+        DWORD timeout = 5000;
+#else
+        timeval timeout{5, 0};
+#endif
+        setsockopt(socket->getRawSocket(), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+        if (socket->connect(sese::net::IPv4Address::localhost(port)) != 0) {
+            return false;
+        }
+        std::string preface = sese::net::http::MAGIC_STRING;
+        if (socket->write(preface.data(), preface.size()) != static_cast<int64_t>(preface.size())) {
+            return false;
+        }
+        std::string payload;
+        for (auto &&[key, value]: settings) {
+            auto big_key = ToBigEndian16(key);
+            auto big_value = ToBigEndian32(value);
+            payload.append(reinterpret_cast<const char *>(&big_key), 2);
+            payload.append(reinterpret_cast<const char *>(&big_value), 4);
+        }
+        return writeFrame(sese::net::http::FRAME_TYPE_SETTINGS, 0, 0, payload);
+    }
+
+    bool writeFrame(uint8_t type, uint8_t flags, uint32_t ident, const std::string &payload = {}) {
+        char header[9];
+        auto length = ToBigEndian32(static_cast<uint32_t>(payload.size()));
+        memcpy(header, reinterpret_cast<const char *>(&length) + 1, 3);
+        header[3] = static_cast<char>(type);
+        header[4] = static_cast<char>(flags);
+        ident = ToBigEndian32(ident);
+        memcpy(header + 5, &ident, 4);
+        auto frame = std::string(header, 9) + payload;
+        return socket->write(frame.data(), frame.size()) == static_cast<int64_t>(frame.size());
+    }
+
+    /// Send the fields in one HEADERS frame
+    bool writeHeaders(uint32_t ident, sese::net::http::Header header, bool end_stream) {
+        sese::io::ByteBuilder buffer;
+        auto size = sese::net::http::HPackUtil::encode(&buffer, encoder, header);
+        std::string payload(size, '\0');
+        buffer.read(payload.data(), size);
+        auto flags = sese::net::http::FRAME_FLAG_END_HEADERS | (end_stream ? sese::net::http::FRAME_FLAG_END_STREAM : 0);
+        return writeFrame(sese::net::http::FRAME_TYPE_HEADERS, static_cast<uint8_t>(flags), ident, payload);
+    }
+
+    /// Send a GET request without a body
+    bool get(uint32_t ident, const std::string &path) {
+        return writeHeaders(ident, {{":method", "GET"}, {":scheme", "https"}, {":path", path}, {":authority", "localhost"}}, true);
+    }
+
+    bool writeWindowUpdate(uint32_t ident, uint32_t increment) {
+        increment = ToBigEndian32(increment);
+        return writeFrame(sese::net::http::FRAME_TYPE_WINDOW_UPDATE, 0, ident, std::string(reinterpret_cast<const char *>(&increment), 4));
+    }
+
+    /// Read the next frame, the SETTINGS of the server are acknowledged
+    /// @return false if the connection was closed or nothing arrived in time
+    bool readFrame(Frame &frame) {
+        char header[9];
+        if (!readExactly(header, 9)) {
+            return false;
+        }
+        uint32_t length = 0;
+        memcpy(reinterpret_cast<char *>(&length) + 1, header, 3);
+        frame.type = static_cast<uint8_t>(header[3]);
+        frame.flags = static_cast<uint8_t>(header[4]);
+        memcpy(&frame.ident, header + 5, 4);
+        frame.ident = FromBigEndian32(frame.ident) & 0x7fffffff;
+        frame.payload.resize(FromBigEndian32(length));
+        if (!readExactly(frame.payload.data(), frame.payload.size())) {
+            return false;
+        }
+        if (frame.type == sese::net::http::FRAME_TYPE_SETTINGS && !(frame.flags & sese::net::http::SETTINGS_FLAGS_ACK)) {
+            writeFrame(sese::net::http::FRAME_TYPE_SETTINGS, sese::net::http::SETTINGS_FLAGS_ACK, 0);
+        }
+        return true;
+    }
+
+    /// Decode the payload of a HEADERS frame
+    sese::net::http::Header decode(const std::string &payload) {
+        sese::net::http::Header header;
+        sese::io::InputBufferWrapper input(payload.data(), payload.size());
+        sese::net::http::HPackUtil::decode(&input, payload.size(), decoder, header, true);
+        return header;
+    }
+
+    /// @return The 32-bit value at the offset of a payload
+    static uint32_t readUint32(const std::string &payload, size_t offset = 0) {
+        uint32_t value;
+        memcpy(&value, payload.data() + offset, 4);
+        return FromBigEndian32(value);
+    }
+
+    void close() {
+        if (socket) {
+            socket->close();
+            socket.reset();
+        }
+    }
+
+    ~Http2TestClient() {
+        close();
+    }
+
+private:
+    bool readExactly(char *buffer, size_t length) {
+        while (length) {
+            auto len = socket->read(buffer, length);
+            if (len <= 0) {
+                return false;
+            }
+            buffer += len;
+            length -= len;
+        }
+        return true;
+    }
+
+    std::shared_ptr<sese::security::SSLContext> context;
+    std::unique_ptr<sese::security::SecuritySocket> socket;
+    sese::net::http::DynamicTable encoder;
+    sese::net::http::DynamicTable decoder;
+};
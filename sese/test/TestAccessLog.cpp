@@ -0,0 +1,181 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/Socket.h>
+#include <sese/net/http/RequestHeader.h>
+#include <sese/service/http/AccessLog.h>
+#include <sese/service/http/HttpServer.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using sese::service::http::AccessLog;
+
+static AccessLog::Record makeRecord() {
+    AccessLog::Record record{};
+    // 2023-11-14 22:13:20.123 UTC
+    record.timestamp = 1700000000123000;
+    record.latency = 1500;
+    record.bytes = 5;
+    record.status = 200;
+    record.method = static_cast<uint8_t>(sese::net::http::RequestType::GET);
+    record.version = static_cast<uint8_t>(sese::net::http::HttpVersion::VERSION_1_1);
+    record.family = AF_INET;
+    record.address[0] = 127;
+    record.address[3] = 1;
+    AccessLog::Record::copy(record.uri, record.uri_length, "/hello/\"a\"");
+    AccessLog::Record::copy(record.user_agent, record.user_agent_length, "curl/8.0");
+    return record;
+}
+
+static std::string readFile(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    std::stringstream stream;
+    stream << input.rdbuf();
+    return stream.str();
+}
+
+TEST(TestAccessLog, Combined) {
+    auto record = makeRecord();
+    std::string line;
+    AccessLog::format(record, "/hello/{name}", AccessLog::Format::COMBINED, line);
+    EXPECT_EQ(line, "127.0.0.1 - - [14/Nov/2023:22:13:20 +0000] \"GET /hello/\\x22a\\x22 HTTP/1.1\" 200 5 \"-\" \"curl/8.0\"\n");
+
+    record.bytes = -1;
+    line.clear();
+    AccessLog::format(record, "", AccessLog::Format::COMBINED, line);
+    EXPECT_NE(line.find("\" 200 - \"-\""), std::string::npos);
+}
+
+TEST(TestAccessLog, Json) {
+    auto record = makeRecord();
+    AccessLog::Record::copy(record.referer, record.referer_length, "a\nb");
+    std::string line;
+    AccessLog::format(record, "/hello/{name}", AccessLog::Format::JSON, line);
+    EXPECT_EQ(line.find("{\"time\":\"2023-11-14T22:13:20.123Z\",\"remote\":\"127.0.0.1\",\"method\":\"GET\",\"uri\":\"/hello/\\\"a\\\"\""), 0);
+    EXPECT_NE(line.find(",\"status\":200,\"bytes\":5,\"route\":\"/hello/{name}\",\"latency_us\":1500,\"referer\":\"a\\u000ab\",\"user_agent\":\"curl/8.0\"}\n"), std::string::npos);
+}
+
+TEST(TestAccessLog, Truncate) {
+    AccessLog::Record record{};
+    AccessLog::Record::copy(record.uri, record.uri_length, std::string(1000, 'a'));
+    EXPECT_EQ(record.uri_length, sizeof(record.uri));
+}
+
+TEST(TestAccessLog, Drop) {
+    auto path = (std::filesystem::temp_directory_path() / "sese_access_log_drop.log").string();
+    std::filesystem::remove(path);
+    AccessLog::Options options;
+    options.ring_size = 4;
+    options.flush_interval = 60 * 1000;
+    {
+        auto log = AccessLog::create(path, options);
+        ASSERT_NE(log, nullptr);
+        auto record = makeRecord();
+        size_t committed = 0;
+        for (int i = 0; i < 10; ++i) {
+            auto slot = log->begin();
+            if (slot) {
+                *slot = record;
+                log->commit();
+                committed += 1;
+            }
+        }
+        EXPECT_EQ(committed, 4);
+        EXPECT_EQ(log->getDropped(), 6);
+    }
+    auto text = readFile(path);
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 4);
+    std::filesystem::remove(path);
+}
+
+TEST(TestAccessLog, Rotate) {
+    auto path = (std::filesystem::temp_directory_path() / "sese_access_log_rotate.log").string();
+    for (auto &&name: {path, path + ".1", path + ".2", path + ".3"}) {
+        std::filesystem::remove(name);
+    }
+    AccessLog::Options options;
+    options.max_size = 1;
+    options.max_files = 2;
+    options.flush_interval = 10;
+    {
+        auto log = AccessLog::create(path, options);
+        ASSERT_NE(log, nullptr);
+        for (int i = 0; i < 4; ++i) {
+            auto slot = log->begin();
+            ASSERT_NE(slot, nullptr);
+            *slot = makeRecord();
+            log->commit();
+            // Each write exceeds the size and rotates the file
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        EXPECT_EQ(log->getWritten(), 4);
+    }
+    EXPECT_TRUE(std::filesystem::exists(path));
+    EXPECT_TRUE(std::filesystem::exists(path + ".1"));
+    EXPECT_TRUE(std::filesystem::exists(path + ".2"));
+    EXPECT_FALSE(std::filesystem::exists(path + ".3"));
+    for (auto &&name: {path, path + ".1", path + ".2"}) {
+        std::filesystem::remove(name);
+    }
+}
+
+TEST(TestAccessLog, HttpServer) {
+    auto path = (std::filesystem::temp_directory_path() / "sese_access_log_server.log").string();
+    std::filesystem::remove(path);
+    AccessLog::Options options;
+    options.format = AccessLog::Format::JSON;
+    auto log = AccessLog::create(path, options);
+    ASSERT_NE(log, nullptr);
+
+    std::random_device device;
+    auto port = static_cast<uint16_t>(device() % 20000 + 30000);
+    {
+        sese::service::http::HttpServer server;
+        sese::net::http::Servlet hello(sese::net::http::RequestType::GET, "/greet/{name}");
+        hello = [](sese::net::http::HttpServletContext &ctx) {
+            ctx.getResp().getBody().write("hello", 5);
+        };
+        server.regServlet(hello);
+        server.setAccessLog(log);
+        server.regService(sese::net::IPv4Address::localhost(port), nullptr);
+        ASSERT_TRUE(server.startup());
+
+        for (auto &&uri: {"/greet/a", "/missing"}) {
+            auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+            ASSERT_EQ(client.connect(sese::net::IPv4Address::localhost(port)), 0);
+            auto text = std::string("GET ") + uri + " HTTP/1.1\r\nhost: localhost\r\nuser-agent: test\r\nconnection: close\r\n\r\n";
+            client.write(text.data(), text.length());
+            char buffer[1024];
+            while (client.read(buffer, sizeof(buffer)) > 0) {
+            }
+            client.close();
+        }
+        server.shutdown();
+    }
+    // Written by the background thread before it exits
+    log = nullptr;
+
+    auto text = readFile(path);
+    EXPECT_NE(text.find("\"remote\":\"127.0.0.1\",\"method\":\"GET\",\"uri\":\"/greet/a\",\"protocol\":\"HTTP/1.1\",\"status\":200,\"bytes\":5,\"route\":\"/greet/{name}\""), std::string::npos);
+    EXPECT_NE(text.find("\"uri\":\"/missing\",\"protocol\":\"HTTP/1.1\",\"status\":404,\"bytes\":0,\"route\":null"), std::string::npos);
+    EXPECT_NE(text.find("\"user_agent\":\"test\"}\n"), std::string::npos);
+    std::filesystem::remove(path);
+}
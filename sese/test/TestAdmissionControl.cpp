@@ -0,0 +1,145 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/Socket.h>
+#include <sese/service/http/HttpServer.h>
+#include <sese/util/RateLimiter.h>
+
+#include <random>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+TEST(TestRateLimiter, Burst) {
+    sese::RateLimiter limiter(1, 3);
+    uint64_t retry_after = 0;
+    EXPECT_TRUE(limiter.tryAcquire("a"));
+    EXPECT_TRUE(limiter.tryAcquire("a"));
+    EXPECT_TRUE(limiter.tryAcquire("a"));
+    EXPECT_FALSE(limiter.tryAcquire("a", &retry_after));
+    EXPECT_GT(retry_after, 0);
+    EXPECT_LE(retry_after, 1000000);
+    // The other keys have their own buckets
+    EXPECT_TRUE(limiter.tryAcquire("b"));
+}
+
+TEST(TestRateLimiter, Refill) {
+    sese::RateLimiter limiter(100, 1);
+    EXPECT_TRUE(limiter.tryAcquire("a"));
+    EXPECT_FALSE(limiter.tryAcquire("a"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(limiter.tryAcquire("a"));
+}
+
+TEST(TestRateLimiter, Concurrent) {
+    sese::RateLimiter limiter(0.001, 1000);
+    std::atomic<int> acquired{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 1000; ++j) {
+                if (limiter.tryAcquire(uint64_t{42})) {
+                    acquired += 1;
+                }
+            }
+        });
+    }
+    for (auto &&thread: threads) {
+        thread.join();
+    }
+    EXPECT_EQ(acquired, 1000);
+}
+
+TEST(TestRateLimiter, Capacity) {
+    sese::RateLimiter limiter(0.001, 1, 16);
+    EXPECT_EQ(limiter.getCapacity(), 16);
+    // More keys than slots, the limited keys are replaced by the new ones
+    for (uint64_t key = 1; key <= 1000; ++key) {
+        EXPECT_TRUE(limiter.tryAcquire(key));
+    }
+    EXPECT_FALSE(limiter.tryAcquire(uint64_t{1000}));
+}
+
+static std::string request(uint16_t port, const std::string &uri) {
+    auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    std::string response;
+    if (client.connect(sese::net::IPv4Address::localhost(port)) != 0) {
+        return response;
+    }
+    auto text = "GET " + uri + " HTTP/1.1\r\nhost: localhost\r\nconnection: close\r\n\r\n";
+    client.write(text.data(), text.length());
+    char buffer[4096];
+    int64_t length;
+    while ((length = client.read(buffer, sizeof(buffer))) > 0) {
+        response.append(buffer, length);
+    }
+    client.close();
+    return response;
+}
+
+TEST(TestAdmissionControl, RateLimit) {
+    std::random_device device;
+    auto port = static_cast<uint16_t>(device() % 20000 + 30000);
+    sese::service::http::HttpServer server;
+    sese::net::http::Servlet hello(sese::net::http::RequestType::GET, "/hello");
+    hello = [](sese::net::http::HttpServletContext &ctx) {
+        ctx.getResp().getBody().write("hello", 5);
+    };
+    server.regServlet(hello);
+    sese::net::http::Servlet login(sese::net::http::RequestType::GET, "/api/login");
+    login = [](sese::net::http::HttpServletContext &) {};
+    server.regServlet(login);
+    server.setRateLimit(0.01, 4);
+    server.regRateLimit("/api/", 0.01, 1);
+    server.regService(sese::net::IPv4Address::localhost(port), nullptr);
+    ASSERT_TRUE(server.startup());
+
+    EXPECT_EQ(request(port, "/api/login").find("HTTP/1.1 200"), 0);
+    // The route allows a single request
+    auto limited = request(port, "/api/login");
+    EXPECT_EQ(limited.find("HTTP/1.1 429"), 0);
+    EXPECT_NE(limited.find("retry-after: "), std::string::npos);
+    // The client allows four requests, one of them was rejected by the route
+    EXPECT_EQ(request(port, "/hello").find("HTTP/1.1 200"), 0);
+    EXPECT_EQ(request(port, "/hello").find("HTTP/1.1 200"), 0);
+    EXPECT_EQ(request(port, "/hello").find("HTTP/1.1 429"), 0);
+    server.shutdown();
+}
+
+TEST(TestAdmissionControl, LoadShedding) {
+    std::random_device device;
+    auto port = static_cast<uint16_t>(device() % 20000 + 30000);
+    sese::service::http::HttpServer server;
+    sese::net::http::Servlet slow(sese::net::http::RequestType::GET, "/slow");
+    slow = [](sese::net::http::HttpServletContext &) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    };
+    slow.setAsync(true);
+    server.regServlet(slow);
+    server.setWorkerPool(2);
+    server.setLoadShedding(1);
+    server.regService(sese::net::IPv4Address::localhost(port), nullptr);
+    ASSERT_TRUE(server.startup());
+
+    std::string first;
+    std::thread thread([&first, port] { first = request(port, "/slow"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto second = request(port, "/slow");
+    thread.join();
+    EXPECT_EQ(first.find("HTTP/1.1 200"), 0);
+    EXPECT_EQ(second.find("HTTP/1.1 503"), 0);
+    // Admitted again once the first request is answered
+    EXPECT_EQ(request(port, "/slow").find("HTTP/1.1 200"), 0);
+    server.shutdown();
+}
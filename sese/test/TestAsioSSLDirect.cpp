@@ -0,0 +1,151 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/net/AsioSSLDirect.h>
+#include <sese/security/SSLContextBuilder.h>
+#include <sese/security/SecuritySocket.h>
+#include <sese/net/AddressPool.h>
+#include <sese/net/Socket.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+
+using sese::internal::net::AsioSSLDirect;
+
+/// A loopback TLS connection whose server stream is attached to its socket
+class TestAsioSSLDirect : public testing::Test {
+public:
+    /// Larger than the write budget, so that the writes take several turns of the loop
+    static constexpr size_t BODY_SIZE = AsioSSLDirect::WRITE_BUDGET + 2 * 1024 * 1024;
+
+    asio::io_context io_context;
+    asio::ssl::context ssl_context{asio::ssl::context::tls_server};
+    std::shared_ptr<AsioSSLDirect::Stream> stream;
+    std::thread client;
+    std::promise<std::string> received;
+
+    static char pattern(size_t i) {
+        return static_cast<char>(i * 7);
+    }
+
+    void SetUp() override {
+        ssl_context.use_certificate_chain_file(PROJECT_PATH "/sese/test/Data/test-ca.crt");
+        ssl_context.use_private_key_file(PROJECT_PATH "/sese/test/Data/test-key.pem", asio::ssl::context::pem);
+
+        asio::ip::tcp::acceptor acceptor(io_context, {asio::ip::address_v4::loopback(), 0});
+        auto port = acceptor.local_endpoint().port();
+        // The client reads until close_notify
+        client = std::thread([this, port] {
+            auto client_ctx = sese::security::SSLContextBuilder::SSL4Client();
+            auto socket = sese::security::SecuritySocket(client_ctx, sese::net::Socket::Family::IPv4, IPPROTO_IP);
+            std::string data;
+            if (socket.connect(sese::net::IPv4Address::localhost(port)) == 0) {
+                char buffer[65536];
+                int64_t length;
+                while ((length = socket.read(buffer, sizeof(buffer))) > 0) {
+                    data.append(buffer, length);
+                }
+            }
+            socket.close();
+            received.set_value(std::move(data));
+        });
+
+        stream = std::make_shared<AsioSSLDirect::Stream>(io_context, ssl_context);
+        acceptor.accept(stream->next_layer());
+        ASSERT_TRUE(AsioSSLDirect::attach(*stream));
+        ASSERT_TRUE(AsioSSLDirect::isAttached(*stream));
+        asio::error_code error;
+        error = stream->handshake(asio::ssl::stream_base::server, error);
+        ASSERT_FALSE(error) << error.message();
+    }
+
+    void TearDown() override {
+        asio::error_code ignored;
+        ignored = stream->lowest_layer().close(ignored);
+        if (client.joinable()) {
+            client.join();
+        }
+    }
+
+    /// Run the loop until the stream is closed, then compare what the client received
+    void finish(const std::string &expected) {
+        io_context.run();
+        auto data = received.get_future().get();
+        ASSERT_EQ(data.size(), expected.size());
+        EXPECT_TRUE(data == expected);
+    }
+
+    void close(const asio::error_code &error) const {
+        EXPECT_FALSE(error) << error.message();
+        AsioSSLDirect::shutdown(*stream);
+        asio::error_code ignored;
+        ignored = stream->lowest_layer().close(ignored);
+    }
+};
+
+TEST_F(TestAsioSSLDirect, Write) {
+    std::string body(BODY_SIZE, '\0');
+    for (size_t i = 0; i < BODY_SIZE; ++i) {
+        body[i] = pattern(i);
+    }
+    bool done = false;
+    AsioSSLDirect::write(stream, body.data(), body.size(), [this, &done](const asio::error_code &error) {
+        done = true;
+        close(error);
+    });
+    // The client does not read fast enough for the whole body to be written at once
+    EXPECT_FALSE(done);
+    finish(body);
+    EXPECT_TRUE(done);
+}
+
+TEST_F(TestAsioSSLDirect, Buffers) {
+    std::string header = "header:";
+    std::string body(BODY_SIZE, 'x');
+    std::vector<asio::const_buffer> buffers{asio::buffer(header), asio::buffer(body), asio::buffer(header)};
+    AsioSSLDirect::write(stream, buffers, [this](const asio::error_code &error) {
+        close(error);
+    });
+    finish(header + body + header);
+}
+
+/// Without kTLS the file cannot be sent by the kernel, the caller reads it and writes it instead
+TEST_F(TestAsioSSLDirect, SendFileFallback) {
+    auto path = std::filesystem::temp_directory_path() / "sese_asio_ssl_direct.bin";
+    std::string content(BODY_SIZE, '\0');
+    for (size_t i = 0; i < BODY_SIZE; ++i) {
+        content[i] = pattern(i);
+    }
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(content.data(), static_cast<std::streamsize>(content.size()));
+
+    auto file = std::fopen(path.string().c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    auto offloaded = AsioSSLDirect::isOffloaded(*stream);
+    auto sent = AsioSSLDirect::sendFile(stream, fileno(file), 0, content.size(), [this](const asio::error_code &error) {
+        close(error);
+    });
+    EXPECT_EQ(sent, offloaded);
+    if (!sent) {
+        AsioSSLDirect::write(stream, content.data(), content.size(), [this](const asio::error_code &error) {
+            close(error);
+        });
+    }
+    finish(content);
+    std::fclose(file);
+    std::filesystem::remove(path);
+}
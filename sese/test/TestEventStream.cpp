@@ -0,0 +1,244 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Http2TestClient.h"
+
+#include <sese/net/AddressPool.h>
+#include <sese/net/Socket.h>
+#include <sese/net/http/EventTopic.h>
+#include <sese/service/http/HttpServer.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using sese::net::http::EventTopic;
+
+TEST(TestEventTopic, Serialize) {
+    auto event = EventTopic::serialize("first\r\nsecond\nthird", "tick", "7");
+    EXPECT_EQ(*event, "event: tick\nid: 7\ndata: first\ndata: second\ndata: third\n\n");
+    EXPECT_EQ(*EventTopic::serialize(""), "data: \n\n");
+}
+
+TEST(TestEventTopic, DropOldest) {
+    EventTopic topic(2);
+    auto subscriber = topic.subscribe();
+    int notified = 0;
+    subscriber->setNotifyCallback([&notified] { notified += 1; });
+    std::vector<EventTopic::Event> events;
+    // Only a waiting subscriber is notified
+    ASSERT_TRUE(subscriber->take(events));
+    EXPECT_TRUE(events.empty());
+    topic.publish("1");
+    topic.publish("2");
+    topic.publish("3");
+    EXPECT_EQ(notified, 1);
+    EXPECT_EQ(topic.getDroppedCount(), 1);
+
+    ASSERT_TRUE(subscriber->take(events));
+    ASSERT_EQ(events.size(), 2);
+    EXPECT_EQ(*events[0], "data: 2\n\n");
+    EXPECT_EQ(*events[1], "data: 3\n\n");
+
+    EXPECT_EQ(topic.getSubscriberCount(), 1);
+    subscriber = nullptr;
+    EXPECT_EQ(topic.getSubscriberCount(), 0);
+}
+
+TEST(TestEventTopic, Disconnect) {
+    EventTopic topic(2, EventTopic::OverflowPolicy::DISCONNECT);
+    auto slow = topic.subscribe();
+    auto fast = topic.subscribe();
+    std::vector<EventTopic::Event> events;
+    topic.publish("1");
+    topic.publish("2");
+    ASSERT_TRUE(fast->take(events));
+    topic.publish("3");
+    EXPECT_FALSE(slow->take(events));
+    ASSERT_TRUE(fast->take(events));
+    // The buffer of an event is shared by the subscribers
+    ASSERT_EQ(events.size(), 3);
+    EXPECT_EQ(*events[2], "data: 3\n\n");
+    EXPECT_EQ(topic.getDroppedCount(), 1);
+}
+
+class TestEventStreamServer : public testing::Test {
+public:
+    static uint16_t port;
+    static std::unique_ptr<sese::service::http::HttpServer> server;
+    static EventTopic::Ptr topic;
+
+    static void SetUpTestSuite() {
+        std::random_device device;
+        port = static_cast<uint16_t>(device() % 20000 + 30000);
+        topic = std::make_shared<EventTopic>();
+        server = std::make_unique<sese::service::http::HttpServer>();
+
+        sese::net::http::Servlet events(sese::net::http::RequestType::GET, "/events");
+        events = [](sese::net::http::HttpServletContext &ctx) {
+            // Sent before the events
+            ctx.getResp().getBody().write("retry: 1000\n\n", 13);
+            EXPECT_TRUE(ctx.subscribe(topic));
+            EXPECT_FALSE(ctx.subscribe(topic));
+        };
+        server->regServlet(events);
+        server->setThreads(2);
+        server->regService(sese::net::IPv4Address::localhost(port), nullptr);
+        ASSERT_TRUE(server->startup());
+    }
+
+    static void TearDownTestSuite() {
+        server->shutdown();
+        server = nullptr;
+        topic = nullptr;
+    }
+
+    /// Wait until the number of subscribers becomes the expected one
+    static bool waitForSubscribers(size_t count) {
+        for (int i = 0; i < 200; ++i) {
+            if (topic->getSubscriberCount() == count) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    /// Read until the data ends with the expected suffix
+    static bool readUntil(sese::net::Socket &client, std::string &data, const std::string &suffix) {
+        char buffer[1024];
+        while (data.length() < suffix.length() || data.compare(data.length() - suffix.length(), suffix.length(), suffix) != 0) {
+            auto length = client.read(buffer, sizeof(buffer));
+            if (length <= 0) {
+                return false;
+            }
+            data.append(buffer, length);
+        }
+        return true;
+    }
+};
+
+uint16_t TestEventStreamServer::port = 0;
+std::unique_ptr<sese::service::http::HttpServer> TestEventStreamServer::server;
+EventTopic::Ptr TestEventStreamServer::topic;
+
+TEST_F(TestEventStreamServer, Http1) {
+    std::vector<std::unique_ptr<sese::net::Socket>> clients;
+    for (int i = 0; i < 2; ++i) {
+        auto &&client = *clients.emplace_back(std::make_unique<sese::net::Socket>(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP));
+        ASSERT_EQ(client.connect(sese::net::IPv4Address::localhost(port)), 0);
+        std::string request = "GET /events HTTP/1.1\r\nhost: localhost\r\nconnection: keep-alive\r\n\r\n";
+        client.write(request.data(), request.length());
+        std::string data;
+        ASSERT_TRUE(readUntil(client, data, "retry: 1000\n\n"));
+        EXPECT_EQ(data.find("HTTP/1.1 200"), 0);
+        EXPECT_NE(data.find("content-type: text/event-stream"), std::string::npos);
+        EXPECT_NE(data.find("connection: close"), std::string::npos);
+        EXPECT_EQ(data.find("content-length"), std::string::npos);
+    }
+    ASSERT_TRUE(waitForSubscribers(2));
+
+    topic->publish("hello", "greeting", "1");
+    topic->publish("line 1\nline 2", "", "2");
+    for (auto &&client: clients) {
+        std::string data;
+        ASSERT_TRUE(readUntil(*client, data, "id: 2\ndata: line 1\ndata: line 2\n\n"));
+        EXPECT_EQ(data, "event: greeting\nid: 1\ndata: hello\n\nid: 2\ndata: line 1\ndata: line 2\n\n");
+    }
+
+    // Disconnected clients are unsubscribed without another event being published
+    clients.front()->close();
+    EXPECT_TRUE(waitForSubscribers(1));
+    clients.back()->close();
+    EXPECT_TRUE(waitForSubscribers(0));
+}
+
+/// Events larger than the window of the stream are split, a stream overflowing its subscription is ended
+TEST(TestEventStreamHttp2, Overflow) {
+    using namespace sese::net::http;
+    auto topic = std::make_shared<EventTopic>(2, EventTopic::OverflowPolicy::DISCONNECT);
+    auto ssl = sese::security::SSLContextBuilder::UniqueSSL4Server();
+    ASSERT_TRUE(ssl->importCertFile(PROJECT_PATH "/sese/test/Data/test-ca.crt"));
+    ASSERT_TRUE(ssl->importPrivateKeyFile(PROJECT_PATH "/sese/test/Data/test-key.pem"));
+    auto port = sese::net::createRandomPort();
+    sese::service::http::HttpServer server;
+    Servlet events(RequestType::GET, "/events");
+    events = [topic](HttpServletContext &ctx) {
+        EXPECT_TRUE(ctx.subscribe(topic));
+    };
+    server.regServlet(events);
+    server.regService(sese::net::IPv4Address::localhost(port), std::move(ssl));
+    ASSERT_TRUE(server.startup());
+
+    Http2TestClient client;
+    ASSERT_TRUE(client.connect(port));
+    ASSERT_TRUE(client.get(1, "/events"));
+    Http2TestClient::Frame frame;
+    do {
+        ASSERT_TRUE(client.readFrame(frame));
+    } while (frame.type != FRAME_TYPE_HEADERS);
+    auto header = client.decode(frame.payload);
+    EXPECT_EQ(header.get(":status"), "200");
+    EXPECT_EQ(header.get("content-type"), "text/event-stream");
+    EXPECT_FALSE(frame.flags & FRAME_FLAG_END_STREAM);
+    for (int i = 0; i < 200 && topic->getSubscriberCount() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(topic->getSubscriberCount(), 1);
+
+    // Sent up to the initial windows of the client
+    auto event = EventTopic::serialize(std::string(100000, 'a'));
+    topic->publish(event);
+    std::string data;
+    while (data.length() < 65535) {
+        ASSERT_TRUE(client.readFrame(frame));
+        if (frame.type != FRAME_TYPE_DATA) {
+            continue;
+        }
+        EXPECT_EQ(frame.ident, 1);
+        EXPECT_LE(frame.payload.length(), 16384);
+        EXPECT_FALSE(frame.flags & FRAME_FLAG_END_STREAM);
+        data += frame.payload;
+    }
+    ASSERT_EQ(data.length(), 65535);
+
+    // The stalled subscriber overflows, the events already taken are still sent
+    topic->publish("b");
+    topic->publish("c");
+    topic->publish("d");
+    EXPECT_EQ(topic->getDroppedCount(), 1);
+    ASSERT_TRUE(client.writeWindowUpdate(0, 100000));
+    ASSERT_TRUE(client.writeWindowUpdate(1, 100000));
+    while (true) {
+        ASSERT_TRUE(client.readFrame(frame));
+        if (frame.type != FRAME_TYPE_DATA) {
+            continue;
+        }
+        data += frame.payload;
+        if (frame.flags & FRAME_FLAG_END_STREAM) {
+            break;
+        }
+    }
+    EXPECT_TRUE(data == *event);
+    EXPECT_TRUE(frame.payload.empty());
+
+    client.close();
+    for (int i = 0; i < 200 && topic->getSubscriberCount() != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(topic->getSubscriberCount(), 0);
+    server.shutdown();
+}
@@ -118,6 +118,44 @@ TEST(TestHttp, Header_misc) {
     EXPECT_TRUE(header.empty());
 }
 
+TEST(TestHttp, Header_flat) {
+    using namespace sese::net::http;
+
+    Header header;
+    header.set("X-Request-Identifier-Long", "1");
+    header.set("content-type", "text/plain");
+    header.set("Accept", "*/*");
+    header.set("x-request-identifier-LONG", "2");
+    ASSERT_EQ(header.size(), 3);
+
+    // In the order they were set, the first spelling of a name is kept
+    std::vector<std::string> names;
+    for (auto &[name, value]: header) {
+        names.emplace_back(name);
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"X-Request-Identifier-Long", "content-type", "Accept"}));
+    EXPECT_EQ(header.get("X-REQUEST-IDENTIFIER-LONG", ""), "2");
+    EXPECT_EQ(header.get("Content-Type", ""), "text/plain");
+    EXPECT_THROW(header.get("Content-Length"), std::out_of_range);
+
+    EXPECT_EQ(header.getNameIndex(header.find("ACCEPT")), 19);
+    EXPECT_EQ(header.getNameIndex(header.find("Content-Type")), 31);
+    EXPECT_EQ(header.getNameIndex(header.find("x-request-identifier-long")), 0);
+
+    EXPECT_TRUE(Header::equalName("Strict-Transport-Security", "strict-transport-securitY"));
+    EXPECT_FALSE(Header::equalName("Strict-Transport-Security", "strict-transport-securitx"));
+    EXPECT_FALSE(Header::equalName("Strict-Transport-Security@", "strict-transport-security`"));
+    EXPECT_EQ(Header::hashName("Content-Length"), Header::hashName("content-length"));
+
+    header.clear();
+    EXPECT_TRUE(header.empty());
+    EXPECT_EQ(header.find("accept"), header.end());
+    header.set("Host", "localhost");
+    ASSERT_EQ(header.size(), 1);
+    EXPECT_EQ(header.begin()->first, "Host");
+    EXPECT_EQ(header.getNameIndex(header.begin()), 38);
+}
+
 /// Illegal HTTP header ending
 TEST(TestHttpUtil, GetLine_0) {
     auto str = "GET / HTTP/1.1";
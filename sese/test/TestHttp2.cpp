@@ -47,16 +47,45 @@ void showDynamicTable(const auto &table) noexcept {
 }
 
 TEST(TestHttp2, DynamicTable_0) {
-    sese::net::http::DynamicTable table(15);
+    // Each entry takes 32 bytes in addition to its name and value
+    sese::net::http::DynamicTable table(40);
     table.set("k1", "v1");
     table.set("k2", "v2");
     EXPECT_TRUE(table.getCount() == 1);
-    EXPECT_TRUE(table.getSize() == 8);
+    EXPECT_TRUE(table.getSize() == 36);
     auto item = table.get(62);
     ASSERT_TRUE(item != std::nullopt);
     EXPECT_TRUE(item->second == "v2");
 }
 
+TEST(TestHttp2, DynamicTable_1) {
+    sese::net::http::DynamicTable table(200);
+    for (int i = 0; i < 100; ++i) {
+        table.set("key", "value" + std::to_string(i));
+    }
+    // Each entry takes 32 + 3 + 7 bytes
+    EXPECT_EQ(table.getCount(), 4);
+    EXPECT_EQ(table.get(62)->second, "value99");
+    EXPECT_EQ(table.get(65)->second, "value96");
+    EXPECT_EQ(table.get(66), std::nullopt);
+
+    bool matched;
+    EXPECT_EQ(table.find("key", "value98", matched), 63);
+    EXPECT_TRUE(matched);
+    EXPECT_EQ(table.find("key", "value95", matched), 62);
+    EXPECT_FALSE(matched);
+    EXPECT_EQ(table.find(":method", "GET", matched), 2);
+    EXPECT_TRUE(matched);
+    EXPECT_EQ(table.find("content-type", "text/html", matched), 31);
+    EXPECT_FALSE(matched);
+    EXPECT_EQ(table.find("x-unknown", "", matched), 0);
+
+    // An entry larger than the table empties it
+    EXPECT_FALSE(table.set("key", std::string(200, 'a')));
+    EXPECT_EQ(table.getCount(), 0);
+    EXPECT_EQ(table.find("key", "value99", matched), 0);
+}
+
 TEST(TestHttp2, HuffmanEncoder) {
     sese::net::http::HuffmanEncoder encoder;
     {
@@ -93,6 +122,33 @@ TEST(TestHttp2, HuffmanDecoder) {
     EXPECT_TRUE(str2.value() == "\"63ea2d3e-18b4\"");
 }
 
+TEST(TestHttp2, HuffmanRoundTrip) {
+    sese::net::http::HuffmanDecoder decoder;
+    sese::net::http::HuffmanEncoder encoder;
+    {
+        std::string all;
+        for (int i = 0; i < 256; ++i) {
+            all.push_back(static_cast<char>(i));
+        }
+        auto code = encoder.encode(all);
+        EXPECT_EQ(code.size(), sese::net::http::HuffmanEncoder::encodedLength(reinterpret_cast<const uint8_t *>(all.data()), all.size()));
+        auto result = decoder.decode(reinterpret_cast<const char *>(code.data()), code.size());
+        ASSERT_TRUE(result != std::nullopt);
+        EXPECT_EQ(result.value(), all);
+    }
+    {
+        auto result = decoder.decode("", 0);
+        ASSERT_TRUE(result != std::nullopt);
+        EXPECT_TRUE(result->empty());
+    }
+    // 'a' is 00011, the padding is not made of 1 bits
+    EXPECT_EQ(decoder.decode("\x18", 1), std::nullopt);
+    // The padding is longer than 7 bits
+    EXPECT_EQ(decoder.decode("\x1f\xff", 2), std::nullopt);
+    // EOS
+    EXPECT_EQ(decoder.decode("\xff\xff\xff\xff", 4), std::nullopt);
+}
+
 TEST(TestHttp2, HPackDecode) {
     const uint8_t BUF[] = {0x82, 0x86, 0x41, 0x88, 0xaa, 0x69, 0xd2, 0x9a, 0xc4, 0xb9, 0xec, 0x9b, 0x84, 0x7a, 0x88, 0x25, 0xb6, 0x50, 0xc3, 0xcb, 0xbe, 0xb8, 0x7f, 0x53, 0x3, 0x2a, 0x2f, 0x2a};
 
@@ -104,4 +160,45 @@ TEST(TestHttp2, HPackDecode) {
 
     showStreamHeader(header);
     showDynamicTable(table);
+}
+
+TEST(TestHttp2, HPackEncode) {
+    sese::net::http::DynamicTable encoder_table;
+    sese::net::http::DynamicTable decoder_table;
+    auto response = sese::net::http::Header{
+            {":status", "200"},
+            {"Content-Type", "application/json; charset=utf-8"},
+            {"server", "sese"},
+            {"cache-control", "max-age=0, no-cache"},
+            {"content-length", "1024"},
+            {"authorization", "Bearer 0123456789abcdef"},
+    };
+
+    size_t sizes[2];
+    for (auto &&size: sizes) {
+        sese::io::ByteBuilder buffer;
+        size = sese::net::http::HPackUtil::encode(&buffer, encoder_table, response);
+        ASSERT_EQ(size, buffer.getReadableSize());
+
+        sese::net::http::Header header;
+        ASSERT_EQ(0, sese::net::http::HPackUtil::decode(&buffer, size, decoder_table, header, true));
+        EXPECT_EQ(header.get("content-type"), "application/json; charset=utf-8");
+        EXPECT_EQ(header.get("server"), "sese");
+        EXPECT_EQ(header.get("content-length"), "1024");
+        EXPECT_EQ(header.get("authorization"), "Bearer 0123456789abcdef");
+    }
+    // Only content-length and authorization are sent as literals again
+    EXPECT_LT(sizes[1], sizes[0]);
+    EXPECT_EQ(encoder_table.getCount(), 3);
+    EXPECT_EQ(decoder_table.getCount(), 3);
+
+    // The peer shrinks the table, the update is signaled and both tables are emptied
+    encoder_table.resize(0);
+    sese::io::ByteBuilder buffer;
+    auto size = sese::net::http::HPackUtil::encode(&buffer, encoder_table, response);
+    sese::net::http::Header header;
+    ASSERT_EQ(0, sese::net::http::HPackUtil::decode(&buffer, size, decoder_table, header, true));
+    EXPECT_EQ(decoder_table.getMaxSize(), 0);
+    EXPECT_EQ(decoder_table.getCount(), 0);
+    EXPECT_EQ(header.get("server"), "sese");
 }
\ No newline at end of file
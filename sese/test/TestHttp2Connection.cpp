@@ -0,0 +1,308 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Http2TestClient.h"
+
+#include <sese/internal/service/http/HttpConnectionEx.h>
+#include <sese/net/AddressPool.h>
+#include <sese/service/http/HttpServer.h>
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+using namespace sese::net::http;
+
+/// HTTP 2 server echoing the size of the uploaded bodies and the number of their bytes that are not 'x',
+/// with the windows driven by raw frames
+class TestHttp2Connection : public testing::Test {
+public:
+    uint16_t port = 0;
+    std::unique_ptr<sese::service::http::HttpServer> server;
+    Http2TestClient client;
+    /// Windows of the server as seen by the client
+    int64_t connection_window = 65535;
+    int64_t stream_window = 65535;
+    uint32_t max_concurrent_streams = 16;
+
+    void start(bool auto_tune, uint32_t max_window_size = 1024 * 1024) {
+        auto ssl = sese::security::SSLContextBuilder::UniqueSSL4Server();
+        ASSERT_TRUE(ssl->importCertFile(PROJECT_PATH "/sese/test/Data/test-ca.crt"));
+        ASSERT_TRUE(ssl->importPrivateKeyFile(PROJECT_PATH "/sese/test/Data/test-key.pem"));
+        port = sese::net::createRandomPort();
+        server = std::make_unique<sese::service::http::HttpServer>();
+        Servlet upload(RequestType::POST, "/upload");
+        upload = [](HttpServletContext &ctx) {
+            char buffer[4096];
+            size_t size = 0;
+            size_t corrupted = 0;
+            int64_t len;
+            while ((len = ctx.getInputStream()->read(buffer, sizeof(buffer))) > 0) {
+                size += len;
+                corrupted += len - std::count(buffer, buffer + len, 'x');
+            }
+            auto body = std::to_string(size) + " " + std::to_string(corrupted);
+            ctx.getOutputStream()->write(body.data(), body.size());
+        };
+        server->regServlet(upload);
+        server->setHttp2AutoTune(auto_tune, max_window_size);
+        server->setHttp2Limits(16384, max_concurrent_streams);
+        server->regService(sese::net::IPv4Address::localhost(port), std::move(ssl));
+        ASSERT_TRUE(server->startup());
+        ASSERT_TRUE(client.connect(port));
+        ASSERT_TRUE(client.writeHeaders(1, {{":method", "POST"}, {":scheme", "https"}, {":path", "/upload"}, {":authority", "localhost"}}, false));
+    }
+
+    void TearDown() override {
+        client.close();
+        if (server) {
+            server->shutdown();
+        }
+    }
+
+    void writeData(size_t length, bool end_stream = false) {
+        ASSERT_LE(static_cast<int64_t>(length), std::min(connection_window, stream_window));
+        ASSERT_TRUE(client.writeFrame(FRAME_TYPE_DATA, end_stream ? FRAME_FLAG_END_STREAM : 0, 1, std::string(length, 'x')));
+        connection_window -= length;
+        stream_window -= length;
+    }
+
+    /// Read the frames until the one of the type, following the window updates
+    void readUntil(uint8_t type, Http2TestClient::Frame &frame) {
+        while (true) {
+            ASSERT_TRUE(client.readFrame(frame)) << "frame " << static_cast<int>(type) << " expected";
+            if (frame.type == FRAME_TYPE_WINDOW_UPDATE) {
+                (frame.ident ? stream_window : connection_window) += Http2TestClient::readUint32(frame.payload);
+            }
+            if (frame.type == type) {
+                return;
+            }
+            ASSERT_NE(frame.type, FRAME_TYPE_GOAWAY) << "error " << Http2TestClient::readUint32(frame.payload, 4);
+            ASSERT_NE(frame.type, FRAME_TYPE_PING) << "the windows are not tuned";
+        }
+    }
+
+    /// Finish the upload and check the response, the window updates sent before it are followed
+    void finish(size_t expected) {
+        writeData(1, true);
+        Http2TestClient::Frame frame;
+        readUntil(FRAME_TYPE_HEADERS, frame);
+        EXPECT_EQ(client.decode(frame.payload).get(":status"), "200");
+        readUntil(FRAME_TYPE_DATA, frame);
+        EXPECT_EQ(frame.payload, std::to_string(expected + 1) + " 0");
+    }
+};
+
+/// The windows are enlarged again once half of them has been consumed
+TEST_F(TestHttp2Connection, ReplenishWindows) {
+    start(false);
+    writeData(16384);
+    writeData(16384);
+    writeData(16384);
+    Http2TestClient::Frame frame;
+    readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+    readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+    EXPECT_EQ(connection_window, 65535);
+    EXPECT_EQ(stream_window, 65535);
+
+    // Less than half of the windows is consumed
+    writeData(16384);
+    writeData(16383);
+    finish(16384 * 3 + 32767);
+    EXPECT_EQ(connection_window, 65535 - 32767 - 1);
+    EXPECT_EQ(stream_window, 65535 - 32767 - 1);
+}
+
+/// A round trip filled by the peer doubles the windows up to their limit
+TEST_F(TestHttp2Connection, AutoTune) {
+    constexpr uint32_t MAX_WINDOW_SIZE = 96 * 1024;
+    start(true, MAX_WINDOW_SIZE);
+    // The first frame starts the measurement with a PING, the ACK is held back to fill the round trip.
+    // Small frames sent back to back share TLS records, so the following ones are already received when the PING is written
+    for (int i = 0; i < 16; ++i) {
+        writeData(1024);
+    }
+    writeData(16384);
+    writeData(16384);
+    Http2TestClient::Frame ping;
+    readUntil(FRAME_TYPE_PING, ping);
+    EXPECT_EQ(ping.flags, 0);
+    Http2TestClient::Frame frame;
+    readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+    readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+    writeData(16384);
+    ASSERT_TRUE(client.writeFrame(FRAME_TYPE_PING, 0x1, 0, ping.payload));
+
+    // The sample of 65536 bytes is doubled and capped, the connection window is enlarged at once
+    readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+    EXPECT_EQ(frame.ident, 0);
+    EXPECT_EQ(connection_window, MAX_WINDOW_SIZE);
+    // The stream on its next frame, no other measurement is started at the limit
+    writeData(1);
+    readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+    EXPECT_EQ(frame.ident, 1);
+    EXPECT_EQ(stream_window, MAX_WINDOW_SIZE);
+    finish(16384 * 4 + 1);
+}
+
+/// Without tuning the peer never receives a PING and the windows keep their size
+TEST_F(TestHttp2Connection, AutoTuneDisabled) {
+    start(false);
+    for (int i = 0; i < 8; ++i) {
+        writeData(16384);
+        Http2TestClient::Frame frame;
+        if (connection_window < 65535 / 2) {
+            readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+            readUntil(FRAME_TYPE_WINDOW_UPDATE, frame);
+        }
+    }
+    finish(16384 * 8);
+    EXPECT_LE(connection_window, 65535);
+    EXPECT_LE(stream_window, 65535);
+}
+
+/// A stream beyond the advertised limit is refused alone, its body is discarded and the first stream completes
+TEST_F(TestHttp2Connection, RefuseStream) {
+    max_concurrent_streams = 1;
+    start(false);
+    ASSERT_TRUE(client.writeHeaders(3, {{":method", "POST"}, {":scheme", "https"}, {":path", "/upload"}, {":authority", "localhost"}}, false));
+    Http2TestClient::Frame frame;
+    readUntil(FRAME_TYPE_RST_STREAM, frame);
+    EXPECT_EQ(frame.ident, 3);
+    EXPECT_EQ(Http2TestClient::readUint32(frame.payload), GOAWAY_REFUSED_STREAM);
+
+    // DATA sent before the reset was received
+    ASSERT_TRUE(client.writeFrame(FRAME_TYPE_DATA, FRAME_FLAG_END_STREAM, 3, std::string(1024, 'y')));
+    connection_window -= 1024;
+    writeData(1024);
+    finish(1024);
+}
+
+/// Padding that leaves no room for the Pad Length field ends the connection
+TEST_F(TestHttp2Connection, InvalidPadding) {
+    start(false);
+    // The frame only holds the Pad Length field, which claims one byte of padding
+    ASSERT_TRUE(client.writeFrame(FRAME_TYPE_DATA, FRAME_FLAG_PADDED, 1, std::string(1, '\x01')));
+    Http2TestClient::Frame frame;
+    do {
+        ASSERT_TRUE(client.readFrame(frame));
+    } while (frame.type != FRAME_TYPE_GOAWAY);
+    EXPECT_EQ(Http2TestClient::readUint32(frame.payload, 4), GOAWAY_PROTOCOL_ERROR);
+}
+
+/// A padded HEADERS frame without payload ends the connection
+TEST_F(TestHttp2Connection, EmptyPaddedHeaders) {
+    start(false);
+    ASSERT_TRUE(client.writeFrame(FRAME_TYPE_HEADERS, FRAME_FLAG_PADDED | FRAME_FLAG_END_HEADERS, 3));
+    Http2TestClient::Frame frame;
+    do {
+        ASSERT_TRUE(client.readFrame(frame));
+    } while (frame.type != FRAME_TYPE_GOAWAY);
+    EXPECT_EQ(Http2TestClient::readUint32(frame.payload, 4), GOAWAY_PROTOCOL_ERROR);
+}
+
+TEST(TestHttp2Priority, ParseUrgency) {
+    using sese::internal::service::http::HttpConnectionEx;
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("u=0", 3), 0);
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("u=7", 3), 7);
+    // Out of range, the current urgency is kept
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("u=8", 3), 3);
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("u=3;i", 5), 3);
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("i, u=1", 3), 1);
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("u=12", 3), 3);
+    EXPECT_EQ(HttpConnectionEx::parseUrgency("", 4), 4);
+}
+
+/// Streams waiting for the window of the connection are served by urgency, then in turns
+TEST(TestHttp2Priority, Schedule) {
+    constexpr size_t BODY_SIZE = 200000;
+    auto ssl = sese::security::SSLContextBuilder::UniqueSSL4Server();
+    ASSERT_TRUE(ssl->importCertFile(PROJECT_PATH "/sese/test/Data/test-ca.crt"));
+    ASSERT_TRUE(ssl->importPrivateKeyFile(PROJECT_PATH "/sese/test/Data/test-key.pem"));
+    auto port = sese::net::createRandomPort();
+    sese::service::http::HttpServer server;
+    Servlet large(RequestType::GET, "/large");
+    large = [](HttpServletContext &ctx) {
+        std::string body(BODY_SIZE, 'x');
+        ctx.getOutputStream()->write(body.data(), body.size());
+    };
+    server.regServlet(large);
+    server.regService(sese::net::IPv4Address::localhost(port), std::move(ssl));
+    ASSERT_TRUE(server.startup());
+
+    // Only the window of the connection limits the responses
+    Http2TestClient client;
+    ASSERT_TRUE(client.connect(port, {{SETTINGS_INITIAL_WINDOW_SIZE, 1024 * 1024}}));
+    auto request = [&client](uint32_t ident, const std::string &priority) {
+        return client.writeHeaders(ident, {{":method", "GET"}, {":scheme", "https"}, {":path", "/large"}, {":authority", "localhost"}, {"priority", priority}}, true);
+    };
+    auto priorityUpdate = [&client](uint32_t ident, const std::string &priority) {
+        auto big_ident = ToBigEndian32(ident);
+        return client.writeFrame(FRAME_TYPE_PRIORITY_UPDATE, 0, 0, std::string(reinterpret_cast<const char *>(&big_ident), 4) + priority);
+    };
+    // Read the DATA frames filling the window of the connection
+    auto readData = [&client](size_t window) {
+        std::vector<std::pair<uint32_t, size_t>> frames;
+        size_t received = 0;
+        Http2TestClient::Frame frame;
+        while (received < window && client.readFrame(frame)) {
+            if (frame.type == FRAME_TYPE_DATA) {
+                frames.emplace_back(frame.ident, frame.payload.size());
+                received += frame.payload.size();
+            }
+        }
+        return frames;
+    };
+
+    // The first response takes the whole window
+    ASSERT_TRUE(request(1, "u=7"));
+    auto frames = readData(65535);
+    ASSERT_FALSE(frames.empty());
+    for (auto &&[ident, size]: frames) {
+        EXPECT_EQ(ident, 1);
+    }
+    // The second is more urgent and waits for the window with its header sent
+    ASSERT_TRUE(request(3, "u=0"));
+    Http2TestClient::Frame frame;
+    do {
+        ASSERT_TRUE(client.readFrame(frame));
+        ASSERT_NE(frame.type, FRAME_TYPE_DATA);
+    } while (frame.type != FRAME_TYPE_HEADERS);
+    EXPECT_EQ(frame.ident, 3);
+
+    ASSERT_TRUE(client.writeWindowUpdate(0, 100000));
+    for (auto &&[ident, size]: readData(100000)) {
+        EXPECT_EQ(ident, 3);
+    }
+
+    // PRIORITY_UPDATE reverses the order
+    ASSERT_TRUE(priorityUpdate(1, "u=0"));
+    ASSERT_TRUE(priorityUpdate(3, "u=7"));
+    ASSERT_TRUE(client.writeWindowUpdate(0, 50000));
+    for (auto &&[ident, size]: readData(50000)) {
+        EXPECT_EQ(ident, 1);
+    }
+
+    // Streams of the same urgency take turns
+    ASSERT_TRUE(priorityUpdate(3, "u=0"));
+    ASSERT_TRUE(client.writeWindowUpdate(0, 16384 * 4));
+    frames = readData(16384 * 4);
+    ASSERT_EQ(frames.size(), 4);
+    for (size_t i = 1; i < frames.size(); ++i) {
+        EXPECT_NE(frames[i].first, frames[i - 1].first);
+    }
+
+    client.close();
+    server.shutdown();
+}
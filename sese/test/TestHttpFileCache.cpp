@@ -0,0 +1,123 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/internal/service/http/HttpFileCache.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using sese::internal::service::http::HttpFileCache;
+using namespace std::chrono_literals;
+
+class TestHttpFileCache : public testing::Test {
+public:
+    std::filesystem::path root = std::filesystem::temp_directory_path() / "sese_http_file_cache";
+
+    void SetUp() override {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "a");
+        std::filesystem::create_directories(root / "b");
+        std::ofstream(root / "a" / "1.txt") << "1";
+        std::ofstream(root / "a" / "2.txt") << "2";
+        std::ofstream(root / "b" / "3.txt") << "3";
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(root);
+    }
+
+    std::string path(const std::string &name) const {
+        return (root / name).lexically_normal().string();
+    }
+
+    /// Wait for the notification of a change
+    static bool waitFor(const std::function<bool()> &predicate) {
+        for (int i = 0; i < 50; ++i) {
+            if (predicate()) {
+                return true;
+            }
+            std::this_thread::sleep_for(20ms);
+        }
+        return predicate();
+    }
+};
+
+TEST_F(TestHttpFileCache, Invalidate) {
+    HttpFileCache cache(8);
+    auto entry = cache.get(path("a/1.txt"));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->size, 1);
+    EXPECT_EQ(cache.get(path("a/1.txt")), entry);
+    EXPECT_EQ(cache.size(), 1);
+
+    std::ofstream(path("a/1.txt"), std::ios::trunc) << "one";
+    ASSERT_TRUE(waitFor([&] { return cache.size() == 0; }));
+    entry = cache.get(path("a/1.txt"));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->size, 3);
+}
+
+/// A directory is watched while it has entries only
+TEST_F(TestHttpFileCache, Unwatch) {
+    std::ofstream(path("b/4.txt")) << "4";
+    HttpFileCache cache(2);
+    ASSERT_NE(cache.get(path("a/1.txt")), nullptr);
+    ASSERT_NE(cache.get(path("a/2.txt")), nullptr);
+    EXPECT_EQ(cache.watchCount(), 1);
+
+    // Evicts the first entry of the directory a
+    ASSERT_NE(cache.get(path("b/3.txt")), nullptr);
+    EXPECT_EQ(cache.watchCount(), 2);
+    // Evicts the last one
+    ASSERT_NE(cache.get(path("b/4.txt")), nullptr);
+    EXPECT_EQ(cache.watchCount(), 1);
+
+    cache.invalidate(path("b"));
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.watchCount(), 0);
+
+    // Watched again for a new entry
+    ASSERT_NE(cache.get(path("a/2.txt")), nullptr);
+    EXPECT_EQ(cache.watchCount(), 1);
+    std::filesystem::remove(path("a/2.txt"));
+    ASSERT_TRUE(waitFor([&] { return cache.size() == 0; }));
+    EXPECT_EQ(cache.get(path("a/2.txt")), nullptr);
+
+    ASSERT_NE(cache.get(path("a/1.txt")), nullptr);
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.watchCount(), 0);
+}
+
+/// The absence of a sibling is cached with the file until the sibling appears
+TEST_F(TestHttpFileCache, Siblings) {
+    HttpFileCache cache(8, {".zst", ".gz"});
+    auto entry = cache.get(path("a/1.txt"));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->siblings, 0);
+    EXPECT_EQ(cache.get(path("a/1.txt")), entry);
+
+    std::ofstream(path("a/1.txt.gz")) << "compressed";
+    ASSERT_TRUE(waitFor([&] { return cache.size() == 0; }));
+    entry = cache.get(path("a/1.txt"));
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->siblings, 0b10);
+
+    std::filesystem::remove(path("a/1.txt.gz"));
+    ASSERT_TRUE(waitFor([&] { return cache.size() == 0; }));
+    EXPECT_EQ(cache.get(path("a/1.txt"))->siblings, 0);
+}
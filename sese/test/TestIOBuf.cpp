@@ -50,6 +50,37 @@ TEST(TestIOBuf, Clear) {
     EXPECT_EQ(buffer.getTotalSize(), 0);
 }
 
+TEST(TestIOBuf, Reclaim) {
+    sese::IOBuf buffer;
+    EXPECT_EQ(buffer.reclaim(), nullptr);
+
+    auto node = std::make_unique<sese::IOBufNode>(4);
+    auto first = node.get();
+    node->size = 4;
+    memcpy(node->buffer, "ABCD", 4);
+    buffer.push(std::move(node));
+    node = std::make_unique<sese::IOBufNode>(2);
+    node->size = 2;
+    memcpy(node->buffer, "EF", 2);
+    buffer.push(std::move(node));
+    char buf[16]{};
+    EXPECT_EQ(buffer.read(buf, 5), 5);
+
+    node = buffer.reclaim();
+    ASSERT_EQ(node.get(), first);
+    EXPECT_EQ(node->getReadableSize(), 0);
+    EXPECT_EQ(node->getWriteableSize(), 4);
+    EXPECT_EQ(buffer.getReadableSize(), 0);
+    EXPECT_EQ(buffer.getTotalSize(), 0);
+
+    node->size = 3;
+    memcpy(node->buffer, "GHI", 3);
+    buffer.push(std::move(node));
+    memset(buf, 0, sizeof(buf));
+    EXPECT_EQ(buffer.read(buf, 16), 3);
+    EXPECT_EQ(std::string(buf), "GHI");
+}
+
 TEST(TestIOBuf, Input) {
     sese::IOBuf buffer;
     auto node = std::make_unique<sese::IOBufNode>(1);
@@ -0,0 +1,146 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/Socket.h>
+#include <sese/service/http/HttpServer.h>
+#include <sese/thread/ThreadPool.h>
+#include <sese/util/Metrics.h>
+
+#include <random>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+TEST(TestMetrics, Counter) {
+    sese::Counter counter;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < 10000; ++j) {
+                counter.inc();
+            }
+        });
+    }
+    for (auto &&thread: threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.value(), 80000);
+}
+
+TEST(TestMetrics, HistogramBuckets) {
+    using sese::Histogram;
+    // Every value is within the bucket it is recorded in
+    for (uint64_t value: {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, (1ull << 36) - 1}) {
+        auto bucket = Histogram::getBucket(value);
+        ASSERT_LT(bucket, Histogram::BUCKETS);
+        EXPECT_LE(value, Histogram::getUpperBound(bucket));
+        if (bucket > 0) {
+            EXPECT_GT(value, Histogram::getUpperBound(bucket - 1));
+        }
+    }
+    EXPECT_EQ(Histogram::getBucket(1ull << 40), Histogram::BUCKETS - 1);
+
+    Histogram histogram;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram.record(i);
+    }
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 1000);
+    EXPECT_EQ(snapshot.sum, 500500);
+    // Within the precision of the buckets
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(0.5)), 500, 500 * 0.0625);
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(0.99)), 990, 990 * 0.0625);
+    EXPECT_EQ(Histogram().snapshot().quantile(0.99), 0);
+}
+
+TEST(TestMetrics, Expose) {
+    auto registry = sese::MetricsRegistry::getInstance();
+    registry->counter("test_metrics_requests_total", "Requests", {{"path", "/a\"b"}}).inc(3);
+    registry->gauge("test_metrics_temperature", "Temperature\nin degrees").set(-4);
+    auto &&histogram = registry->histogram("test_metrics_latency_seconds", "Latency", {}, 1e-6);
+    histogram.record(2000);
+    // The same metric is returned for the same name and labels
+    EXPECT_EQ(&registry->counter("test_metrics_requests_total", "Requests", {{"path", "/a\"b"}}), &registry->counter("test_metrics_requests_total", "Requests", {{"path", "/a\"b"}}));
+
+    std::string text;
+    registry->expose(text);
+    EXPECT_NE(text.find("# TYPE test_metrics_requests_total counter\ntest_metrics_requests_total{path=\"/a\\\"b\"} 3\n"), std::string::npos);
+    EXPECT_NE(text.find("# HELP test_metrics_temperature Temperature\\nin degrees\n# TYPE test_metrics_temperature gauge\ntest_metrics_temperature -4\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_metrics_latency_seconds summary\n"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_latency_seconds{quantile=\"0.99\"} 0.002"), std::string::npos);
+    EXPECT_NE(text.find("test_metrics_latency_seconds_sum 0.002\ntest_metrics_latency_seconds_count 1\n"), std::string::npos);
+}
+
+TEST(TestMetrics, ThreadPool) {
+    auto registry = sese::MetricsRegistry::getInstance();
+    auto &&completed = registry->counter("sese_thread_pool_completed_tasks_total", "", {{"pool", "TestMetrics"}});
+    auto &&queued = registry->gauge("sese_thread_pool_queued_tasks", "", {{"pool", "TestMetrics"}});
+    {
+        sese::ThreadPool pool("TestMetrics", 2);
+        std::vector<std::shared_future<int>> futures;
+        for (int i = 0; i < 10; ++i) {
+            futures.emplace_back(pool.postTask<int>([i] { return i; }));
+        }
+        for (auto &&future: futures) {
+            future.wait();
+        }
+    }
+    EXPECT_EQ(completed.value(), 10);
+    EXPECT_EQ(queued.value(), 0);
+}
+
+TEST(TestMetrics, HttpServer) {
+    std::random_device device;
+    auto port = static_cast<uint16_t>(device() % 20000 + 30000);
+    sese::service::http::HttpServer server;
+    sese::net::http::Servlet hello(sese::net::http::RequestType::GET, "/hello/{name}");
+    hello = [](sese::net::http::HttpServletContext &ctx) {
+        ctx.getResp().getBody().write("hello", 5);
+    };
+    server.regServlet(hello);
+    server.regMetrics();
+    server.regService(sese::net::IPv4Address::localhost(port), nullptr);
+    ASSERT_TRUE(server.startup());
+
+    auto request = [port](const std::string &uri) {
+        auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+        std::string response;
+        if (client.connect(sese::net::IPv4Address::localhost(port)) != 0) {
+            return response;
+        }
+        auto text = "GET " + uri + " HTTP/1.1\r\nhost: localhost\r\nconnection: close\r\n\r\n";
+        client.write(text.data(), text.length());
+        char buffer[4096];
+        int64_t length;
+        while ((length = client.read(buffer, sizeof(buffer))) > 0) {
+            response.append(buffer, length);
+        }
+        client.close();
+        return response;
+    };
+    EXPECT_EQ(request("/hello/a").find("HTTP/1.1 200"), 0);
+    EXPECT_EQ(request("/hello/b").find("HTTP/1.1 200"), 0);
+    EXPECT_EQ(request("/missing").find("HTTP/1.1 404"), 0);
+
+    auto response = request("/metrics");
+    server.shutdown();
+    EXPECT_EQ(response.find("HTTP/1.1 200"), 0);
+    EXPECT_NE(response.find("content-type: text/plain; version=0.0.4"), std::string::npos);
+    // The requests are attributed to the route patterns
+    EXPECT_NE(response.find("sese_http_request_duration_seconds_count{type=\"servlet\",route=\"/hello/{name}\"} 2\n"), std::string::npos);
+    EXPECT_NE(response.find("sese_http_request_duration_seconds_count{type=\"none\",route=\"\"}"), std::string::npos);
+    EXPECT_NE(response.find("sese_http_request_duration_seconds{type=\"servlet\",route=\"/hello/{name}\",quantile=\"0.99\"}"), std::string::npos);
+    EXPECT_NE(response.find("sese_http_responses_total{code=\"4xx\"}"), std::string::npos);
+    EXPECT_NE(response.find("sese_http_open_connections{protocol=\"http/1.1\"}"), std::string::npos);
+}
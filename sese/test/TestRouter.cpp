@@ -0,0 +1,88 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/net/http/Router.h>
+
+#include <gtest/gtest.h>
+
+using sese::net::http::Router;
+
+TEST(TestRouter, Exact) {
+    Router router;
+    ASSERT_TRUE(router.insert("/", 0));
+    ASSERT_TRUE(router.insert("/login", 1));
+    ASSERT_TRUE(router.insert("/logout", 2));
+    ASSERT_TRUE(router.insert("/log", 3));
+    ASSERT_FALSE(router.insert("/login", 4));
+
+    EXPECT_EQ(router.match("/"), 0);
+    EXPECT_EQ(router.match("/login"), 1);
+    EXPECT_EQ(router.match("/logout"), 2);
+    EXPECT_EQ(router.match("/log"), 3);
+    EXPECT_EQ(router.match("/lo"), Router::NPOS);
+    EXPECT_EQ(router.match("/login/"), Router::NPOS);
+    EXPECT_EQ(router.match(""), Router::NPOS);
+}
+
+TEST(TestRouter, Params) {
+    Router router;
+    ASSERT_TRUE(router.insert("/users/{id}", 0));
+    ASSERT_TRUE(router.insert("/users/{uid}/posts/{post}", 1));
+    ASSERT_TRUE(router.insert("/users/me", 2));
+    ASSERT_FALSE(router.insert("/users/{id", 3));
+    ASSERT_FALSE(router.insert("/users/{}", 3));
+    ASSERT_FALSE(router.insert("/users/{id}.json", 3));
+
+    Router::Params params;
+    EXPECT_EQ(router.match("/users/42", &params), 0);
+    ASSERT_EQ(params.size(), 1);
+    EXPECT_EQ(params[0].first, "id");
+    EXPECT_EQ(params[0].second, "42");
+
+    EXPECT_EQ(router.match("/users/42/posts/7", &params), 1);
+    ASSERT_EQ(params.size(), 2);
+    EXPECT_EQ(params[0].first, "uid");
+    EXPECT_EQ(params[0].second, "42");
+    EXPECT_EQ(params[1].first, "post");
+    EXPECT_EQ(params[1].second, "7");
+
+    // Static segments take precedence
+    EXPECT_EQ(router.match("/users/me", &params), 2);
+    EXPECT_TRUE(params.empty());
+
+    EXPECT_EQ(router.match("/users/"), Router::NPOS);
+    EXPECT_EQ(router.match("/users/42/posts"), Router::NPOS);
+    EXPECT_EQ(router.match("/users/42/posts/"), Router::NPOS);
+}
+
+TEST(TestRouter, Prefix) {
+    Router router;
+    ASSERT_TRUE(router.insertPrefix("/", 0));
+    ASSERT_TRUE(router.insertPrefix("/www", 1));
+    ASSERT_TRUE(router.insertPrefix("/www/static", 2));
+    ASSERT_TRUE(router.insertPrefix("/api", 3));
+    ASSERT_FALSE(router.insertPrefix("/www", 4));
+
+    EXPECT_EQ(router.matchLongestPrefix("/www/static/a.js"), 2);
+    EXPECT_EQ(router.matchLongestPrefix("/www/index.html"), 1);
+    EXPECT_EQ(router.matchLongestPrefix("/ap"), 0);
+    EXPECT_EQ(router.matchLongestPrefix("none"), Router::NPOS);
+
+    std::vector<size_t> ids;
+    router.matchPrefixes("/www/static/a.js", ids);
+    EXPECT_EQ(ids, (std::vector<size_t>{0, 1, 2}));
+    ids.clear();
+    router.matchPrefixes("/api/users", ids);
+    EXPECT_EQ(ids, (std::vector<size_t>{0, 3}));
+}
@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 
+#include <openssl/ssl.h>
+
 using namespace std::chrono_literals;
 
 TEST(TestSSL, Auth) {
@@ -113,4 +115,104 @@ TEST(TestSSL, Server) {
 
     th.join();
     server.close();
-}
\ No newline at end of file
+}
+
+/// Handshake with the server context in memory
+/// @param server Server SSL_CTX
+/// @param session Session to resume, nullptr for a full handshake
+/// @return The session of the client, nullptr if the handshake failed
+static SSL_SESSION *handshake(void *server, SSL_SESSION *session, bool *reused) {
+    auto client_ctx = SSL_CTX_new(TLS_client_method());
+    auto client = SSL_new(client_ctx);
+    auto server_ssl = SSL_new(static_cast<SSL_CTX *>(server));
+    BIO *client_bio, *server_bio;
+    BIO_new_bio_pair(&client_bio, 0, &server_bio, 0);
+    SSL_set_bio(client, client_bio, client_bio);
+    SSL_set_bio(server_ssl, server_bio, server_bio);
+    SSL_set_connect_state(client);
+    SSL_set_accept_state(server_ssl);
+    if (session) {
+        SSL_set_session(client, session);
+    }
+
+    SSL_SESSION *result = nullptr;
+    char buffer[16];
+    for (int i = 0; i < 16; ++i) {
+        SSL_do_handshake(client);
+        SSL_do_handshake(server_ssl);
+        // TLS 1.3 tickets arrive after the handshake
+        if (SSL_is_init_finished(client) && SSL_is_init_finished(server_ssl)) {
+            SSL_write(server_ssl, "x", 1);
+            if (SSL_read(client, buffer, sizeof(buffer)) == 1) {
+                *reused = SSL_session_reused(client) == 1;
+                result = SSL_get1_session(client);
+                break;
+            }
+        }
+    }
+    // Sessions of connections closed without close_notify are not resumable
+    SSL_shutdown(client);
+    SSL_shutdown(server_ssl);
+    SSL_free(server_ssl);
+    SSL_free(client);
+    SSL_CTX_free(client_ctx);
+    return result;
+}
+
+static void resume(void *server, int version, bool expect) {
+    SSL_CTX_set_max_proto_version(static_cast<SSL_CTX *>(server), version);
+    bool reused = true;
+    auto session = handshake(server, nullptr, &reused);
+    ASSERT_NE(session, nullptr);
+    EXPECT_FALSE(reused);
+    auto resumed = handshake(server, session, &reused);
+    ASSERT_NE(resumed, nullptr);
+    EXPECT_EQ(reused, expect);
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+}
+
+TEST(TestSSL, SessionCache) {
+    sese::security::SSLContextBuilder::SessionOptions options;
+    options.ticket_rotation = 0;
+    auto context = sese::security::SSLContextBuilder::SSL4Server(options);
+    ASSERT_TRUE(context->importCertFile(PROJECT_PATH "/sese/test/Data/test-ca.crt"));
+    ASSERT_TRUE(context->importPrivateKeyFile(PROJECT_PATH "/sese/test/Data/test-key.pem"));
+    resume(context->getContext(), TLS1_2_VERSION, true);
+    resume(context->getContext(), TLS1_3_VERSION, true);
+    EXPECT_GT(SSL_CTX_sess_number(static_cast<SSL_CTX *>(context->getContext())), 0);
+
+    options.cache_size = 0;
+    context = sese::security::SSLContextBuilder::SSL4Server(options);
+    ASSERT_TRUE(context->importCertFile(PROJECT_PATH "/sese/test/Data/test-ca.crt"));
+    ASSERT_TRUE(context->importPrivateKeyFile(PROJECT_PATH "/sese/test/Data/test-key.pem"));
+    resume(context->getContext(), TLS1_2_VERSION, false);
+}
+
+TEST(TestSSL, SessionTicket) {
+    sese::security::SSLContextBuilder::SessionOptions options;
+    options.cache_size = 0;
+    options.ticket_rotation = 1;
+    auto context = sese::security::SSLContextBuilder::SSL4Server(options);
+    ASSERT_TRUE(context->importCertFile(PROJECT_PATH "/sese/test/Data/test-ca.crt"));
+    ASSERT_TRUE(context->importPrivateKeyFile(PROJECT_PATH "/sese/test/Data/test-key.pem"));
+    resume(context->getContext(), TLS1_2_VERSION, true);
+    resume(context->getContext(), TLS1_3_VERSION, true);
+
+    bool reused = false;
+    auto session = handshake(context->getContext(), nullptr, &reused);
+    ASSERT_NE(session, nullptr);
+    // Encrypted by the previous key after one rotation
+    std::this_thread::sleep_for(1100ms);
+    auto resumed = handshake(context->getContext(), session, &reused);
+    ASSERT_NE(resumed, nullptr);
+    EXPECT_TRUE(reused);
+    SSL_SESSION_free(resumed);
+    // The key expires after two rotations
+    std::this_thread::sleep_for(1100ms);
+    resumed = handshake(context->getContext(), session, &reused);
+    ASSERT_NE(resumed, nullptr);
+    EXPECT_FALSE(reused);
+    SSL_SESSION_free(resumed);
+    SSL_SESSION_free(session);
+}
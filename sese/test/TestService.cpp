@@ -18,9 +18,15 @@
 #include "sese/service/http/HttpServer.h"
 #include "sese/security/SSLContextBuilder.h"
 #include "sese/io/ConsoleOutputStream.h"
+#include "sese/io/File.h"
+#include "sese/util/Decompressor.h"
 #include "sese/log/Marco.h"
 #include "gtest/gtest.h"
 
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
 #define ASSERT_NOT_NULL(x) ASSERT_TRUE(x != nullptr)
 
 SESE_CTRL(MyController) {
@@ -51,6 +57,61 @@ SESE_CTRL(MyController) {
         resp.setCode(200);
         SESE_INFO("form:\nname: {}\npwd: {}", name, pwd);
     };
+    SESE_URL(async_info, RequestType::GET, "/async_info?{name}") {
+        auto &req = ctx.getReq();
+        auto &resp = ctx.getResp();
+        auto name = req.getQueryArg("name");
+        resp.getBody().write(name.data(), name.length());
+    };
+    async_info.setAsync(true);
+    SESE_URL(upload, RequestType::POST, "/upload") {
+        auto input = ctx.getInputStream();
+        char buffer[4096];
+        uint64_t size = 0;
+        uint64_t sum = 0;
+        int64_t len;
+        while ((len = input->read(buffer, sizeof(buffer))) > 0) {
+            for (int64_t i = 0; i < len; ++i) {
+                sum += static_cast<uint8_t>(buffer[i]);
+            }
+            size += len;
+        }
+        ctx.getResp().set("size", std::to_string(size));
+        ctx.getResp().set("sum", std::to_string(sum));
+    };
+    upload.setStreaming(true);
+    SESE_URL(upload_ignored, RequestType::POST, "/upload_ignored") {
+        ctx.getResp().setCode(413);
+    };
+    upload_ignored.setStreaming(true);
+    SESE_URL(get_export, RequestType::GET, "/export") {
+        auto &resp = ctx.getResp();
+        resp.set("content-type", "text/csv");
+        resp.getBody().write("id,value\n", 9);
+        auto output = ctx.getResponseStream();
+        if (!output) {
+            resp.setCode(500);
+            return;
+        }
+        for (int i = 0; i < 100000; ++i) {
+            auto line = std::to_string(i) + ",sese\n";
+            if (output->write(line.data(), line.length()) < 0) {
+                return;
+            }
+        }
+    };
+    get_export.setAsync(true);
+    SESE_URL(get_text, RequestType::GET, "/text") {
+        auto &resp = ctx.getResp();
+        resp.set("content-type", "text/plain");
+        for (int i = 0; i < 256; ++i) {
+            resp.getBody().write("Hello, World\n", 13);
+        }
+    };
+    SESE_URL(get_user, RequestType::GET, "/users/{id}") {
+        auto &resp = ctx.getResp();
+        resp.set("id", ctx.getPathArg("id", ""));
+    };
 }
 
 class TestHttpServerV3 : public testing::Test {
@@ -72,8 +133,14 @@ public:
 
         server = std::make_unique<HttpServer>();
         server->setKeepalive(60);
+        server->setThreads(2);
+        server->setWorkerPool(2);
+        server->setCompression();
+        server->setPrecompressed(true);
         server->setName("HttpServiceImpl_V3");
         server->regMountPoint("/www", PROJECT_PATH);
+        std::filesystem::create_directories(cacheDir());
+        server->regMountPoint("/cache", cacheDir());
         server->regController<MyController>();
         server->regService(sese::net::IPv4Address::localhost(ssl_port), std::move(ssl));
         server->regService(sese::net::IPv4Address::localhost(port), nullptr);
@@ -85,6 +152,10 @@ public:
         server->shutdown();
     }
 
+    static std::string cacheDir() {
+        return (std::filesystem::temp_directory_path() / "sese_http_file_cache").string();
+    }
+
     static std::string getUrl(bool ssl, uint16_t port, const std::string &url) {
         using namespace sese::text;
         return fmt("{}://127.0.0.1:{}{}", ssl ? "https" : "http", port, url);
@@ -152,6 +223,27 @@ public:
         }
     }
 
+    static void async(bool ssl, uint16_t port) {
+        using namespace sese::net::http;
+        auto client = HttpClient::create(getUrl(ssl, port, "/async_info?name=sese"));
+        ASSERT_NOT_NULL(client);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+        EXPECT_EQ(client->getResponse()->get("content-length"), "4");
+        // Keepalive connections continue to work after the servlet is resumed
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+    }
+
+    static void pathArgs(bool ssl, uint16_t port) {
+        using namespace sese::net::http;
+        auto client = HttpClient::create(getUrl(ssl, port, "/users/42"));
+        ASSERT_NOT_NULL(client);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+        EXPECT_EQ(client->getResponse()->get("id", ""), "42");
+    }
+
     static void form(bool ssl, uint16_t port) {
         using namespace sese::net::http;
         auto client = HttpClient::create(getUrl(ssl, port, "/login"));
@@ -182,6 +274,95 @@ public:
         }
     }
 
+    static void fileContent(bool ssl, uint16_t port) {
+        using namespace sese::net::http;
+        auto client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        sese::io::ByteBuilder received;
+        client->setWriteData(&received);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+
+        auto file = sese::io::File::create(PROJECT_PATH "/sese/test/Data/data.ini", sese::io::File::B_READ);
+        ASSERT_NOT_NULL(file);
+        sese::io::ByteBuilder expected;
+        sese::streamMove(&expected, file.get(), 64 * 1024);
+        ASSERT_EQ(received.getReadableSize(), expected.getReadableSize());
+        std::string received_str(received.getReadableSize(), '\0');
+        std::string expected_str(expected.getReadableSize(), '\0');
+        received.read(received_str.data(), received_str.size());
+        expected.read(expected_str.data(), expected_str.size());
+        EXPECT_EQ(received_str, expected_str);
+    }
+
+    static std::string fileBody(bool ssl, uint16_t port, const std::string &url) {
+        using namespace sese::net::http;
+        auto client = HttpClient::create(getUrl(ssl, port, url));
+        EXPECT_TRUE(client != nullptr);
+        if (!client) {
+            return {};
+        }
+        sese::io::ByteBuilder received;
+        client->setWriteData(&received);
+        EXPECT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+        std::string result(received.getReadableSize(), '\0');
+        received.read(result.data(), result.size());
+        return result;
+    }
+
+    static void conditional(bool ssl, uint16_t port) {
+        using namespace sese::net::http;
+        auto client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        sese::io::ByteBuilder received;
+        client->setWriteData(&received);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+        auto etag = client->getResponse()->get("etag", "");
+        auto last_modified = client->getResponse()->get("last-modified", "");
+        ASSERT_FALSE(etag.empty());
+        ASSERT_FALSE(last_modified.empty());
+
+        client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        client->getRequest()->set("if-none-match", "\"other\", W/" + etag);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 304);
+        EXPECT_EQ(client->getResponse()->get("etag", ""), etag);
+
+        client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        client->getRequest()->set("if-modified-since", last_modified);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 304);
+
+        // If-None-Match takes precedence
+        client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        client->setWriteData(&received);
+        client->getRequest()->set("if-none-match", "\"other\"");
+        client->getRequest()->set("if-modified-since", last_modified);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+
+        client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        client->setWriteData(&received);
+        client->getRequest()->set("range", "bytes=2-16");
+        client->getRequest()->set("if-range", etag);
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 206);
+
+        client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
+        ASSERT_NOT_NULL(client);
+        client->setWriteData(&received);
+        client->getRequest()->set("range", "bytes=2-16");
+        client->getRequest()->set("if-range", "\"other\"");
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->getCode(), 200);
+    }
+
     static void range(bool ssl, uint16_t port) {
         using namespace sese::net::http;
         auto client = HttpClient::create(getUrl(ssl, port, "/www/sese/test/Data/data.ini"));
@@ -217,6 +398,16 @@ TEST_F(TestHttpServerV3, Keepalive) {
     keepalive(false, port);
 }
 
+TEST_F(TestHttpServerV3, Async) {
+    async(true, ssl_port);
+    async(false, port);
+}
+
+TEST_F(TestHttpServerV3, PathArgs) {
+    pathArgs(true, ssl_port);
+    pathArgs(false, port);
+}
+
 TEST_F(TestHttpServerV3, Form) {
     form(true, ssl_port);
     form(false, port);
@@ -227,8 +418,250 @@ TEST_F(TestHttpServerV3, File) {
     file(false, port);
 }
 
+TEST_F(TestHttpServerV3, FileContent) {
+    fileContent(true, ssl_port);
+    fileContent(false, port);
+}
+
+TEST_F(TestHttpServerV3, FileCache) {
+    using namespace std::chrono_literals;
+    auto path = cacheDir() + "/index.txt";
+    std::ofstream(path, std::ios::trunc) << "first version";
+    EXPECT_EQ(fileBody(true, ssl_port, "/cache/index.txt"), "first version");
+    EXPECT_EQ(fileBody(false, port, "/cache/index.txt"), "first version");
+
+    // The cached entry is invalidated by the modification
+    std::ofstream(path, std::ios::trunc) << "the second version";
+    std::this_thread::sleep_for(200ms);
+    EXPECT_EQ(fileBody(true, ssl_port, "/cache/index.txt"), "the second version");
+    EXPECT_EQ(fileBody(false, port, "/cache/index.txt"), "the second version");
+
+    std::filesystem::remove(path);
+    std::this_thread::sleep_for(200ms);
+    auto client = sese::net::http::HttpClient::create(getUrl(false, port, "/cache/index.txt"));
+    ASSERT_NOT_NULL(client);
+    ASSERT_TRUE(client->request()) << client->getLastError();
+    EXPECT_EQ(client->getResponse()->getCode(), 404);
+}
+
+TEST_F(TestHttpServerV3, Conditional) {
+    conditional(true, ssl_port);
+    conditional(false, port);
+}
+
+TEST_F(TestHttpServerV3, Compression) {
+    using namespace sese::net::http;
+    std::string expected;
+    for (int i = 0; i < 256; ++i) {
+        expected += "Hello, World\n";
+    }
+    for (auto &&[ssl, port]: {std::make_pair(true, ssl_port), std::make_pair(false, port)}) {
+        auto client = HttpClient::create(getUrl(ssl, port, "/text"));
+        ASSERT_NOT_NULL(client);
+        sese::io::ByteBuilder received;
+        client->setWriteData(&received);
+        client->getRequest()->set("accept-encoding", "deflate;q=0.5, gzip");
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->get("content-encoding", ""), "gzip");
+        EXPECT_EQ(client->getResponse()->get("vary", ""), "accept-encoding");
+
+        std::string compressed(received.getReadableSize(), '\0');
+        received.read(compressed.data(), compressed.size());
+        EXPECT_LT(compressed.size(), expected.size());
+        sese::io::ByteBuilder decompressed;
+        sese::Decompressor decompressor(sese::CompressionType::GZIP);
+        decompressor.input(compressed.data(), static_cast<unsigned int>(compressed.size()));
+        decompressor.inflate(&decompressed);
+        std::string result(decompressed.getReadableSize(), '\0');
+        decompressed.read(result.data(), result.size());
+        EXPECT_EQ(result, expected);
+
+        // Not accepted by the client
+        client = HttpClient::create(getUrl(ssl, port, "/text"));
+        ASSERT_NOT_NULL(client);
+        client->setWriteData(&received);
+        client->getRequest()->set("accept-encoding", "gzip;q=0");
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_FALSE(client->getResponse()->exist("content-encoding"));
+        EXPECT_EQ(client->getResponse()->get("content-length", ""), std::to_string(expected.size()));
+    }
+}
+
+TEST_F(TestHttpServerV3, Precompressed) {
+    std::ofstream(cacheDir() + "/app.js", std::ios::trunc) << "identity";
+    std::ofstream(cacheDir() + "/app.js.gz", std::ios::trunc) << "gzip sibling";
+    for (auto &&[ssl, port]: {std::make_pair(true, ssl_port), std::make_pair(false, port)}) {
+        auto client = sese::net::http::HttpClient::create(getUrl(ssl, port, "/cache/app.js"));
+        ASSERT_NOT_NULL(client);
+        sese::io::ByteBuilder received;
+        client->setWriteData(&received);
+        client->getRequest()->set("accept-encoding", "zstd, gzip");
+        ASSERT_TRUE(client->request()) << client->getLastError();
+        EXPECT_EQ(client->getResponse()->get("content-encoding", ""), "gzip");
+        EXPECT_NE(client->getResponse()->get("content-type", "").find("script"), std::string::npos);
+        std::string body(received.getReadableSize(), '\0');
+        received.read(body.data(), body.size());
+        EXPECT_EQ(body, "gzip sibling");
+
+        EXPECT_EQ(fileBody(ssl, port, "/cache/app.js"), "identity");
+    }
+    std::filesystem::remove(cacheDir() + "/app.js");
+    std::filesystem::remove(cacheDir() + "/app.js.gz");
+}
+
+TEST_F(TestHttpServerV3, StreamingBody) {
+    using namespace sese::net::http;
+    constexpr size_t TOTAL = 4 * 1024 * 1024;
+    uint64_t expected_sum = 0;
+    for (size_t i = 0; i < TOTAL; ++i) {
+        expected_sum += i % 251;
+    }
+    for (auto &&[ssl, port]: {std::make_pair(true, ssl_port), std::make_pair(false, port)}) {
+        for (auto &&url: {"/upload", "/upload_ignored"}) {
+            auto client = HttpClient::create(getUrl(ssl, port, url));
+            ASSERT_NOT_NULL(client);
+            client->getRequest()->setType(RequestType::POST);
+            size_t sent = 0;
+            client->setReadCallback(
+                    [&sent](void *buffer, size_t length) -> int64_t {
+                        length = std::min(length, TOTAL - sent);
+                        for (size_t i = 0; i < length; ++i) {
+                            static_cast<char *>(buffer)[i] = static_cast<char>((sent + i) % 251);
+                        }
+                        sent += length;
+                        return static_cast<int64_t>(length);
+                    },
+                    TOTAL
+            );
+            ASSERT_TRUE(client->request()) << client->getLastError();
+            if (std::string(url) == "/upload") {
+                EXPECT_EQ(client->getResponse()->getCode(), 200);
+                EXPECT_EQ(client->getResponse()->get("size", ""), std::to_string(TOTAL));
+                EXPECT_EQ(client->getResponse()->get("sum", ""), std::to_string(expected_sum));
+            } else {
+                EXPECT_EQ(client->getResponse()->getCode(), 413);
+            }
+        }
+    }
+}
+
+TEST_F(TestHttpServerV3, StreamingResponse) {
+    std::string expected = "id,value\n";
+    for (int i = 0; i < 100000; ++i) {
+        expected += std::to_string(i) + ",sese\n";
+    }
+
+    auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    ASSERT_EQ(client.connect(sese::net::IPv4Address::localhost(port)), 0);
+    std::string data;
+    char buffer[4096];
+    // Twice on the same connection, so the end of the first body must be found from the chunks
+    for (int round = 0; round < 2; ++round) {
+        constexpr auto REQUEST = "GET /export HTTP/1.1\r\nhost: localhost\r\nconnection: keep-alive\r\n\r\n";
+        ASSERT_EQ(client.write(REQUEST, strlen(REQUEST)), strlen(REQUEST));
+
+        size_t pos;
+        while ((pos = data.find("\r\n\r\n")) == std::string::npos) {
+            auto len = client.read(buffer, sizeof(buffer));
+            ASSERT_GT(len, 0);
+            data.append(buffer, len);
+        }
+        auto header = data.substr(0, pos);
+        data.erase(0, pos + 4);
+        EXPECT_EQ(header.find("HTTP/1.1 200"), 0);
+        EXPECT_NE(header.find("transfer-encoding: chunked"), std::string::npos);
+        EXPECT_EQ(header.find("content-length"), std::string::npos);
+
+        std::string body;
+        while (true) {
+            while ((pos = data.find("\r\n")) == std::string::npos) {
+                auto len = client.read(buffer, sizeof(buffer));
+                ASSERT_GT(len, 0);
+                data.append(buffer, len);
+            }
+            auto size = std::stoul(data.substr(0, pos), nullptr, 16);
+            data.erase(0, pos + 2);
+            while (data.size() < size + 2) {
+                auto len = client.read(buffer, sizeof(buffer));
+                ASSERT_GT(len, 0);
+                data.append(buffer, len);
+            }
+            body.append(data, 0, size);
+            data.erase(0, size + 2);
+            if (size == 0) {
+                break;
+            }
+        }
+        EXPECT_EQ(body, expected);
+    }
+    client.close();
+}
+
+TEST_F(TestHttpServerV3, Pipelining) {
+    // Inline, asynchronous and requests with a body, all sent in one write
+    std::string requests;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 10; ++i) {
+        auto name = "client" + std::to_string(i);
+        if (i % 3 == 0) {
+            requests += "GET /async_info?name=" + name + " HTTP/1.1\r\nconnection: keep-alive\r\n\r\n";
+            expected.emplace_back(name);
+        } else if (i % 3 == 1) {
+            requests += "GET /get_info?name=" + name + " HTTP/1.1\r\nconnection: keep-alive\r\n\r\n";
+            expected.emplace_back("");
+        } else {
+            auto body = R"({"name": ")" + name + R"(", "pwd": "0x7c00"})";
+            requests += "POST /login HTTP/1.1\r\nconnection: keep-alive\r\ncontent-length: " + std::to_string(body.length()) + "\r\n\r\n" + body;
+            expected.emplace_back("OK");
+        }
+    }
+
+    auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    ASSERT_EQ(client.connect(sese::net::IPv4Address::localhost(port)), 0);
+    ASSERT_EQ(client.write(requests.data(), requests.length()), requests.length());
+
+    std::string data;
+    char buffer[4096];
+    for (int i = 0; i < 10; ++i) {
+        size_t pos;
+        while ((pos = data.find("\r\n\r\n")) == std::string::npos) {
+            auto len = client.read(buffer, sizeof(buffer));
+            ASSERT_GT(len, 0);
+            data.append(buffer, len);
+        }
+        auto header = data.substr(0, pos);
+        data.erase(0, pos + 4);
+        EXPECT_EQ(header.find("HTTP/1.1 200"), 0) << header;
+        if (i % 3 == 1) {
+            EXPECT_NE(header.find("name: client" + std::to_string(i)), std::string::npos) << header;
+        }
+        auto content_length = header.find("content-length: ");
+        ASSERT_NE(content_length, std::string::npos);
+        auto size = std::stoul(header.substr(content_length + 16));
+        while (data.size() < size) {
+            auto len = client.read(buffer, sizeof(buffer));
+            ASSERT_GT(len, 0);
+            data.append(buffer, len);
+        }
+        EXPECT_EQ(data.substr(0, size), expected[i]);
+        data.erase(0, size);
+    }
+    client.close();
+}
+
 TEST_F(TestHttpServerV3, Range) {
     range(true, ssl_port);
     range(false, port);
 }
 
+TEST_F(TestHttpServerV3, MultiThread) {
+    std::vector<std::thread> clients;
+    for (int i = 0; i < 4; ++i) {
+        clients.emplace_back([i] {
+            keepalive(i % 2 == 0, i % 2 == 0 ? ssl_port : port);
+        });
+    }
+    for (auto &&client: clients) {
+        client.join();
+    }
+}
@@ -62,4 +62,120 @@ TEST(TestTimer, Launcher) {
     th1.join();
     th2.join();
     SESE_INFO("all task done");
-}
\ No newline at end of file
+}
+
+/// Time wheel driven by a manual clock
+class ManualTimeWheel final : public sese::TimeWheel {
+public:
+    explicit ManualTimeWheel(int64_t now) : now(now) { lastCheckTime = now; }
+
+    void advance(int64_t seconds) {
+        now += seconds;
+        check();
+    }
+
+protected:
+    int64_t getTimestamp() const override { return now; }
+
+private:
+    int64_t now;
+};
+
+TEST(TestTimer, TimeWheelHierarchy) {
+    ManualTimeWheel wheel(1000);
+    std::vector<std::string> fired;
+    wheel.delay([&] { fired.emplace_back("short"); }, 3);
+    wheel.delay([&] { fired.emplace_back("minute"); }, 60);
+    wheel.delay([&] { fired.emplace_back("long"); }, 150);
+    wheel.delay([&] { fired.emplace_back("hours"); }, 3 * 3600 + 7);
+    auto cancelled = wheel.delay([&] { fired.emplace_back("cancelled"); }, 90);
+    auto refreshed = wheel.delay([&] { fired.emplace_back("refreshed"); }, 5);
+    int repeated = 0;
+    auto repeat = wheel.delay([&] { repeated += 1; }, 10, true);
+
+    wheel.advance(2);
+    EXPECT_TRUE(fired.empty());
+    wheel.refresh(refreshed, 100);
+    wheel.advance(1);
+    ASSERT_EQ(fired.size(), 1);
+    EXPECT_EQ(fired[0], "short");
+
+    wheel.cancel(cancelled);
+    wheel.advance(57);
+    ASSERT_EQ(fired.size(), 2);
+    EXPECT_EQ(fired[1], "minute");
+    EXPECT_EQ(repeated, 6);
+
+    wheel.advance(41);
+    EXPECT_EQ(fired.size(), 2);
+    wheel.advance(1);
+    ASSERT_EQ(fired.size(), 3);
+    EXPECT_EQ(fired[2], "refreshed");
+
+    wheel.cancel(repeat);
+    wheel.advance(47);
+    EXPECT_EQ(fired.size(), 3);
+    wheel.advance(1);
+    ASSERT_EQ(fired.size(), 4);
+    EXPECT_EQ(fired[3], "long");
+
+    wheel.advance(3 * 3600 + 6 - 150);
+    EXPECT_EQ(fired.size(), 4);
+    wheel.advance(1);
+    ASSERT_EQ(fired.size(), 5);
+    EXPECT_EQ(fired[4], "hours");
+    EXPECT_EQ(repeated, 10);
+}
+
+TEST(TestTimer, TimeWheelCancelInCallback) {
+    ManualTimeWheel wheel(59);
+    int count = 0;
+    sese::TimeoutEvent *event = nullptr;
+    event = wheel.delay([&] {
+        count += 1;
+        wheel.cancel(event);
+    }, 1, true);
+    sese::TimeoutEvent *again = nullptr;
+    again = wheel.delay([&] {
+        count += 10;
+        wheel.refresh(again, 60);
+    }, 1);
+    wheel.advance(1);
+    EXPECT_EQ(count, 11);
+    wheel.advance(59);
+    EXPECT_EQ(count, 11);
+    wheel.advance(1);
+    EXPECT_EQ(count, 21);
+    wheel.cancel(again);
+}
+
+TEST(TestTimer, TimeWheelSuspend) {
+    ManualTimeWheel wheel(1000);
+    int count = 0;
+    auto event = wheel.delay([&] { count += 1; }, 5);
+    wheel.advance(3);
+    wheel.suspend(event);
+    wheel.advance(120);
+    EXPECT_EQ(count, 0);
+
+    wheel.refresh(event, 2);
+    wheel.advance(1);
+    EXPECT_EQ(count, 0);
+    wheel.advance(1);
+    EXPECT_EQ(count, 1);
+
+    int kept = 0;
+    sese::TimeoutEvent *self = nullptr;
+    self = wheel.delay([&] {
+        kept += 1;
+        wheel.suspend(self);
+    }, 1);
+    wheel.advance(1);
+    EXPECT_EQ(kept, 1);
+    wheel.refresh(self, 70);
+    wheel.advance(69);
+    EXPECT_EQ(kept, 1);
+    wheel.advance(1);
+    EXPECT_EQ(kept, 2);
+    wheel.cancel(self);
+}
@@ -13,8 +13,14 @@
 // limitations under the License.
 
 #include <sese/log/Marco.h>
+#include <sese/net/Socket.h>
 #include <sese/net/ws/WebsocketAuthenticator.h>
+#include <sese/net/ws/WebsocketFrame.h>
+#include <sese/service/http/HttpServer.h>
 
+#include <algorithm>
+#include <map>
+#include <mutex>
 #include <random>
 
 #include <gtest/gtest.h>
@@ -28,4 +34,303 @@ TEST(TestWebsocket, Auth_0) {
 TEST(TestWebsocket, Auth_1) {
     auto pair = sese::net::ws::WebsocketAuthenticator::generateKeyPair();
     EXPECT_TRUE(sese::net::ws::WebsocketAuthenticator::verify(pair.first.get(), pair.second.get()));
-}
\ No newline at end of file
+}
+using sese::net::ws::FrameHeader;
+using sese::net::ws::Opcode;
+using sese::net::ws::WebsocketFrame;
+
+/// Serialize a masked frame, as sent by a client
+static std::string makeClientFrame(Opcode opcode, const std::string &payload, bool fin = true) {
+    FrameHeader header;
+    header.fin = fin;
+    header.opcode = opcode;
+    header.masked = true;
+    header.payload_length = payload.length();
+    uint8_t key[4] = {0x12, 0x34, 0x56, 0x78};
+    memcpy(header.mask_key, key, 4);
+    char buffer[WebsocketFrame::MAX_HEADER_SIZE];
+    auto size = WebsocketFrame::serialize(header, buffer);
+    auto frame = std::string(buffer, size) + payload;
+    WebsocketFrame::unmask(frame.data() + size, payload.length(), key);
+    return frame;
+}
+
+TEST(TestWebsocket, Frame_header) {
+    for (uint64_t length: {0ull, 125ull, 126ull, 65535ull, 65536ull, 1ull << 40}) {
+        FrameHeader header;
+        header.fin = false;
+        header.opcode = Opcode::BINARY;
+        header.masked = true;
+        header.mask_key[0] = 0xAB;
+        header.mask_key[3] = 0xCD;
+        header.payload_length = length;
+        uint8_t buffer[WebsocketFrame::MAX_HEADER_SIZE];
+        auto size = WebsocketFrame::serialize(header, buffer);
+        EXPECT_EQ(size, (length < 126 ? 2 : length <= 0xFFFF ? 4 : 10) + 4);
+
+        // Incomplete headers need more data
+        FrameHeader decoded;
+        for (size_t i = 0; i < size; ++i) {
+            EXPECT_EQ(WebsocketFrame::parse(buffer, i, decoded), 0);
+        }
+        ASSERT_EQ(WebsocketFrame::parse(buffer, size, decoded), static_cast<int64_t>(size));
+        EXPECT_FALSE(decoded.fin);
+        EXPECT_EQ(decoded.opcode, Opcode::BINARY);
+        EXPECT_TRUE(decoded.masked);
+        EXPECT_EQ(decoded.payload_length, length);
+        EXPECT_EQ(memcmp(decoded.mask_key, header.mask_key, 4), 0);
+    }
+
+    FrameHeader decoded;
+    // Reserved opcode
+    const uint8_t reserved[] = {0x83, 0x00};
+    EXPECT_EQ(WebsocketFrame::parse(reserved, sizeof(reserved), decoded), -1);
+    // Fragmented control frame
+    const uint8_t fragmented_ping[] = {0x09, 0x00};
+    EXPECT_EQ(WebsocketFrame::parse(fragmented_ping, sizeof(fragmented_ping), decoded), -1);
+    // Control frame with a long payload
+    const uint8_t long_close[] = {0x88, 0x7E, 0x00, 0x80};
+    EXPECT_EQ(WebsocketFrame::parse(long_close, sizeof(long_close), decoded), -1);
+    // Length not encoded in the fewest bytes
+    const uint8_t not_minimal[] = {0x82, 0x7E, 0x00, 0x10};
+    EXPECT_EQ(WebsocketFrame::parse(not_minimal, sizeof(not_minimal), decoded), -1);
+
+    auto close = WebsocketFrame::makeClose(1001, "bye");
+    ASSERT_EQ(close->length(), 7);
+    EXPECT_EQ(static_cast<uint8_t>((*close)[0]), 0x88);
+    EXPECT_EQ(close->substr(2), std::string("\x03\xE9" "bye", 5));
+}
+
+TEST(TestWebsocket, Frame_unmask) {
+    const uint8_t key[4] = {0x01, 0x80, 0xFF, 0x5A};
+    std::string data(300, '\0');
+    for (size_t i = 0; i < data.length(); ++i) {
+        data[i] = static_cast<char>(i * 7);
+    }
+    std::string expected = data;
+    for (size_t i = 0; i < expected.length(); ++i) {
+        expected[i] = static_cast<char>(expected[i] ^ key[i % 4]);
+    }
+
+    // Every length through the vector, word and byte paths
+    for (size_t length = 0; length <= data.length(); ++length) {
+        auto copy = data.substr(0, length);
+        WebsocketFrame::unmask(copy.data(), length, key);
+        ASSERT_EQ(copy, expected.substr(0, length)) << length;
+    }
+
+    // Unmasked in parts as the payload is received
+    for (size_t split = 0; split < 40; ++split) {
+        auto copy = data;
+        WebsocketFrame::unmask(copy.data(), split, key);
+        WebsocketFrame::unmask(copy.data() + split, copy.length() - split, key, split);
+        ASSERT_EQ(copy, expected) << split;
+    }
+}
+
+class TestWebsocketServer : public testing::Test {
+public:
+    static uint16_t port;
+    static std::unique_ptr<sese::service::http::HttpServer> server;
+    static std::mutex mutex;
+    static std::vector<sese::service::http::WebsocketSession::Ptr> sessions;
+    static std::map<sese::service::http::WebsocketSession *, std::string> messages;
+
+    static void SetUpTestSuite() {
+        using sese::service::http::WebsocketSession;
+
+        std::random_device device;
+        port = static_cast<uint16_t>(device() % 20000 + 30000);
+        server = std::make_unique<sese::service::http::HttpServer>();
+
+        sese::service::http::WebsocketHandler echo;
+        // The parts of each message are collected before it is echoed
+        echo.on_message = [](const WebsocketSession::Ptr &session, Opcode opcode, const char *data, size_t length, bool last) {
+            std::unique_lock lock(mutex);
+            auto &&message = messages[session.get()];
+            message.append(data, length);
+            if (last) {
+                auto frame = WebsocketFrame::make(opcode, message.data(), message.length());
+                messages.erase(session.get());
+                lock.unlock();
+                session->send(frame);
+            }
+        };
+        echo.on_close = [](const WebsocketSession::Ptr &session, uint16_t) {
+            std::lock_guard lock(mutex);
+            messages.erase(session.get());
+        };
+        server->regWebsocket("/echo", echo);
+
+        sese::service::http::WebsocketHandler chat;
+        chat.on_open = [](const WebsocketSession::Ptr &session) {
+            std::lock_guard lock(mutex);
+            sessions.emplace_back(session);
+            session->sendText("hello " + session->getPathArgs().at(0).second);
+        };
+        chat.on_message = [](const WebsocketSession::Ptr &, Opcode opcode, const char *data, size_t length, bool) {
+            std::vector<WebsocketSession::Ptr> receivers;
+            {
+                std::lock_guard lock(mutex);
+                receivers = sessions;
+            }
+            WebsocketSession::broadcast(receivers, opcode, data, length);
+        };
+        chat.on_close = [](const WebsocketSession::Ptr &session, uint16_t) {
+            std::lock_guard lock(mutex);
+            sessions.erase(std::remove(sessions.begin(), sessions.end(), session), sessions.end());
+        };
+        server->regWebsocket("/chat/{name}", chat);
+
+        server->setThreads(2);
+        server->regService(sese::net::IPv4Address::localhost(port), nullptr);
+        ASSERT_TRUE(server->startup());
+    }
+
+    static void TearDownTestSuite() {
+        server->shutdown();
+        server = nullptr;
+        sessions.clear();
+    }
+
+    /// Connect and complete the opening handshake
+    static bool handshake(sese::net::Socket &client, const std::string &uri) {
+        if (client.connect(sese::net::IPv4Address::localhost(port)) != 0) {
+            return false;
+        }
+        auto pair = sese::net::ws::WebsocketAuthenticator::generateKeyPair();
+        auto request = "GET " + uri + " HTTP/1.1\r\n"
+                       "host: localhost\r\n"
+                       "connection: keep-alive, Upgrade\r\n"
+                       "upgrade: websocket\r\n"
+                       "sec-websocket-version: 13\r\n"
+                       "sec-websocket-key: " + std::string(pair.first.get()) + "\r\n\r\n";
+        client.write(request.data(), request.length());
+        std::string response;
+        char ch;
+        while (response.find("\r\n\r\n") == std::string::npos && client.read(&ch, 1) == 1) {
+            response += ch;
+        }
+        return response.find("HTTP/1.1 101") == 0 &&
+               response.find("sec-websocket-accept: " + std::string(pair.second.get())) != std::string::npos;
+    }
+
+    /// Read one unmasked frame
+    static bool readFrame(sese::net::Socket &client, FrameHeader &header, std::string &payload) {
+        std::string data;
+        char buffer[1024];
+        int64_t size;
+        while ((size = WebsocketFrame::parse(data.data(), data.length(), header)) == 0) {
+            auto length = client.read(buffer, 1);
+            if (length <= 0) {
+                return false;
+            }
+            data.append(buffer, length);
+        }
+        if (size < 0 || header.masked) {
+            return false;
+        }
+        payload.resize(header.payload_length);
+        for (size_t read = 0; read < payload.length();) {
+            auto length = client.read(payload.data() + read, payload.length() - read);
+            if (length <= 0) {
+                return false;
+            }
+            read += length;
+        }
+        return true;
+    }
+};
+
+uint16_t TestWebsocketServer::port = 0;
+std::unique_ptr<sese::service::http::HttpServer> TestWebsocketServer::server;
+std::mutex TestWebsocketServer::mutex;
+std::vector<sese::service::http::WebsocketSession::Ptr> TestWebsocketServer::sessions;
+std::map<sese::service::http::WebsocketSession *, std::string> TestWebsocketServer::messages;
+
+TEST_F(TestWebsocketServer, Echo) {
+    auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    ASSERT_TRUE(handshake(client, "/echo"));
+
+    // A fragmented message with a ping in between, followed by a large frame, all in one write
+    std::string large(200000, 'x');
+    auto frames = makeClientFrame(Opcode::TEXT, "Hello, ", false) +
+                  makeClientFrame(Opcode::PING, "ping") +
+                  makeClientFrame(Opcode::CONTINUATION, "World") +
+                  makeClientFrame(Opcode::BINARY, large);
+    ASSERT_EQ(client.write(frames.data(), frames.length()), frames.length());
+
+    FrameHeader header;
+    std::string payload;
+    ASSERT_TRUE(readFrame(client, header, payload));
+    EXPECT_EQ(header.opcode, Opcode::PONG);
+    EXPECT_EQ(payload, "ping");
+    ASSERT_TRUE(readFrame(client, header, payload));
+    EXPECT_EQ(header.opcode, Opcode::TEXT);
+    EXPECT_EQ(payload, "Hello, World");
+    ASSERT_TRUE(readFrame(client, header, payload));
+    EXPECT_EQ(header.opcode, Opcode::BINARY);
+    EXPECT_EQ(payload, large);
+
+    // The server echoes the close frame and closes the connection
+    auto close = makeClientFrame(Opcode::CLOSE, std::string("\x03\xE8", 2));
+    client.write(close.data(), close.length());
+    ASSERT_TRUE(readFrame(client, header, payload));
+    EXPECT_EQ(header.opcode, Opcode::CLOSE);
+    EXPECT_EQ(payload, std::string("\x03\xE8", 2));
+    char ch;
+    EXPECT_LE(client.read(&ch, 1), 0);
+    client.close();
+}
+
+TEST_F(TestWebsocketServer, ProtocolError) {
+    auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    ASSERT_TRUE(handshake(client, "/echo"));
+
+    // A continuation frame without a message
+    auto frame = makeClientFrame(Opcode::CONTINUATION, "orphan");
+    client.write(frame.data(), frame.length());
+    FrameHeader header;
+    std::string payload;
+    ASSERT_TRUE(readFrame(client, header, payload));
+    EXPECT_EQ(header.opcode, Opcode::CLOSE);
+    EXPECT_EQ(payload, std::string("\x03\xEA", 2));
+    client.close();
+}
+
+TEST_F(TestWebsocketServer, NotUpgraded) {
+    auto client = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    ASSERT_EQ(client.connect(sese::net::IPv4Address::localhost(port)), 0);
+    std::string request = "GET /echo HTTP/1.1\r\nhost: localhost\r\n\r\n";
+    client.write(request.data(), request.length());
+    char buffer[1024];
+    auto length = client.read(buffer, sizeof(buffer));
+    ASSERT_GT(length, 0);
+    auto response = std::string(buffer, length);
+    EXPECT_EQ(response.find("HTTP/1.1 426"), 0) << response;
+    EXPECT_NE(response.find("sec-websocket-version: 13"), std::string::npos) << response;
+    client.close();
+}
+
+TEST_F(TestWebsocketServer, Broadcast) {
+    auto alice = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    auto bob = sese::net::Socket(sese::net::Socket::Family::IPv4, sese::net::Socket::Type::TCP, IPPROTO_IP);
+    FrameHeader header;
+    std::string payload;
+    ASSERT_TRUE(handshake(alice, "/chat/alice"));
+    ASSERT_TRUE(readFrame(alice, header, payload));
+    EXPECT_EQ(payload, "hello alice");
+    ASSERT_TRUE(handshake(bob, "/chat/bob"));
+    ASSERT_TRUE(readFrame(bob, header, payload));
+    EXPECT_EQ(payload, "hello bob");
+
+    auto frame = makeClientFrame(Opcode::TEXT, "news");
+    alice.write(frame.data(), frame.length());
+    for (auto client: {&alice, &bob}) {
+        ASSERT_TRUE(readFrame(*client, header, payload));
+        EXPECT_EQ(header.opcode, Opcode::TEXT);
+        EXPECT_EQ(payload, "news");
+    }
+    alice.close();
+    bob.close();
+}
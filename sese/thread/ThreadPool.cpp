@@ -22,6 +22,11 @@ ThreadPool::ThreadPool(std::string thread_pool_name, size_t threads)
     : name(std::move(thread_pool_name)),
       threads(std::max<size_t>(2, threads)),
       data(std::make_shared<RuntimeData>()) {
+    auto registry = MetricsRegistry::getInstance();
+    MetricsRegistry::Labels labels{{"pool", name}};
+    data->completed = &registry->counter("sese_thread_pool_completed_tasks_total", "Tasks executed by the thread pool", labels);
+    data->queued = &registry->gauge("sese_thread_pool_queued_tasks", "Tasks waiting for a thread", labels);
+    data->busy = &registry->gauge("sese_thread_pool_busy_threads", "Threads executing a task", labels);
 
     auto proc = [data = data] {
         while (true) {
@@ -35,9 +40,13 @@ ThreadPool::ThreadPool(std::string thread_pool_name, size_t threads)
                 auto task = std::move(data->tasks.front());
                 data->tasks.pop();
                 locker.unlock();
+                data->queued->sub();
                 if (task != nullptr) {
+                    data->busy->add();
                     task();
+                    data->busy->sub();
                 }
+                data->completed->inc();
             }
         }
     };
@@ -59,6 +68,7 @@ void ThreadPool::postTask(const std::function<void()> &task) {
     {
         Locker locker(data->mutex);
         data->tasks.emplace(task);
+        data->queued->add();
     }
     data->conditionVariable.notify_one();
 }
@@ -69,6 +79,7 @@ void ThreadPool::postTask(const std::vector<std::function<void()>> &tasks) {
         for (const auto &task: tasks) {
             data->tasks.emplace(task);
         }
+        data->queued->add(static_cast<int64_t>(tasks.size()));
     }
     data->conditionVariable.notify_all();
 }
@@ -82,6 +93,13 @@ void ThreadPool::shutdown() {
         delete pthread; // GCOVR_EXCL_LINE
         // }
     }
+    // The tasks left in the queue are never executed
+    std::queue<std::function<void()>> remaining;
+    {
+        Locker locker(data->mutex);
+        data->queued->sub(static_cast<int64_t>(data->tasks.size()));
+        remaining.swap(data->tasks);
+    }
 }
 
 size_t ThreadPool::size() noexcept {
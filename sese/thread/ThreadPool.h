@@ -24,6 +24,7 @@
 #include "sese/Config.h"
 #include "sese/util/Noncopyable.h"
 #include "sese/thread/Thread.h"
+#include "sese/util/Metrics.h"
 
 #include <atomic>
 #include <condition_variable>
@@ -108,6 +109,10 @@ private:
         std::condition_variable conditionVariable;
         std::queue<std::function<void()>> tasks;
         std::atomic<bool> isShutdown{false};
+        /// Shared by the pools of the same name
+        Counter *completed = nullptr;
+        Gauge *queued = nullptr;
+        Gauge *busy = nullptr;
     };
     std::shared_ptr<RuntimeData> data;
 };
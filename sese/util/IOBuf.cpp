@@ -41,11 +41,15 @@ void sese::IOBuf::push(Node node) {
     // }
     // total += node->size;
     total += node->size;
-    if (list.empty()) {
+    auto empty = list.empty();
+    if (spare.empty()) {
         list.push_back(std::move(node));
-        cur = list.begin();
     } else {
-        list.push_back(std::move(node));
+        list.splice(list.end(), spare, spare.begin());
+        list.back() = std::move(node);
+    }
+    if (empty) {
+        cur = list.begin();
     }
 }
 
@@ -64,6 +68,22 @@ void sese::IOBuf::clear() {
     readed = 0;
 }
 
+sese::IOBuf::Node sese::IOBuf::reclaim() {
+    Node node;
+    if (!list.empty()) {
+        node = std::move(list.front());
+        node->read = 0;
+        node->size = 0;
+    }
+    for (auto &&item: list) {
+        item = nullptr;
+    }
+    spare.splice(spare.end(), list);
+    total = 0;
+    readed = 0;
+    return node;
+}
+
 size_t sese::IOBuf::getReadableSize() const noexcept {
     return total - readed;
 }
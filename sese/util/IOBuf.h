@@ -75,6 +75,11 @@ public:
     /// Release all nodes
     void clear();
 
+    /// Release all nodes except the first one, which is handed back emptied for reuse.
+    /// The list entries are kept, so pushing as many nodes again does not allocate
+    /// \return The first node, nullptr if there is none
+    Node reclaim();
+
     /// Get the current readable size
     [[nodiscard]] size_t getReadableSize() const noexcept;
 
@@ -100,6 +105,8 @@ public:
 
 private:
     ListType list;
+    /// Empty list entries kept by reclaim
+    ListType spare;
     ListType::iterator cur;
 
     size_t total{0};
@@ -0,0 +1,218 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/util/Metrics.h>
+
+#include <algorithm>
+#include <cstdio>
+
+using sese::Counter;
+using sese::Histogram;
+using sese::MetricsRegistry;
+
+size_t sese::getMetricsShard() noexcept {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) & (METRICS_SHARDS - 1);
+    return shard;
+}
+
+uint64_t Counter::value() const noexcept {
+    uint64_t result = 0;
+    for (auto &&shard: shards) {
+        result += shard.value.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+Histogram::Histogram(double scale) noexcept : scale(scale), shards(std::make_unique<Shard[]>(SHARDS)) {
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot result;
+    result.buckets.resize(BUCKETS);
+    for (size_t i = 0; i < SHARDS; ++i) {
+        auto &&shard = shards[i];
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            auto count = shard.buckets[bucket].load(std::memory_order_relaxed);
+            result.buckets[bucket] += count;
+            result.count += count;
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+uint64_t Histogram::getUpperBound(size_t bucket) noexcept {
+    if (bucket < (1u << SUB_BUCKET_BITS)) {
+        return bucket;
+    }
+    auto shift = static_cast<uint32_t>(bucket >> SUB_BUCKET_BITS) - 1;
+    auto lower = static_cast<uint64_t>((bucket & ((1u << SUB_BUCKET_BITS) - 1)) + (1u << SUB_BUCKET_BITS)) << shift;
+    return lower + (static_cast<uint64_t>(1) << shift) - 1;
+}
+
+uint64_t Histogram::Snapshot::quantile(double q) const noexcept {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return getUpperBound(bucket);
+        }
+    }
+    return getUpperBound(buckets.size() - 1);
+}
+
+MetricsRegistry *MetricsRegistry::getInstance() {
+    static MetricsRegistry registry;
+    return &registry;
+}
+
+MetricsRegistry::Family &MetricsRegistry::getFamily(const std::string &name, const std::string &help, Type type) {
+    auto iterator = families.find(name);
+    if (iterator == families.end()) {
+        iterator = families.emplace(name, Family{type, help, {}, {}, {}}).first;
+    }
+    return iterator->second;
+}
+
+std::string MetricsRegistry::serializeLabels(const Labels &labels) {
+    std::string result;
+    for (auto &&[name, value]: labels) {
+        if (!result.empty()) {
+            result += ',';
+        }
+        result += name;
+        result += "=\"";
+        for (auto ch: value) {
+            if (ch == '\\' || ch == '"') {
+                result += '\\';
+                result += ch;
+            } else if (ch == '\n') {
+                result += "\\n";
+            } else {
+                result += ch;
+            }
+        }
+        result += '"';
+    }
+    return result;
+}
+
+Counter &MetricsRegistry::counter(const std::string &name, const std::string &help, const Labels &labels) {
+    std::lock_guard lock(mutex);
+    auto &&metric = getFamily(name, help, Type::COUNTER).counters[serializeLabels(labels)];
+    if (!metric) {
+        metric = std::make_unique<Counter>();
+    }
+    return *metric;
+}
+
+sese::Gauge &MetricsRegistry::gauge(const std::string &name, const std::string &help, const Labels &labels) {
+    std::lock_guard lock(mutex);
+    auto &&metric = getFamily(name, help, Type::GAUGE).gauges[serializeLabels(labels)];
+    if (!metric) {
+        metric = std::make_unique<Gauge>();
+    }
+    return *metric;
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name, const std::string &help, const Labels &labels, double scale) {
+    std::lock_guard lock(mutex);
+    auto &&metric = getFamily(name, help, Type::SUMMARY).histograms[serializeLabels(labels)];
+    if (!metric) {
+        metric = std::make_unique<Histogram>(scale);
+    }
+    return *metric;
+}
+
+/// Append a sample line
+static void appendSample(std::string &output, const std::string &name, const char *suffix, const std::string &labels, const char *extra, const char *value) {
+    output += name;
+    output += suffix;
+    if (!labels.empty() || *extra) {
+        output += '{';
+        output += labels;
+        if (!labels.empty() && *extra) {
+            output += ',';
+        }
+        output += extra;
+        output += '}';
+    }
+    output += ' ';
+    output += value;
+    output += '\n';
+}
+
+void MetricsRegistry::expose(std::string &output) const {
+    constexpr std::pair<double, const char *> QUANTILES[] = {
+            {0.5, "quantile=\"0.5\""},
+            {0.9, "quantile=\"0.9\""},
+            {0.99, "quantile=\"0.99\""},
+            {0.999, "quantile=\"0.999\""},
+    };
+    char value[32];
+    std::lock_guard lock(mutex);
+    for (auto &&[name, family]: families) {
+        output += "# HELP ";
+        output += name;
+        output += ' ';
+        for (auto ch: family.help) {
+            if (ch == '\\') {
+                output += "\\\\";
+            } else if (ch == '\n') {
+                output += "\\n";
+            } else {
+                output += ch;
+            }
+        }
+        output += "\n# TYPE ";
+        output += name;
+        switch (family.type) {
+            case Type::COUNTER:
+                output += " counter\n";
+                for (auto &&[labels, metric]: family.counters) {
+                    std::snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(metric->value()));
+                    appendSample(output, name, "", labels, "", value);
+                }
+                break;
+            case Type::GAUGE:
+                output += " gauge\n";
+                for (auto &&[labels, metric]: family.gauges) {
+                    std::snprintf(value, sizeof(value), "%lld", static_cast<long long>(metric->value()));
+                    appendSample(output, name, "", labels, "", value);
+                }
+                break;
+            case Type::SUMMARY:
+                output += " summary\n";
+                for (auto &&[labels, metric]: family.histograms) {
+                    auto snapshot = metric->snapshot();
+                    auto scale = metric->getScale();
+                    for (auto &&[q, quantile]: QUANTILES) {
+                        std::snprintf(value, sizeof(value), "%.9g", static_cast<double>(snapshot.quantile(q)) * scale);
+                        appendSample(output, name, "", labels, quantile, value);
+                    }
+                    std::snprintf(value, sizeof(value), "%.9g", static_cast<double>(snapshot.sum) * scale);
+                    appendSample(output, name, "_sum", labels, "", value);
+                    std::snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(snapshot.count));
+                    appendSample(output, name, "_count", labels, "", value);
+                }
+                break;
+        }
+    }
+}
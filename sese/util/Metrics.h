@@ -0,0 +1,243 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file Metrics.h
+/// \author kaoru
+/// \date October 17, 2026
+/// \brief Counters, gauges and latency histograms exposed in the Prometheus text format
+
+#pragma once
+
+#include <sese/Config.h>
+#include <sese/util/Noncopyable.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace sese {
+
+/// Number of shards of the metrics updated concurrently, a power of two
+constexpr size_t METRICS_SHARDS = 16;
+
+/// Shard of the calling thread, threads are spread over the shards in the order they first update a metric
+/// \return Shard index
+size_t getMetricsShard() noexcept;
+
+/// Monotonically increasing counter. Each thread adds to its own shard, the shards are summed when read
+class Counter final : public Noncopyable {
+public:
+    /// Increase the counter
+    /// \param n Increment
+    void inc(uint64_t n = 1) noexcept {
+        shards[getMetricsShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// \return The sum of the shards
+    [[nodiscard]] uint64_t value() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, METRICS_SHARDS> shards{};
+};
+
+/// Value that goes up and down
+class Gauge final : public Noncopyable {
+public:
+    void set(int64_t n) noexcept { current.store(n, std::memory_order_relaxed); }
+
+    void add(int64_t n = 1) noexcept { current.fetch_add(n, std::memory_order_relaxed); }
+
+    void sub(int64_t n = 1) noexcept { current.fetch_sub(n, std::memory_order_relaxed); }
+
+    [[nodiscard]] int64_t value() const noexcept { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> current{0};
+};
+
+/// Log-linear histogram in the manner of HdrHistogram. Each power of two is split into 16 buckets,
+/// so a recorded value is known within 6.25%. Each thread records into its own shard, the shards are merged when read
+class Histogram final : public Noncopyable {
+public:
+    /// Bits of the sub-buckets of each power of two
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    /// Values from 2^MAX_VALUE_BITS are recorded as the largest value
+    static constexpr uint32_t MAX_VALUE_BITS = 36;
+    static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+    /// Histograms are larger, so they have fewer shards than the counters
+    static constexpr size_t SHARDS = 8;
+
+    /// Merged state of the shards
+    struct Snapshot {
+        std::vector<uint64_t> buckets;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        /// Estimate a quantile
+        /// \param q Quantile between 0 and 1
+        /// \return The highest value of the bucket containing the quantile, 0 if nothing was recorded
+        [[nodiscard]] uint64_t quantile(double q) const noexcept;
+    };
+
+    /// Records the elapsed microseconds when destroyed
+    class Timer final {
+    public:
+        explicit Timer(Histogram &histogram) noexcept : histogram(histogram), begin(std::chrono::steady_clock::now()) {}
+
+        ~Timer() noexcept {
+            auto elapsed = std::chrono::steady_clock::now() - begin;
+            histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        }
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+    private:
+        Histogram &histogram;
+        std::chrono::steady_clock::time_point begin;
+    };
+
+    /// \param scale Factor converting the recorded values into the exposed unit, e.g. 1e-6 for microseconds to seconds
+    explicit Histogram(double scale = 1) noexcept;
+
+    /// Record a value
+    /// \param value Value
+    void record(uint64_t value) noexcept {
+        auto &&shard = shards[getMetricsShard() & (SHARDS - 1)];
+        shard.buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /// Measure the lifetime of the returned object in microseconds
+    /// \return Timer
+    Timer time() noexcept { return Timer(*this); }
+
+    [[nodiscard]] Snapshot snapshot() const;
+
+    [[nodiscard]] double getScale() const noexcept { return scale; }
+
+    /// \param value Value
+    /// \return Index of the bucket the value is recorded in
+    static size_t getBucket(uint64_t value) noexcept {
+        constexpr uint64_t max = (static_cast<uint64_t>(1) << MAX_VALUE_BITS) - 1;
+        if (value > max) {
+            value = max;
+        }
+        if (value < (1u << SUB_BUCKET_BITS)) {
+            return static_cast<size_t>(value);
+        }
+        auto shift = static_cast<uint32_t>(63 - countLeadingZeros(value)) - SUB_BUCKET_BITS;
+        return ((shift + 1) << SUB_BUCKET_BITS) + static_cast<size_t>((value >> shift) - (1u << SUB_BUCKET_BITS));
+    }
+
+    /// \param bucket Bucket index
+    /// \return The highest value recorded in the bucket
+    static uint64_t getUpperBound(size_t bucket) noexcept;
+
+private:
+    static int countLeadingZeros(uint64_t value) noexcept {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return 63 - static_cast<int>(index);
+#else
+        return __builtin_clzll(value);
+#endif
+    }
+
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+        std::atomic<uint64_t> sum{0};
+    };
+
+    double scale;
+    std::unique_ptr<Shard[]> shards;
+};
+
+/// Registry of the metrics of the process, exposed in the Prometheus text format.
+/// Metrics are created on first use and live as long as the registry, so the references can be kept by the callers
+class MetricsRegistry final : public Noncopyable {
+public:
+    /// Label names and values
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    /// \return The registry shared by the process
+    static MetricsRegistry *getInstance();
+
+    /// Get or create a counter
+    /// \note Thread safe. A name must not be used by metrics of different types, such metrics are not exposed
+    /// \param name Metric name
+    /// \param help Description
+    /// \param labels Labels, in the order they are exposed
+    /// \return Counter
+    Counter &counter(const std::string &name, const std::string &help, const Labels &labels = {});
+
+    /// Get or create a gauge
+    /// \note Thread safe
+    /// \param name Metric name
+    /// \param help Description
+    /// \param labels Labels, in the order they are exposed
+    /// \return Gauge
+    Gauge &gauge(const std::string &name, const std::string &help, const Labels &labels = {});
+
+    /// Get or create a histogram, exposed as a summary with the 0.5, 0.9, 0.99 and 0.999 quantiles
+    /// \note Thread safe
+    /// \param name Metric name
+    /// \param help Description
+    /// \param labels Labels, in the order they are exposed
+    /// \param scale Factor converting the recorded values into the exposed unit
+    /// \return Histogram
+    Histogram &histogram(const std::string &name, const std::string &help, const Labels &labels = {}, double scale = 1);
+
+    /// Serialize every metric in the Prometheus text format 0.0.4
+    /// \param output The text is appended to it
+    void expose(std::string &output) const;
+
+private:
+    enum class Type {
+        COUNTER,
+        GAUGE,
+        SUMMARY
+    };
+
+    struct Family {
+        Type type;
+        std::string help;
+        /// Keyed by the serialized labels
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+    };
+
+    Family &getFamily(const std::string &name, const std::string &help, Type type);
+
+    static std::string serializeLabels(const Labels &labels);
+
+    mutable std::mutex mutex;
+    std::map<std::string, Family> families;
+};
+
+} // namespace sese
@@ -152,3 +152,25 @@ std::string sese::PercentConverter::decode(const char *src) {
     }
     return builder.toString();
 }
+
+bool sese::PercentConverter::decode(std::string_view src, std::string &dest) {
+    dest.clear();
+    auto pos = src.find('%');
+    dest.append(src.data(), std::min(pos, src.length()));
+    while (pos < src.length()) {
+        if (src[pos] == '%') {
+            auto ch1 = pos + 1 < src.length() ? getHexChar(src[pos + 1]) : static_cast<char>(-1);
+            auto ch2 = pos + 2 < src.length() ? getHexChar(src[pos + 2]) : static_cast<char>(-1);
+            if (ch1 == static_cast<char>(-1) || ch2 == static_cast<char>(-1)) {
+                dest.clear();
+                return false;
+            }
+            dest.push_back(static_cast<char>(ch1 * 0x10 + ch2));
+            pos += 3;
+        } else {
+            dest.push_back(src[pos]);
+            pos += 1;
+        }
+    }
+    return true;
+}
@@ -25,6 +25,7 @@
 #include "sese/util/NotInstantiable.h"
 
 #include <set>
+#include <string_view>
 
 #ifdef _WIN32
 #pragma warning(disable : 4624)
@@ -56,6 +57,12 @@ public:
     /// \retval {} Decoding failed
     static std::string decode(const char *src);
 
+    /// Decode string into an existing string, reusing its storage
+    /// \param src String to be decoded
+    /// \param dest Replaced with the result, empty if decoding failed
+    /// \return Whether decoding succeeded
+    static bool decode(std::string_view src, std::string &dest);
+
 private:
     static const std::set<char> URL_EXCLUDE_CHARS;
 };
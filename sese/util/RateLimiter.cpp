@@ -0,0 +1,90 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sese/util/RateLimiter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+using sese::RateLimiter;
+
+RateLimiter::RateLimiter(double rate, uint32_t burst, size_t capacity)
+    // Both are kept far enough from the limits of int64_t for the arithmetic on the arrival times
+    : interval(std::max<int64_t>(1, std::llround(rate > 1e-9 ? 1e9 / rate : 1e18))),
+      limit(std::llround(std::min(static_cast<double>(interval) * std::max<uint32_t>(burst, 1), 1e18))),
+      epoch(std::chrono::steady_clock::now()) {
+    size_t size = PROBES;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    slots = std::make_unique<Slot[]>(size);
+}
+
+bool RateLimiter::tryAcquire(std::string_view key, uint64_t *retry_after) noexcept {
+    return tryAcquire(static_cast<uint64_t>(std::hash<std::string_view>{}(key)), retry_after);
+}
+
+bool RateLimiter::tryAcquire(uint64_t hash, uint64_t *retry_after) noexcept {
+    // 0 marks the unused slots
+    hash = hash ? hash : 1;
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    auto &&slot = getSlot(hash, now);
+    auto tat = slot.tat.load(std::memory_order_relaxed);
+    while (true) {
+        auto next = std::max(tat, now) + interval;
+        if (next - now > limit) {
+            if (retry_after) {
+                *retry_after = static_cast<uint64_t>(next - now - limit + 999) / 1000;
+            }
+            return false;
+        }
+        if (slot.tat.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+RateLimiter::Slot &RateLimiter::getSlot(uint64_t hash, int64_t now) noexcept {
+    // The low bits are also mixed into the home slot, std::hash may be the identity
+    auto home = static_cast<size_t>((hash * 0x9e3779b97f4a7c15ull) >> 32);
+    while (true) {
+        Slot *victim = nullptr;
+        uint64_t victim_key = 0;
+        int64_t victim_tat = INT64_MAX;
+        for (size_t i = 0; i < PROBES; ++i) {
+            auto &&slot = slots[(home + i) & mask];
+            auto key = slot.key.load(std::memory_order_relaxed);
+            if (key == hash) {
+                return slot;
+            }
+            auto tat = key ? slot.tat.load(std::memory_order_relaxed) : INT64_MIN;
+            if (tat < victim_tat) {
+                victim = &slot;
+                victim_key = key;
+                victim_tat = tat;
+            }
+        }
+        // Prefer an unused slot, then a full bucket, then the bucket closest to being full
+        if (victim->key.compare_exchange_strong(victim_key, hash, std::memory_order_relaxed)) {
+            if (victim_tat > now) {
+                // The previous key was still limited, the new one starts with a full bucket
+                victim->tat.compare_exchange_strong(victim_tat, 0, std::memory_order_relaxed);
+            }
+            return *victim;
+        }
+        // Taken over by another key in the meantime
+    }
+}
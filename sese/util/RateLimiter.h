@@ -0,0 +1,83 @@
+// Copyright 2024 libsese
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/// \file RateLimiter.h
+/// \author kaoru
+/// \date October 17, 2026
+/// \brief Token buckets of many keys kept in a lock-free table
+
+#pragma once
+
+#include <sese/Config.h>
+#include <sese/util/Noncopyable.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string_view>
+
+namespace sese {
+
+/// Token buckets of many keys, such as client addresses, kept in a fixed-size table.
+/// Each bucket is a single atomic theoretical arrival time (GCRA) refilled lazily when it is used,
+/// so taking a token is a compare-and-swap and never blocks.
+/// A key whose bucket is full again takes no space, its slot is reused by the next key that needs one
+class RateLimiter final : public Noncopyable {
+public:
+    /// \param rate Tokens added to each bucket per second
+    /// \param burst Capacity of each bucket, minimum value is 1
+    /// \param capacity Number of keys tracked at once, rounded up to a power of two
+    RateLimiter(double rate, uint32_t burst, size_t capacity = 65536);
+
+    /// Take a token from the bucket of a key
+    /// \param key Key
+    /// \param retry_after Set to the microseconds until a token is available when none is left
+    /// \return Whether a token was taken
+    bool tryAcquire(std::string_view key, uint64_t *retry_after = nullptr) noexcept;
+
+    /// Take a token from the bucket of a hashed key, distinct keys sharing a hash share their bucket
+    /// \param hash Hash of the key
+    /// \param retry_after Set to the microseconds until a token is available when none is left
+    /// \return Whether a token was taken
+    bool tryAcquire(uint64_t hash, uint64_t *retry_after = nullptr) noexcept;
+
+    [[nodiscard]] size_t getCapacity() const noexcept { return mask + 1; }
+
+private:
+    struct Slot {
+        /// Hash of the key, 0 if the slot has never been used
+        std::atomic<uint64_t> key{0};
+        /// Time the bucket is full again in nanoseconds since the epoch, a past time means it is full
+        std::atomic<int64_t> tat{0};
+    };
+
+    /// Slots examined from the home slot of a key, the least used of them is taken over when the key is missing
+    static constexpr size_t PROBES = 8;
+
+    /// Nanoseconds to refill a token
+    int64_t interval;
+    /// Nanoseconds to refill the whole bucket
+    int64_t limit;
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    std::chrono::steady_clock::time_point epoch;
+
+    /// Find the slot of a key, taking one over if the key is missing
+    /// \param hash Hash of the key, not 0
+    /// \param now Current time since the epoch
+    /// \return Slot
+    Slot &getSlot(uint64_t hash, int64_t now) noexcept;
+};
+
+} // namespace sese
@@ -13,85 +13,141 @@
 // limitations under the License.
 
 #include <sese/util/TimeWheel.h>
-#include <sese/util/Range.h>
 
-#include <algorithm>
 #include <chrono>
 
 using namespace sese;
 
 TimeWheel::TimeWheel() {
-    TimeoutEventSlot *pre_address = nullptr;
-    Range<int> range(0, 59);
-    std::for_each(range.rbegin(), range.rend(), [&](const int &number) {
-        this->slots[number].next = pre_address;
-        pre_address = &this->slots[number];
-    });
-    this->slots[59].next = &this->slots[0];
-    startTime = lastCheckTime = getTimestamp();
+    lastCheckTime = TimeWheel::getTimestamp();
 }
 
 TimeWheel::~TimeWheel() {
-    for (TimeoutEventSlot &slot: slots) {
-        for (TimeoutEvent *event: slot.events) {
-            delete event; // GCOVR_EXCL_LINE
+    for (auto *slots: {seconds, minutes}) {
+        for (int i = 0; i < 60; ++i) {
+            for (TimeoutEvent *event: slots[i].events) {
+                delete event; // GCOVR_EXCL_LINE
+            }
+            slots[i].events.clear();
         }
-        slot.events.clear();
     }
+    for (TimeoutEvent *event: suspended.events) {
+        delete event; // GCOVR_EXCL_LINE
+    }
+}
+
+int64_t TimeWheel::getTimestamp() const {
+    auto point = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::seconds>(point.time_since_epoch()).count();
+}
+
+void TimeWheel::place(TimeoutEvent *event) {
+    TimeoutEventSlot *slot;
+    if (event->target <= lastCheckTime) {
+        // Already due, triggered by the next check
+        slot = &seconds[(lastCheckTime + 1) % 60];
+    } else if (event->target - lastCheckTime <= 60) {
+        // The slots of the next 60 seconds are all distinct
+        slot = &seconds[event->target % 60];
+    } else {
+        // Events more than 60 seconds away wait in the slot of their minute and are placed again when it comes,
+        // those more than an hour away go around the wheel
+        slot = &minutes[event->target / 60 % 60];
+    }
+    moveTo(event, slot);
 }
 
-int64_t TimeWheel::getTimestamp() {
-    auto point = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::time_point_cast<std::chrono::seconds>(point);
-    return timestamp.time_since_epoch().count();
+void TimeWheel::moveTo(TimeoutEvent *event, TimeoutEventSlot *slot) {
+    if (event->slot) {
+        // Splicing keeps the list entry and the iterator of the event valid
+        slot->events.splice(slot->events.end(), event->slot->events, event->position);
+    } else {
+        event->position = slot->events.insert(slot->events.end(), event);
+    }
+    event->slot = slot;
+}
+
+void TimeWheel::remove(TimeoutEvent *event) {
+    event->slot->events.erase(event->position);
+    event->slot = nullptr;
+}
+
+void TimeWheel::cascade(TimeoutEventSlot &slot) {
+    TimeoutEventSlot pending;
+    pending.events.splice(pending.events.end(), slot.events);
+    for (TimeoutEvent *event: pending.events) {
+        event->slot = &pending;
+    }
+    while (!pending.events.empty()) {
+        place(pending.events.front());
+    }
 }
 
 TimeoutEvent *TimeWheel::delay(const TimeoutEvent::Callback &callback, int64_t seconds, bool repeat) {
-    auto current = getTimestamp();
     auto event = new TimeoutEvent;
     event->range = seconds;
     event->repeat = repeat;
     event->callback = callback;
-    event->target = current + seconds;
-
-    auto index = (event->target - startTime) % 60;
-    slots[index].events.emplace_back(event);
-
+    event->target = getTimestamp() + seconds;
+    place(event);
     return event;
 }
 
 void TimeWheel::cancel(TimeoutEvent *event) {
-    auto index = (event->target - startTime) % 60;
-    slots[index].events.remove(event);
+    if (event->slot == nullptr) {
+        // The callback is running, the event is destroyed once it returns
+        event->repeat = false;
+        return;
+    }
+    remove(event);
     delete event; // GCOVR_EXCL_LINE
 }
 
+void TimeWheel::refresh(TimeoutEvent *event, int64_t seconds) {
+    event->range = seconds;
+    event->target = getTimestamp() + seconds;
+    place(event);
+}
+
+void TimeWheel::suspend(TimeoutEvent *event) {
+    // Also called from the callback of the event, which then keeps it like a refresh
+    moveTo(event, &suspended);
+}
+
 void TimeWheel::check() {
     auto current = getTimestamp();
-    auto number_of_slots = current - lastCheckTime;
-    number_of_slots = std::min<int64_t>(number_of_slots, 60);
-
-    auto index = (lastCheckTime - startTime) % 60;
-    auto p_slot = &slots[index];
-    for (int i = 0; i < number_of_slots; ++i) {
-        for (auto iterator = p_slot->events.begin(); iterator != p_slot->events.end();) {
-#define EVENT (*iterator)
-            if (EVENT->target > current) {
-                iterator++;
+    while (lastCheckTime < current) {
+        auto now = lastCheckTime + 1;
+        if (now % 60 == 0) {
+            // Placed before the current second is processed, so the events of this minute land in the slots of one second
+            cascade(minutes[now / 60 % 60]);
+        }
+        lastCheckTime = now;
+
+        // Callbacks may add events to the current slot, they wait for its next turn
+        TimeoutEventSlot due;
+        due.events.splice(due.events.end(), seconds[now % 60].events);
+        for (TimeoutEvent *event: due.events) {
+            event->slot = &due;
+        }
+        while (!due.events.empty()) {
+            TimeoutEvent *event = due.events.front();
+            if (event->target > now) {
+                place(event);
+                continue;
+            }
+            remove(event);
+            event->callback();
+            if (event->slot) {
+                // Refreshed by its own callback
+                continue;
+            }
+            if (event->repeat) {
+                event->target = now + event->range;
+                place(event);
             } else {
-                EVENT->callback();
-                if (EVENT->repeat) {
-                    EVENT->target = getTimestamp() + EVENT->range;
-                    auto new_index = (EVENT->target - startTime) % 60;
-                    slots[new_index].events.emplace_back(EVENT);
-                } else {
-                    delete EVENT; // GCOVR_EXCL_LINE
-                }
-                p_slot->events.erase(iterator++);
+                delete event; // GCOVR_EXCL_LINE
             }
-#undef EVENT
         }
-        p_slot = p_slot->next;
     }
-    lastCheckTime = current;
 }
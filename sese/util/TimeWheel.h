@@ -14,9 +14,9 @@
 
 /**
  * @file TimeWheel.h
- * @brief Low-Precision Time Wheel Algorithm
+ * @brief Low-Precision Hierarchical Time Wheel Algorithm
  * @author kaoru
- * @version 0.2
+ * @version 0.3
  * @date September 15, 2023
  */
 
@@ -29,6 +29,8 @@
 
 namespace sese {
 
+struct TimeoutEventSlot;
+
 /**
  * @brief Timeout Event
  */
@@ -44,6 +46,10 @@ struct TimeoutEvent {
     bool repeat{false};
     /// Callback function when the timeout event occurs
     Callback callback{};
+    /// Slot holding the event, nullptr while its callback is running
+    TimeoutEventSlot *slot{nullptr};
+    /// Position of the event in the slot, used to remove it in constant time
+    std::list<TimeoutEvent *>::iterator position{};
 };
 
 /**
@@ -52,12 +58,13 @@ struct TimeoutEvent {
 struct TimeoutEventSlot {
     /// List of timeout events stored here
     std::list<TimeoutEvent *> events{};
-    /// Pointer to the next timeout event slot
-    TimeoutEventSlot *next{nullptr};
 };
 
 /**
  * @brief Time Wheel
+ * @details Events due within a minute are kept in slots of one second, later ones in slots of one minute
+ * and moved down when their minute comes. Adding, cancelling and refreshing an event take constant time.
+ * The wheel is not thread-safe and is meant to be driven by a single loop
  */
 class TimeWheel {
 public:
@@ -76,19 +83,49 @@ public:
             bool repeat = false
     );
 
-    /// Cancel a timeout event, making it unavailable
+    /// Cancel a timeout event, making it unavailable.
+    /// Cancelling an event from its own callback stops it from repeating
     /// \param event Timeout event
     void cancel(TimeoutEvent *event);
 
+    /// Postpone a timeout event so that it occurs after the duration counted from now
+    /// \param event Timeout event
+    /// \param seconds Timeout duration
+    void refresh(TimeoutEvent *event, int64_t seconds);
+
+    /// Stop a timeout event from occurring until it is refreshed, keeping it for reuse.
+    /// Unlike cancel followed by delay, this does not allocate
+    /// \param event Timeout event
+    void suspend(TimeoutEvent *event);
+
     /// Check for any timeout events that need to be triggered, and trigger the corresponding callback functions and destroy the events as needed
     void check();
 
 protected:
-    static int64_t getTimestamp();
+    /// Current time in seconds from a monotonic clock
+    virtual int64_t getTimestamp() const;
 
-    int64_t startTime{};
+    /// Put the event into the slot matching its target, moving it out of its current slot if any
+    void place(TimeoutEvent *event);
+
+    /// Move the event to the end of the slot, reusing its list entry if it already has one
+    static void moveTo(TimeoutEvent *event, TimeoutEventSlot *slot);
+
+    /// Move the events of the slot to the slots matching their targets
+    void cascade(TimeoutEventSlot &slot);
+
+    /// Take the event out of its slot
+    static void remove(TimeoutEvent *event);
+
+    /// Time up to which the slots have been processed
     int64_t lastCheckTime{};
-    TimeoutEventSlot slots[60]{};
+    /// Slots of one second
+    TimeoutEventSlot seconds[60]{};
+    /// Slots of one minute
+    TimeoutEventSlot minutes[60]{};
+
+    /// Events kept by suspend
+    TimeoutEventSlot suspended{};
 };
 
 } // namespace sese